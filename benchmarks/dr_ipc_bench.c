@@ -0,0 +1,592 @@
+// Throughput and latency benchmarks for drpipe. Public Domain. See "unlicense" statement at the end of dr_ipc.h.
+//
+// This is a standalone program. Build it with something like the following:
+//   cc -O2 -o dr_ipc_bench benchmarks/dr_ipc_bench.c -lpthread
+//
+// Then run it with:
+//   ./dr_ipc_bench [--mode thread|fork|all] [--transport anonymous|named|all] [--cpu-a N] [--cpu-b N]
+//                  [--iterations N] [--stream-bytes N] [--wait block|spin|busy] [--label TEXT]
+//
+// Three benchmarks are run for each combination of transport and mode:
+//   pingpong    The round-trip time of a message bounced between two ends, reported as percentiles.
+//   stream      One-way throughput with the reader calling drpipe_read() for whatever is available.
+//   read_exact  The same as stream, but the reader calls drpipe_read_exact() for each message. Comparing the two shows
+//               the overhead of drpipe_read_exact().
+//
+// The two ends run on separate threads with "--mode thread" and in separate processes with "--mode fork". "--cpu-a" and
+// "--cpu-b" pin each end to a CPU, which is only supported on Linux. "--wait" sets the wait policy of the reading side of
+// each end with drpipe_set_wait_policy(). Busy polling is only sensible when each end is pinned to its own CPU.
+//
+// Results are written to stdout as JSON lines, one object per measurement, so they can be collected and compared between
+// commits. Use "--label" to tag every line with something like a commit hash. Progress is written to stderr.
+//
+// This is currently only supported on *nix platforms.
+#define DR_IPC_IMPLEMENTATION
+#include "../dr_ipc.h"     // Defines _GNU_SOURCE which is needed for sched_setaffinity().
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+
+#define BENCH_MODE_THREAD       0x01
+#define BENCH_MODE_FORK         0x02
+
+#define BENCH_TRANSPORT_ANONYMOUS   0x01
+#define BENCH_TRANSPORT_NAMED       0x02
+
+#define BENCH_PINGPONG_WARMUP   1000
+
+static const size_t g_PingPongSizes[] = {8, 64, 512, 4096, 65536};
+static const size_t g_StreamSizes[]   = {8, 64, 512, 4096, 65536, 1048576, 4194304};
+
+typedef enum
+{
+    bench_kind_pingpong,
+    bench_kind_stream,
+    bench_kind_read_exact
+} bench_kind;
+
+typedef struct
+{
+    unsigned int modes;
+    unsigned int transports;
+    int cpuA;
+    int cpuB;
+    size_t iterations;
+    size_t streamBytes;
+    dripc_wait_mode waitMode;
+    const char* label;
+} bench_options;
+
+// The pipes used by one end of a benchmark. Messages are sent to the other end on toPeer and received on fromPeer.
+typedef struct
+{
+    drpipe toPeer;
+    drpipe fromPeer;
+} bench_endpoint;
+
+typedef struct
+{
+    const bench_options* pOptions;
+    unsigned int transport;
+    bench_kind kind;
+    size_t messageSize;
+    size_t messageCount;
+    bench_endpoint endpointB;
+    int result;
+} bench_peer_args;
+
+
+static uint64_t bench_get_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_pin_to_cpu(int cpu)
+{
+    if (cpu < 0) {
+        return;
+    }
+
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {   // 0 is the calling thread.
+        fprintf(stderr, "warning: failed to pin to CPU %d\n", cpu);
+    }
+#else
+    fprintf(stderr, "warning: CPU pinning is not supported on this platform\n");
+#endif
+}
+
+static const char* bench_transport_name(unsigned int transport)
+{
+    return (transport == BENCH_TRANSPORT_NAMED) ? "named" : "anonymous";
+}
+
+static const char* bench_mode_name(unsigned int mode)
+{
+    return (mode == BENCH_MODE_FORK) ? "fork" : "thread";
+}
+
+static const char* bench_wait_mode_name(dripc_wait_mode waitMode)
+{
+    switch (waitMode)
+    {
+    case dripc_wait_mode_spin_then_block: return "spin";
+    case dripc_wait_mode_busy_poll:       return "busy";
+    default:                              return "block";
+    }
+}
+
+static const char* bench_kind_name(bench_kind kind)
+{
+    switch (kind)
+    {
+    case bench_kind_pingpong:   return "pingpong";
+    case bench_kind_stream:     return "stream";
+    case bench_kind_read_exact: return "read_exact";
+    default:                    return "unknown";
+    }
+}
+
+static int bench_write_all(drpipe pipe, const void* pData, size_t size)
+{
+    while (size > 0) {
+        size_t bytesWritten;
+        if (drpipe_write(pipe, pData, size, &bytesWritten) != dripc_result_success) {
+            return 0;
+        }
+
+        pData = (const char*)pData + bytesWritten;
+        size -= bytesWritten;
+    }
+
+    return 1;
+}
+
+
+// Opening the named pipes of each end. Named pipes only go one way so two are needed. The server side of each is opened
+// by end A and the client side by end B. They are opened in the same order on both sides so neither end waits on a pipe
+// the other hasn't got to yet.
+static int bench_open_named_a(bench_endpoint* pEndpoint)
+{
+    if (drpipe_open_named_server("dr_ipc_bench_ab", DR_IPC_WRITE, &pEndpoint->toPeer) != dripc_result_success) {
+        return 0;
+    }
+
+    if (drpipe_open_named_server("dr_ipc_bench_ba", DR_IPC_READ, &pEndpoint->fromPeer) != dripc_result_success) {
+        drpipe_close(pEndpoint->toPeer);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int bench_open_named_b(bench_endpoint* pEndpoint)
+{
+    // The server may not have created the pipes yet.
+    drpipe_config config = drpipe_config_init(DR_IPC_READ);
+    config.timeoutInMilliseconds = 10000;
+    if (drpipe_open_named_client_with_config("dr_ipc_bench_ab", &config, &pEndpoint->fromPeer) != dripc_result_success) {
+        return 0;
+    }
+
+    config = drpipe_config_init(DR_IPC_WRITE);
+    config.timeoutInMilliseconds = 10000;
+    if (drpipe_open_named_client_with_config("dr_ipc_bench_ba", &config, &pEndpoint->toPeer) != dripc_result_success) {
+        drpipe_close(pEndpoint->fromPeer);
+        return 0;
+    }
+
+    return 1;
+}
+
+// A run that was killed part way through leaves its pipes behind which would stop the next run from creating them.
+static void bench_remove_stale_named_pipes(void)
+{
+    const char* names[2] = {"dr_ipc_bench_ab", "dr_ipc_bench_ba"};
+
+    size_t iName;
+    for (iName = 0; iName < 2; ++iName) {
+        char nameUnix[512];
+        if (drpipe_get_translated_name(names[iName], nameUnix, sizeof(nameUnix)) > 0) {
+            unlink(nameUnix);
+        }
+    }
+}
+
+static int bench_set_wait_policy(const bench_options* pOptions, bench_endpoint* pEndpoint)
+{
+    drpipe_wait_policy policy = drpipe_wait_policy_init(pOptions->waitMode);
+    return drpipe_set_wait_policy(pEndpoint->fromPeer, &policy) == dripc_result_success;
+}
+
+static void bench_close_endpoint(bench_endpoint* pEndpoint)
+{
+    drpipe_close(pEndpoint->toPeer);
+    drpipe_close(pEndpoint->fromPeer);
+}
+
+
+// End B. This echoes messages back for ping-pong and is the writer for the streaming benchmarks.
+static int bench_run_b(bench_peer_args* pArgs)
+{
+    bench_pin_to_cpu(pArgs->pOptions->cpuB);
+
+    if (pArgs->transport == BENCH_TRANSPORT_NAMED) {
+        if (!bench_open_named_b(&pArgs->endpointB)) {
+            return 0;
+        }
+    }
+
+    bench_endpoint* pEndpoint = &pArgs->endpointB;
+    int result = 0;
+
+    void* pMessage = calloc(1, pArgs->messageSize);
+    if (pMessage == NULL) {
+        goto done;
+    }
+
+    if (!bench_set_wait_policy(pArgs->pOptions, pEndpoint)) {
+        goto done;
+    }
+
+    if (pArgs->kind == bench_kind_pingpong) {
+        size_t iMessage;
+        for (iMessage = 0; iMessage < pArgs->messageCount; ++iMessage) {
+            if (drpipe_read_exact(pEndpoint->fromPeer, pMessage, pArgs->messageSize, NULL) != dripc_result_success) {
+                goto done;
+            }
+            if (!bench_write_all(pEndpoint->toPeer, pMessage, pArgs->messageSize)) {
+                goto done;
+            }
+        }
+    } else {
+        // Wait for the reader to start the clock.
+        char go;
+        if (drpipe_read_exact(pEndpoint->fromPeer, &go, 1, NULL) != dripc_result_success) {
+            goto done;
+        }
+
+        size_t iMessage;
+        for (iMessage = 0; iMessage < pArgs->messageCount; ++iMessage) {
+            if (!bench_write_all(pEndpoint->toPeer, pMessage, pArgs->messageSize)) {
+                goto done;
+            }
+        }
+    }
+
+    result = 1;
+
+done:
+    free(pMessage);
+    bench_close_endpoint(pEndpoint);
+    return result;
+}
+
+static void* bench_run_b_thread(void* pUserData)
+{
+    bench_peer_args* pArgs = (bench_peer_args*)pUserData;
+    pArgs->result = bench_run_b(pArgs);
+    return NULL;
+}
+
+
+static int bench_compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+static uint64_t bench_percentile(const uint64_t* pSorted, size_t count, double percentile)
+{
+    return pSorted[(size_t)(percentile * (double)(count - 1))];
+}
+
+static void bench_print_header(const bench_options* pOptions, bench_kind kind, unsigned int transport, unsigned int mode, size_t messageSize, size_t messageCount)
+{
+    printf("{\"benchmark\":\"%s\",\"transport\":\"%s\",\"mode\":\"%s\",\"message_size\":%zu,\"messages\":%zu,\"cpu_a\":%d,\"cpu_b\":%d,\"wait\":\"%s\"",
+        bench_kind_name(kind), bench_transport_name(transport), bench_mode_name(mode), messageSize, messageCount, pOptions->cpuA, pOptions->cpuB, bench_wait_mode_name(pOptions->waitMode));
+
+    if (pOptions->label != NULL) {
+        printf(",\"label\":\"%s\"", pOptions->label);
+    }
+}
+
+// End A. This does the timing.
+static int bench_run_a(const bench_options* pOptions, bench_endpoint* pEndpoint, bench_kind kind, unsigned int transport, unsigned int mode, size_t messageSize, size_t messageCount)
+{
+    int result = 0;
+    uint64_t* pSamples = NULL;
+
+    void* pMessage = calloc(1, messageSize);
+    if (pMessage == NULL) {
+        return 0;
+    }
+
+    if (!bench_set_wait_policy(pOptions, pEndpoint)) {
+        goto done;
+    }
+
+    if (kind == bench_kind_pingpong) {
+        size_t sampleCount = messageCount - BENCH_PINGPONG_WARMUP;
+        pSamples = (uint64_t*)malloc(sampleCount * sizeof(*pSamples));
+        if (pSamples == NULL) {
+            goto done;
+        }
+
+        size_t iMessage;
+        for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+            uint64_t startTime = bench_get_time_ns();
+            if (!bench_write_all(pEndpoint->toPeer, pMessage, messageSize)) {
+                goto done;
+            }
+            if (drpipe_read_exact(pEndpoint->fromPeer, pMessage, messageSize, NULL) != dripc_result_success) {
+                goto done;
+            }
+
+            if (iMessage >= BENCH_PINGPONG_WARMUP) {
+                pSamples[iMessage - BENCH_PINGPONG_WARMUP] = bench_get_time_ns() - startTime;
+            }
+        }
+
+        qsort(pSamples, sampleCount, sizeof(*pSamples), bench_compare_u64);
+
+        uint64_t total = 0;
+        size_t iSample;
+        for (iSample = 0; iSample < sampleCount; ++iSample) {
+            total += pSamples[iSample];
+        }
+
+        bench_print_header(pOptions, kind, transport, mode, messageSize, sampleCount);
+        printf(",\"min_ns\":%llu,\"mean_ns\":%llu,\"p50_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu}\n",
+            (unsigned long long)pSamples[0],
+            (unsigned long long)(total / sampleCount),
+            (unsigned long long)bench_percentile(pSamples, sampleCount, 0.50),
+            (unsigned long long)bench_percentile(pSamples, sampleCount, 0.99),
+            (unsigned long long)bench_percentile(pSamples, sampleCount, 0.999),
+            (unsigned long long)pSamples[sampleCount - 1]);
+    } else {
+        size_t totalBytes = messageSize * messageCount;
+
+        uint64_t startTime = bench_get_time_ns();
+        if (!bench_write_all(pEndpoint->toPeer, "g", 1)) {
+            goto done;
+        }
+
+        if (kind == bench_kind_read_exact) {
+            size_t iMessage;
+            for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+                if (drpipe_read_exact(pEndpoint->fromPeer, pMessage, messageSize, NULL) != dripc_result_success) {
+                    goto done;
+                }
+            }
+        } else {
+            size_t bytesRemaining = totalBytes;
+            while (bytesRemaining > 0) {
+                size_t bytesRead;
+                if (drpipe_read(pEndpoint->fromPeer, pMessage, (bytesRemaining < messageSize) ? bytesRemaining : messageSize, &bytesRead) != dripc_result_success || bytesRead == 0) {
+                    goto done;
+                }
+
+                bytesRemaining -= bytesRead;
+            }
+        }
+
+        uint64_t elapsed = bench_get_time_ns() - startTime;
+        double seconds = (double)elapsed / 1e9;
+
+        bench_print_header(pOptions, kind, transport, mode, messageSize, messageCount);
+        printf(",\"bytes\":%zu,\"elapsed_ns\":%llu,\"ns_per_message\":%.1f,\"mib_per_sec\":%.1f}\n",
+            totalBytes,
+            (unsigned long long)elapsed,
+            (double)elapsed / (double)messageCount,
+            ((double)totalBytes / (1024.0*1024.0)) / seconds);
+    }
+
+    fflush(stdout);
+    result = 1;
+
+done:
+    free(pSamples);
+    free(pMessage);
+    return result;
+}
+
+
+// Runs a single benchmark. End A always runs on the calling thread and end B on a new thread or process.
+static int bench_run(const bench_options* pOptions, bench_kind kind, unsigned int transport, unsigned int mode, size_t messageSize, size_t messageCount)
+{
+    bench_peer_args args;
+    memset(&args, 0, sizeof(args));
+    args.pOptions     = pOptions;
+    args.transport    = transport;
+    args.kind         = kind;
+    args.messageSize  = messageSize;
+    args.messageCount = messageCount;
+
+    bench_endpoint endpointA;
+    if (transport == BENCH_TRANSPORT_ANONYMOUS) {
+        if (drpipe_open_anonymous(&args.endpointB.fromPeer, &endpointA.toPeer) != dripc_result_success) {
+            return 0;
+        }
+        if (drpipe_open_anonymous(&endpointA.fromPeer, &args.endpointB.toPeer) != dripc_result_success) {
+            drpipe_close(args.endpointB.fromPeer);
+            drpipe_close(endpointA.toPeer);
+            return 0;
+        }
+    }
+
+    pthread_t thread;
+    pid_t pid = -1;
+    if (mode == BENCH_MODE_FORK) {
+        fflush(stdout);
+        pid = fork();
+        if (pid == -1) {
+            return 0;
+        }
+        if (pid == 0) {
+            if (transport == BENCH_TRANSPORT_ANONYMOUS) {
+                bench_close_endpoint(&endpointA);
+            }
+            _exit(bench_run_b(&args) ? 0 : 1);
+        }
+
+        if (transport == BENCH_TRANSPORT_ANONYMOUS) {
+            bench_close_endpoint(&args.endpointB);
+        }
+    } else {
+        if (pthread_create(&thread, NULL, bench_run_b_thread, &args) != 0) {
+            return 0;
+        }
+    }
+
+    bench_pin_to_cpu(pOptions->cpuA);
+
+    int result = 1;
+    if (transport == BENCH_TRANSPORT_NAMED) {
+        result = bench_open_named_a(&endpointA);
+    }
+
+    if (result) {
+        result = bench_run_a(pOptions, &endpointA, kind, transport, mode, messageSize, messageCount);
+        bench_close_endpoint(&endpointA);
+    }
+
+    if (mode == BENCH_MODE_FORK) {
+        int status;
+        waitpid(pid, &status, 0);
+        result = result && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    } else {
+        pthread_join(thread, NULL);
+        result = result && args.result;
+    }
+
+    return result;
+}
+
+static int bench_run_all(const bench_options* pOptions, unsigned int transport, unsigned int mode)
+{
+    size_t iSize;
+    for (iSize = 0; iSize < sizeof(g_PingPongSizes)/sizeof(g_PingPongSizes[0]); ++iSize) {
+        fprintf(stderr, "%s %s pingpong %zu\n", bench_transport_name(transport), bench_mode_name(mode), g_PingPongSizes[iSize]);
+        if (!bench_run(pOptions, bench_kind_pingpong, transport, mode, g_PingPongSizes[iSize], pOptions->iterations + BENCH_PINGPONG_WARMUP)) {
+            return 0;
+        }
+    }
+
+    bench_kind streamKinds[2] = {bench_kind_stream, bench_kind_read_exact};
+    size_t iKind;
+    for (iKind = 0; iKind < 2; ++iKind) {
+        for (iSize = 0; iSize < sizeof(g_StreamSizes)/sizeof(g_StreamSizes[0]); ++iSize) {
+            // Small messages are capped so they don't take forever, large ones always send a few.
+            size_t messageCount = pOptions->streamBytes / g_StreamSizes[iSize];
+            if (messageCount > 1048576) {
+                messageCount = 1048576;
+            }
+            if (messageCount < 16) {
+                messageCount = 16;
+            }
+
+            fprintf(stderr, "%s %s %s %zu\n", bench_transport_name(transport), bench_mode_name(mode), bench_kind_name(streamKinds[iKind]), g_StreamSizes[iSize]);
+            if (!bench_run(pOptions, streamKinds[iKind], transport, mode, g_StreamSizes[iSize], messageCount)) {
+                return 0;
+            }
+        }
+    }
+
+    return 1;
+}
+
+
+static void bench_print_usage(const char* program)
+{
+    fprintf(stderr, "usage: %s [--mode thread|fork|all] [--transport anonymous|named|all] [--cpu-a N] [--cpu-b N]\n", program);
+    fprintf(stderr, "       [--iterations N] [--stream-bytes N] [--wait block|spin|busy] [--label TEXT]\n");
+}
+
+int main(int argc, char** argv)
+{
+    bench_options options;
+    options.modes       = BENCH_MODE_THREAD | BENCH_MODE_FORK;
+    options.transports  = BENCH_TRANSPORT_ANONYMOUS | BENCH_TRANSPORT_NAMED;
+    options.cpuA        = -1;
+    options.cpuB        = -1;
+    options.iterations  = 100000;
+    options.streamBytes = 64*1024*1024;
+    options.waitMode    = dripc_wait_mode_block;
+    options.label       = NULL;
+
+    int iArg;
+    for (iArg = 1; iArg < argc; ++iArg) {
+        const char* value = (iArg+1 < argc) ? argv[iArg+1] : NULL;
+        if (value == NULL) {
+            bench_print_usage(argv[0]);
+            return 1;
+        }
+
+        if (strcmp(argv[iArg], "--mode") == 0) {
+            options.modes = (strcmp(value, "thread") == 0) ? BENCH_MODE_THREAD : (strcmp(value, "fork") == 0) ? BENCH_MODE_FORK : (BENCH_MODE_THREAD | BENCH_MODE_FORK);
+        } else if (strcmp(argv[iArg], "--transport") == 0) {
+            options.transports = (strcmp(value, "anonymous") == 0) ? BENCH_TRANSPORT_ANONYMOUS : (strcmp(value, "named") == 0) ? BENCH_TRANSPORT_NAMED : (BENCH_TRANSPORT_ANONYMOUS | BENCH_TRANSPORT_NAMED);
+        } else if (strcmp(argv[iArg], "--cpu-a") == 0) {
+            options.cpuA = atoi(value);
+        } else if (strcmp(argv[iArg], "--cpu-b") == 0) {
+            options.cpuB = atoi(value);
+        } else if (strcmp(argv[iArg], "--iterations") == 0) {
+            options.iterations = (size_t)strtoull(value, NULL, 10);
+        } else if (strcmp(argv[iArg], "--stream-bytes") == 0) {
+            options.streamBytes = (size_t)strtoull(value, NULL, 10);
+        } else if (strcmp(argv[iArg], "--wait") == 0) {
+            options.waitMode = (strcmp(value, "spin") == 0) ? dripc_wait_mode_spin_then_block : (strcmp(value, "busy") == 0) ? dripc_wait_mode_busy_poll : dripc_wait_mode_block;
+        } else if (strcmp(argv[iArg], "--label") == 0) {
+            options.label = value;
+        } else {
+            bench_print_usage(argv[0]);
+            return 1;
+        }
+
+        iArg += 1;
+    }
+
+    if (options.iterations == 0) {
+        options.iterations = 1;
+    }
+
+    // A benchmark that fails half way shouldn't take the whole process down with it.
+    signal(SIGPIPE, SIG_IGN);
+
+    if (options.transports & BENCH_TRANSPORT_NAMED) {
+        bench_remove_stale_named_pipes();
+    }
+
+    unsigned int transports[2] = {BENCH_TRANSPORT_ANONYMOUS, BENCH_TRANSPORT_NAMED};
+    unsigned int modes[2] = {BENCH_MODE_THREAD, BENCH_MODE_FORK};
+
+    size_t iTransport;
+    for (iTransport = 0; iTransport < 2; ++iTransport) {
+        if ((options.transports & transports[iTransport]) == 0) {
+            continue;
+        }
+
+        size_t iMode;
+        for (iMode = 0; iMode < 2; ++iMode) {
+            if ((options.modes & modes[iMode]) == 0) {
+                continue;
+            }
+
+            if (!bench_run_all(&options, transports[iTransport], modes[iMode])) {
+                fprintf(stderr, "%s %s benchmark failed\n", bench_transport_name(transports[iTransport]), bench_mode_name(modes[iMode]));
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,397 @@
+// Replays traffic captured with drpipe_start_capture() through a pipe. Public Domain. See "unlicense" statement at the
+// end of dr_ipc.h.
+//
+// This is a standalone program. Build it with something like the following:
+//   cc -O2 -o dr_ipc_replay benchmarks/dr_ipc_replay.c -lpthread
+//
+// Then run it with:
+//   ./dr_ipc_replay CAPTURE_FILE [--speed original|max] [--kind write|read] [--wait block|spin|busy] [--label TEXT]
+//
+// Every record of the chosen kind is written to an anonymous pipe in the order it was captured, with the same sizes and
+// contents, and a second thread reads each one back out. "--kind write" replays what the captured pipe sent and
+// "--kind read" what it received. "--speed original" waits until each record's original time before writing it, so
+// bursts and gaps are reproduced as they happened. "--speed max" writes everything as fast as the pipe takes it.
+// "--wait" sets the wait policy of the reading end with drpipe_set_wait_policy().
+//
+// The latency of each record is the time from just before it was written to when the last of it was read. Results are
+// written to stdout as a JSON line in the same style as dr_ipc_bench. Use "--label" to tag it with something like a
+// commit hash.
+//
+// This is currently only supported on *nix platforms.
+#define DR_IPC_IMPLEMENTATION
+#include "../dr_ipc.h"
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+
+typedef struct
+{
+    int isOriginalSpeed;
+    unsigned int kind;
+    dripc_wait_mode waitMode;
+    const char* label;
+} replay_options;
+
+// One record picked out of the capture. pData points into the loaded file.
+typedef struct
+{
+    unsigned long long timeInNanoseconds;
+    const unsigned char* pData;
+    size_t sizeInBytes;
+} replay_record;
+
+typedef struct
+{
+    drpipe pipe;
+    const replay_record* pRecords;
+    size_t recordCount;
+    size_t largestRecordSize;
+    uint64_t* pReceiveTimes;
+    int result;
+} replay_reader_args;
+
+static uint64_t replay_get_time_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+// Sleeps until shortly before the target time and spins the rest of the way, since sleeping alone overshoots by tens
+// of microseconds.
+static void replay_wait_until(uint64_t targetTime)
+{
+    for (;;) {
+        uint64_t now = replay_get_time_ns();
+        if (now >= targetTime) {
+            return;
+        }
+
+        if (targetTime - now > 200000) {
+            struct timespec ts;
+            ts.tv_sec  = (time_t)((targetTime - now - 100000) / 1000000000);
+            ts.tv_nsec = (long)((targetTime - now - 100000) % 1000000000);
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+
+static const char* replay_wait_mode_name(dripc_wait_mode waitMode)
+{
+    switch (waitMode)
+    {
+    case dripc_wait_mode_spin_then_block: return "spin";
+    case dripc_wait_mode_busy_poll:       return "busy";
+    default:                              return "block";
+    }
+}
+
+static int replay_write_all(drpipe pipe, const void* pData, size_t size)
+{
+    while (size > 0) {
+        size_t bytesWritten;
+        if (drpipe_write(pipe, pData, size, &bytesWritten) != dripc_result_success) {
+            return 0;
+        }
+
+        pData = (const char*)pData + bytesWritten;
+        size -= bytesWritten;
+    }
+
+    return 1;
+}
+
+// Loads a capture file and checks that its header and records hold together. Returns the contents, which need to be
+// freed, or NULL on error.
+static unsigned char* replay_load_capture(const char* path, size_t* pDataSize)
+{
+    FILE* pFile = fopen(path, "rb");
+    if (pFile == NULL) {
+        fprintf(stderr, "failed to open %s\n", path);
+        return NULL;
+    }
+
+    drpipe_capture_header header;
+    if (fread(&header, sizeof(header), 1, pFile) != 1 || header.magic != DR_IPC_CAPTURE_MAGIC || header.version != DR_IPC_CAPTURE_VERSION) {
+        fprintf(stderr, "%s is not a capture file\n", path);
+        fclose(pFile);
+        return NULL;
+    }
+
+    if (header.recordsDropped > 0) {
+        fprintf(stderr, "warning: %llu records were dropped when the capture file filled up\n", header.recordsDropped);
+    }
+
+    unsigned char* pData = (unsigned char*)malloc((size_t)header.dataSize + 1);  // +1 so an empty capture isn't a NULL.
+    if (pData == NULL || fread(pData, 1, (size_t)header.dataSize, pFile) != (size_t)header.dataSize) {
+        fprintf(stderr, "%s is truncated\n", path);
+        free(pData);
+        fclose(pFile);
+        return NULL;
+    }
+
+    fclose(pFile);
+
+    *pDataSize = (size_t)header.dataSize;
+    return pData;
+}
+
+// Picks out the records of the given kind. Returns the number found, or (size_t)-1 if the capture is corrupt.
+static size_t replay_parse_records(const unsigned char* pData, size_t dataSize, unsigned int kind, replay_record* pRecords)
+{
+    size_t recordCount = 0;
+    size_t offset = 0;
+    while (offset < dataSize) {
+        drpipe_capture_record record;
+        if (dataSize - offset < sizeof(record)) {
+            return (size_t)-1;
+        }
+
+        memcpy(&record, pData + offset, sizeof(record));
+
+        size_t recordSize = (sizeof(record) + (size_t)record.sizeInBytes + 7) & ~(size_t)7;
+        if (recordSize > dataSize - offset) {
+            return (size_t)-1;
+        }
+
+        if (record.kind == kind) {
+            if (pRecords != NULL) {
+                pRecords[recordCount].timeInNanoseconds = record.timeInNanoseconds;
+                pRecords[recordCount].pData             = pData + offset + sizeof(record);
+                pRecords[recordCount].sizeInBytes       = record.sizeInBytes;
+            }
+            recordCount += 1;
+        }
+
+        offset += recordSize;
+    }
+
+    return recordCount;
+}
+
+static void* replay_reader_thread(void* pUserData)
+{
+    replay_reader_args* pArgs = (replay_reader_args*)pUserData;
+    pArgs->result = 0;
+
+    void* pBuffer = malloc(pArgs->largestRecordSize + 1);
+    if (pBuffer == NULL) {
+        return NULL;
+    }
+
+    size_t iRecord;
+    for (iRecord = 0; iRecord < pArgs->recordCount; ++iRecord) {
+        if (drpipe_read_exact(pArgs->pipe, pBuffer, pArgs->pRecords[iRecord].sizeInBytes, NULL) != dripc_result_success) {
+            free(pBuffer);
+            return NULL;
+        }
+
+        pArgs->pReceiveTimes[iRecord] = replay_get_time_ns();
+    }
+
+    free(pBuffer);
+    pArgs->result = 1;
+    return NULL;
+}
+
+static int replay_compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a;
+    uint64_t y = *(const uint64_t*)b;
+    return (x < y) ? -1 : (x > y);
+}
+
+static uint64_t replay_percentile(const uint64_t* pSorted, size_t count, double percentile)
+{
+    return pSorted[(size_t)(percentile * (double)(count - 1))];
+}
+
+static int replay_run(const replay_options* pOptions, const replay_record* pRecords, size_t recordCount)
+{
+    int result = 0;
+    drpipe pipeRead  = NULL;
+    drpipe pipeWrite = NULL;
+
+    uint64_t* pSendTimes    = (uint64_t*)malloc(recordCount * sizeof(uint64_t));
+    uint64_t* pReceiveTimes = (uint64_t*)malloc(recordCount * sizeof(uint64_t));
+    if (pSendTimes == NULL || pReceiveTimes == NULL) {
+        goto done;
+    }
+
+    if (drpipe_open_anonymous(&pipeRead, &pipeWrite) != dripc_result_success) {
+        goto done;
+    }
+
+    drpipe_wait_policy policy = drpipe_wait_policy_init(pOptions->waitMode);
+    if (drpipe_set_wait_policy(pipeRead, &policy) != dripc_result_success) {
+        goto done;
+    }
+
+    replay_reader_args readerArgs;
+    readerArgs.pipe              = pipeRead;
+    readerArgs.pRecords          = pRecords;
+    readerArgs.recordCount       = recordCount;
+    readerArgs.largestRecordSize = 0;
+    readerArgs.pReceiveTimes     = pReceiveTimes;
+    readerArgs.result            = 0;
+
+    size_t totalBytes = 0;
+    size_t iRecord;
+    for (iRecord = 0; iRecord < recordCount; ++iRecord) {
+        if (pRecords[iRecord].sizeInBytes > readerArgs.largestRecordSize) {
+            readerArgs.largestRecordSize = pRecords[iRecord].sizeInBytes;
+        }
+        totalBytes += pRecords[iRecord].sizeInBytes;
+    }
+
+    pthread_t reader;
+    if (pthread_create(&reader, NULL, replay_reader_thread, &readerArgs) != 0) {
+        goto done;
+    }
+
+    // The schedule is relative to the first record so the time before it in the capture isn't replayed.
+    uint64_t startTime = replay_get_time_ns();
+    uint64_t lateTime  = 0;    // How far behind the original schedule writes ended up in total.
+    unsigned long long firstRecordTime = pRecords[0].timeInNanoseconds;
+    for (iRecord = 0; iRecord < recordCount; ++iRecord) {
+        if (pOptions->isOriginalSpeed) {
+            uint64_t targetTime = startTime + (pRecords[iRecord].timeInNanoseconds - firstRecordTime);
+            replay_wait_until(targetTime);
+            lateTime += replay_get_time_ns() - targetTime;
+        }
+
+        pSendTimes[iRecord] = replay_get_time_ns();
+        if (!replay_write_all(pipeWrite, pRecords[iRecord].pData, pRecords[iRecord].sizeInBytes)) {
+            break;
+        }
+    }
+
+    // Closing the write end unblocks the reader if the writer gave up part way through.
+    drpipe_close(pipeWrite);
+    pipeWrite = NULL;
+
+    pthread_join(reader, NULL);
+    if (!readerArgs.result || iRecord < recordCount) {
+        goto done;
+    }
+
+    uint64_t endTime = pReceiveTimes[recordCount - 1];
+    double seconds = (double)(endTime - startTime) / 1e9;
+
+    // The send times aren't needed any more so they're turned into latencies in place.
+    for (iRecord = 0; iRecord < recordCount; ++iRecord) {
+        pSendTimes[iRecord] = pReceiveTimes[iRecord] - pSendTimes[iRecord];
+    }
+    qsort(pSendTimes, recordCount, sizeof(uint64_t), replay_compare_u64);
+
+    printf("{\"benchmark\":\"replay\",\"speed\":\"%s\",\"kind\":\"%s\",\"wait\":\"%s\",\"records\":%zu,\"bytes\":%zu",
+        pOptions->isOriginalSpeed ? "original" : "max", (pOptions->kind == DR_IPC_CAPTURE_READ) ? "read" : "write", replay_wait_mode_name(pOptions->waitMode), recordCount, totalBytes);
+    if (pOptions->label != NULL) {
+        printf(",\"label\":\"%s\"", pOptions->label);
+    }
+    printf(",\"seconds\":%.6f,\"records_per_sec\":%.0f,\"mb_per_sec\":%.2f", seconds, (double)recordCount / seconds, (double)totalBytes / seconds / (1024*1024));
+    printf(",\"p50_ns\":%llu,\"p90_ns\":%llu,\"p99_ns\":%llu,\"p999_ns\":%llu,\"max_ns\":%llu",
+        (unsigned long long)replay_percentile(pSendTimes, recordCount, 0.5),
+        (unsigned long long)replay_percentile(pSendTimes, recordCount, 0.9),
+        (unsigned long long)replay_percentile(pSendTimes, recordCount, 0.99),
+        (unsigned long long)replay_percentile(pSendTimes, recordCount, 0.999),
+        (unsigned long long)pSendTimes[recordCount - 1]);
+    if (pOptions->isOriginalSpeed) {
+        printf(",\"mean_lateness_ns\":%llu", (unsigned long long)(lateTime / recordCount));
+    }
+    printf("}\n");
+
+    result = 1;
+
+done:
+    drpipe_close(pipeWrite);
+    drpipe_close(pipeRead);
+    free(pReceiveTimes);
+    free(pSendTimes);
+    return result;
+}
+
+
+static void replay_print_usage(const char* program)
+{
+    fprintf(stderr, "usage: %s CAPTURE_FILE [--speed original|max] [--kind write|read] [--wait block|spin|busy] [--label TEXT]\n", program);
+}
+
+int main(int argc, char** argv)
+{
+    replay_options options;
+    options.isOriginalSpeed = 1;
+    options.kind            = DR_IPC_CAPTURE_WRITE;
+    options.waitMode        = dripc_wait_mode_block;
+    options.label           = NULL;
+
+    if (argc < 2) {
+        replay_print_usage(argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[1];
+
+    int iArg;
+    for (iArg = 2; iArg < argc; ++iArg) {
+        const char* value = (iArg+1 < argc) ? argv[iArg+1] : NULL;
+        if (value == NULL) {
+            replay_print_usage(argv[0]);
+            return 1;
+        }
+
+        if (strcmp(argv[iArg], "--speed") == 0) {
+            options.isOriginalSpeed = (strcmp(value, "max") != 0);
+        } else if (strcmp(argv[iArg], "--kind") == 0) {
+            options.kind = (strcmp(value, "read") == 0) ? DR_IPC_CAPTURE_READ : DR_IPC_CAPTURE_WRITE;
+        } else if (strcmp(argv[iArg], "--wait") == 0) {
+            options.waitMode = (strcmp(value, "spin") == 0) ? dripc_wait_mode_spin_then_block : (strcmp(value, "busy") == 0) ? dripc_wait_mode_busy_poll : dripc_wait_mode_block;
+        } else if (strcmp(argv[iArg], "--label") == 0) {
+            options.label = value;
+        } else {
+            replay_print_usage(argv[0]);
+            return 1;
+        }
+
+        iArg += 1;
+    }
+
+    size_t dataSize;
+    unsigned char* pData = replay_load_capture(path, &dataSize);
+    if (pData == NULL) {
+        return 1;
+    }
+
+    size_t recordCount = replay_parse_records(pData, dataSize, options.kind, NULL);
+    if (recordCount == (size_t)-1) {
+        fprintf(stderr, "%s is corrupt\n", path);
+        free(pData);
+        return 1;
+    }
+    if (recordCount == 0) {
+        fprintf(stderr, "%s has no records to replay\n", path);
+        free(pData);
+        return 1;
+    }
+
+    replay_record* pRecords = (replay_record*)malloc(recordCount * sizeof(*pRecords));
+    if (pRecords == NULL) {
+        free(pData);
+        return 1;
+    }
+    replay_parse_records(pData, dataSize, options.kind, pRecords);
+
+    // A replay that fails half way shouldn't take the whole process down with it.
+    signal(SIGPIPE, SIG_IGN);
+
+    fprintf(stderr, "replaying %zu records\n", recordCount);
+    int result = replay_run(&options, pRecords, recordCount);
+    if (!result) {
+        fprintf(stderr, "replay failed\n");
+    }
+
+    free(pRecords);
+    free(pData);
+    return result ? 0 : 1;
+}
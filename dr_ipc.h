@@ -9,6 +9,10 @@
 //   #define DR_IPC_IMPLEMENTATION
 //   #include "dr_ipc.h"
 //
+// On Linux the implementation needs _GNU_SOURCE for things like pipe2() and memfd. It defines it itself, but that only
+// works if it's included before any system header, so put it at the top of the file or define _GNU_SOURCE when
+// compiling it.
+//
 // You can then #include this file in other parts of the program as you would with any other header file.
 //
 //
@@ -25,7 +29,8 @@
 //   }
 //
 // The above function will block until a client is connected on the other end of the pipe so you will likely want to
-// do this on a separate thread. Connecting on the client side is very similar:
+// do this on a separate thread, or put a limit on the wait with drpipe_open_named_server_with_config(). Connecting on the
+// client side is very similar:
 //
 //   drpipe clientPipe;
 //   dripc_result result = drpipe_open_named_client("my_pipe_name", DR_IPC_READ | DR_IPC_WRITE, &clientPipe);
@@ -35,20 +40,347 @@
 //
 // To read and write data, use drpipe_read() and drpipe_write() respectively. These functions are both blocking. You
 // can also use drpipe_read_exact() to continuously read bytes until exactly the number of bytes requested have been
-// read.
+// read. drpipe_read_timeout(), drpipe_read_exact_timeout() and drpipe_write_timeout() return dripc_result_timeout instead
+// of blocking forever.
 //
 // Internally, for all platforms, the name of the pipe is translated to a platform-specific name. To get this name,
 // use the drpipe_get_translated_name() API. On *nix platforms the pipe will be named as "/tmp/{your pipe name}" by
 // default. This can be changed by #define-ing DR_IPC_UNIX_PIPE_NAME_HEAD before #include-ing this file.
 //
-// An anonymous pipe can be created with the drpipe_open_anonymous() API.
-// 
+// A server that needs to handle many clients should use a drpipe_server instead. It keeps a pool of instances listening
+// for clients so that connecting doesn't have to wait on the server, and hands out each connection as its own drpipe:
+//
+//   drpipe_config config = drpipe_config_init(DR_IPC_READ | DR_IPC_WRITE);
+//   drpipe_server server;
+//   drpipe_server_open("my_pipe_name", &config, 0, &server);
+//
+//   for (;;) {
+//       drpipe connection;
+//       if (drpipe_server_accept(server, DR_IPC_INFINITE, &connection) == dripc_result_success) {
+//           ... hand the connection off to another thread ...
+//       }
+//   }
+//
+// An anonymous pipe can be created with the drpipe_open_anonymous() API. Programs that create lots of short lived
+// anonymous pipes can avoid the heap with drpipe_open_anonymous_in_place(), which puts the handles in storage provided
+// by the caller, or recycle them with a pool:
+//
+//   drpipe_pool pool;
+//   drpipe_pool_open(NULL, 64, &pool);
+//
+//   drpipe pipeRead;
+//   drpipe pipeWrite;
+//   drpipe_pool_acquire(pool, &pipeRead, &pipeWrite);
+//   ... use the pipe, reading everything that was written ...
+//   drpipe_pool_release(pool, pipeRead, pipeWrite);
+//
+//
+// --- Sockets ---
+//
+// Sockets use a listen/accept model so that a single server can serve any number of concurrent clients. Each accepted
+// connection is a regular drpipe which means it works with drpipe_read(), drpipe_write(), drpipe_read_exact(), the
+// message APIs and dripc_poller just like any other pipe:
+//
+//   drsocket listener;
+//   dripc_result result = drsocket_listen("my_socket_name", 0, 0, &listener);
+//   if (result != dripc_result_success) {
+//       return -1;
+//   }
+//
+//   for (;;) {
+//       drpipe connection;
+//       if (drsocket_accept(listener, 0, &connection) == dripc_result_success) {
+//           ... hand the connection off to another thread or a dripc_poller ...
+//       }
+//   }
+//
+// Clients connect with drsocket_connect() which also returns a drpipe. Sockets are stream based by default. Pass
+// DR_IPC_SEQPACKET to both sides to preserve message boundaries instead, in which case each drpipe_read() returns exactly
+// one packet. Sockets use the same name translation as pipes so they are named as "/tmp/{your socket name}" by default on
+// *nix platforms. Sockets are currently only supported on *nix platforms where they are implemented as Unix domain
+// sockets.
+//
+// Sockets can also carry file descriptors. dripc_send_fd() sends one along with a message, and dripc_recv_fd() on the
+// other end receives the message and a new descriptor for the same file. This is the cheapest way to hand a large buffer
+// to another process: put it in a memfd, send the descriptor and let the receiver mmap() it.
+//
+//
+// --- Non-Blocking Pipes ---
+//
+// Pass DR_IPC_NONBLOCK to drpipe_open_named_server(), drpipe_open_named_client() or drpipe_open_anonymous_ex() to make
+// reads and writes return dripc_result_would_block instead of blocking. Opening a named server still waits for a client.
+// To wait on many pipes from a single thread, add them to a dripc_poller:
+//
+//   dripc_poller poller;
+//   dripc_poller_open(&poller);
+//   dripc_poller_add(poller, myPipe, DR_IPC_READ, pMyUserData);
+//
+//   dripc_poll_event events[64];
+//   size_t eventCount;
+//   if (dripc_poller_wait(poller, events, 64, DR_IPC_INFINITE, &eventCount) == dripc_result_success) {
+//       for (size_t i = 0; i < eventCount; ++i) {
+//           ... events[i].pipe is readable ...
+//       }
+//   }
+//
+// Pollers are currently only supported on Linux where they are built on epoll.
+//
+//
+// --- Buffering ---
+//
+// Lots of small reads and writes are expensive because each one is a system call. drpipe_enable_buffering() puts a
+// user-space buffer in front of a pipe so that they become a memcpy instead:
+//
+//   drpipe_enable_buffering(myPipe, 64*1024, 0, 64*1024);
+//   drpipe_write(myPipe, &header, sizeof(header), NULL);   // Buffered.
+//   drpipe_write(myPipe, pBody, bodySize, NULL);           // Buffered.
+//   drpipe_flush(myPipe);                                  // One system call.
+//
+// Reading from a pipe always flushes its write buffer first so a request can't get stuck waiting for its own response.
+//
+// Relays that move lots of small messages can send and receive them in batches instead, which on *nix costs a single
+// writev() for the whole batch on the way out and usually a single read() on the way in. Receiving in batches needs a
+// read buffer:
+//
+//   drpipe_enable_buffering(myPipe, 0, 0, 64*1024);
+//
+//   dripc_message messages[32];    // pData and sizeInBytes point each message at a receive buffer.
+//   size_t messageCount;
+//   drpipe_read_batch(myPipe, messages, 32, &messageCount);
+//   for (size_t i = 0; i < messageCount; ++i) {
+//       messages[i].sizeInBytes = messages[i].messageSize;
+//   }
+//   drpipe_write_batch(myOtherPipe, messages, messageCount, NULL);
+//
+//
+// --- Wait Policies ---
+//
+// A blocking read on an empty pipe puts the thread to sleep, and waking it back up again costs several microseconds. For
+// request/response traffic that's most of the round trip. drpipe_set_wait_policy() makes reads poll for a while first:
+//
+//   drpipe_wait_policy policy = drpipe_wait_policy_init(dripc_wait_mode_spin_then_block);
+//   drpipe_set_wait_policy(myPipe, &policy);
+//
+// dripc_wait_mode_busy_poll never sleeps at all which is only sensible for a thread with a core to itself. Use
+// drpipe_get_wait_counters() to see how often each stage found data and tune the spin and yield counts from there.
+//
+//
+// --- Multiple Writers ---
+//
+// Normally two threads writing messages to the same pipe at once can interleave their bytes. drpipe_enable_multi_writer()
+// makes drpipe_send_message() safe to call from any number of threads and processes without a lock:
+//
+//   drpipe_enable_multi_writer(myReadPipe);
+//   drpipe_enable_multi_writer(myWritePipe);   // Before fork() or handing the pipe to other threads.
+//
+// Messages up to drpipe_get_atomic_message_size() bytes, which is PIPE_BUF less a 16 byte header, go out in a single
+// write that the kernel guarantees is atomic. Larger messages are split into chunks of that size and put back together
+// by the reader, so they're still lock free but cost a copy on each side. Messages sent by the same thread arrive in order.
+//
+//
+// --- Remote Procedure Calls ---
+//
+// A dripc_rpc sits on top of a pipe that can be both read from and written to and tags every request with an ID so the
+// client doesn't have to wait for one response before sending the next request. Responses can come back in any order:
+//
+//   dripc_rpc rpc;
+//   dripc_rpc_open(mySocket, 0, 0, &rpc);
+//   dripc_rpc_call_async(rpc, pRequestA, requestSizeA, on_response, pUserDataA, NULL);
+//   dripc_rpc_call_async(rpc, pRequestB, requestSizeB, on_response, pUserDataB, NULL);
+//   while (dripc_rpc_get_calls_in_flight(rpc) > 0) {
+//       dripc_rpc_pump(rpc);   // Receives one response and fires its callback.
+//   }
+//
+// dripc_rpc_call() is the blocking version. The server side uses dripc_rpc_recv_request() and dripc_rpc_send_response()
+// and can take its time over any request it likes. Requests and responses are sent with drpipe_send_message() so turning
+// on buffering for the pipe lets a burst of calls go out in one write.
+//
+//
+// --- Child Processes ---
+//
+// dripc_spawn() starts a child process with pipes already connected to whichever of its descriptors are needed:
+//
+//   dripc_spawn_fd fds[2];
+//   fds[0].childFD = 0; fds[0].options = DR_IPC_READ;  fds[0].pipe = NULL;    // The child reads its stdin.
+//   fds[1].childFD = 1; fds[1].options = DR_IPC_WRITE; fds[1].pipe = NULL;    // The child writes its stdout.
+//
+//   const char* args[] = {"worker", "--quiet", NULL};
+//   dripc_process process;
+//   dripc_spawn("worker", args, NULL, fds, 2, &process);
+//
+//   drpipe_write(fds[0].parentPipe, pRequest, requestSize, NULL);
+//   drpipe_read(fds[1].parentPipe, pResponse, responseSize, &bytesRead);
+//
+// Close the parent's end of the child's stdin to tell it there's nothing more coming, then use dripc_process_wait() to
+// collect its exit code.
+//
+//
+// --- Zero-Copy Transfers ---
+//
+// On Linux, large amounts of data can be moved through a pipe without copying it through user space.
+// drpipe_splice_from_fd() and drpipe_splice_to_fd() move data between a pipe and any other file descriptor,
+// drpipe_write_pages() hands user pages straight to the pipe and drpipe_tee() duplicates data from one pipe into another.
+// Use drpipe_get_zero_copy_caps() to find out what's available. Everything except drpipe_tee() falls back to ordinary
+// reads and writes when it isn't.
+//
+//
+// --- Asynchronous I/O ---
+//
+// Reads and writes can be queued on a dripc_io_context and then performed in batches. Each operation fires a callback
+// when it completes:
+//
+//   void on_read(dripc_io_context context, drpipe pipe, dripc_result result, size_t bytesRead, void* pUserData)
+//   {
+//       ... pUserData was passed to drpipe_read_async() ...
+//   }
+//
+//   dripc_io_context context;
+//   dripc_io_context_open(256, 0, &context);
+//   drpipe_read_async(context, myPipe, myBuffer, sizeof(myBuffer), on_read, pMyUserData);
+//
+//   size_t completionCount;
+//   dripc_io_context_run(context, DR_IPC_INFINITE, &completionCount);
+//
+// On Linux the context is built on io_uring which allows any number of operations to be submitted and reaped with a
+// single system call. Kernels without io_uring fall back to an epoll loop. Other platforms are not currently supported.
+//
+//
+// --- Shared Memory Ring Buffers ---
+//
+// A drshm_ring is a single-producer/single-consumer byte stream that lives in shared memory. Once it has been opened,
+// reading and writing is done entirely in user space without any system calls unless one end needs to wait on the
+// other. It follows the same server/client model as named pipes, except that the server does not wait for a client:
+//
+//   drshm_ring ring;
+//   dripc_result result = drshm_ring_open_named_server("my_ring_name", 1024*1024, DR_IPC_WRITE, &ring);
+//   if (result != dripc_result_success) {
+//       return -1;
+//   }
+//
+// The other process then attaches with the opposite access mode:
+//
+//   drshm_ring ring;
+//   dripc_result result = drshm_ring_open_named_client("my_ring_name", DR_IPC_READ, &ring);
+//
+// Use drshm_ring_read(), drshm_ring_read_exact() and drshm_ring_write() just like their drpipe equivalents. An
+// anonymous ring can be created with drshm_ring_open_anonymous() which is useful for sharing with a child process
+// created with fork(). On *nix platforms the shared memory object is named as "/{your ring name}" by default. This can
+// be changed by #define-ing DR_IPC_UNIX_SHM_NAME_HEAD before #include-ing this file. On older versions of glibc you
+// will need to link with -lrt.
+//
+//
+// --- Shared Memory Queues ---
+//
+// A drshm_queue is a named queue of fixed-size messages in shared memory that any number of processes can push to and
+// pop from at the same time. It's useful for fanning work in from many processes without needing a pipe for each one:
+//
+//   drshm_queue queue;
+//   drshm_queue_open_named_server("my_queue_name", 256, 4096, &queue);    // 4096 messages of up to 256 bytes each.
+//
+//   char message[256];
+//   size_t messageSize;
+//   while (drshm_queue_pop(queue, message, sizeof(message), &messageSize) == dripc_result_success) {
+//       ...
+//   }
+//
+// Each worker attaches with drshm_queue_open_named_client() and calls drshm_queue_push(). Pushing and popping only enter
+// the kernel when the queue is full or empty and somebody needs to wait. A process that dies in the middle of a push or
+// pop will leave the queue stuck at that slot.
+//
+//
+// --- Shared Memory Arenas ---
+//
+// A drshm_arena is a named block of shared memory with an allocator in front of it. It's for passing large objects
+// between processes without copying them through a pipe. The producer allocates a block, fills it in place and then
+// sends just the block's offset to the consumer, which reads it straight out of shared memory and frees it when it's done:
+//
+//   size_t offset;
+//   drshm_arena_alloc(arena, sizeof(my_record), &offset);
+//   my_record* pRecord = (my_record*)drshm_arena_get_pointer(arena, offset);
+//   ... fill in pRecord ...
+//   drpipe_write(pipe, &offset, sizeof(offset), NULL);
+//
+// Allocating and freeing never enter the kernel and never take a lock. Memory is carved into pages, each of which is
+// split into blocks of a single power of 2 size. A freed block can only be reused for another block of the same size so
+// an arena that is used for lots of different sizes needs some headroom.
+//
+//
+// --- Shared Memory Broadcasts ---
+//
+// A drshm_broadcast is a named ring of fixed-size messages in shared memory with a single writer and any number of
+// readers, each of which sees every message. It's for sending the same stream to lots of processes without writing a
+// copy of every message to each of them:
+//
+//   drshm_broadcast broadcast;
+//   drshm_broadcast_open_named_server("my_feed_name", 256, 4096, &broadcast);
+//   drshm_broadcast_publish(broadcast, pMessage, messageSize);
+//
+// Readers attach with drshm_broadcast_open_named_client() whenever they like and start with the next message to be
+// published. Each reader keeps its own position in its own process, so publishing costs the same no matter how many
+// readers there are and readers can come and go without the writer knowing. The writer never waits for anybody. A
+// reader that falls more than a whole ring behind gets dripc_result_overrun and skips ahead.
+//
+//
+// --- Shared Memory Latest Values ---
+//
+// A drshm_latest is a named slot in shared memory holding the most recent value published by a single writer. It's for
+// things like configuration and price snapshots where readers only care about the newest value and draining every
+// stale update out of a pipe would be a waste:
+//
+//   drshm_latest latest;
+//   drshm_latest_open_named_server("my_snapshot_name", sizeof(snapshot), &latest);
+//   drshm_latest_publish(latest, &snapshot, sizeof(snapshot));
+//
+// A reader attaches with drshm_latest_open_named_client() and calls drshm_latest_read() whenever it wants the current
+// value. Publishing overwrites the previous value, so reading costs the same however many updates were published in
+// between. Neither side takes a lock or makes a system call, and readers can never hold up the writer. Use
+// drshm_latest_get_version() to check for a new value without copying it.
+//
+//
+// --- Shared Memory Regions ---
+//
+// A drshm_region is a plain named block of shared memory for building your own structures in. Large regions can ask for
+// huge pages to take pressure off the TLB, be faulted in up front so the first touch of each page doesn't stall, and be
+// bound to a NUMA node so they live next to the threads that use them:
+//
+//   drshm_region_config config = drshm_region_config_init(DR_IPC_SHM_HUGE_PAGES | DR_IPC_SHM_PREFAULT);
+//   config.numaNode = 1;
+//   drshm_region_open_named_server("my_region_name", 1024*1024*1024, &config, &region);
+//
+// Each of these is a request that the kernel is free to turn down, except for the NUMA binding which fails the open if
+// it can't be done. Use drshm_region_get_info() to find out what was actually granted. Huge pages come from hugetlbfs
+// where there are some reserved, and otherwise from transparent huge pages. This is all Linux only. Elsewhere a region
+// is ordinary shared memory. drshm_get_translated_name() returns the name the region ends up with.
+//
+//
+// --- Instrumentation ---
+//
+// #define DR_IPC_ENABLE_STATS before including the implementation to have every drpipe keep count of its reads and writes,
+// how long it spent blocked and how long each system call took. Take a snapshot with drpipe_get_stats():
+//
+//   drpipe_stats stats;
+//   if (drpipe_get_stats(myPipe, &stats) == dripc_result_success) {
+//       printf("p99 = %llu ns\n", drpipe_stats_get_latency_percentile(&stats, 0.99));
+//   }
+//
+// None of this is compiled in without DR_IPC_ENABLE_STATS, in which case drpipe_get_stats() returns
+// dripc_result_not_supported.
+//
+// To reproduce a problem with real traffic, record everything going through a pipe to a file and play it back later
+// with benchmarks/dr_ipc_replay.c:
+//
+//   drpipe_start_capture(myPipe, "my_pipe.capture", 0);
+//   ... use the pipe as normal ...
+//   drpipe_stop_capture(myPipe);
+//
+// Capturing is always available and costs a single NULL check on each read and write when it's not turned on.
 //
 //
 //
 // QUICK NOTES
-// - Currently, only pipes have been implemented. Sockets will be coming soon.
-// - Non-blocking pipes are not supported.
+// - Sockets are not yet supported on Win32.
+// - Passing descriptors with dripc_send_fd() and dripc_recv_fd() is not yet supported on Win32.
+// - Asynchronous I/O contexts are not yet supported on Win32.
 
 #ifndef dr_ipc_h
 #define dr_ipc_h
@@ -62,9 +394,37 @@ extern "C" {
 // Each primitive type in dr_ipc is opaque because otherwise it would require exposing system headers like windows.h
 // to the public section of this file.
 typedef void* drpipe;
+typedef void* drpipe_server;
+typedef void* drpipe_pool;
+typedef void* drshm_ring;
+typedef void* drshm_queue;
+typedef void* drshm_arena;
+typedef void* drshm_broadcast;
+typedef void* drshm_latest;
+typedef void* drshm_region;
+typedef void* dripc_poller;
+typedef void* drsocket;
+typedef void* dripc_io_context;
+typedef void* dripc_rpc;
+typedef void* dripc_process;
 
 #define DR_IPC_READ     0x01
 #define DR_IPC_WRITE    0x02
+#define DR_IPC_NONBLOCK 0x04
+#define DR_IPC_SEQPACKET 0x08  // Sockets only. Preserves message boundaries.
+#define DR_IPC_NO_IO_URING 0x10 // dripc_io_context_open() only. Always use the epoll backend.
+
+// Options for drshm_region_config.
+#define DR_IPC_SHM_HUGE_PAGES   0x01    // Back the region with huge pages if possible.
+#define DR_IPC_SHM_PREFAULT     0x02    // Fault every page in when the region is opened.
+
+// Returned by drpipe_get_zero_copy_caps().
+#define DR_IPC_ZERO_COPY_SPLICE   0x01  // drpipe_splice_from_fd() and drpipe_splice_to_fd() move data without copying.
+#define DR_IPC_ZERO_COPY_VMSPLICE 0x02  // drpipe_write_pages() maps user pages into the pipe without copying.
+#define DR_IPC_ZERO_COPY_TEE      0x04  // drpipe_tee() is available.
+
+// Reported by dripc_poller_wait() when the other end of a pipe has been closed or an error has occurred.
+#define DR_IPC_HANGUP   0x100
 
 #define DR_IPC_INFINITE 0xFFFFFFFF
 
@@ -75,9 +435,174 @@ typedef enum
     dripc_result_invalid_args,
     dripc_result_name_too_long,
     dripc_result_access_denied,
-    dripc_result_timeout
+    dripc_result_timeout,
+    dripc_result_would_block,
+    dripc_result_not_supported,
+    dripc_result_too_large,
+    dripc_result_out_of_memory,
+    dripc_result_overrun,
+    dripc_result_disconnected
 } dripc_result;
 
+// Describes a region of memory for scatter/gather APIs such as drpipe_send_message() and drpipe_recv_message().
+typedef struct
+{
+    void* pData;
+    size_t sizeInBytes;
+} dripc_buffer;
+
+// The maximum size of a message sent with drpipe_send_message().
+#define DR_IPC_MAX_MESSAGE_SIZE 0x7FFFFFFF
+
+// One message in a batch for drpipe_write_batch() and drpipe_read_batch().
+typedef struct
+{
+    void* pData;            // The message to write, or the buffer to receive it into.
+    size_t sizeInBytes;     // The size of the message to write, or the size of the buffer to receive it into.
+    size_t messageSize;     // Set by drpipe_read_batch() to the full size of the message that was received.
+    dripc_result result;    // Set to the result for this message.
+} dripc_message;
+
+// Storage for a pipe handle that's owned by the caller. See drpipe_open_anonymous_in_place(). The size depends on
+// whether or not DR_IPC_ENABLE_STATS is defined so that needs to be the same everywhere this is used.
+#ifdef DR_IPC_ENABLE_STATS
+#define DR_IPC_PIPE_STORAGE_SIZE    4096
+#else
+#define DR_IPC_PIPE_STORAGE_SIZE    64
+#endif
+
+typedef union
+{
+    void* pAlign;
+    unsigned long long align;
+    unsigned char data[DR_IPC_PIPE_STORAGE_SIZE];
+} drpipe_storage;
+
+typedef struct
+{
+    drpipe pipe;
+    unsigned int events;    // A combination of DR_IPC_READ, DR_IPC_WRITE and DR_IPC_HANGUP.
+    void* pUserData;        // The user data that was passed to dripc_poller_add().
+} dripc_poll_event;
+
+typedef enum
+{
+    dripc_io_backend_none = 0,
+    dripc_io_backend_io_uring,
+    dripc_io_backend_epoll
+} dripc_io_backend;
+
+// Called by dripc_io_context_run() when an asynchronous read or write has completed. bytesTransferred can be less than
+// what was requested, just like drpipe_read() and drpipe_write(). A read that transfers 0 bytes means the other end
+// has been closed.
+typedef void (* dripc_io_callback)(dripc_io_context context, drpipe pipe, dripc_result result, size_t bytesTransferred, void* pUserData);
+
+// Called when the response to a call made with dripc_rpc_call_async() arrives. pResponse is only valid until this returns.
+typedef void (* dripc_rpc_callback)(dripc_rpc rpc, dripc_result result, const void* pResponse, size_t responseSize, void* pUserData);
+
+// How a blocking read waits for data to arrive. See drpipe_set_wait_policy().
+typedef enum
+{
+    dripc_wait_mode_block = 0,          // Sleep in the kernel straight away. This is the default.
+    dripc_wait_mode_spin_then_block,    // Poll with a pause in between, then yield, then sleep in the kernel.
+    dripc_wait_mode_busy_poll           // Poll forever without ever sleeping. For latency critical threads on their own core.
+} dripc_wait_mode;
+
+// Initialize this with drpipe_wait_policy_init().
+typedef struct
+{
+    dripc_wait_mode mode;
+    unsigned int spinCount;     // The number of times to poll with a pause instruction before yielding.
+    unsigned int yieldCount;    // The number of times to poll after yielding the rest of the time slice before sleeping.
+} drpipe_wait_policy;
+
+// How often each stage of a drpipe_wait_policy found data, retrieved with drpipe_get_wait_counters().
+typedef struct
+{
+    unsigned long long immediate;   // Data was already waiting.
+    unsigned long long spin;
+    unsigned long long yield;
+    unsigned long long block;       // Nothing arrived in time so the read slept in the kernel.
+} drpipe_wait_counters;
+
+// Settings for opening a pipe. Initialize this with drpipe_config_init().
+typedef struct
+{
+    unsigned int options;   // The same options that are passed to drpipe_open_named_server() and friends.
+    size_t capacity;        // The requested size of the pipe's kernel buffer in bytes. 0 uses the platform default.
+    unsigned int timeoutInMilliseconds; // How long to wait for the other end of a named pipe. Defaults to DR_IPC_INFINITE.
+} drpipe_config;
+
+// Initializes a pipe config with the given options and defaults for everything else.
+drpipe_config drpipe_config_init(unsigned int options);
+
+// Settings for opening a shared memory region. Initialize this with drshm_region_config_init().
+typedef struct
+{
+    unsigned int options;   // A combination of DR_IPC_SHM_HUGE_PAGES and DR_IPC_SHM_PREFAULT.
+    int numaNode;           // The NUMA node to bind the memory to. Defaults to -1 which leaves it up to the kernel.
+} drshm_region_config;
+
+// Initializes a region config with the given options and defaults for everything else.
+drshm_region_config drshm_region_config_init(unsigned int options);
+
+// What the kernel actually granted for a region, retrieved with drshm_region_get_info().
+typedef struct
+{
+    size_t sizeInBytes;
+    size_t pageSize;        // The size of the pages the region is mapped with. Larger than normal for hugetlbfs.
+    size_t hugePageBytes;   // How much of the region is currently mapped with huge pages, transparent ones included.
+    int numaNode;           // The node the first page is on, or -1 if it's not known or hasn't been faulted in.
+    int isNumaBound;        // Whether or not the region is bound to the node in drshm_region_config.
+} drshm_region_info;
+
+// The layout of a capture file written by drpipe_start_capture(). The file starts with a drpipe_capture_header and is
+// followed by dataSize bytes of records. Each record is a drpipe_capture_record followed by the data that was read or
+// written, padded out to a multiple of 8 bytes.
+#define DR_IPC_CAPTURE_MAGIC    0x50414344  // "DCAP"
+#define DR_IPC_CAPTURE_VERSION  1
+#define DR_IPC_CAPTURE_READ     1
+#define DR_IPC_CAPTURE_WRITE    2
+
+typedef struct
+{
+    unsigned int magic;
+    unsigned int version;
+    unsigned long long dataSize;            // The number of bytes of records that follow the header.
+    unsigned long long recordCount;
+    unsigned long long recordsDropped;      // Records that didn't fit in the file.
+} drpipe_capture_header;
+
+typedef struct
+{
+    unsigned long long timeInNanoseconds;   // The time since the capture was started.
+    unsigned int sizeInBytes;               // The number of bytes that were read or written.
+    unsigned int kind;                      // DR_IPC_CAPTURE_READ or DR_IPC_CAPTURE_WRITE.
+} drpipe_capture_record;
+
+#define DR_IPC_STATS_SIZE_BUCKET_COUNT      32
+#define DR_IPC_STATS_LATENCY_BUCKET_COUNT   320
+
+// A snapshot of a pipe's counters, retrieved with drpipe_get_stats(). Only available with DR_IPC_ENABLE_STATS.
+//
+// Sizes are bucketed by powers of two. Bucket 0 counts transfers of 0 bytes, and bucket n counts transfers of between
+// 2^(n-1) and 2^n - 1 bytes. Latencies are in nanoseconds and use a log-linear layout like HDR histograms where each
+// power of two is split into 8 sub-buckets, giving a resolution of 12.5%. Use drpipe_stats_get_latency_percentile() to
+// read them.
+typedef struct
+{
+    unsigned long long readCalls;           // The number of read system calls, including ones that failed or would block.
+    unsigned long long readBytes;
+    unsigned long long writeCalls;
+    unsigned long long writeBytes;
+    unsigned long long shortReads;          // Reads in drpipe_read_exact() that returned less than what was left to read.
+    unsigned long long wouldBlockCount;     // Reads and writes that returned dripc_result_would_block.
+    unsigned long long blockedTimeInNanoseconds;    // Time spent in read and write system calls and waiting on the pipe.
+    unsigned long long readSizeHistogram[DR_IPC_STATS_SIZE_BUCKET_COUNT];
+    unsigned long long writeSizeHistogram[DR_IPC_STATS_SIZE_BUCKET_COUNT];
+    unsigned long long latencyHistogram[DR_IPC_STATS_LATENCY_BUCKET_COUNT];    // The time taken by each read and write system call.
+} drpipe_stats;
+
 // Opens a server-side pipe.
 //
 // This will block until a client is connected. On *nix platforms the pipe will be named as "/tmp/{name}" by default, but
@@ -86,583 +611,10552 @@ dripc_result drpipe_open_named_server(const char* name, unsigned int options, dr
 
 // Opens the client-side end of a named pipe.
 //
-// If the server-side end of the pipe does not exist, this will fail.
+// If the server-side end of the pipe does not exist, this will fail. Use drpipe_open_named_client_with_config() with a
+// timeout to wait for the server instead.
 dripc_result drpipe_open_named_client(const char* name, unsigned int options, drpipe* pPipeOut);
 
 // Opens an anonymous pipe.
 dripc_result drpipe_open_anonymous(drpipe* pPipeRead, drpipe* pPipeWrite);
 
+// Opens an anonymous pipe with options.
+//
+// DR_IPC_READ and DR_IPC_WRITE are implied for each end and are ignored. Use DR_IPC_NONBLOCK for non-blocking pipes.
+dripc_result drpipe_open_anonymous_ex(unsigned int options, drpipe* pPipeRead, drpipe* pPipeWrite);
+
+// Versions of drpipe_open_named_server(), drpipe_open_named_client() and drpipe_open_anonymous_ex() that take a config.
+//
+// On Linux the capacity is applied with F_SETPIPE_SZ and is clamped to /proc/sys/fs/pipe-max-size. On Win32 it sets the
+// size of the buffers of the server side of named pipes and of anonymous pipes, and is ignored by clients. Other
+// platforms ignore it. The kernel may round the capacity up or refuse to grow the pipe, in which case the pipe is still
+// opened at its current size. Use drpipe_get_capacity() to find out what it ended up as.
+//
+// The timeout is how long a server waits for a client to connect and how long a client waits for the server to create
+// the pipe, or for a free instance if every one of them is busy. dripc_result_timeout is returned if it expires. A client
+// with a timeout of 0 fails straight away like drpipe_open_named_client(). The timeout is ignored by anonymous pipes.
+//
+// On Unix, a named pipe opened with both DR_IPC_READ and DR_IPC_WRITE is a FIFO opened in read-write mode which doesn't
+// wait for the other side at all, so a server opened that way returns straight away whatever the timeout is and a
+// client only waits for the pipe to be created. On Unix platforms other than Linux, one that's opened with only
+// DR_IPC_READ also stops waiting as soon as the pipe exists because there's no way of telling whether the other side
+// has opened it without reading from it.
+dripc_result drpipe_open_named_server_with_config(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut);
+dripc_result drpipe_open_named_client_with_config(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut);
+dripc_result drpipe_open_anonymous_with_config(const drpipe_config* pConfig, drpipe* pPipeRead, drpipe* pPipeWrite);
+
+// Opens an anonymous pipe with handles that live in memory provided by the caller instead of on the heap.
+//
+// The storage can be anywhere, including the stack, as long as it outlives the pipe. *pPipeRead and *pPipeWrite point
+// into it. drpipe_close() still needs to be called, but won't free the storage. pConfig can be NULL for the defaults.
+dripc_result drpipe_open_anonymous_in_place(const drpipe_config* pConfig, drpipe_storage* pStorageRead, drpipe_storage* pStorageWrite, drpipe* pPipeRead, drpipe* pPipeWrite);
+
 // Closes a pipe opened with drpipe_open_named_server(), drpipe_open_named_client() or drpipe_open_anonymous().
 void drpipe_close(drpipe pipe);
 
+// Creates a pool that recycles anonymous pipes.
+//
+// Storage for pairCount pipes is allocated up front. A pair that's handed back to drpipe_pool_release() with nothing
+// left in it is kept open and given out again by the next drpipe_pool_acquire(), so a recycled pipe costs no system
+// calls to set up and tear down beyond a check that it's empty. When every pair is in use, drpipe_pool_acquire() falls
+// back to drpipe_open_anonymous_with_config(). Every pipe comes from pConfig, which can be NULL for the defaults. A pool
+// is not thread safe.
+dripc_result drpipe_pool_open(const drpipe_config* pConfig, size_t pairCount, drpipe_pool* pPoolOut);
+
+// Closes a pool along with the pipes it's holding on to. Every pair that was acquired must be released first.
+void drpipe_pool_close(drpipe_pool pool);
+
+// Retrieves a pipe from the pool, opening a new one if there isn't one ready.
+dripc_result drpipe_pool_acquire(drpipe_pool pool, drpipe* pPipeRead, drpipe* pPipeWrite);
+
+// Hands a pair from drpipe_pool_acquire() back to the pool. Use this instead of drpipe_close().
+//
+// The pair is only reused if it's been drained. Anything still in the pipe or its buffers means the pair is closed
+// instead. Buffering, wait policies and multi-writer mode are turned off again before the pair is reused.
+void drpipe_pool_release(drpipe_pool pool, drpipe pipeRead, drpipe pipeWrite);
+
+// Creates a named pipe server that any number of clients can connect to.
+//
+// Unlike drpipe_open_named_server() this does not wait for a client. Instead, poolSize listening instances are kept
+// ready so that clients connecting in a burst don't have to wait for the server to get around to each of them. Clients
+// connect with drpipe_open_named_client() and drpipe_open_named_client_with_config() as usual. Set poolSize to 0 to use
+// the default. The config's options are applied to each accepted pipe and its capacity to each connection's buffers.
+// The config's timeout is not used.
+//
+// On Win32, each instance in the pool is serviced by its own thread which creates a new instance as soon as the last one
+// has been connected to. On *nix platforms there are no instances to create ahead of time or replenish. The server is a
+// Unix domain socket and poolSize is its listen backlog, clamped to SOMAXCONN, so the kernel completes up to that many
+// connections before drpipe_server_accept() gets to them. A connected pipe is a socket on *nix platforms which means it
+// can be both read from and written to regardless of the options.
+dripc_result drpipe_server_open(const char* name, const drpipe_config* pConfig, unsigned int poolSize, drpipe_server* pServerOut);
+
+// Retrieves the next connected client.
+//
+// Returns dripc_result_timeout if no client connects in time. This is safe to call from several threads at once. The
+// returned pipe must be closed with drpipe_close().
+dripc_result drpipe_server_accept(drpipe_server server, unsigned int timeoutInMilliseconds, drpipe* pPipeOut);
+
+// Closes a server. Clients that have connected but have not been accepted are disconnected. Pipes that have already been
+// accepted are not affected.
+void drpipe_server_close(drpipe_server server);
+
+// Retrieves the effective size of a pipe's kernel buffer in bytes.
+//
+// This is supported on Linux and Win32. Returns dripc_result_not_supported elsewhere and for sockets.
+dripc_result drpipe_get_capacity(drpipe pipe, size_t* pCapacity);
+
+// Takes a snapshot of a pipe's counters.
+//
+// This does not lock anything so it's safe to call from any thread while the pipe is in use. Each counter is read
+// atomically, but the pipe may be used while the snapshot is being taken so the counters might not all agree with each
+// other. Returns dripc_result_not_supported unless DR_IPC_ENABLE_STATS was defined.
+dripc_result drpipe_get_stats(drpipe pipe, drpipe_stats* pStats);
+
+// Retrieves the latency in nanoseconds at the given percentile, between 0 and 1, of a snapshot taken with drpipe_get_stats().
+//
+// This is the upper bound of the histogram bucket the percentile falls in. Returns 0 if nothing has been recorded.
+unsigned long long drpipe_stats_get_latency_percentile(const drpipe_stats* pStats, double percentile);
+
+// Starts recording everything read from and written to a pipe with drpipe_read() and drpipe_write() to a file.
+//
+// Records are collected in a buffer belonging to the pipe and copied into a memory mapped file when it fills up, so
+// recording doesn't add any system calls. The file is created at maxFileSize, or DR_IPC_CAPTURE_DEFAULT_FILE_SIZE if
+// that's 0, and truncated to what was actually used when the capture is stopped. Records that don't fit are counted and
+// dropped. drpipe_close() stops the capture. Use the replay tool in benchmarks/dr_ipc_replay.c to play it back.
+dripc_result drpipe_start_capture(drpipe pipe, const char* filePath, size_t maxFileSize);
+
+// Stops recording a pipe's traffic and finishes writing the capture file.
+dripc_result drpipe_stop_capture(drpipe pipe);
+
 
 // Reads data from a pipe.
 //
 // This is a blocking call, and may not return the exact number of bytes requested. In addition, it is not guaranteed that
-// writes from one end of the pipe is atomic.
+// writes from one end of the pipe is atomic. If the pipe was opened with DR_IPC_NONBLOCK and there is no data available
+// this returns dripc_result_would_block.
 dripc_result drpipe_read(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead);
 
 // Reads data from a pipe and does not return until either an error occurs or exactly the number of requested bytes have been read.
 //
-// This is a blocking call.
+// This is a blocking call. For non-blocking pipes this returns dripc_result_would_block as soon as the pipe runs dry, in
+// which case *pBytesRead will be set to the number of bytes that were read before that happened. If the other end of the
+// pipe is closed before all of the data has been read this returns dripc_result_unknown_error.
 dripc_result drpipe_read_exact(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead);
 
+// Versions of drpipe_read() and drpipe_read_exact() that give up and return dripc_result_timeout if the data doesn't
+// arrive in time.
+//
+// drpipe_read_timeout() waits for data to become available and then reads whatever is there. The timeout of
+// drpipe_read_exact_timeout() covers the whole read, and *pBytesRead is set to the number of bytes that arrived before it
+// expired. A timeout of 0 never blocks, and DR_IPC_INFINITE waits forever. On Win32 these poll for data.
+dripc_result drpipe_read_timeout(drpipe pipe, void* pDataOut, size_t bytesToRead, unsigned int timeoutInMilliseconds, size_t* pBytesRead);
+dripc_result drpipe_read_exact_timeout(drpipe pipe, void* pDataOut, size_t bytesToRead, unsigned int timeoutInMilliseconds, size_t* pBytesRead);
+
 
 // Writes data to a pipe.
 //
-// This blocks until the data has been written.
+// This blocks until the data has been written. For non-blocking pipes this may write less than requested, and returns
+// dripc_result_would_block if nothing at all could be written.
 dripc_result drpipe_write(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten);
 
-
-// Internally, dr_ipc needs to translate the name of a pipe to a platform-specific name. This function returns that internal name.
+// Writes all of the given data unless the timeout expires first, in which case this returns dripc_result_timeout and
+// *pBytesWritten is set to the number of bytes that were written before that happened.
 //
-// Returns the length of the name. If nameOut is NULL the return value is the required size, not including the null terminator.
-size_t drpipe_get_translated_name(const char* name, char* nameOut, size_t nameOutSize);
+// This always goes straight to the pipe. Anything in the write buffer is flushed first, within the same timeout.
+dripc_result drpipe_write_timeout(drpipe pipe, const void* pData, size_t bytesToWrite, unsigned int timeoutInMilliseconds, size_t* pBytesWritten);
 
-#ifdef __cplusplus
-}
-#endif
-#endif  // dr_ipc
 
+// Sends a single message made up of each of the given buffers, in order.
+//
+// The message is framed with a length prefix so that the other end can receive it in one piece with drpipe_recv_message().
+// On *nix platforms the prefix and every buffer are written with a single writev() where possible so there's no need to
+// concatenate the fragments into a temporary buffer first. The total size of the message cannot be larger than
+// DR_IPC_MAX_MESSAGE_SIZE.
+//
+// For non-blocking pipes this returns dripc_result_would_block if none of the message could be written. Once any part of
+// the message has been written this waits for the rest to be written so the stream is never left with half a message.
+dripc_result drpipe_send_message(drpipe pipe, const dripc_buffer* pBuffers, size_t bufferCount);
 
-///////////////////////////////////////////////////////////////////////////////
+// Receives a single message that was sent with drpipe_send_message(), scattering it across the given buffers.
 //
-// IMPLEMENTATION
+// The buffers are filled in order. *pMessageSize is set to the size of the message. If the message is larger than the
+// combined size of the buffers, the buffers are filled, the remainder of the message is discarded and
+// dripc_result_too_large is returned. In this case *pMessageSize is still set to the full size of the message.
 //
-///////////////////////////////////////////////////////////////////////////////
-#ifdef DR_IPC_IMPLEMENTATION
+// For non-blocking pipes this returns dripc_result_would_block if there is no message waiting. Once any part of a message
+// has been received this waits for the rest.
+dripc_result drpipe_recv_message(drpipe pipe, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize);
 
-// Platform Detection
-#ifdef _WIN32
-#define DR_IPC_WIN32
-#include <windows.h>
-#else
-#define DR_IPC_UNIX
-#endif
+// Sends a batch of messages, each framed the same way as drpipe_send_message().
+//
+// On *nix platforms the whole batch goes out with a single writev() where possible. The result of each message is
+// stored in its result member. A message that's larger than DR_IPC_MAX_MESSAGE_SIZE is skipped with
+// dripc_result_too_large without affecting the others. *pMessagesWritten, if not NULL, is set to the number of messages
+// that were written.
+//
+// For non-blocking pipes this returns dripc_result_would_block if none of the batch could be written. Once any message
+// has started going out this waits for it to finish, but may stop before the next one in which case the messages that
+// were left behind have their result set to dripc_result_would_block.
+dripc_result drpipe_write_batch(drpipe pipe, dripc_message* pMessages, size_t messageCount, size_t* pMessagesWritten);
 
+// Receives a batch of messages sent with drpipe_send_message() or drpipe_write_batch().
+//
+// This waits for the first message the same way as drpipe_recv_message() and then keeps going only for as long as there
+// are whole messages that can be had without waiting, so one large read() can be split into many messages. The result
+// of each message is stored in its result member which is either dripc_result_success or, when the message didn't fit in
+// its buffer, dripc_result_too_large. messageSize is set to the full size of the message. *pMessagesRead is set to the
+// number of messages that were received and the rest are left with dripc_result_would_block.
+//
+// Splitting messages needs a read buffer, so the pipe must have had one set up with drpipe_enable_buffering() first or
+// this returns dripc_result_invalid_args. Anything read ahead is kept in that buffer. On a socket that also carries
+// descriptors, a descriptor that arrives with data that was read ahead is lost, and dripc_recv_fd() fails until the
+// buffer has been emptied, so don't mix the two on the same pipe.
+dripc_result drpipe_read_batch(drpipe pipe, dripc_message* pMessages, size_t messageCount, size_t* pMessagesRead);
 
-///////////////////////////////////////////////////////////////////////////////
+// Sends a file descriptor to the other end of a socket along with a message.
 //
-// Win32 Implementation
+// The message works the same way as drpipe_send_message() and can be empty. The receiving process gets its own
+// descriptor referring to the same open file, so a large buffer can be handed over by putting it in a memfd or shared
+// memory object and sending the descriptor instead of the contents, which costs the same regardless of the size. The
+// sender's descriptor stays open. This only works on sockets. Returns dripc_result_not_supported for other pipes and on
+// Win32.
+dripc_result dripc_send_fd(drpipe pipe, int fd, const dripc_buffer* pBuffers, size_t bufferCount);
+
+// Receives a message sent with dripc_send_fd() along with its file descriptor.
 //
-///////////////////////////////////////////////////////////////////////////////
-#ifdef DR_IPC_WIN32
+// This works the same way as drpipe_recv_message(). *pFD is set to the received descriptor which the caller is
+// responsible for closing, or -1 if the message didn't come with one. The descriptor is still returned when this fails
+// with dripc_result_too_large. The pipe must not have anything waiting in its read buffer since any descriptor that
+// came with that data has already been lost, in which case this returns dripc_result_invalid_args. If the kernel
+// couldn't pass the descriptor on, for example because this process has hit its descriptor limit, the message is still
+// consumed so the next one can be received, but this returns dripc_result_unknown_error with *pFD set to -1.
+dripc_result dripc_recv_fd(drpipe pipe, int* pFD, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize);
+
+// Turns on user-space buffering for a pipe so that small reads and writes cost a memcpy instead of a system call.
+//
+// Writes are collected in a buffer of writeBufferSize bytes which is written out when it reaches flushThreshold bytes,
+// when it runs out of room, when drpipe_flush() is called, before every read on the same pipe and when the pipe is
+// closed. A flushThreshold of 0 is the same as writeBufferSize. Reads are served from a read-ahead buffer of
+// readBufferSize bytes. Either size can be 0 to only buffer in one direction. Passing 0 for both turns buffering off.
+//
+// Data sitting in the read buffer is invisible to dripc_poller_wait() so drain the pipe with drpipe_read() before
+// waiting on it again. Asynchronous I/O with drpipe_read_async() and drpipe_write_async() bypasses the buffers.
+dripc_result drpipe_enable_buffering(drpipe pipe, size_t writeBufferSize, size_t flushThreshold, size_t readBufferSize);
 
-#define DR_IPC_WIN32_PIPE_NAME_HEAD         "\\\\.\\pipe\\"
-#define DR_IPC_WIN32_PIPE_BUFFER_SIZE       512
-#define DR_IPC_WIN32_HANDLE_TO_PIPE(handle) ((drpipe)handle)
-#define DR_IPC_PIPE_TO_WIN32_HANDLE(pipe)   ((HANDLE)pipe)
+// Retrieves the zero-copy transfers that are available for a pipe as a combination of the DR_IPC_ZERO_COPY_* flags.
+//
+// These are only available on Linux and only for pipes that are backed by a kernel pipe, which excludes sockets. The
+// transfer functions below still work when a capability is missing, but fall back to copying through user space.
+unsigned int drpipe_get_zero_copy_caps(drpipe pipe);
 
-static dripc_result dripc_result_from_win32_error(DWORD dwError)
-{
-    switch (dwError)
-    {
-    case ERROR_INVALID_PARAMETER: return dripc_result_invalid_args;
-    case ERROR_ACCESS_DENIED:     return dripc_result_access_denied;
-    case ERROR_SEM_TIMEOUT:       return dripc_result_timeout;
-    default:                      return dripc_result_unknown_error;
-    }
-}
+// Moves up to bytesToTransfer bytes from a file descriptor into a pipe with splice().
+//
+// This keeps going until everything has been transferred, the end of the file has been reached or, for a non-blocking
+// pipe, the pipe is full. In the last case dripc_result_would_block is only returned if nothing was transferred at all.
+// This is not supported on Win32.
+dripc_result drpipe_splice_from_fd(drpipe pipe, int fd, size_t bytesToTransfer, size_t* pBytesTransferred);
 
-dripc_result drpipe_open_named_server__win32(const char* name, unsigned int options, drpipe* pPipeOut)
-{
-    char nameWin32[256] = DR_IPC_WIN32_PIPE_NAME_HEAD;
-    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
-        return dripc_result_name_too_long;
-    }
+// Moves up to bytesToTransfer bytes out of a pipe and into a file descriptor with splice(). See drpipe_splice_from_fd().
+dripc_result drpipe_splice_to_fd(drpipe pipe, int fd, size_t bytesToTransfer, size_t* pBytesTransferred);
 
-    DWORD dwOpenMode = FILE_FLAG_FIRST_PIPE_INSTANCE;
-    if (options & DR_IPC_READ) {
-        if (options & DR_IPC_WRITE) {
-            dwOpenMode |= PIPE_ACCESS_DUPLEX;
-        } else {
-            dwOpenMode |= PIPE_ACCESS_INBOUND;
-        }
-    } else {
-        if (options & DR_IPC_WRITE) {
-            dwOpenMode |= PIPE_ACCESS_OUTBOUND;
-        } else {
-            return dripc_result_invalid_args;   // Neither read nor write mode was specified.
-        }
-    }
+// Writes user memory into a pipe with vmsplice().
+//
+// The pipe refers to the pages directly instead of copying them, so the memory must not be modified or freed until the
+// reader has consumed the data. Page-aligned buffers that are a multiple of the page size work best. Falls back to a
+// normal write when vmsplice() is not available. This is not supported on Win32.
+dripc_result drpipe_write_pages(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten);
 
-    HANDLE hPipeWin32 = CreateNamedPipeA(nameWin32, dwOpenMode, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, PIPE_UNLIMITED_INSTANCES, DR_IPC_WIN32_PIPE_BUFFER_SIZE, DR_IPC_WIN32_PIPE_BUFFER_SIZE, NMPWAIT_USE_DEFAULT_WAIT, NULL);
-    if (hPipeWin32 == INVALID_HANDLE_VALUE) {
-        return dripc_result_from_win32_error(GetLastError());
+// Duplicates up to bytesToCopy bytes of the data waiting in pipeIn into pipeOut without consuming it.
+//
+// Read the data out of pipeIn afterwards to move on. Call this once for each output to fan one pipe out to several.
+// There is no fallback for this so it returns dripc_result_not_supported when DR_IPC_ZERO_COPY_TEE is not available
+// for both pipes. Data that has already been read into pipeIn's read buffer is not included.
+dripc_result drpipe_tee(drpipe pipeIn, drpipe pipeOut, size_t bytesToCopy, size_t* pBytesCopied);
+
+// Writes out everything in a pipe's write buffer.
+//
+// On a non-blocking pipe this returns dripc_result_would_block if the pipe filled up before everything was written. The
+// rest stays in the buffer and is written by the next flush.
+dripc_result drpipe_flush(drpipe pipe);
+
+// Initializes a wait policy with default spin and yield counts for the given mode. Spinning is skipped on machines with a
+// single CPU.
+drpipe_wait_policy drpipe_wait_policy_init(dripc_wait_mode mode);
+
+// Sets how reads on a pipe wait for data.
+//
+// Waking a thread that's asleep in the kernel costs several microseconds, which is most of the round trip time of a
+// small request and response. A thread that polls the pipe for a little while first can pick up a quick response
+// without going to sleep at all, at the cost of burning CPU while it waits. Each poll is still a system call, but one
+// that doesn't involve the scheduler. Passing NULL or a policy with dripc_wait_mode_block turns polling off again.
+//
+// This applies to drpipe_read(), drpipe_read_exact() and the reads done to fill a read buffer. It can't be used with
+// non-blocking pipes. Set this before the pipe is used from other threads.
+dripc_result drpipe_set_wait_policy(drpipe pipe, const drpipe_wait_policy* pPolicy);
+
+// Retrieves how often each stage of a pipe's wait policy found data. The counters are reset by drpipe_set_wait_policy().
+dripc_result drpipe_get_wait_counters(drpipe pipe, drpipe_wait_counters* pCounters);
+
+// Lets any number of threads and processes send messages down the same pipe at the same time.
+//
+// Messages are sent as chunks that each go out in a single write of no more than PIPE_BUF bytes, which the kernel never
+// interleaves with other writes. Messages no larger than drpipe_get_atomic_message_size() are a single chunk. Larger
+// messages are split up and tagged with a stream ID so the reader can put them back together. No lock is taken for
+// messages of any size. Call this on both ends before the pipe is shared. Only drpipe_send_message(),
+// drpipe_recv_message() and drpipe_write_batch() can be used afterwards, and there can only be one reader. Write
+// buffering can't be used. This is only supported on Unix pipes and FIFOs.
+dripc_result drpipe_enable_multi_writer(drpipe pipe);
+
+// Retrieves the largest message that is sent in a single atomic write, or 0 if multi-writer mode is not enabled.
+size_t drpipe_get_atomic_message_size(drpipe pipe);
+
+
+// Creates an RPC connection on top of a pipe that can be both read from and written to, such as a socket.
+//
+// maxCallsInFlight is the number of calls that can be waiting for a response at the same time, rounded up to a power of
+// 2. maxResponseSize is the largest response the client can receive. Either can be 0 for DR_IPC_RPC_DEFAULT_MAX_CALLS
+// and DR_IPC_RPC_DEFAULT_MAX_RESPONSE_SIZE. The pipe must not be used for anything else while the RPC connection is open
+// and is not closed by dripc_rpc_close(). A connection is not thread safe.
+dripc_result dripc_rpc_open(drpipe pipe, unsigned int maxCallsInFlight, size_t maxResponseSize, dripc_rpc* pRpcOut);
+
+// Closes an RPC connection. Calls that are still in flight are abandoned without their callbacks being fired.
+void dripc_rpc_close(dripc_rpc rpc);
+
+// Sends a request and returns without waiting for the response.
+//
+// The callback is fired from dripc_rpc_pump() or dripc_rpc_call() when the response arrives. pResponse is only valid
+// for the duration of the callback. If the response is larger than maxResponseSize the callback gets
+// dripc_result_too_large with a NULL pResponse and the full size. If the connection fails, every call in flight is
+// completed with the error. *pRequestID, if not NULL, is set to the ID the request was sent with. Returns
+// dripc_result_would_block without sending anything if the pipe is full or if the slot for the next ID is still waiting.
+// IDs share maxCallsInFlight slots in turn, so when responses come back out of order this can happen with fewer than
+// maxCallsInFlight calls waiting.
+dripc_result dripc_rpc_call_async(dripc_rpc rpc, const void* pRequest, size_t requestSize, dripc_rpc_callback onComplete, void* pUserData, unsigned long long* pRequestID);
+
+// Sends a request and waits for its response.
+//
+// Responses to other calls that arrive in the meantime have their callbacks fired. Returns dripc_result_too_large if the
+// response is larger than responseBufferSize or maxResponseSize, in which case *pResponseSize is still set to its size.
+dripc_result dripc_rpc_call(dripc_rpc rpc, const void* pRequest, size_t requestSize, void* pResponseOut, size_t responseBufferSize, size_t* pResponseSize);
+
+// Receives one response and fires the callback of the call it belongs to.
+//
+// This returns straight away if there are no calls in flight. For a non-blocking pipe this returns
+// dripc_result_would_block if there's no response waiting.
+dripc_result dripc_rpc_pump(dripc_rpc rpc);
+
+// Retrieves the number of calls that are waiting for a response.
+size_t dripc_rpc_get_calls_in_flight(dripc_rpc rpc);
+
+// Receives the next request on the server side of a connection.
+//
+// Pass *pRequestID to dripc_rpc_send_response() to respond. If the request is larger than requestBufferSize, this
+// returns dripc_result_too_large with its size in *pRequestSize and ID in *pRequestID. What's left of it is discarded.
+dripc_result dripc_rpc_recv_request(dripc_rpc rpc, void* pRequestOut, size_t requestBufferSize, size_t* pRequestSize, unsigned long long* pRequestID);
+
+// Sends the response to a request received with dripc_rpc_recv_request(). Requests can be responded to in any order.
+dripc_result dripc_rpc_send_response(dripc_rpc rpc, unsigned long long requestID, const void* pResponse, size_t responseSize);
+
+
+// Describes a descriptor to set up in a child process started with dripc_spawn().
+typedef struct
+{
+    int childFD;            // The descriptor number in the child, such as 0 for stdin. Only 0, 1 and 2 work on Win32.
+    unsigned int options;   // DR_IPC_READ if the child reads from it or DR_IPC_WRITE if it writes to it, plus DR_IPC_NONBLOCK for a non-blocking parentPipe.
+    drpipe pipe;            // An existing pipe end to give to the child, or NULL to create a new pipe.
+    drpipe parentPipe;      // Set by dripc_spawn() to the parent's end of the new pipe when pipe is NULL.
+} dripc_spawn_fd;
+
+// Starts a child process with pipes connected to any of its descriptors.
+//
+// ppArgs is the NULL terminated argument list with the program name first, or NULL to pass only path. ppEnv is a NULL
+// terminated list of "NAME=value" strings, or NULL to inherit the parent's environment. On Unix path is searched for in
+// PATH if it doesn't contain a slash. On Win32 it must be the full path to the executable.
+//
+// For each of pFDs, either the given pipe is duplicated into the child, or a new anonymous pipe is created with one end
+// going to the child and the other returned in parentPipe. Pipes passed in are left open in the parent and need to be
+// closed there for the child to see the end of its input. Other than those and the parent's standard streams that
+// aren't replaced, nothing opened by this library is inherited by the child because everything it opens is close-on-exec
+// or non-inheritable. Descriptors the application opens itself without close-on-exec are still inherited on Unix. On
+// Unix this uses posix_spawn(), which doesn't copy the parent's page tables, so it takes the same time no matter how
+// much memory the parent is using.
+dripc_result dripc_spawn(const char* path, const char* const* ppArgs, const char* const* ppEnv, dripc_spawn_fd* pFDs, size_t fdCount, dripc_process* pProcessOut);
+
+// Waits for a child process to exit.
+//
+// The exit code is whatever the child exited with, or 128 plus the signal number if it was killed by a signal on Unix.
+// Returns dripc_result_timeout if the child is still running when the timeout expires. Once it has exited this returns
+// the same exit code every time.
+dripc_result dripc_process_wait(dripc_process process, unsigned int timeoutInMilliseconds, int* pExitCode);
+
+// Forcibly terminates a child process. Use dripc_process_wait() afterwards to wait for it to be gone.
+dripc_result dripc_process_kill(dripc_process process);
+
+// Frees a process handle. This does not wait for or terminate the child. On Unix a child that hasn't been waited for
+// stays around as a zombie until the parent exits.
+void dripc_process_close(dripc_process process);
+
+
+// Internally, dr_ipc needs to translate the name of a pipe to a platform-specific name. This function returns that internal name.
+//
+// Returns the length of the name. If nameOut is NULL the return value is the required size, not including the null terminator.
+size_t drpipe_get_translated_name(const char* name, char* nameOut, size_t nameOutSize);
+
+
+// Creates a listening socket that clients can connect to with drsocket_connect().
+//
+// options can be 0 or a combination of DR_IPC_SEQPACKET and DR_IPC_NONBLOCK. When DR_IPC_NONBLOCK is used,
+// drsocket_accept() will return dripc_result_would_block if there are no pending connections. backlog is the number of
+// pending connections the system will queue up before refusing new ones. Set it to 0 to use the system default.
+//
+// A stale socket left behind by a server that did not shut down cleanly is replaced, but a live one is not.
+dripc_result drsocket_listen(const char* name, unsigned int options, unsigned int backlog, drsocket* pSocketOut);
+
+// Accepts a connection on a listening socket.
+//
+// This blocks until a client connects unless the socket was created with DR_IPC_NONBLOCK. The returned pipe can be both
+// read from and written to, and must be closed with drpipe_close(). Use DR_IPC_NONBLOCK in options for a non-blocking pipe.
+dripc_result drsocket_accept(drsocket socket, unsigned int options, drpipe* pPipeOut);
+
+// Connects to a socket created with drsocket_listen().
+//
+// options can be 0 or a combination of DR_IPC_SEQPACKET and DR_IPC_NONBLOCK. DR_IPC_SEQPACKET must match the server.
+// The returned pipe can be both read from and written to, and must be closed with drpipe_close().
+dripc_result drsocket_connect(const char* name, unsigned int options, drpipe* pPipeOut);
+
+// Closes a listening socket. Connections that have already been accepted are not affected.
+void drsocket_close(drsocket socket);
+
+// Sets the size of the kernel send and receive buffers (SO_SNDBUF and SO_RCVBUF) of a listening socket.
+//
+// Connections accepted after this call inherit the sizes. A size of 0 leaves that buffer unchanged. The system may round
+// or clamp the sizes.
+dripc_result drsocket_set_buffer_sizes(drsocket socket, size_t sendBufferSize, size_t receiveBufferSize);
+
+// Sets the size of the kernel send and receive buffers of a pipe returned by drsocket_accept() or drsocket_connect().
+//
+// A size of 0 leaves that buffer unchanged. This fails with dripc_result_invalid_args if the pipe is not a socket.
+dripc_result drpipe_set_socket_buffer_sizes(drpipe pipe, size_t sendBufferSize, size_t receiveBufferSize);
+
+
+// Creates an object for waiting on multiple pipes at the same time.
+//
+// This is currently only supported on Linux. Other platforms will return dripc_result_not_supported.
+dripc_result dripc_poller_open(dripc_poller* pPollerOut);
+
+// Closes a poller. This does not close any of the pipes that were added to it.
+void dripc_poller_close(dripc_poller poller);
+
+// Adds a pipe to a poller.
+//
+// The events parameter is a combination of DR_IPC_READ and DR_IPC_WRITE. Hang ups are always reported. pUserData is
+// passed back in the pUserData member of dripc_poll_event. A pipe can only be added to a given poller once.
+dripc_result dripc_poller_add(dripc_poller poller, drpipe pipe, unsigned int events, void* pUserData);
+
+// Changes the events and user data of a pipe that was previously added with dripc_poller_add().
+dripc_result dripc_poller_modify(dripc_poller poller, drpipe pipe, unsigned int events, void* pUserData);
+
+// Removes a pipe from a poller. This must be called before closing a pipe that has been added to a poller.
+dripc_result dripc_poller_remove(dripc_poller poller, drpipe pipe);
+
+// Waits for one or more pipes to become ready.
+//
+// Use DR_IPC_INFINITE to wait forever. Returns dripc_result_timeout if nothing became ready within the timeout. This is
+// level triggered, so a pipe will keep being reported for as long as it is ready.
+dripc_result dripc_poller_wait(dripc_poller poller, dripc_poll_event* pEvents, size_t eventCapacity, unsigned int timeoutInMilliseconds, size_t* pEventCount);
+
+
+// Creates a context for performing asynchronous reads and writes.
+//
+// queueDepth is the maximum number of operations that can be in flight at the same time. io_uring is used when the
+// kernel supports it and epoll is used otherwise. Pass DR_IPC_NO_IO_URING in options to always use epoll. This is
+// currently only supported on Linux. Other platforms will return dripc_result_not_supported.
+dripc_result dripc_io_context_open(unsigned int queueDepth, unsigned int options, dripc_io_context* pContextOut);
+
+// Closes an asynchronous I/O context. Every operation should have completed before calling this, otherwise the kernel
+// may still be accessing their buffers.
+void dripc_io_context_close(dripc_io_context context);
+
+// Retrieves the backend that a context ended up using.
+dripc_io_backend dripc_io_context_get_backend(dripc_io_context context);
+
+// Queues an asynchronous read.
+//
+// The buffer must remain valid until the callback has been fired by dripc_io_context_run(). Returns
+// dripc_result_would_block if queueDepth operations are already in flight. Multiple reads on the same pipe are performed
+// in order by the epoll backend, but io_uring makes no such guarantee, so keep one read in flight per pipe if the
+// order matters.
+dripc_result drpipe_read_async(dripc_io_context context, drpipe pipe, void* pDataOut, size_t bytesToRead, dripc_io_callback onComplete, void* pUserData);
+
+// Queues an asynchronous write. See drpipe_read_async().
+//
+// Like write(), the callback may report fewer bytes than were asked for, in which case queue another write for the rest.
+// If the other end has been closed the callback gets dripc_result_disconnected, and with the epoll backend every other
+// write still queued on the pipe fails the same way without being attempted.
+dripc_result drpipe_write_async(dripc_io_context context, drpipe pipe, const void* pData, size_t bytesToWrite, dripc_io_callback onComplete, void* pUserData);
+
+// Hands every queued operation to the kernel in a single system call without waiting for any of them to complete.
+//
+// This is optional because dripc_io_context_run() also submits. It is useful for getting operations started early.
+dripc_result dripc_io_context_submit(dripc_io_context context);
+
+// Submits any queued operations, waits for at least one to complete and then fires the callback of every operation
+// that has completed.
+//
+// Use DR_IPC_INFINITE to wait forever. Returns dripc_result_timeout if nothing completed within the timeout. Returns
+// immediately with a completion count of 0 if there is nothing in flight. Callbacks are fired on the calling thread and
+// may queue up new operations, but must not close the context.
+dripc_result dripc_io_context_run(dripc_io_context context, unsigned int timeoutInMilliseconds, size_t* pCompletionCount);
+
+
+// Creates a named shared memory ring buffer.
+//
+// Unlike drpipe_open_named_server(), this does not wait for a client to connect. The options must be either DR_IPC_READ
+// or DR_IPC_WRITE, but not both, because a ring only ever has a single producer and a single consumer. The capacity is
+// rounded up to a power of 2.
+dripc_result drshm_ring_open_named_server(const char* name, size_t capacity, unsigned int options, drshm_ring* pRingOut);
+
+// Attaches to a named shared memory ring buffer that was created with drshm_ring_open_named_server().
+//
+// If the server-side end of the ring does not exist, this will fail. The options should be the opposite of those that
+// were used by the server.
+dripc_result drshm_ring_open_named_client(const char* name, unsigned int options, drshm_ring* pRingOut);
+
+// Creates an anonymous shared memory ring buffer.
+//
+// The memory is shared with child processes created with fork().
+dripc_result drshm_ring_open_anonymous(size_t capacity, drshm_ring* pRingRead, drshm_ring* pRingWrite);
+
+// Closes a ring opened with drshm_ring_open_named_server(), drshm_ring_open_named_client() or drshm_ring_open_anonymous().
+//
+// If the other end is waiting on this one it will be woken up. A reader will see end-of-stream once all remaining data
+// has been consumed. An end of an anonymous ring that has never been read from or written to is closed silently so that
+// each process can close the end it does not use after a fork().
+void drshm_ring_close(drshm_ring ring);
+
+// Reads data from a ring.
+//
+// This blocks until at least one byte is available and may not return the exact number of bytes requested. When the
+// write end has been closed and the ring is empty this returns dripc_result_success with *pBytesRead set to 0.
+dripc_result drshm_ring_read(drshm_ring ring, void* pDataOut, size_t bytesToRead, size_t* pBytesRead);
+
+// Reads data from a ring and does not return until either an error occurs or exactly the number of requested bytes
+// have been read.
+dripc_result drshm_ring_read_exact(drshm_ring ring, void* pDataOut, size_t bytesToRead, size_t* pBytesRead);
+
+// Writes data to a ring.
+//
+// This blocks until all of the data has been written.
+dripc_result drshm_ring_write(drshm_ring ring, const void* pData, size_t bytesToWrite, size_t* pBytesWritten);
+
+
+// Creates a named shared memory queue that any number of processes can push messages to and pop messages from.
+//
+// Each message is copied into a fixed-size slot so messages can be at most slotSize bytes. slotCount is the number of
+// messages the queue can hold and is rounded up to a power of 2. Like drshm_ring_open_named_server(), this does not wait
+// for anybody to attach.
+dripc_result drshm_queue_open_named_server(const char* name, size_t slotSize, size_t slotCount, drshm_queue* pQueueOut);
+
+// Attaches to a queue that was created with drshm_queue_open_named_server().
+dripc_result drshm_queue_open_named_client(const char* name, drshm_queue* pQueueOut);
+
+// Closes a queue. Closing the server removes the name, but processes that are already attached can keep using it.
+void drshm_queue_close(drshm_queue queue);
+
+// Retrieves the maximum size of a message.
+size_t drshm_queue_get_slot_size(drshm_queue queue);
+
+// Pushes a message onto a queue, waiting for room if it's full.
+//
+// Returns dripc_result_too_large if the message is bigger than the slot size.
+dripc_result drshm_queue_push(drshm_queue queue, const void* pData, size_t sizeInBytes);
+
+// Pushes a message onto a queue, returning dripc_result_would_block if it's full.
+dripc_result drshm_queue_try_push(drshm_queue queue, const void* pData, size_t sizeInBytes);
+
+// Pops a message off a queue, waiting for one if it's empty.
+//
+// If the next message is bigger than bufferSize, this returns dripc_result_too_large with its size in *pMessageSize and
+// leaves it in the queue so it can be popped again with a bigger buffer.
+dripc_result drshm_queue_pop(drshm_queue queue, void* pDataOut, size_t bufferSize, size_t* pMessageSize);
+
+// Pops a message off a queue, returning dripc_result_would_block if it's empty.
+dripc_result drshm_queue_try_pop(drshm_queue queue, void* pDataOut, size_t bufferSize, size_t* pMessageSize);
+
+
+// Creates a named shared memory arena that any number of processes can allocate from and free to.
+//
+// capacity is the number of bytes available for allocations and is rounded up to a whole number of pages. Like
+// drshm_ring_open_named_server(), this does not wait for anybody to attach.
+dripc_result drshm_arena_open_named_server(const char* name, size_t capacity, drshm_arena* pArenaOut);
+
+// Attaches to an arena that was created with drshm_arena_open_named_server().
+dripc_result drshm_arena_open_named_client(const char* name, drshm_arena* pArenaOut);
+
+// Closes an arena. Closing the server removes the name, but processes that are already attached can keep using it.
+void drshm_arena_close(drshm_arena arena);
+
+// Allocates a block of memory from an arena.
+//
+// The block is identified by its offset which is the same in every process attached to the arena. Use
+// drshm_arena_get_pointer() to get at its memory. Sizes are rounded up to a power of 2 of at least 64 bytes and blocks
+// are aligned to their size, up to a page. Returns dripc_result_out_of_memory if the arena is full, and
+// dripc_result_too_large if the block would never fit.
+dripc_result drshm_arena_alloc(drshm_arena arena, size_t sizeInBytes, size_t* pOffsetOut);
+
+// Returns a block to an arena. Any process attached to the arena can free any block.
+//
+// Returns dripc_result_invalid_args if the offset is not the start of a block. Freeing a block twice is not detected.
+dripc_result drshm_arena_free(drshm_arena arena, size_t offset);
+
+// Retrieves a pointer to the memory of a block in the calling process. Returns NULL if the offset is out of range.
+void* drshm_arena_get_pointer(drshm_arena arena, size_t offset);
+
+// Retrieves the offset of a pointer into an arena's memory. Returns 0 if the pointer is not inside the arena.
+size_t drshm_arena_get_offset(drshm_arena arena, const void* pData);
+
+
+// Creates a named shared memory broadcast channel. The server is the only one that can publish to it.
+//
+// Each message is copied into a fixed-size slot so messages can be at most slotSize bytes. slotCount is the number of
+// messages a reader can fall behind by before it misses some and is rounded up to a power of 2. Like
+// drshm_ring_open_named_server(), this does not wait for anybody to attach.
+dripc_result drshm_broadcast_open_named_server(const char* name, size_t slotSize, size_t slotCount, drshm_broadcast* pBroadcastOut);
+
+// Attaches a reader to a broadcast channel that was created with drshm_broadcast_open_named_server().
+//
+// The reader starts at the next message to be published. Every reader receives every message independently of the
+// others.
+dripc_result drshm_broadcast_open_named_client(const char* name, drshm_broadcast* pBroadcastOut);
+
+// Closes a broadcast channel. Closing the server removes the name, but readers that are already attached can keep
+// receiving whatever is left in the ring.
+void drshm_broadcast_close(drshm_broadcast broadcast);
+
+// Retrieves the maximum size of a message.
+size_t drshm_broadcast_get_slot_size(drshm_broadcast broadcast);
+
+// Publishes a message to every reader. This never waits. The oldest message is overwritten whether or not every
+// reader has received it.
+//
+// Returns dripc_result_too_large if the message is bigger than the slot size, and dripc_result_invalid_args if this is
+// not the server.
+dripc_result drshm_broadcast_publish(drshm_broadcast broadcast, const void* pData, size_t sizeInBytes);
+
+// Receives the next message, waiting for one to be published if the reader has caught up.
+//
+// If the writer has lapped the reader, the messages that were overwritten are lost. This returns dripc_result_overrun
+// with *pMessageSize set to 0 and skips the reader ahead to half a ring behind the writer, after which receiving carries
+// on as normal. If the next message is bigger than bufferSize, this returns dripc_result_too_large with its size in
+// *pMessageSize and doesn't move past it.
+dripc_result drshm_broadcast_receive(drshm_broadcast broadcast, void* pDataOut, size_t bufferSize, size_t* pMessageSize);
+
+// Receives the next message, returning dripc_result_would_block if the reader has caught up. See drshm_broadcast_receive().
+dripc_result drshm_broadcast_try_receive(drshm_broadcast broadcast, void* pDataOut, size_t bufferSize, size_t* pMessageSize);
+
+// Retrieves the total number of messages this reader has missed because it was overrun.
+unsigned long long drshm_broadcast_get_messages_lost(drshm_broadcast broadcast);
+
+
+// Creates a named shared memory latest-value channel. The server is the only one that can publish to it.
+//
+// Values can be at most maxValueSize bytes. Like drshm_ring_open_named_server(), this does not wait for anybody to attach.
+dripc_result drshm_latest_open_named_server(const char* name, size_t maxValueSize, drshm_latest* pLatestOut);
+
+// Attaches a reader to a latest-value channel that was created with drshm_latest_open_named_server().
+dripc_result drshm_latest_open_named_client(const char* name, drshm_latest* pLatestOut);
+
+// Closes a latest-value channel. Closing the server removes the name, but readers that are already attached can keep
+// reading the last value that was published.
+void drshm_latest_close(drshm_latest latest);
+
+// Retrieves the maximum size of a value.
+size_t drshm_latest_get_max_size(drshm_latest latest);
+
+// Publishes a new value, replacing the previous one. This never waits for readers.
+//
+// Returns dripc_result_too_large if the value is bigger than the maximum size, and dripc_result_invalid_args if this is
+// not the server.
+dripc_result drshm_latest_publish(drshm_latest latest, const void* pData, size_t sizeInBytes);
+
+// Copies out the most recently published value. The copy is always a whole value from a single publish, never a mix
+// of two.
+//
+// pVersion can be NULL. Otherwise it receives the version of the value that was copied, which is the number of values
+// that had been published up to and including it. Returns dripc_result_would_block if nothing has been published yet.
+// If the value is bigger than bufferSize, this returns dripc_result_too_large with its size in *pValueSize.
+dripc_result drshm_latest_read(drshm_latest latest, void* pDataOut, size_t bufferSize, size_t* pValueSize, unsigned long long* pVersion);
+
+// Retrieves the version of the most recently published value, or 0 if nothing has been published yet. This is a single
+// load from shared memory so it's a cheap way to poll for a change before calling drshm_latest_read().
+unsigned long long drshm_latest_get_version(drshm_latest latest);
+
+
+// Creates a named shared memory region.
+//
+// The memory starts out zeroed. The size is rounded up to a whole number of huge pages when they're granted. pConfig can
+// be NULL to use the defaults. Huge pages and prefaulting are requests that fall back to normal behaviour when they
+// can't be had. A numaNode other than -1 that can't be bound to fails with the reason. These are only acted on by Linux.
+dripc_result drshm_region_open_named_server(const char* name, size_t sizeInBytes, const drshm_region_config* pConfig, drshm_region* pRegionOut);
+
+// Attaches to a region that was created with drshm_region_open_named_server().
+//
+// Only DR_IPC_SHM_PREFAULT is used from pConfig, which can be NULL. Huge pages and the NUMA binding are decided by the
+// server.
+dripc_result drshm_region_open_named_client(const char* name, const drshm_region_config* pConfig, drshm_region* pRegionOut);
+
+// Closes a region. Closing the server removes the name, but processes that are already attached can keep using it.
+void drshm_region_close(drshm_region region);
+
+// Retrieves a pointer to the start of a region's memory in the calling process.
+void* drshm_region_get_pointer(drshm_region region);
+
+// Retrieves the size of a region, which may have been rounded up by the server.
+size_t drshm_region_get_size(drshm_region region);
+
+// Retrieves what the kernel granted for a region. This is a snapshot since transparent huge pages can come and go.
+dripc_result drshm_region_get_info(drshm_region region, drshm_region_info* pInfo);
+
+// Translates the name of a shared memory object to its platform-specific name, in the same way as
+// drpipe_get_translated_name().
+//
+// Returns the length of the name. If nameOut is NULL the return value is the required size, not including the null terminator.
+size_t drshm_get_translated_name(const char* name, char* nameOut, size_t nameOutSize);
+
+#ifdef __cplusplus
+}
+#endif
+#endif  // dr_ipc
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// IMPLEMENTATION
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifdef DR_IPC_IMPLEMENTATION
+
+// Platform Detection
+#ifdef _WIN32
+#define DR_IPC_WIN32
+#include <windows.h>
+#else
+#define DR_IPC_UNIX
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE     // Must come before any system header for things like memfd and pipe2 to be declared.
+#endif
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sched.h>
+#include <time.h>
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/ioctl.h>
+#include <sys/wait.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#ifdef __linux__
+#define DR_IPC_LINUX
+#include <sys/syscall.h>
+#include <sys/epoll.h>
+#include <linux/futex.h>
+
+// glibc decides what to declare the first time any of its headers is included, so defining _GNU_SOURCE above does
+// nothing if something else got there first. Catch that here rather than with a pile of implicit declarations.
+#if defined(__GLIBC__) && !defined(__USE_GNU)
+#error "dr_ipc: #define DR_IPC_IMPLEMENTATION and #include dr_ipc.h before any system header, or define _GNU_SOURCE when compiling that file."
+#endif
+#if defined(__has_include)
+#if __has_include(<linux/io_uring.h>) && defined(__NR_io_uring_setup)
+#define DR_IPC_HAS_IO_URING
+#include <linux/io_uring.h>
+#endif
+#endif
+#endif
+#endif
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef _MSC_VER
+#define DR_IPC_INLINE __inline
+#else
+#define DR_IPC_INLINE __inline__
+#endif
+
+#define DR_IPC_CACHE_LINE_SIZE  64
+
+// The number of times a shared memory primitive will spin before falling back to a kernel wait.
+#ifndef DR_IPC_PIPE_SPIN_COUNT
+#define DR_IPC_PIPE_SPIN_COUNT  2000    // The default for dripc_wait_mode_spin_then_block. Each spin is a poll() or PeekNamedPipe().
+#endif
+#ifndef DR_IPC_PIPE_YIELD_COUNT
+#define DR_IPC_PIPE_YIELD_COUNT 16
+#endif
+#ifndef DR_IPC_SHM_SPIN_COUNT
+#define DR_IPC_SHM_SPIN_COUNT   1024
+#endif
+
+// The largest write to a pipe that the kernel guarantees won't be interleaved with other writes. 512 is the smallest
+// value POSIX allows.
+#ifdef PIPE_BUF
+#define DR_IPC_PIPE_BUF     PIPE_BUF
+#else
+#define DR_IPC_PIPE_BUF     512
+#endif
+
+// The size of the file drpipe_start_capture() creates when it's given 0, and of the buffer records are staged in.
+#ifndef DR_IPC_CAPTURE_DEFAULT_FILE_SIZE
+#define DR_IPC_CAPTURE_DEFAULT_FILE_SIZE    (256*1024*1024)
+#endif
+#ifndef DR_IPC_CAPTURE_STAGING_SIZE
+#define DR_IPC_CAPTURE_STAGING_SIZE         (64*1024)
+#endif
+
+// The limits dripc_rpc_open() uses when it's passed 0.
+#ifndef DR_IPC_RPC_DEFAULT_MAX_CALLS
+#define DR_IPC_RPC_DEFAULT_MAX_CALLS            64
+#endif
+#ifndef DR_IPC_RPC_DEFAULT_MAX_RESPONSE_SIZE
+#define DR_IPC_RPC_DEFAULT_MAX_RESPONSE_SIZE    (64*1024)
+#endif
+
+
+// Atomics
+//
+// Shared memory primitives are used across processes, so these only ever operate on fixed-size integers. Loads have
+// acquire semantics and stores have release semantics. dripc_atomic_fence() is a full sequentially consistent fence.
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+static DR_IPC_INLINE uint32_t dripc_atomic_load_u32(volatile uint32_t* p)                   { uint32_t v = *p; _ReadWriteBarrier(); return v; }
+static DR_IPC_INLINE void     dripc_atomic_store_u32(volatile uint32_t* p, uint32_t v)       { _ReadWriteBarrier(); *p = v; }
+static DR_IPC_INLINE uint64_t dripc_atomic_load_u64(volatile uint64_t* p)                   { return (uint64_t)InterlockedCompareExchange64((volatile LONG64*)p, 0, 0); }
+static DR_IPC_INLINE void     dripc_atomic_store_u64(volatile uint64_t* p, uint64_t v)       { InterlockedExchange64((volatile LONG64*)p, (LONG64)v); }
+static DR_IPC_INLINE uint32_t dripc_atomic_fetch_or_u32(volatile uint32_t* p, uint32_t v)    { return (uint32_t)InterlockedOr((volatile LONG*)p, (LONG)v); }
+static DR_IPC_INLINE uint32_t dripc_atomic_fetch_add_u32(volatile uint32_t* p, uint32_t v)   { return (uint32_t)InterlockedExchangeAdd((volatile LONG*)p, (LONG)v); }
+static DR_IPC_INLINE uint64_t dripc_atomic_fetch_add_u64(volatile uint64_t* p, uint64_t v)   { return (uint64_t)InterlockedExchangeAdd64((volatile LONG64*)p, (LONG64)v); }
+static DR_IPC_INLINE int      dripc_atomic_compare_exchange_u64(volatile uint64_t* p, uint64_t* pExpected, uint64_t desired) { uint64_t prev = (uint64_t)InterlockedCompareExchange64((volatile LONG64*)p, (LONG64)desired, (LONG64)*pExpected); if (prev == *pExpected) return 1; *pExpected = prev; return 0; }
+static DR_IPC_INLINE void     dripc_atomic_fence(void)                                       { MemoryBarrier(); }
+static DR_IPC_INLINE void     dripc_cpu_pause(void)                                          { YieldProcessor(); }
+#else
+static DR_IPC_INLINE uint32_t dripc_atomic_load_u32(volatile uint32_t* p)                   { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static DR_IPC_INLINE void     dripc_atomic_store_u32(volatile uint32_t* p, uint32_t v)       { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static DR_IPC_INLINE uint64_t dripc_atomic_load_u64(volatile uint64_t* p)                   { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+static DR_IPC_INLINE void     dripc_atomic_store_u64(volatile uint64_t* p, uint64_t v)       { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+static DR_IPC_INLINE uint32_t dripc_atomic_fetch_or_u32(volatile uint32_t* p, uint32_t v)    { return __atomic_fetch_or(p, v, __ATOMIC_SEQ_CST); }
+static DR_IPC_INLINE uint32_t dripc_atomic_fetch_add_u32(volatile uint32_t* p, uint32_t v)   { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+static DR_IPC_INLINE uint64_t dripc_atomic_fetch_add_u64(volatile uint64_t* p, uint64_t v)   { return __atomic_fetch_add(p, v, __ATOMIC_SEQ_CST); }
+static DR_IPC_INLINE int      dripc_atomic_compare_exchange_u64(volatile uint64_t* p, uint64_t* pExpected, uint64_t desired) { return __atomic_compare_exchange_n(p, pExpected, desired, 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST); }
+static DR_IPC_INLINE void     dripc_atomic_fence(void)                                       { __atomic_thread_fence(__ATOMIC_SEQ_CST); }
+#if defined(__i386__) || defined(__x86_64__)
+static DR_IPC_INLINE void     dripc_cpu_pause(void)                                          { __builtin_ia32_pause(); }
+#elif defined(__aarch64__) || (defined(__arm__) && defined(__ARM_ARCH) && __ARM_ARCH >= 7)
+static DR_IPC_INLINE void     dripc_cpu_pause(void)                                          { __asm__ __volatile__ ("yield"); }
+#else
+static DR_IPC_INLINE void     dripc_cpu_pause(void)                                          { }
+#endif
+#endif
+
+
+// Shared memory mappings are used internally by every shared memory primitive.
+typedef struct
+{
+    void* pData;
+    size_t sizeInBytes;
+    void* hMapping;         // Win32 only. The HANDLE of the file mapping object.
+    int isOwner;            // Set for the server side of named objects. The owner is responsible for removing the name.
+    char name[256];         // The translated name. Empty for anonymous objects.
+} dripc_shm;
+
+// The state of a drshm_region.
+typedef struct
+{
+    dripc_shm shm;
+    size_t pageSize;
+    int isHugeTLB;          // Backed by a file on hugetlbfs instead of a POSIX shared memory object. shm.name is its path.
+    int isNumaBound;
+} drshm_region_state;
+
+// Faults in every page of a region by reading from it. Reading is enough to get a shared page allocated, and unlike
+// writing it's safe to do while other processes are using the region.
+static void drshm_region_prefault(drshm_region_state* pRegion)
+{
+    volatile unsigned char* pBytes = (volatile unsigned char*)pRegion->shm.pData;
+    size_t offset;
+    for (offset = 0; offset < pRegion->shm.sizeInBytes; offset += pRegion->pageSize) {
+        (void)pBytes[offset];
+    }
+}
+
+
+// The state of drpipe_enable_buffering(). The structure, write buffer and read buffer share a single allocation.
+typedef struct
+{
+    unsigned char* pWriteBuffer;
+    size_t writeBufferSize;
+    size_t writeBufferLength;   // The number of bytes waiting to be flushed.
+    size_t flushThreshold;
+    unsigned char* pReadBuffer;
+    size_t readBufferSize;
+    size_t readBufferOffset;    // The number of bytes of the read buffer that have already been consumed.
+    size_t readBufferLength;    // The number of valid bytes in the read buffer, including consumed ones.
+} drpipe_buffering;
+
+// The state of drpipe_set_wait_policy().
+typedef struct
+{
+    dripc_wait_mode mode;
+    unsigned int spinCount;
+    unsigned int yieldCount;
+    volatile uint64_t readyImmediately;
+    volatile uint64_t readyAfterSpin;
+    volatile uint64_t readyAfterYield;
+    volatile uint64_t readyAfterBlock;
+} drpipe_waiting;
+
+// Multi-writer pipes send every message as one or more chunks, each of which is written with a single write of no more
+// than DR_IPC_PIPE_BUF bytes so the kernel never interleaves it with anything else. Every message gets its own stream ID
+// and the reader stitches the chunks of each stream back together.
+#define DR_IPC_CHUNK_LAST   0x01    // The last chunk of a message.
+
+typedef struct
+{
+    uint64_t streamID;      // The writer's process ID in the top half and a process-wide message counter in the bottom.
+    uint32_t chunkSize;     // The number of bytes that follow the header.
+    uint32_t flags;
+} drpipe_chunk_header;
+
+typedef struct
+{
+    uint64_t streamID;
+    unsigned char* pData;
+    size_t size;
+    size_t capacity;
+} drpipe_partial_message;
+
+// The state of drpipe_enable_multi_writer(). The partial messages are only touched by the reader.
+typedef struct
+{
+    drpipe_partial_message* pPartialMessages;
+    size_t partialMessageCount;
+    size_t partialMessageCapacity;
+} drpipe_multi_writer;
+
+#ifdef DR_IPC_ENABLE_STATS
+// The live version of drpipe_stats. The counters that change on every call come first so they share a cache line.
+typedef struct
+{
+    volatile uint64_t readCalls;
+    volatile uint64_t readBytes;
+    volatile uint64_t writeCalls;
+    volatile uint64_t writeBytes;
+    volatile uint64_t shortReads;
+    volatile uint64_t wouldBlockCount;
+    volatile uint64_t blockedTimeInNanoseconds;
+    volatile uint64_t reserved;
+    volatile uint64_t readSizeHistogram[DR_IPC_STATS_SIZE_BUCKET_COUNT];
+    volatile uint64_t writeSizeHistogram[DR_IPC_STATS_SIZE_BUCKET_COUNT];
+    volatile uint64_t latencyHistogram[DR_IPC_STATS_LATENCY_BUCKET_COUNT];
+} drpipe_stats_counters;
+#endif
+
+// A file mapped into memory for writing. Used by drpipe_start_capture().
+typedef struct
+{
+    void* pData;
+    size_t sizeInBytes;
+    void* hFile;            // Win32 only. The HANDLE of the file.
+    void* hMapping;         // Win32 only. The HANDLE of the file mapping object.
+    int fd;                 // Unix only.
+} dripc_mapped_file;
+
+// The state of drpipe_start_capture(). Records are staged in pStaging and copied to the file in one go when it fills up.
+typedef struct
+{
+    dripc_mapped_file file;
+    size_t fileOffset;      // Where the next record goes in the file.
+    uint64_t startTime;
+    unsigned char* pStaging;
+    size_t stagingLength;
+    uint64_t stagedRecordCount;     // Added to the header's record count when the staged records are flushed.
+} drpipe_capture;
+
+// State shared by every platform's pipe structure. This must always be the first member so that platform independent
+// code can get to it with a simple cast.
+typedef struct
+{
+    drpipe_buffering* pBuffering;
+    drpipe_waiting* pWaiting;   // NULL unless a wait policy other than dripc_wait_mode_block has been set.
+    drpipe_multi_writer* pMultiWriter;  // NULL unless drpipe_enable_multi_writer() has been called.
+    drpipe_capture* pCapture;   // NULL unless drpipe_start_capture() has been called.
+#ifdef DR_IPC_ENABLE_STATS
+    unsigned char statsStorage[sizeof(drpipe_stats_counters) + DR_IPC_CACHE_LINE_SIZE - 1];   // Aligned with DR_IPC_PIPE_TO_STATS().
+#endif
+} drpipe_base;
+
+#define DR_IPC_PIPE_TO_BASE(pipe)   ((drpipe_base*)(pipe))
+
+static uint64_t dripc_get_time_ns(void)
+{
+#ifdef DR_IPC_WIN32
+    LARGE_INTEGER counter;
+    LARGE_INTEGER frequency;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&frequency);
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart)*1000000000 + (uint64_t)(counter.QuadPart % frequency.QuadPart)*1000000000 / (uint64_t)frequency.QuadPart;
+#endif
+
+#ifdef DR_IPC_UNIX
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000000000 + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef DR_IPC_ENABLE_STATS
+#define DR_IPC_PIPE_TO_STATS(pipe)  ((drpipe_stats_counters*)(((uintptr_t)DR_IPC_PIPE_TO_BASE(pipe)->statsStorage + DR_IPC_CACHE_LINE_SIZE-1) & ~(uintptr_t)(DR_IPC_CACHE_LINE_SIZE-1)))
+
+static unsigned int dripc_stats_bit_length(uint64_t value)
+{
+    unsigned int length = 0;
+    while (value > 0) {
+        value >>= 1;
+        length += 1;
+    }
+
+    return length;
+}
+
+static unsigned int dripc_stats_size_bucket(size_t size)
+{
+    unsigned int bucket = dripc_stats_bit_length(size);
+    return (bucket < DR_IPC_STATS_SIZE_BUCKET_COUNT) ? bucket : DR_IPC_STATS_SIZE_BUCKET_COUNT-1;
+}
+
+// Values below 8 get a bucket each. After that, each power of two is split into 8 sub-buckets using the 3 bits that
+// follow the most significant bit.
+static unsigned int dripc_stats_latency_bucket(uint64_t nanoseconds)
+{
+    if (nanoseconds < 8) {
+        return (unsigned int)nanoseconds;
+    }
+
+    unsigned int msb = dripc_stats_bit_length(nanoseconds) - 1;
+    unsigned int bucket = (msb - 2)*8 + (unsigned int)((nanoseconds >> (msb - 3)) & 7);
+    return (bucket < DR_IPC_STATS_LATENCY_BUCKET_COUNT) ? bucket : DR_IPC_STATS_LATENCY_BUCKET_COUNT-1;
+}
+
+static void drpipe_stats_record_io(drpipe pipe, int isWrite, dripc_result result, size_t bytesTransferred, uint64_t startTime)
+{
+    drpipe_stats_counters* pStats = DR_IPC_PIPE_TO_STATS(pipe);
+    uint64_t elapsed = dripc_get_time_ns() - startTime;
+
+    if (isWrite) {
+        dripc_atomic_fetch_add_u64(&pStats->writeCalls, 1);
+        dripc_atomic_fetch_add_u64(&pStats->writeBytes, bytesTransferred);
+    } else {
+        dripc_atomic_fetch_add_u64(&pStats->readCalls, 1);
+        dripc_atomic_fetch_add_u64(&pStats->readBytes, bytesTransferred);
+    }
+
+    if (result == dripc_result_would_block) {
+        dripc_atomic_fetch_add_u64(&pStats->wouldBlockCount, 1);
+    } else if (result == dripc_result_success) {
+        volatile uint64_t* pSizeHistogram = (isWrite) ? pStats->writeSizeHistogram : pStats->readSizeHistogram;
+        dripc_atomic_fetch_add_u64(&pSizeHistogram[dripc_stats_size_bucket(bytesTransferred)], 1);
+    }
+
+    dripc_atomic_fetch_add_u64(&pStats->latencyHistogram[dripc_stats_latency_bucket(elapsed)], 1);
+    dripc_atomic_fetch_add_u64(&pStats->blockedTimeInNanoseconds, elapsed);
+}
+
+static void drpipe_stats_record_wait(drpipe pipe, uint64_t startTime)
+{
+    dripc_atomic_fetch_add_u64(&DR_IPC_PIPE_TO_STATS(pipe)->blockedTimeInNanoseconds, dripc_get_time_ns() - startTime);
+}
+
+// These compile to nothing without DR_IPC_ENABLE_STATS.
+#define DR_IPC_STATS_BEGIN(startTime)                                       uint64_t startTime = dripc_get_time_ns()
+#define DR_IPC_STATS_RECORD_IO(pipe, isWrite, result, bytes, startTime)     drpipe_stats_record_io(pipe, isWrite, result, bytes, startTime)
+#define DR_IPC_STATS_RECORD_WAIT(pipe, startTime)                           drpipe_stats_record_wait(pipe, startTime)
+#define DR_IPC_STATS_RECORD_SHORT_READ(pipe)                                dripc_atomic_fetch_add_u64(&DR_IPC_PIPE_TO_STATS(pipe)->shortReads, 1)
+#else
+#define DR_IPC_STATS_BEGIN(startTime)
+#define DR_IPC_STATS_RECORD_IO(pipe, isWrite, result, bytes, startTime)     ((void)0)
+#define DR_IPC_STATS_RECORD_WAIT(pipe, startTime)                           ((void)0)
+#define DR_IPC_STATS_RECORD_SHORT_READ(pipe)                                ((void)0)
+#endif
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Win32 Implementation
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifdef DR_IPC_WIN32
+
+#define DR_IPC_WIN32_PIPE_NAME_HEAD         "\\\\.\\pipe\\"
+#ifndef DR_IPC_WIN32_PIPE_BUFFER_SIZE
+#define DR_IPC_WIN32_PIPE_BUFFER_SIZE       512     // The default when the config does not specify a capacity.
+#endif
+#define DR_IPC_PIPE_TO_WIN32_HANDLE(pipe)   (((drpipe_win32*)pipe)->hPipe)
+#define DR_IPC_WIN32_IN_PLACE               (1u << 29)  // The pipe lives in caller provided storage and isn't freed.
+
+typedef struct
+{
+    drpipe_base base;
+    HANDLE hPipe;
+    unsigned int options;
+} drpipe_win32;
+
+typedef char drpipe_win32_fits_in_storage[(sizeof(drpipe_win32) <= sizeof(drpipe_storage)) ? 1 : -1];
+
+// Wraps a pipe handle in a drpipe. The handle is closed if this fails.
+static dripc_result drpipe_from_win32_handle(HANDLE hPipe, unsigned int options, drpipe* pPipeOut)
+{
+    drpipe_win32* pPipeWin32 = (drpipe_win32*)calloc(1, sizeof(*pPipeWin32));
+    if (pPipeWin32 == NULL) {
+        CloseHandle(hPipe);
+        return dripc_result_unknown_error;
+    }
+
+    pPipeWin32->hPipe = hPipe;
+    pPipeWin32->options = options;
+
+    *pPipeOut = (drpipe)pPipeWin32;
+    return dripc_result_success;
+}
+
+static dripc_result dripc_result_from_win32_error(DWORD dwError)
+{
+    switch (dwError)
+    {
+    case ERROR_INVALID_PARAMETER: return dripc_result_invalid_args;
+    case ERROR_ACCESS_DENIED:     return dripc_result_access_denied;
+    case ERROR_SEM_TIMEOUT:       return dripc_result_timeout;
+    case ERROR_BROKEN_PIPE:       return dripc_result_disconnected;
+    case ERROR_NO_DATA:           return dripc_result_disconnected;
+    default:                      return dripc_result_unknown_error;
+    }
+}
+
+static dripc_result drpipe_set_wait_mode__win32(HANDLE hPipe, DWORD dwWaitMode)
+{
+    DWORD dwMode = PIPE_READMODE_BYTE | dwWaitMode;
+    if (!SetNamedPipeHandleState(hPipe, &dwMode, NULL, NULL)) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    return dripc_result_success;
+}
+
+static dripc_result drpipe_set_nonblocking__win32(HANDLE hPipe)
+{
+    return drpipe_set_wait_mode__win32(hPipe, PIPE_NOWAIT);
+}
+
+static uint64_t dripc_get_tick_count__win32(void)
+{
+    return (uint64_t)GetTickCount64();
+}
+
+// Returns the number of milliseconds left before a timeout expires, or DR_IPC_INFINITE for an infinite timeout.
+static DWORD dripc_get_remaining_time__win32(uint64_t startTime, unsigned int timeoutInMilliseconds)
+{
+    if (timeoutInMilliseconds == DR_IPC_INFINITE) {
+        return DR_IPC_INFINITE;
+    }
+
+    uint64_t elapsed = dripc_get_tick_count__win32() - startTime;
+    return (elapsed >= timeoutInMilliseconds) ? 0 : (DWORD)(timeoutInMilliseconds - elapsed);
+}
+
+// Sleeps for a little longer each time it's called while polling for something that has no way of being waited on.
+static void dripc_backoff__win32(DWORD* pBackoff, DWORD remainingTime)
+{
+    DWORD sleepTime = (*pBackoff < remainingTime) ? *pBackoff : remainingTime;
+    Sleep(sleepTime);
+
+    if (*pBackoff < 32) {
+        *pBackoff = (*pBackoff == 0) ? 1 : *pBackoff * 2;
+    }
+}
+
+static DWORD drpipe_get_buffer_size__win32(const drpipe_config* pConfig)
+{
+    if (pConfig->capacity == 0) {
+        return DR_IPC_WIN32_PIPE_BUFFER_SIZE;
+    }
+
+    return (pConfig->capacity > 0x7FFFFFFF) ? 0x7FFFFFFF : (DWORD)pConfig->capacity;
+}
+
+// Returns 0 if neither DR_IPC_READ nor DR_IPC_WRITE is set.
+static DWORD drpipe_options_to_open_mode__win32(unsigned int options)
+{
+    if (options & DR_IPC_READ) {
+        if (options & DR_IPC_WRITE) {
+            return PIPE_ACCESS_DUPLEX;
+        } else {
+            return PIPE_ACCESS_INBOUND;
+        }
+    } else {
+        if (options & DR_IPC_WRITE) {
+            return PIPE_ACCESS_OUTBOUND;
+        } else {
+            return 0;
+        }
+    }
+}
+
+static HANDLE drpipe_create_instance__win32(const char* nameWin32, DWORD dwOpenMode, const drpipe_config* pConfig)
+{
+    return CreateNamedPipeA(nameWin32, dwOpenMode, PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT, PIPE_UNLIMITED_INSTANCES, drpipe_get_buffer_size__win32(pConfig), drpipe_get_buffer_size__win32(pConfig), NMPWAIT_USE_DEFAULT_WAIT, NULL);
+}
+
+dripc_result drpipe_open_named_server__win32(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut)
+{
+    unsigned int options = pConfig->options;
+
+    char nameWin32[256] = DR_IPC_WIN32_PIPE_NAME_HEAD;
+    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
+        return dripc_result_name_too_long;
+    }
+
+    DWORD dwOpenMode = drpipe_options_to_open_mode__win32(options);
+    if (dwOpenMode == 0) {
+        return dripc_result_invalid_args;   // Neither read nor write mode was specified.
+    }
+
+    HANDLE hPipeWin32 = drpipe_create_instance__win32(nameWin32, dwOpenMode | FILE_FLAG_FIRST_PIPE_INSTANCE, pConfig);
+    if (hPipeWin32 == INVALID_HANDLE_VALUE) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+
+    // Wait for a client to connect...
+    if (pConfig->timeoutInMilliseconds == DR_IPC_INFINITE) {
+        if (!ConnectNamedPipe(hPipeWin32, NULL)) {
+            DWORD dwError = GetLastError();
+            if (dwError != ERROR_PIPE_CONNECTED) {  // The client connected between CreateNamedPipe() and ConnectNamedPipe().
+                CloseHandle(hPipeWin32);
+                return dripc_result_from_win32_error(dwError);
+            }
+        }
+    } else {
+        // A pipe in non-blocking mode makes ConnectNamedPipe() return straight away which is the only way to put a time
+        // limit on it without switching the whole pipe over to overlapped I/O.
+        dripc_result result = drpipe_set_nonblocking__win32(hPipeWin32);
+        if (result != dripc_result_success) {
+            CloseHandle(hPipeWin32);
+            return result;
+        }
+
+        uint64_t startTime = dripc_get_tick_count__win32();
+        DWORD backoff = 0;
+        for (;;) {
+            if (ConnectNamedPipe(hPipeWin32, NULL)) {
+                break;
+            }
+
+            DWORD dwError = GetLastError();
+            if (dwError == ERROR_PIPE_CONNECTED || dwError == ERROR_NO_DATA) {
+                break;  // ERROR_NO_DATA means the client has already been and gone. Reads will report that.
+            }
+            if (dwError != ERROR_PIPE_LISTENING) {
+                CloseHandle(hPipeWin32);
+                return dripc_result_from_win32_error(dwError);
+            }
+
+            DWORD remainingTime = dripc_get_remaining_time__win32(startTime, pConfig->timeoutInMilliseconds);
+            if (remainingTime == 0) {
+                CloseHandle(hPipeWin32);
+                return dripc_result_timeout;
+            }
+
+            dripc_backoff__win32(&backoff, remainingTime);
+        }
+
+        if ((options & DR_IPC_NONBLOCK) == 0) {
+            result = drpipe_set_wait_mode__win32(hPipeWin32, PIPE_WAIT);
+            if (result != dripc_result_success) {
+                CloseHandle(hPipeWin32);
+                return result;
+            }
+        }
+    }
+
+    // Non-blocking mode is only switched on after connecting so that the server still waits for a client.
+    if (options & DR_IPC_NONBLOCK) {
+        dripc_result result = drpipe_set_nonblocking__win32(hPipeWin32);
+        if (result != dripc_result_success) {
+            CloseHandle(hPipeWin32);
+            return result;
+        }
+    }
+
+
+    return drpipe_from_win32_handle(hPipeWin32, options, pPipeOut);
+}
+
+dripc_result drpipe_open_named_client__win32(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut)
+{
+    unsigned int options = pConfig->options;
+
+    char nameWin32[256] = DR_IPC_WIN32_PIPE_NAME_HEAD;
+    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
+        return dripc_result_name_too_long;
+    }
+
+    DWORD dwDesiredAccess = 0;
+    if (options & DR_IPC_READ) {
+        dwDesiredAccess |= GENERIC_READ;
+    }
+    if (options & DR_IPC_WRITE) {
+        dwDesiredAccess |= GENERIC_WRITE;
+    }
+
+    if (dwDesiredAccess == 0) {
+        return dripc_result_invalid_args;   // Neither read nor write mode was specified.
+    }
+
+    uint64_t startTime = dripc_get_tick_count__win32();
+    DWORD backoff = 0;
+    for (;;) {
+        HANDLE hPipeWin32 = CreateFileA(nameWin32, dwDesiredAccess, 0, NULL, OPEN_EXISTING, 0, NULL);
+        if (hPipeWin32 == INVALID_HANDLE_VALUE) {
+            DWORD dwError = GetLastError();
+            DWORD remainingTime = dripc_get_remaining_time__win32(startTime, pConfig->timeoutInMilliseconds);
+
+            if (dwError == ERROR_PIPE_BUSY) {
+                // Every instance is in use. Wait for the server to make another one available instead of spinning.
+                if (remainingTime == 0) {
+                    return dripc_result_timeout;
+                }
+                if (!WaitNamedPipeA(nameWin32, (remainingTime == DR_IPC_INFINITE) ? NMPWAIT_WAIT_FOREVER : remainingTime)) {
+                    dwError = GetLastError();
+                    if (dwError == ERROR_SEM_TIMEOUT) {
+                        return dripc_result_timeout;
+                    }
+                    if (dwError != ERROR_FILE_NOT_FOUND) {
+                        return dripc_result_from_win32_error(dwError);
+                    }
+                }
+            } else if (dwError == ERROR_FILE_NOT_FOUND && remainingTime != 0) {
+                // The server hasn't created the pipe yet.
+                dripc_backoff__win32(&backoff, remainingTime);
+            } else {
+                return dripc_result_from_win32_error(dwError);
+            }
+        } else {
+            if (options & DR_IPC_NONBLOCK) {
+                dripc_result result = drpipe_set_nonblocking__win32(hPipeWin32);
+                if (result != dripc_result_success) {
+                    CloseHandle(hPipeWin32);
+                    return result;
+                }
+            }
+
+            return drpipe_from_win32_handle(hPipeWin32, options, pPipeOut);
+        }
+    }
+}
+
+#ifndef DR_IPC_WIN32_DEFAULT_SERVER_POOL_SIZE
+#define DR_IPC_WIN32_DEFAULT_SERVER_POOL_SIZE   4
+#endif
+
+typedef struct drpipe_server_win32 drpipe_server_win32;
+
+typedef struct
+{
+    drpipe_server_win32* pServer;
+    HANDLE hThread;
+    HANDLE hPipe;   // The instance the thread is listening on. Owned by the thread once it has started.
+} drpipe_server_listener__win32;
+
+// Each listener thread waits for a client on its own instance, hands the connected instance over to the ready queue and
+// then creates a new one. The ready queue holds at most one connection per listener so a server that isn't accepting
+// stops creating instances and new clients wait in WaitNamedPipe() instead.
+struct drpipe_server_win32
+{
+    char name[256];
+    drpipe_config config;
+    DWORD dwOpenMode;
+    volatile uint32_t isStopping;
+    CRITICAL_SECTION lock;
+    HANDLE hReadySemaphore;     // Signaled once for each connection in the ready queue.
+    HANDLE hFreeSemaphore;      // Signaled once for each free slot in the ready queue.
+    HANDLE* pReadyPipes;        // A ring buffer of connected instances waiting to be accepted.
+    unsigned int readyHead;
+    unsigned int readyCount;
+    unsigned int listenerCount;
+    drpipe_server_listener__win32* pListeners;
+};
+
+static DWORD WINAPI drpipe_server_listener_thread__win32(LPVOID pUserData)
+{
+    drpipe_server_listener__win32* pListener = (drpipe_server_listener__win32*)pUserData;
+    drpipe_server_win32* pServer = pListener->pServer;
+    HANDLE hPipe = pListener->hPipe;
+
+    while (!dripc_atomic_load_u32(&pServer->isStopping)) {
+        if (hPipe == INVALID_HANDLE_VALUE) {
+            hPipe = drpipe_create_instance__win32(pServer->name, pServer->dwOpenMode, &pServer->config);
+            if (hPipe == INVALID_HANDLE_VALUE) {
+                Sleep(1);   // Most likely out of resources. Try again rather than giving up on the pool for good.
+                continue;
+            }
+        }
+
+        // This is interrupted with CancelSynchronousIo() when the server is closed.
+        if (!ConnectNamedPipe(hPipe, NULL)) {
+            DWORD dwError = GetLastError();
+            if (dwError != ERROR_PIPE_CONNECTED) {  // The client connected between CreateNamedPipe() and ConnectNamedPipe().
+                DisconnectNamedPipe(hPipe);         // ERROR_NO_DATA means the client has already been and gone.
+                continue;
+            }
+        }
+
+        WaitForSingleObject(pServer->hFreeSemaphore, INFINITE);
+        if (dripc_atomic_load_u32(&pServer->isStopping)) {
+            break;
+        }
+
+        EnterCriticalSection(&pServer->lock);
+        {
+            pServer->pReadyPipes[(pServer->readyHead + pServer->readyCount) % pServer->listenerCount] = hPipe;
+            pServer->readyCount += 1;
+        }
+        LeaveCriticalSection(&pServer->lock);
+        ReleaseSemaphore(pServer->hReadySemaphore, 1, NULL);
+
+        hPipe = INVALID_HANDLE_VALUE;
+    }
+
+    if (hPipe != INVALID_HANDLE_VALUE) {
+        CloseHandle(hPipe);
+    }
+
+    return 0;
+}
+
+void drpipe_server_close__win32(drpipe_server server);
+
+dripc_result drpipe_server_open__win32(const char* name, const drpipe_config* pConfig, unsigned int poolSize, drpipe_server* pServerOut)
+{
+    if (poolSize == 0) {
+        poolSize = DR_IPC_WIN32_DEFAULT_SERVER_POOL_SIZE;
+    }
+
+    DWORD dwOpenMode = drpipe_options_to_open_mode__win32(pConfig->options);
+    if (dwOpenMode == 0) {
+        return dripc_result_invalid_args;   // Neither read nor write mode was specified.
+    }
+
+    drpipe_server_win32* pServer = (drpipe_server_win32*)calloc(1, sizeof(*pServer) + poolSize*(sizeof(*pServer->pListeners) + sizeof(*pServer->pReadyPipes)));
+    if (pServer == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    strcpy_s(pServer->name, sizeof(pServer->name), DR_IPC_WIN32_PIPE_NAME_HEAD);
+    if (strcat_s(pServer->name, sizeof(pServer->name), name) != 0) {
+        free(pServer);
+        return dripc_result_name_too_long;
+    }
+
+    pServer->config        = *pConfig;
+    pServer->dwOpenMode    = dwOpenMode;
+    pServer->listenerCount = poolSize;
+    pServer->pListeners    = (drpipe_server_listener__win32*)(pServer + 1);
+    pServer->pReadyPipes   = (HANDLE*)(pServer->pListeners + poolSize);
+    InitializeCriticalSection(&pServer->lock);
+
+    pServer->hReadySemaphore = CreateSemaphoreA(NULL, 0, (LONG)poolSize, NULL);
+    pServer->hFreeSemaphore  = CreateSemaphoreA(NULL, (LONG)poolSize, (LONG)poolSize, NULL);
+    if (pServer->hReadySemaphore == NULL || pServer->hFreeSemaphore == NULL) {
+        DWORD dwError = GetLastError();
+        drpipe_server_close__win32((drpipe_server)pServer);
+        return dripc_result_from_win32_error(dwError);
+    }
+
+    // Every instance is created up front so that clients can connect as soon as this returns, and so that a name that's
+    // already in use fails here rather than in a listener thread.
+    unsigned int iListener;
+    for (iListener = 0; iListener < poolSize; ++iListener) {
+        drpipe_server_listener__win32* pListener = &pServer->pListeners[iListener];
+        pListener->pServer = pServer;
+        pListener->hPipe   = drpipe_create_instance__win32(pServer->name, dwOpenMode | ((iListener == 0) ? FILE_FLAG_FIRST_PIPE_INSTANCE : 0), pConfig);
+        if (pListener->hPipe == INVALID_HANDLE_VALUE) {
+            DWORD dwError = GetLastError();
+            drpipe_server_close__win32((drpipe_server)pServer);
+            return dripc_result_from_win32_error(dwError);
+        }
+    }
+
+    for (iListener = 0; iListener < poolSize; ++iListener) {
+        drpipe_server_listener__win32* pListener = &pServer->pListeners[iListener];
+        pListener->hThread = CreateThread(NULL, 0, drpipe_server_listener_thread__win32, pListener, 0, NULL);
+        if (pListener->hThread == NULL) {
+            DWORD dwError = GetLastError();
+            drpipe_server_close__win32((drpipe_server)pServer);
+            return dripc_result_from_win32_error(dwError);
+        }
+    }
+
+    *pServerOut = (drpipe_server)pServer;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_server_accept__win32(drpipe_server server, unsigned int timeoutInMilliseconds, drpipe* pPipeOut)
+{
+    drpipe_server_win32* pServer = (drpipe_server_win32*)server;
+
+    DWORD waitResult = WaitForSingleObject(pServer->hReadySemaphore, (timeoutInMilliseconds == DR_IPC_INFINITE) ? INFINITE : timeoutInMilliseconds);
+    if (waitResult == WAIT_TIMEOUT) {
+        return dripc_result_timeout;
+    }
+    if (waitResult != WAIT_OBJECT_0) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    HANDLE hPipe;
+    EnterCriticalSection(&pServer->lock);
+    {
+        hPipe = pServer->pReadyPipes[pServer->readyHead];
+        pServer->readyHead   = (pServer->readyHead + 1) % pServer->listenerCount;
+        pServer->readyCount -= 1;
+    }
+    LeaveCriticalSection(&pServer->lock);
+    ReleaseSemaphore(pServer->hFreeSemaphore, 1, NULL);
+
+    if (pServer->config.options & DR_IPC_NONBLOCK) {
+        dripc_result result = drpipe_set_nonblocking__win32(hPipe);
+        if (result != dripc_result_success) {
+            CloseHandle(hPipe);
+            return result;
+        }
+    }
+
+    return drpipe_from_win32_handle(hPipe, pServer->config.options, pPipeOut);
+}
+
+void drpipe_server_close__win32(drpipe_server server)
+{
+    drpipe_server_win32* pServer = (drpipe_server_win32*)server;
+
+    dripc_atomic_store_u32(&pServer->isStopping, 1);
+    if (pServer->hFreeSemaphore != NULL) {
+        ReleaseSemaphore(pServer->hFreeSemaphore, (LONG)pServer->listenerCount, NULL);
+    }
+
+    unsigned int iListener;
+    for (iListener = 0; iListener < pServer->listenerCount; ++iListener) {
+        drpipe_server_listener__win32* pListener = &pServer->pListeners[iListener];
+        if (pListener->hThread != NULL) {
+            // The thread may not have reached ConnectNamedPipe() yet when it's first cancelled so keep trying until it exits.
+            do {
+                CancelSynchronousIo(pListener->hThread);
+            } while (WaitForSingleObject(pListener->hThread, 1) == WAIT_TIMEOUT);
+
+            CloseHandle(pListener->hThread);
+        } else if (pListener->hPipe != NULL && pListener->hPipe != INVALID_HANDLE_VALUE) {
+            CloseHandle(pListener->hPipe);  // The thread was never started so the instance is still ours.
+        }
+    }
+
+    // Connections that were never accepted.
+    while (pServer->readyCount > 0) {
+        CloseHandle(pServer->pReadyPipes[pServer->readyHead]);
+        pServer->readyHead   = (pServer->readyHead + 1) % pServer->listenerCount;
+        pServer->readyCount -= 1;
+    }
+
+    if (pServer->hReadySemaphore != NULL) {
+        CloseHandle(pServer->hReadySemaphore);
+    }
+    if (pServer->hFreeSemaphore != NULL) {
+        CloseHandle(pServer->hFreeSemaphore);
+    }
+
+    DeleteCriticalSection(&pServer->lock);
+    free(pServer);
+}
+
+dripc_result drpipe_open_anonymous_in_place__win32(const drpipe_config* pConfig, void* pStorageRead, void* pStorageWrite, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    unsigned int options = pConfig->options;
+
+    HANDLE hPipeReadWin32;
+    HANDLE hPipeWriteWin32;
+    if (!CreatePipe(&hPipeReadWin32, &hPipeWriteWin32, NULL, drpipe_get_buffer_size__win32(pConfig))) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    // Anonymous pipes are implemented as named pipes so they support the same non-blocking mode.
+    if (options & DR_IPC_NONBLOCK) {
+        if (drpipe_set_nonblocking__win32(hPipeReadWin32) != dripc_result_success || drpipe_set_nonblocking__win32(hPipeWriteWin32) != dripc_result_success) {
+            CloseHandle(hPipeReadWin32);
+            CloseHandle(hPipeWriteWin32);
+            return dripc_result_unknown_error;
+        }
+    }
+
+    drpipe_win32* pPipeReadWin32  = (drpipe_win32*)pStorageRead;
+    drpipe_win32* pPipeWriteWin32 = (drpipe_win32*)pStorageWrite;
+    memset(pPipeReadWin32,  0, sizeof(*pPipeReadWin32));
+    memset(pPipeWriteWin32, 0, sizeof(*pPipeWriteWin32));
+    pPipeReadWin32->hPipe    = hPipeReadWin32;
+    pPipeReadWin32->options  = DR_IPC_READ  | DR_IPC_WIN32_IN_PLACE | (options & DR_IPC_NONBLOCK);
+    pPipeWriteWin32->hPipe   = hPipeWriteWin32;
+    pPipeWriteWin32->options = DR_IPC_WRITE | DR_IPC_WIN32_IN_PLACE | (options & DR_IPC_NONBLOCK);
+
+    *pPipeRead  = (drpipe)pPipeReadWin32;
+    *pPipeWrite = (drpipe)pPipeWriteWin32;
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_open_anonymous__win32(const drpipe_config* pConfig, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    drpipe_win32* pPipeReadWin32 = (drpipe_win32*)malloc(sizeof(*pPipeReadWin32));
+    if (pPipeReadWin32 == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    drpipe_win32* pPipeWriteWin32 = (drpipe_win32*)malloc(sizeof(*pPipeWriteWin32));
+    if (pPipeWriteWin32 == NULL) {
+        free(pPipeReadWin32);
+        return dripc_result_unknown_error;
+    }
+
+    dripc_result result = drpipe_open_anonymous_in_place__win32(pConfig, pPipeReadWin32, pPipeWriteWin32, pPipeRead, pPipeWrite);
+    if (result != dripc_result_success) {
+        free(pPipeWriteWin32);
+        free(pPipeReadWin32);
+        return result;
+    }
+
+    pPipeReadWin32->options  &= ~DR_IPC_WIN32_IN_PLACE;
+    pPipeWriteWin32->options &= ~DR_IPC_WIN32_IN_PLACE;
+
+    return dripc_result_success;
+}
+
+void drpipe_close__win32(drpipe pipe)
+{
+    CloseHandle(DR_IPC_PIPE_TO_WIN32_HANDLE(pipe));
+
+    if ((((drpipe_win32*)pipe)->options & DR_IPC_WIN32_IN_PLACE) == 0) {
+        free(pipe);
+    }
+}
+
+dripc_result drpipe_get_bytes_pending__win32(drpipe pipe, size_t* pBytesPending)
+{
+    DWORD dwBytesAvailable;
+    if (!PeekNamedPipe(DR_IPC_PIPE_TO_WIN32_HANDLE(pipe), NULL, 0, NULL, &dwBytesAvailable, NULL)) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    *pBytesPending = dwBytesAvailable;
+    return dripc_result_success;
+}
+
+
+dripc_result drpipe_get_capacity__win32(drpipe pipe, size_t* pCapacity)
+{
+    DWORD dwOutBufferSize;
+    DWORD dwInBufferSize;
+    if (!GetNamedPipeInfo(DR_IPC_PIPE_TO_WIN32_HANDLE(pipe), NULL, &dwOutBufferSize, &dwInBufferSize, NULL)) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    *pCapacity = (dwOutBufferSize > dwInBufferSize) ? dwOutBufferSize : dwInBufferSize;
+    return dripc_result_success;
+}
+
+
+dripc_result drpipe_connect__win32(drpipe pipe)
+{
+    if (!ConnectNamedPipe(DR_IPC_PIPE_TO_WIN32_HANDLE(pipe), NULL)) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    return dripc_result_success;
+}
+
+
+dripc_result drpipe_read__win32(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    HANDLE hPipe = DR_IPC_PIPE_TO_WIN32_HANDLE(pipe);
+
+    DR_IPC_STATS_BEGIN(startTime);
+
+    DWORD dwBytesRead;
+    if (!ReadFile(hPipe, pDataOut, (DWORD)bytesToRead, &dwBytesRead, NULL)) {
+        DWORD dwError = GetLastError();
+        dripc_result result = (dwError == ERROR_NO_DATA) ? dripc_result_would_block : dripc_result_from_win32_error(dwError);   // ERROR_NO_DATA is a non-blocking pipe with nothing to read.
+        DR_IPC_STATS_RECORD_IO(pipe, 0, result, 0, startTime);
+        return result;
+    }
+
+    DR_IPC_STATS_RECORD_IO(pipe, 0, dripc_result_success, dwBytesRead, startTime);
+
+    if (pBytesRead) *pBytesRead = dwBytesRead;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_write__win32(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    HANDLE hPipe = DR_IPC_PIPE_TO_WIN32_HANDLE(pipe);
+
+    DR_IPC_STATS_BEGIN(startTime);
+
+    DWORD dwBytesWritten;
+    if (!WriteFile(hPipe, pData, (DWORD)bytesToWrite, &dwBytesWritten, NULL)) {
+        dripc_result result = dripc_result_from_win32_error(GetLastError());
+        DR_IPC_STATS_RECORD_IO(pipe, 1, result, 0, startTime);
+        return result;
+    }
+
+    // A non-blocking pipe reports success without writing anything when there's no room.
+    if (dwBytesWritten == 0 && bytesToWrite > 0) {
+        DR_IPC_STATS_RECORD_IO(pipe, 1, dripc_result_would_block, 0, startTime);
+        return dripc_result_would_block;
+    }
+
+    DR_IPC_STATS_RECORD_IO(pipe, 1, dripc_result_success, dwBytesWritten, startTime);
+
+    if (pBytesWritten) *pBytesWritten = dwBytesWritten;
+    return dripc_result_success;
+}
+
+// Named and anonymous pipes can't be waited on without overlapped I/O, so this polls for data with a backoff.
+dripc_result drpipe_wait_readable__win32(drpipe pipe, unsigned int timeoutInMilliseconds)
+{
+    HANDLE hPipe = DR_IPC_PIPE_TO_WIN32_HANDLE(pipe);
+
+    uint64_t startTime = dripc_get_tick_count__win32();
+    DWORD backoff = 0;
+    for (;;) {
+        DWORD dwBytesAvailable;
+        if (!PeekNamedPipe(hPipe, NULL, 0, NULL, &dwBytesAvailable, NULL) || dwBytesAvailable > 0) {
+            break;  // If the pipe is broken ReadFile() will report it.
+        }
+
+        DWORD remainingTime = dripc_get_remaining_time__win32(startTime, timeoutInMilliseconds);
+        if (remainingTime == 0) {
+            return dripc_result_timeout;
+        }
+
+        dripc_backoff__win32(&backoff, remainingTime);
+    }
+
+    return dripc_result_success;
+}
+
+// Returns non-zero if reading would not block. A broken pipe counts because ReadFile() will report it straight away.
+static int drpipe_poll_readable__win32(drpipe pipe)
+{
+    DWORD dwBytesAvailable;
+    return !PeekNamedPipe(DR_IPC_PIPE_TO_WIN32_HANDLE(pipe), NULL, 0, NULL, &dwBytesAvailable, NULL) || dwBytesAvailable > 0;
+}
+
+// The pipe is switched to non-blocking mode for the duration of the write so that it can give up at the deadline.
+dripc_result drpipe_write_timeout__win32(drpipe pipe, const void* pData, size_t bytesToWrite, unsigned int timeoutInMilliseconds, size_t* pBytesWritten)
+{
+    drpipe_win32* pPipeWin32 = (drpipe_win32*)pipe;
+
+    if ((pPipeWin32->options & DR_IPC_NONBLOCK) == 0) {
+        dripc_result result = drpipe_set_nonblocking__win32(pPipeWin32->hPipe);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+    dripc_result result = dripc_result_success;
+    uint64_t startTime = dripc_get_tick_count__win32();
+    DWORD backoff = 0;
+    while (*pBytesWritten < bytesToWrite) {
+        size_t bytesWritten;
+        result = drpipe_write__win32(pipe, (const char*)pData + *pBytesWritten, bytesToWrite - *pBytesWritten, &bytesWritten);
+        if (result == dripc_result_would_block) {
+            DWORD remainingTime = dripc_get_remaining_time__win32(startTime, timeoutInMilliseconds);
+            if (remainingTime == 0) {
+                result = dripc_result_timeout;
+                break;
+            }
+
+            dripc_backoff__win32(&backoff, remainingTime);
+            continue;
+        }
+        if (result != dripc_result_success) {
+            break;
+        }
+
+        *pBytesWritten += bytesWritten;
+        backoff = 0;
+    }
+
+    if ((pPipeWin32->options & DR_IPC_NONBLOCK) == 0) {
+        drpipe_set_wait_mode__win32(pPipeWin32->hPipe, PIPE_WAIT);
+    }
+
+    return result;
+}
+
+// Writes all of the given data. *pStarted is used to track whether or not any part of the current message has been
+// written. Once it has, non-blocking pipes are waited on rather than returning dripc_result_would_block.
+static dripc_result drpipe_write_all__win32(drpipe pipe, const void* pData, size_t bytesToWrite, int* pStarted)
+{
+    while (bytesToWrite > 0) {
+        size_t bytesWritten;
+        dripc_result result = drpipe_write__win32(pipe, pData, bytesToWrite, &bytesWritten);
+        if (result == dripc_result_would_block && *pStarted) {
+            Sleep(0);
+            continue;
+        }
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        *pStarted = 1;
+        pData = (const void*)((const char*)pData + bytesWritten);
+        bytesToWrite -= bytesWritten;
+    }
+
+    return dripc_result_success;
+}
+
+static dripc_result drpipe_read_all__win32(drpipe pipe, void* pDataOut, size_t bytesToRead, int* pStarted)
+{
+    while (bytesToRead > 0) {
+        size_t bytesRead;
+        dripc_result result = drpipe_read__win32(pipe, pDataOut, bytesToRead, &bytesRead);
+        if (result == dripc_result_would_block && *pStarted) {
+            Sleep(0);
+            continue;
+        }
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        *pStarted = 1;
+        pDataOut = (void*)((char*)pDataOut + bytesRead);
+        bytesToRead -= bytesRead;
+    }
+
+    return dripc_result_success;
+}
+
+// Win32 has no gather write for pipes so each fragment is written separately.
+dripc_result drpipe_send_message__win32(drpipe pipe, uint32_t messageSize, const dripc_buffer* pBuffers, size_t bufferCount)
+{
+    int started = 0;
+    dripc_result result = drpipe_write_all__win32(pipe, &messageSize, sizeof(messageSize), &started);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        result = drpipe_write_all__win32(pipe, pBuffers[iBuffer].pData, pBuffers[iBuffer].sizeInBytes, &started);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+    return dripc_result_success;
+}
+
+// Messages whose result is not dripc_result_success on the way in were rejected by drpipe_write_batch() and are skipped.
+dripc_result drpipe_write_batch__win32(drpipe pipe, dripc_message* pMessages, size_t messageCount, size_t* pMessagesWritten)
+{
+    size_t iMessage;
+    for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+        if (pMessages[iMessage].result != dripc_result_success) {
+            continue;
+        }
+
+        dripc_buffer buffer;
+        buffer.pData       = pMessages[iMessage].pData;
+        buffer.sizeInBytes = pMessages[iMessage].sizeInBytes;
+
+        dripc_result result = drpipe_send_message__win32(pipe, (uint32_t)buffer.sizeInBytes, &buffer, 1);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        *pMessagesWritten += 1;
+    }
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_recv_message__win32(drpipe pipe, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    int started = 0;
+    uint32_t messageSize;
+    dripc_result result = drpipe_read_all__win32(pipe, &messageSize, sizeof(messageSize), &started);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    *pMessageSize = messageSize;
+
+    size_t bytesRemaining = messageSize;
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount && bytesRemaining > 0; ++iBuffer) {
+        size_t bytesThisBuffer = (pBuffers[iBuffer].sizeInBytes < bytesRemaining) ? pBuffers[iBuffer].sizeInBytes : bytesRemaining;
+        result = drpipe_read_all__win32(pipe, pBuffers[iBuffer].pData, bytesThisBuffer, &started);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        bytesRemaining -= bytesThisBuffer;
+    }
+
+    // Anything that didn't fit needs to be discarded.
+    if (bytesRemaining > 0) {
+        while (bytesRemaining > 0) {
+            char discard[4096];
+            size_t bytesToDiscard = (bytesRemaining < sizeof(discard)) ? bytesRemaining : sizeof(discard);
+            result = drpipe_read_all__win32(pipe, discard, bytesToDiscard, &started);
+            if (result != dripc_result_success) {
+                return result;
+            }
+
+            bytesRemaining -= bytesToDiscard;
+        }
+
+        return dripc_result_too_large;
+    }
+
+    return dripc_result_success;
+}
+
+size_t drpipe_get_translated_name__win32(const char* name, char* nameOut, size_t nameOutSize)
+{
+    if (nameOut != NULL && nameOutSize == 0) {
+        return 0;
+    }
+
+    char nameWin32[256] = DR_IPC_WIN32_PIPE_NAME_HEAD;
+    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
+        return dripc_result_name_too_long;
+    }
+
+    if (nameOut != NULL) {
+        strcpy_s(nameOut, nameOutSize, nameWin32);
+    }
+
+    return strlen(nameWin32);
+}
+
+
+#define DR_IPC_WIN32_SHM_NAME_HEAD          "Local\\"
+
+dripc_result dripc_shm_create__win32(const char* name, size_t sizeInBytes, dripc_shm* pShm)
+{
+    char nameWin32[256] = DR_IPC_WIN32_SHM_NAME_HEAD;
+    if (name != NULL && strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
+        return dripc_result_name_too_long;
+    }
+
+    unsigned long long sizeInBytes64 = (unsigned long long)sizeInBytes;
+    HANDLE hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)(sizeInBytes64 >> 32), (DWORD)(sizeInBytes64 & 0xFFFFFFFF), (name != NULL) ? nameWin32 : NULL);
+    if (hMapping == NULL) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        CloseHandle(hMapping);
+        return dripc_result_unknown_error;
+    }
+
+    void* pData = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeInBytes);
+    if (pData == NULL) {
+        DWORD dwError = GetLastError();
+        CloseHandle(hMapping);
+        return dripc_result_from_win32_error(dwError);
+    }
+
+    pShm->pData = pData;
+    pShm->sizeInBytes = sizeInBytes;
+    pShm->hMapping = (void*)hMapping;
+    pShm->isOwner = (name != NULL);
+    strcpy_s(pShm->name, sizeof(pShm->name), (name != NULL) ? nameWin32 : "");
+
+    return dripc_result_success;
+}
+
+dripc_result dripc_shm_open__win32(const char* name, dripc_shm* pShm)
+{
+    char nameWin32[256] = DR_IPC_WIN32_SHM_NAME_HEAD;
+    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
+        return dripc_result_name_too_long;
+    }
+
+    HANDLE hMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, nameWin32);
+    if (hMapping == NULL) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    void* pData = MapViewOfFile(hMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+    if (pData == NULL) {
+        DWORD dwError = GetLastError();
+        CloseHandle(hMapping);
+        return dripc_result_from_win32_error(dwError);
+    }
+
+    // The size of the view is rounded up to the page size which is fine since each primitive stores its own size in a header.
+    MEMORY_BASIC_INFORMATION mbi;
+    if (VirtualQuery(pData, &mbi, sizeof(mbi)) == 0) {
+        DWORD dwError = GetLastError();
+        UnmapViewOfFile(pData);
+        CloseHandle(hMapping);
+        return dripc_result_from_win32_error(dwError);
+    }
+
+    pShm->pData = pData;
+    pShm->sizeInBytes = mbi.RegionSize;
+    pShm->hMapping = (void*)hMapping;
+    pShm->isOwner = 0;
+    strcpy_s(pShm->name, sizeof(pShm->name), nameWin32);
+
+    return dripc_result_success;
+}
+
+dripc_result dripc_shm_create_anonymous_pair__win32(size_t sizeInBytes, dripc_shm* pShm0, dripc_shm* pShm1)
+{
+    dripc_result result = dripc_shm_create__win32(NULL, sizeInBytes, pShm0);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    void* pData = MapViewOfFile((HANDLE)pShm0->hMapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeInBytes);
+    if (pData == NULL) {
+        DWORD dwError = GetLastError();
+        UnmapViewOfFile(pShm0->pData);
+        CloseHandle((HANDLE)pShm0->hMapping);
+        return dripc_result_from_win32_error(dwError);
+    }
+
+    // Each view keeps the underlying section alive so the mapping handle itself is no longer needed.
+    CloseHandle((HANDLE)pShm0->hMapping);
+    pShm0->hMapping = NULL;
+
+    *pShm1 = *pShm0;
+    pShm1->pData = pData;
+
+    return dripc_result_success;
+}
+
+void dripc_shm_close__win32(dripc_shm* pShm)
+{
+    UnmapViewOfFile(pShm->pData);
+
+    if (pShm->hMapping != NULL) {
+        CloseHandle((HANDLE)pShm->hMapping);
+    }
+}
+
+dripc_result dripc_map_file__win32(const char* path, size_t sizeInBytes, dripc_mapped_file* pFile)
+{
+    HANDLE hFile = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hFile == INVALID_HANDLE_VALUE) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, (DWORD)((unsigned long long)sizeInBytes >> 32), (DWORD)(sizeInBytes & 0xFFFFFFFF), NULL);
+    if (hMapping == NULL) {
+        dripc_result result = dripc_result_from_win32_error(GetLastError());
+        CloseHandle(hFile);
+        return result;
+    }
+
+    void* pData = MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, sizeInBytes);
+    if (pData == NULL) {
+        dripc_result result = dripc_result_from_win32_error(GetLastError());
+        CloseHandle(hMapping);
+        CloseHandle(hFile);
+        return result;
+    }
+
+    pFile->pData       = pData;
+    pFile->sizeInBytes = sizeInBytes;
+    pFile->hFile       = (void*)hFile;
+    pFile->hMapping    = (void*)hMapping;
+
+    return dripc_result_success;
+}
+
+// Unmaps a file and cuts it down to the given size.
+void dripc_unmap_file__win32(dripc_mapped_file* pFile, size_t finalSizeInBytes)
+{
+    UnmapViewOfFile(pFile->pData);
+    CloseHandle((HANDLE)pFile->hMapping);
+
+    LARGE_INTEGER size;
+    size.QuadPart = (LONGLONG)finalSizeInBytes;
+    if (SetFilePointerEx((HANDLE)pFile->hFile, size, NULL, FILE_BEGIN)) {
+        SetEndOfFile((HANDLE)pFile->hFile);
+    }
+
+    CloseHandle((HANDLE)pFile->hFile);
+}
+
+size_t drshm_get_translated_name__win32(const char* name, char* nameOut, size_t nameOutSize)
+{
+    if (nameOut != NULL && nameOutSize == 0) {
+        return 0;
+    }
+
+    char nameWin32[256] = DR_IPC_WIN32_SHM_NAME_HEAD;
+    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
+        return 0;
+    }
+
+    if (nameOut != NULL && strcpy_s(nameOut, nameOutSize, nameWin32) != 0) {
+        return 0;
+    }
+
+    return strlen(nameWin32);
+}
+
+static size_t drshm_region_get_page_size__win32(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+}
+
+// Huge pages and NUMA binding are not supported on Win32. Large page sections need a privilege most processes don't
+// have, so a region is always ordinary shared memory.
+dripc_result drshm_region_open_named_server__win32(const char* name, size_t sizeInBytes, const drshm_region_config* pConfig, drshm_region_state* pRegion)
+{
+    dripc_result result = dripc_shm_create__win32(name, sizeInBytes, &pRegion->shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    pRegion->pageSize = drshm_region_get_page_size__win32();
+    if ((pConfig->options & DR_IPC_SHM_PREFAULT) != 0) {
+        drshm_region_prefault(pRegion);
+    }
+
+    return dripc_result_success;
+}
+
+dripc_result drshm_region_open_named_client__win32(const char* name, const drshm_region_config* pConfig, drshm_region_state* pRegion)
+{
+    dripc_result result = dripc_shm_open__win32(name, &pRegion->shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    pRegion->pageSize = drshm_region_get_page_size__win32();
+    if ((pConfig->options & DR_IPC_SHM_PREFAULT) != 0) {
+        drshm_region_prefault(pRegion);
+    }
+
+    return dripc_result_success;
+}
+
+// Win32 does not have a way to wait on an address across processes so this just sleeps. The caller will re-check the
+// condition it is waiting on.
+void dripc_futex_wait__win32(volatile uint32_t* pAddress, uint32_t expectedValue)
+{
+    (void)pAddress;
+    (void)expectedValue;
+    Sleep(1);
+}
+
+void dripc_futex_wake__win32(volatile uint32_t* pAddress)
+{
+    (void)pAddress;
+}
+
+typedef struct
+{
+    HANDLE hProcess;
+} dripc_process__win32;
+
+// Appends an argument to a command line, quoted the way the C runtime's parser expects. A run of backslashes is only
+// special when it's followed by a quote.
+static char* dripc_append_quoted_arg__win32(char* pCommandLine, const char* arg)
+{
+    *pCommandLine++ = '"';
+    for (;;) {
+        size_t backslashCount = 0;
+        while (*arg == '\\') {
+            backslashCount += 1;
+            arg += 1;
+        }
+
+        if (*arg == '\0') {
+            backslashCount *= 2;
+        } else if (*arg == '"') {
+            backslashCount = backslashCount*2 + 1;
+        }
+
+        while (backslashCount > 0) {
+            *pCommandLine++ = '\\';
+            backslashCount -= 1;
+        }
+
+        if (*arg == '\0') {
+            break;
+        }
+
+        *pCommandLine++ = *arg++;
+    }
+    *pCommandLine++ = '"';
+
+    return pCommandLine;
+}
+
+dripc_result dripc_spawn__win32(const char* path, const char* const* ppArgs, const char* const* ppEnv, dripc_spawn_fd* pFDs, size_t fdCount, dripc_process* pProcessOut)
+{
+    const char* pDefaultArgs[2];
+    if (ppArgs == NULL) {
+        pDefaultArgs[0] = path;
+        pDefaultArgs[1] = NULL;
+        ppArgs = pDefaultArgs;
+    }
+
+    // Every character can need escaping, plus quotes and a separator for each argument.
+    size_t commandLineSize = 1;
+    size_t iArg;
+    for (iArg = 0; ppArgs[iArg] != NULL; ++iArg) {
+        commandLineSize += strlen(ppArgs[iArg])*2 + 3;
+    }
+
+    size_t environmentSize = 0;
+    if (ppEnv != NULL) {
+        environmentSize = 2;
+        for (iArg = 0; ppEnv[iArg] != NULL; ++iArg) {
+            environmentSize += strlen(ppEnv[iArg]) + 1;
+        }
+    }
+
+    dripc_process__win32* pProcess = (dripc_process__win32*)calloc(1, sizeof(*pProcess) + commandLineSize + environmentSize);
+    if (pProcess == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    char* pCommandLine = (char*)(pProcess + 1);
+    char* pEnvironment = (ppEnv != NULL) ? pCommandLine + commandLineSize : NULL;
+
+    char* pNext = pCommandLine;
+    for (iArg = 0; ppArgs[iArg] != NULL; ++iArg) {
+        if (iArg > 0) {
+            *pNext++ = ' ';
+        }
+        pNext = dripc_append_quoted_arg__win32(pNext, ppArgs[iArg]);
+    }
+    *pNext = '\0';
+
+    // The environment block is a list of null terminated strings with an extra null terminator at the end.
+    if (pEnvironment != NULL) {
+        pNext = pEnvironment;
+        for (iArg = 0; ppEnv[iArg] != NULL; ++iArg) {
+            size_t length = strlen(ppEnv[iArg]) + 1;
+            memcpy(pNext, ppEnv[iArg], length);
+            pNext += length;
+        }
+        pNext[0] = '\0';
+        pNext[1] = '\0';
+    }
+
+    // Only the handles that go to the child are made inheritable, so nothing else leaks into it.
+    HANDLE hStdHandles[3];
+    hStdHandles[0] = GetStdHandle(STD_INPUT_HANDLE);
+    hStdHandles[1] = GetStdHandle(STD_OUTPUT_HANDLE);
+    hStdHandles[2] = GetStdHandle(STD_ERROR_HANDLE);
+
+    HANDLE hInheritedHandles[3] = {NULL, NULL, NULL};
+
+    dripc_result result = dripc_result_success;
+    size_t iFD;
+    for (iFD = 0; iFD < fdCount; ++iFD) {
+        pFDs[iFD].parentPipe = NULL;
+    }
+
+    for (iFD = 0; iFD < fdCount; ++iFD) {
+        if (pFDs[iFD].childFD > 2) {
+            result = dripc_result_not_supported;
+            break;
+        }
+
+        drpipe childPipe = pFDs[iFD].pipe;
+        drpipe pipeRead  = NULL;
+        drpipe pipeWrite = NULL;
+        if (childPipe == NULL) {
+            result = drpipe_open_anonymous_ex(0, &pipeRead, &pipeWrite);
+            if (result != dripc_result_success) {
+                break;
+            }
+
+            if ((pFDs[iFD].options & DR_IPC_READ) != 0) {
+                pFDs[iFD].parentPipe = pipeWrite;
+                childPipe = pipeRead;
+            } else {
+                pFDs[iFD].parentPipe = pipeRead;
+                childPipe = pipeWrite;
+            }
+
+            if ((pFDs[iFD].options & DR_IPC_NONBLOCK) != 0) {
+                drpipe_set_nonblocking__win32(DR_IPC_PIPE_TO_WIN32_HANDLE(pFDs[iFD].parentPipe));
+                ((drpipe_win32*)pFDs[iFD].parentPipe)->options |= DR_IPC_NONBLOCK;
+            }
+        }
+
+        int childFD = pFDs[iFD].childFD;
+        if (hInheritedHandles[childFD] != NULL) {
+            CloseHandle(hInheritedHandles[childFD]);
+        }
+
+        if (!DuplicateHandle(GetCurrentProcess(), DR_IPC_PIPE_TO_WIN32_HANDLE(childPipe), GetCurrentProcess(), &hInheritedHandles[childFD], 0, TRUE, DUPLICATE_SAME_ACCESS)) {
+            hInheritedHandles[childFD] = NULL;
+            result = dripc_result_from_win32_error(GetLastError());
+        }
+
+        // The parent's copy of the child's end of a new pipe isn't needed any more.
+        if (pFDs[iFD].pipe == NULL) {
+            drpipe_close(childPipe);
+        }
+
+        if (result != dripc_result_success) {
+            break;
+        }
+
+        hStdHandles[childFD] = hInheritedHandles[childFD];
+    }
+
+    if (result == dripc_result_success) {
+        STARTUPINFOA startupInfo;
+        ZeroMemory(&startupInfo, sizeof(startupInfo));
+        startupInfo.cb         = sizeof(startupInfo);
+        startupInfo.dwFlags    = STARTF_USESTDHANDLES;
+        startupInfo.hStdInput  = hStdHandles[0];
+        startupInfo.hStdOutput = hStdHandles[1];
+        startupInfo.hStdError  = hStdHandles[2];
+
+        PROCESS_INFORMATION processInfo;
+        if (CreateProcessA(path, pCommandLine, NULL, NULL, TRUE, 0, pEnvironment, NULL, &startupInfo, &processInfo)) {
+            CloseHandle(processInfo.hThread);
+            pProcess->hProcess = processInfo.hProcess;
+        } else {
+            result = dripc_result_from_win32_error(GetLastError());
+        }
+    }
+
+    for (iFD = 0; iFD < 3; ++iFD) {
+        if (hInheritedHandles[iFD] != NULL) {
+            CloseHandle(hInheritedHandles[iFD]);
+        }
+    }
+
+    if (result != dripc_result_success) {
+        for (iFD = 0; iFD < fdCount; ++iFD) {
+            drpipe_close(pFDs[iFD].parentPipe);
+            pFDs[iFD].parentPipe = NULL;
+        }
+
+        free(pProcess);
+        return result;
+    }
+
+    *pProcessOut = (dripc_process)pProcess;
+    return dripc_result_success;
+}
+
+dripc_result dripc_process_wait__win32(dripc_process process, unsigned int timeoutInMilliseconds, int* pExitCode)
+{
+    dripc_process__win32* pProcess = (dripc_process__win32*)process;
+
+    DWORD waitResult = WaitForSingleObject(pProcess->hProcess, timeoutInMilliseconds);
+    if (waitResult == WAIT_TIMEOUT) {
+        return dripc_result_timeout;
+    }
+    if (waitResult != WAIT_OBJECT_0) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    DWORD exitCode;
+    if (!GetExitCodeProcess(pProcess->hProcess, &exitCode)) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    *pExitCode = (int)exitCode;
+    return dripc_result_success;
+}
+
+dripc_result dripc_process_kill__win32(dripc_process process)
+{
+    if (!TerminateProcess(((dripc_process__win32*)process)->hProcess, 1)) {
+        return dripc_result_from_win32_error(GetLastError());
+    }
+
+    return dripc_result_success;
+}
+
+void dripc_process_close__win32(dripc_process process)
+{
+    CloseHandle(((dripc_process__win32*)process)->hProcess);
+    free(process);
+}
+#endif  // Win32
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Unix Implementation
+//
+///////////////////////////////////////////////////////////////////////////////
+#ifdef DR_IPC_UNIX
+
+#ifndef DR_IPC_UNIX_PIPE_NAME_HEAD
+#define DR_IPC_UNIX_PIPE_NAME_HEAD  "/tmp/"
+#endif
+
+#define DR_IPC_UNIX_SERVER          (1u << 31)
+#define DR_IPC_UNIX_CLIENT          (1u << 30)
+#define DR_IPC_UNIX_IN_PLACE        (1u << 29)  // The pipe lives in caller provided storage and isn't freed.
+
+typedef struct
+{
+    drpipe_base base;
+    int fd;
+    unsigned int options;
+    char name[1];
+} drpipe_unix;
+
+typedef char drpipe_unix_fits_in_storage[(sizeof(drpipe_unix) <= sizeof(drpipe_storage)) ? 1 : -1];
+
+static dripc_result dripc_result_from_unix_error(int error)
+{
+    switch (error)
+    {
+    case EINVAL:       return dripc_result_invalid_args;
+    case ENAMETOOLONG: return dripc_result_name_too_long;
+    case EACCES:       return dripc_result_access_denied;
+    case EPERM:        return dripc_result_access_denied;
+    case ETIMEDOUT:    return dripc_result_timeout;
+    case EPIPE:        return dripc_result_disconnected;
+    case ECONNRESET:   return dripc_result_disconnected;
+#if EWOULDBLOCK != EAGAIN
+    case EWOULDBLOCK:  return dripc_result_would_block;
+#endif
+    case EAGAIN:       return dripc_result_would_block;
+    default:           return dripc_result_unknown_error;
+    }
+}
+
+#ifdef DR_IPC_ENABLE_STATS
+// Records a read or write system call made directly on a pipe's descriptor. A result of -1 is a failure. errno is preserved.
+static void drpipe_stats_record_syscall__unix(drpipe pipe, int isWrite, ssize_t bytesTransferred, uint64_t startTime)
+{
+    int error = errno;
+    drpipe_stats_record_io(pipe, isWrite, (bytesTransferred == -1) ? dripc_result_from_unix_error(error) : dripc_result_success, (bytesTransferred == -1) ? 0 : (size_t)bytesTransferred, startTime);
+    errno = error;
+}
+
+#define DR_IPC_STATS_RECORD_SYSCALL__UNIX(pipe, isWrite, bytesTransferred, startTime)   drpipe_stats_record_syscall__unix(pipe, isWrite, bytesTransferred, startTime)
+#else
+#define DR_IPC_STATS_RECORD_SYSCALL__UNIX(pipe, isWrite, bytesTransferred, startTime)   ((void)0)
+#endif
+
+static dripc_result drpipe_set_nonblocking__unix(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    return dripc_result_success;
+}
+
+static dripc_result drpipe_set_blocking__unix(int fd)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags == -1 || fcntl(fd, F_SETFL, flags & ~O_NONBLOCK) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    return dripc_result_success;
+}
+
+static uint64_t dripc_get_tick_count__unix(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec*1000 + (uint64_t)ts.tv_nsec/1000000;
+}
+
+// Returns the number of milliseconds left before a timeout expires in the form poll() takes, which is -1 for an infinite
+// timeout.
+static int dripc_get_remaining_time__unix(uint64_t startTime, unsigned int timeoutInMilliseconds)
+{
+    if (timeoutInMilliseconds == DR_IPC_INFINITE) {
+        return -1;
+    }
+
+    uint64_t elapsed = dripc_get_tick_count__unix() - startTime;
+    if (elapsed >= timeoutInMilliseconds) {
+        return 0;
+    }
+
+    uint64_t remaining = timeoutInMilliseconds - elapsed;
+    return (remaining > INT_MAX) ? INT_MAX : (int)remaining;
+}
+
+// Waits for a file descriptor to become ready. A negative timeout waits forever.
+static dripc_result dripc_wait_fd__unix(int fd, short events, int timeoutInMilliseconds)
+{
+    struct pollfd pfd;
+    pfd.fd = fd;
+    pfd.events = events;
+    pfd.revents = 0;
+
+    int result;
+    do {
+        result = poll(&pfd, 1, timeoutInMilliseconds);
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+    if (result == 0) {
+        return dripc_result_timeout;
+    }
+
+    return dripc_result_success;
+}
+
+// Sleeps for a little longer each time it's called while polling for something that has no way of being waited on, such
+// as the other end of a FIFO being opened.
+static void dripc_backoff__unix(int* pBackoff, int remainingTime)
+{
+    int sleepTime = (remainingTime >= 0 && remainingTime < *pBackoff) ? remainingTime : *pBackoff;
+
+    struct timespec ts;
+    ts.tv_sec  = 0;
+    ts.tv_nsec = (long)sleepTime * 1000000;
+    nanosleep(&ts, NULL);
+
+    if (*pBackoff < 32) {
+        *pBackoff = (*pBackoff == 0) ? 1 : *pBackoff * 2;
+    }
+}
+
+static int dripc_options_to_fd_open_flags(unsigned int options)
+{
+    int flags = 0;
+    if (options & DR_IPC_READ) {
+        if (options & DR_IPC_WRITE) {
+            flags |= O_RDWR;
+        } else {
+            flags |= O_RDONLY;
+        }
+    } else {
+        if (options & DR_IPC_WRITE) {
+            flags |= O_WRONLY;
+        } else {
+            return dripc_result_invalid_args;   // Neither read nor write mode was specified.
+        }
+    }
+
+    return flags;
+}
+
+// Reads the largest size an unprivileged process can give a pipe. Returns 0 if it's unknown.
+static size_t dripc_get_max_pipe_capacity__unix(void)
+{
+    size_t maxCapacity = 0;
+#ifdef DR_IPC_LINUX
+    int fd = open("/proc/sys/fs/pipe-max-size", O_RDONLY | O_CLOEXEC);
+    if (fd != -1) {
+        char text[32];
+        ssize_t length = read(fd, text, sizeof(text)-1);
+        if (length > 0) {
+            text[length] = '\0';
+            maxCapacity = (size_t)strtoul(text, NULL, 10);
+        }
+
+        close(fd);
+    }
+#endif
+
+    return maxCapacity;
+}
+
+// This is best effort. The kernel refuses to grow a pipe beyond the per-user limits in which case it keeps its size.
+static void drpipe_set_capacity__unix(int fd, size_t capacity)
+{
+#if defined(DR_IPC_LINUX) && defined(F_SETPIPE_SZ)
+    if (capacity == 0) {
+        return;
+    }
+
+    size_t maxCapacity = dripc_get_max_pipe_capacity__unix();
+    if (maxCapacity > 0 && capacity > maxCapacity) {
+        capacity = maxCapacity;
+    }
+    if (capacity > INT_MAX) {
+        capacity = INT_MAX;
+    }
+
+    fcntl(fd, F_SETPIPE_SZ, (int)capacity);
+#else
+    (void)fd;
+    (void)capacity;
+#endif
+}
+
+// Waits for somebody to open a FIFO for writing after it has been opened for reading in non-blocking mode, which succeeds
+// whether or not there's a writer yet.
+//
+// Nothing can be waited on for that without data being written, so this polls with a non-blocking tee() into a scratch
+// pipe, which takes nothing out of the FIFO. It returns 0 if the FIFO is empty and has no writer, fails with EAGAIN if
+// it's empty but has a writer, and copies something if there's data. Other platforms have no way of telling without
+// reading so the FIFO counts as connected as soon as it's open.
+static dripc_result drpipe_wait_for_writer__unix(int fd, uint64_t startTime, unsigned int timeoutInMilliseconds)
+{
+#if defined(DR_IPC_LINUX)
+    int scratchFDs[2];
+    if (pipe2(scratchFDs, O_CLOEXEC | O_NONBLOCK) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    dripc_result result = dripc_result_success;
+    int backoff = 0;
+    for (;;) {
+        ssize_t teeResult = tee(fd, scratchFDs[1], 1, SPLICE_F_NONBLOCK);
+        if (teeResult == -1 && errno == EINTR) {
+            continue;
+        }
+        if (teeResult != 0) {
+            break;
+        }
+
+        int remainingTime = dripc_get_remaining_time__unix(startTime, timeoutInMilliseconds);
+        if (remainingTime == 0) {
+            result = dripc_result_timeout;
+            break;
+        }
+
+        dripc_backoff__unix(&backoff, remainingTime);
+    }
+
+    close(scratchFDs[0]);
+    close(scratchFDs[1]);
+    return result;
+#else
+    (void)fd;
+    (void)startTime;
+    (void)timeoutInMilliseconds;
+    return dripc_result_success;
+#endif
+}
+
+// Opens the server side of a FIFO, waiting for a client to open the other side.
+//
+// Opening a FIFO blocks until the other side is opened and there's no way to put a time limit on that, so with a timeout
+// the FIFO is opened in non-blocking mode instead. A writer can't open a FIFO without a reader so it retries until the
+// client has opened it. A reader can open it straight away and then waits for the client to open its end with
+// drpipe_wait_for_writer__unix(). The FIFO is put back into blocking mode afterwards.
+static dripc_result drpipe_connect_named_server__unix(drpipe_unix* pPipeUnix, unsigned int timeoutInMilliseconds)
+{
+    int flags = dripc_options_to_fd_open_flags(pPipeUnix->options);
+
+    if (timeoutInMilliseconds == DR_IPC_INFINITE || flags == O_RDWR) {
+        pPipeUnix->fd = open(pPipeUnix->name, flags | O_CLOEXEC);   // O_RDWR never blocks on Linux.
+        if (pPipeUnix->fd == -1) {
+            return dripc_result_from_unix_error(errno);
+        }
+
+        return dripc_result_success;
+    }
+
+    uint64_t startTime = dripc_get_tick_count__unix();
+    int backoff = 0;
+    for (;;) {
+        pPipeUnix->fd = open(pPipeUnix->name, flags | O_NONBLOCK | O_CLOEXEC);
+        if (pPipeUnix->fd != -1) {
+            break;
+        }
+
+        int error = errno;
+        int remainingTime = dripc_get_remaining_time__unix(startTime, timeoutInMilliseconds);
+        if (error == ENXIO && remainingTime != 0) {
+            dripc_backoff__unix(&backoff, remainingTime);   // No reader yet.
+            continue;
+        }
+        if (error == EINTR) {
+            continue;
+        }
+
+        return (error == ENXIO) ? dripc_result_timeout : dripc_result_from_unix_error(error);
+    }
+
+    dripc_result result = dripc_result_success;
+    if (flags == O_RDONLY) {
+        result = drpipe_wait_for_writer__unix(pPipeUnix->fd, startTime, timeoutInMilliseconds);
+    }
+
+    if (result == dripc_result_success) {
+        result = drpipe_set_blocking__unix(pPipeUnix->fd);
+    }
+
+    if (result != dripc_result_success) {
+        close(pPipeUnix->fd);
+        pPipeUnix->fd = -1;
+    }
+
+    return result;
+}
+
+dripc_result drpipe_open_named_server__unix(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut)
+{
+    unsigned int options = pConfig->options;
+
+    char nameUnix[512];
+    if (drpipe_get_translated_name(name, nameUnix, sizeof(nameUnix)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    if (mkfifo(nameUnix, 0666) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+
+    drpipe_unix* pPipeUnix = (drpipe_unix*)calloc(1, sizeof(*pPipeUnix) + strlen(nameUnix)+1);     // +1 for null terminator.
+    if (pPipeUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pPipeUnix->options = options | DR_IPC_UNIX_SERVER;
+    strcpy(pPipeUnix->name, nameUnix);
+
+
+    // Wait for a client to connect...
+    dripc_result result = drpipe_connect_named_server__unix(pPipeUnix, pConfig->timeoutInMilliseconds);
+    if (result != dripc_result_success) {
+        unlink(pPipeUnix->name);
+        free(pPipeUnix);
+        return result;
+    }
+
+    drpipe_set_capacity__unix(pPipeUnix->fd, pConfig->capacity);
+
+    // Non-blocking mode is only switched on after connecting so that the server still waits for a client.
+    if (options & DR_IPC_NONBLOCK) {
+        result = drpipe_set_nonblocking__unix(pPipeUnix->fd);
+        if (result != dripc_result_success) {
+            close(pPipeUnix->fd);
+            unlink(pPipeUnix->name);
+            free(pPipeUnix);
+            return result;
+        }
+    }
+
+
+    *pPipeOut = (drpipe)pPipeUnix;
+    return dripc_result_success;
+}
+
+static int dripc_create_socket__unix(unsigned int options)
+{
+    int type = (options & DR_IPC_SEQPACKET) ? SOCK_SEQPACKET : SOCK_STREAM;
+#ifdef SOCK_CLOEXEC
+    type |= SOCK_CLOEXEC;
+#endif
+
+    int fd = socket(AF_UNIX, type, 0);
+    if (fd == -1) {
+        return -1;
+    }
+
+#ifdef SO_NOSIGPIPE
+    int noSigPipe = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &noSigPipe, sizeof(noSigPipe));
+#endif
+
+    return fd;
+}
+
+// Connects to a drpipe_server which is a listening socket rather than a FIFO. Returns the file descriptor, or -1 with errno
+// set, just like open(). Connecting is always done in blocking mode because connecting to a local socket never waits on the
+// server to accept.
+static int drpipe_connect_named_socket__unix(const char* nameUnix, int flags)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(nameUnix) >= sizeof(address.sun_path)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    strcpy(address.sun_path, nameUnix);
+
+    int fd = dripc_create_socket__unix(0);
+    if (fd == -1) {
+        return -1;
+    }
+
+    int connectResult;
+    do {
+        connectResult = connect(fd, (struct sockaddr*)&address, sizeof(address));
+    } while (connectResult == -1 && errno == EINTR);
+
+    if (connectResult == -1 || ((flags & O_NONBLOCK) && drpipe_set_nonblocking__unix(fd) != dripc_result_success)) {
+        int error = errno;
+        close(fd);
+        errno = error;
+        return -1;
+    }
+
+    return fd;
+}
+
+// Opens a named pipe, or connects to it if it belongs to a drpipe_server. open() fails with ENXIO for sockets.
+static int drpipe_open_named__unix(const char* nameUnix, int flags)
+{
+    int fd = open(nameUnix, flags | O_CLOEXEC);
+    if (fd == -1 && errno == ENXIO) {
+        struct stat info;
+        if (stat(nameUnix, &info) == 0 && S_ISSOCK(info.st_mode)) {
+            fd = drpipe_connect_named_socket__unix(nameUnix, flags);
+        } else {
+            errno = ENXIO;
+        }
+    }
+
+    return fd;
+}
+
+// Opens the client side of a FIFO, waiting for the server to create it if necessary. Opening a FIFO for writing in
+// non-blocking mode fails with ENXIO when the server hasn't opened its end yet so that is retried as well. Opening it for
+// reading succeeds before there's a writer, so in that case this waits for the server to open its end with
+// drpipe_wait_for_writer__unix(), the same as drpipe_connect_named_server__unix(). A pipe that belongs to a drpipe_server is a socket and is
+// connected to instead.
+static dripc_result drpipe_connect_named_client__unix(drpipe_unix* pPipeUnix, unsigned int timeoutInMilliseconds)
+{
+    int flags = dripc_options_to_fd_open_flags(pPipeUnix->options);
+    int isNonBlocking = (pPipeUnix->options & DR_IPC_NONBLOCK) != 0;
+
+    if (timeoutInMilliseconds == 0) {
+        pPipeUnix->fd = drpipe_open_named__unix(pPipeUnix->name, flags | (isNonBlocking ? O_NONBLOCK : 0));
+        if (pPipeUnix->fd == -1) {
+            return dripc_result_from_unix_error(errno);
+        }
+
+        return dripc_result_success;
+    }
+
+    // Without a time limit a blocking open is left to block in the kernel once the FIFO exists.
+    if (timeoutInMilliseconds != DR_IPC_INFINITE || isNonBlocking) {
+        flags |= O_NONBLOCK;
+    }
+
+    uint64_t startTime = dripc_get_tick_count__unix();
+    int backoff = 0;
+    for (;;) {
+        pPipeUnix->fd = drpipe_open_named__unix(pPipeUnix->name, flags);
+        if (pPipeUnix->fd != -1) {
+            break;
+        }
+
+        int error = errno;
+        if (error == EINTR) {
+            continue;
+        }
+
+        // ECONNREFUSED is a drpipe_server whose socket has been created but isn't listening yet.
+        int remainingTime = dripc_get_remaining_time__unix(startTime, timeoutInMilliseconds);
+        if (error != ENOENT && error != ENXIO && error != ECONNREFUSED) {
+            return dripc_result_from_unix_error(error);
+        }
+        if (remainingTime == 0) {
+            return dripc_result_timeout;
+        }
+
+        dripc_backoff__unix(&backoff, remainingTime);
+    }
+
+    dripc_result result = dripc_result_success;
+    if ((flags & O_NONBLOCK) && (flags & O_ACCMODE) == O_RDONLY) {
+        struct stat info;
+        if (fstat(pPipeUnix->fd, &info) == 0 && S_ISFIFO(info.st_mode)) {
+            result = drpipe_wait_for_writer__unix(pPipeUnix->fd, startTime, timeoutInMilliseconds);
+        }
+    }
+
+    if (result == dripc_result_success && (flags & O_NONBLOCK) && !isNonBlocking) {
+        result = drpipe_set_blocking__unix(pPipeUnix->fd);
+    }
+
+    if (result != dripc_result_success) {
+        close(pPipeUnix->fd);
+        pPipeUnix->fd = -1;
+    }
+
+    return result;
+}
+
+dripc_result drpipe_open_named_client__unix(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut)
+{
+    unsigned int options = pConfig->options;
+
+    char nameUnix[512];
+    if (drpipe_get_translated_name(name, nameUnix, sizeof(nameUnix)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    drpipe_unix* pPipeUnix = (drpipe_unix*)calloc(1, sizeof(*pPipeUnix) + strlen(nameUnix)+1);     // +1 for null terminator.
+    if (pPipeUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pPipeUnix->options = options | DR_IPC_UNIX_CLIENT;
+    strcpy(pPipeUnix->name, nameUnix);
+
+    dripc_result result = drpipe_connect_named_client__unix(pPipeUnix, pConfig->timeoutInMilliseconds);
+    if (result != dripc_result_success) {
+        free(pPipeUnix);
+        return result;
+    }
+
+    drpipe_set_capacity__unix(pPipeUnix->fd, pConfig->capacity);
+
+
+    *pPipeOut = (drpipe)pPipeUnix;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_open_anonymous_in_place__unix(const drpipe_config* pConfig, void* pStorageRead, void* pStorageWrite, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    unsigned int options = pConfig->options;
+
+    int pipeFDs[2];
+#if defined(DR_IPC_LINUX)
+    if (pipe2(pipeFDs, O_CLOEXEC | ((options & DR_IPC_NONBLOCK) ? O_NONBLOCK : 0)) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+#else
+    if (pipe(pipeFDs) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    fcntl(pipeFDs[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pipeFDs[1], F_SETFD, FD_CLOEXEC);
+
+    if (options & DR_IPC_NONBLOCK) {
+        if (drpipe_set_nonblocking__unix(pipeFDs[0]) != dripc_result_success || drpipe_set_nonblocking__unix(pipeFDs[1]) != dripc_result_success) {
+            close(pipeFDs[0]);
+            close(pipeFDs[1]);
+            return dripc_result_unknown_error;
+        }
+    }
+#endif
+
+    drpipe_set_capacity__unix(pipeFDs[1], pConfig->capacity);
+
+    drpipe_unix* pPipeReadUnix  = (drpipe_unix*)pStorageRead;
+    drpipe_unix* pPipeWriteUnix = (drpipe_unix*)pStorageWrite;
+    memset(pPipeReadUnix,  0, sizeof(*pPipeReadUnix));
+    memset(pPipeWriteUnix, 0, sizeof(*pPipeWriteUnix));
+    pPipeReadUnix->fd       = pipeFDs[0];
+    pPipeReadUnix->options  = DR_IPC_READ  | DR_IPC_UNIX_IN_PLACE | (options & DR_IPC_NONBLOCK);
+    pPipeWriteUnix->fd      = pipeFDs[1];
+    pPipeWriteUnix->options = DR_IPC_WRITE | DR_IPC_UNIX_IN_PLACE | (options & DR_IPC_NONBLOCK);
+
+    *pPipeRead  = (drpipe)pPipeReadUnix;
+    *pPipeWrite = (drpipe)pPipeWriteUnix;
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_open_anonymous__unix(const drpipe_config* pConfig, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    drpipe_unix* pPipeReadUnix = (drpipe_unix*)malloc(sizeof(*pPipeReadUnix));
+    if (pPipeReadUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    drpipe_unix* pPipeWriteUnix = (drpipe_unix*)malloc(sizeof(*pPipeWriteUnix));
+    if (pPipeWriteUnix == NULL) {
+        free(pPipeReadUnix);
+        return dripc_result_unknown_error;
+    }
+
+    dripc_result result = drpipe_open_anonymous_in_place__unix(pConfig, pPipeReadUnix, pPipeWriteUnix, pPipeRead, pPipeWrite);
+    if (result != dripc_result_success) {
+        free(pPipeWriteUnix);
+        free(pPipeReadUnix);
+        return result;
+    }
+
+    pPipeReadUnix->options  &= ~DR_IPC_UNIX_IN_PLACE;
+    pPipeWriteUnix->options &= ~DR_IPC_UNIX_IN_PLACE;
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_get_bytes_pending__unix(drpipe pipe, size_t* pBytesPending)
+{
+    int bytesPending;
+    if (ioctl(((drpipe_unix*)pipe)->fd, FIONREAD, &bytesPending) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    *pBytesPending = (size_t)bytesPending;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_get_capacity__unix(drpipe pipe, size_t* pCapacity)
+{
+#if defined(DR_IPC_LINUX) && defined(F_GETPIPE_SZ)
+    int capacity = fcntl(((drpipe_unix*)pipe)->fd, F_GETPIPE_SZ);
+    if (capacity == -1) {
+        return (errno == EBADF) ? dripc_result_not_supported : dripc_result_from_unix_error(errno);   // EBADF when it's not a pipe.
+    }
+
+    *pCapacity = (size_t)capacity;
+    return dripc_result_success;
+#else
+    (void)pipe;
+    (void)pCapacity;
+    return dripc_result_not_supported;
+#endif
+}
+
+void drpipe_close__unix(drpipe pipe)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    if (pPipeUnix->fd != -1) {
+        close(pPipeUnix->fd);
+    }
+
+    if (pPipeUnix->options & DR_IPC_UNIX_SERVER) {
+        unlink(pPipeUnix->name);
+    }
+
+    if ((pPipeUnix->options & DR_IPC_UNIX_IN_PLACE) == 0) {
+        free(pPipeUnix);
+    }
+}
+
+
+dripc_result drpipe_read__unix(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    DR_IPC_STATS_BEGIN(startTime);
+
+    ssize_t bytesRead = read(pPipeUnix->fd, pDataOut, bytesToRead);
+    if (bytesRead == -1) {
+        dripc_result result = dripc_result_from_unix_error(errno);
+        DR_IPC_STATS_RECORD_IO(pipe, 0, result, 0, startTime);
+        return result;
+    }
+
+    DR_IPC_STATS_RECORD_IO(pipe, 0, dripc_result_success, (size_t)bytesRead, startTime);
+
+    if (pBytesRead) *pBytesRead = (size_t)bytesRead;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_write__unix(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    DR_IPC_STATS_BEGIN(startTime);
+
+    ssize_t bytesWritten = write(pPipeUnix->fd, pData, bytesToWrite);
+    if (bytesWritten == -1) {
+        dripc_result result = dripc_result_from_unix_error(errno);
+        DR_IPC_STATS_RECORD_IO(pipe, 1, result, 0, startTime);
+        return result;
+    }
+
+    DR_IPC_STATS_RECORD_IO(pipe, 1, dripc_result_success, (size_t)bytesWritten, startTime);
+
+    if (pBytesWritten) *pBytesWritten = (size_t)bytesWritten;
+    return dripc_result_success;
+}
+
+// Only kernel pipes and FIFOs make writes of up to PIPE_BUF bytes atomic. Stream sockets don't.
+dripc_result drpipe_check_multi_writer__unix(drpipe pipe)
+{
+    struct stat info;
+    if (fstat(((drpipe_unix*)pipe)->fd, &info) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    return S_ISFIFO(info.st_mode) ? dripc_result_success : dripc_result_not_supported;
+}
+
+// Writes no more than DR_IPC_PIPE_BUF bytes in a single write() which the kernel does in one piece or not at all.
+dripc_result drpipe_write_atomic__unix(drpipe pipe, const void* pData, size_t bytesToWrite, int allowWouldBlock)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    for (;;) {
+        DR_IPC_STATS_BEGIN(startTime);
+        ssize_t bytesWritten = write(pPipeUnix->fd, pData, bytesToWrite);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX(pipe, 1, bytesWritten, startTime);
+        if (bytesWritten == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if ((errno == EAGAIN || errno == EWOULDBLOCK) && !allowWouldBlock) {
+                DR_IPC_STATS_BEGIN(waitStartTime);
+                dripc_result result = dripc_wait_fd__unix(pPipeUnix->fd, POLLOUT, -1);
+                DR_IPC_STATS_RECORD_WAIT(pipe, waitStartTime);
+                if (result != dripc_result_success) {
+                    return result;
+                }
+
+                continue;
+            }
+
+            return dripc_result_from_unix_error(errno);
+        }
+
+        return ((size_t)bytesWritten == bytesToWrite) ? dripc_result_success : dripc_result_unknown_error;
+    }
+}
+
+dripc_result drpipe_wait_readable__unix(drpipe pipe, unsigned int timeoutInMilliseconds)
+{
+    return dripc_wait_fd__unix(((drpipe_unix*)pipe)->fd, POLLIN, dripc_get_remaining_time__unix(dripc_get_tick_count__unix(), timeoutInMilliseconds));
+}
+
+// Returns non-zero if reading would not block. A hang up or error counts because read() will report it straight away.
+static int drpipe_poll_readable__unix(drpipe pipe)
+{
+    return dripc_wait_fd__unix(((drpipe_unix*)pipe)->fd, POLLIN, 0) != dripc_result_timeout;
+}
+
+// *pBytesWritten is added to. A pipe with room for at least PIPE_BUF bytes is reported as writable, so blocking pipes are
+// written to in chunks of that size to make sure a write never blocks past the deadline.
+dripc_result drpipe_write_timeout__unix(drpipe pipe, const void* pData, size_t bytesToWrite, unsigned int timeoutInMilliseconds, size_t* pBytesWritten)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    size_t maxChunkSize = (pPipeUnix->options & DR_IPC_NONBLOCK) ? bytesToWrite : DR_IPC_PIPE_BUF;
+    uint64_t startTime = dripc_get_tick_count__unix();
+    while (*pBytesWritten < bytesToWrite) {
+        DR_IPC_STATS_BEGIN(waitStartTime);
+        dripc_result result = dripc_wait_fd__unix(pPipeUnix->fd, POLLOUT, dripc_get_remaining_time__unix(startTime, timeoutInMilliseconds));
+        DR_IPC_STATS_RECORD_WAIT(pipe, waitStartTime);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        size_t bytesRemaining = bytesToWrite - *pBytesWritten;
+        DR_IPC_STATS_BEGIN(writeStartTime);
+        ssize_t bytesWritten = write(pPipeUnix->fd, (const char*)pData + *pBytesWritten, (bytesRemaining < maxChunkSize) ? bytesRemaining : maxChunkSize);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX(pipe, 1, bytesWritten, writeStartTime);
+        if (bytesWritten == -1) {
+            if (errno == EAGAIN || errno == EINTR) {
+                continue;
+            }
+
+            return dripc_result_from_unix_error(errno);
+        }
+
+        *pBytesWritten += (size_t)bytesWritten;
+    }
+
+    return dripc_result_success;
+}
+
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+// The largest transfer Linux will do in a single system call. Bigger requests are clamped to this which also keeps the
+// result within the 32-bit result of an io_uring completion.
+#define DR_IPC_UNIX_MAX_IO_SIZE     0x7FFFF000
+
+// Advances an iovec array past the given number of bytes, returning the new number of iovecs.
+static int dripc_advance_iovecs__unix(struct iovec** ppIOVecs, int iovecCount, size_t bytesToSkip)
+{
+    struct iovec* pIOVecs = *ppIOVecs;
+    while (iovecCount > 0 && bytesToSkip >= pIOVecs->iov_len) {
+        bytesToSkip -= pIOVecs->iov_len;
+        pIOVecs    += 1;
+        iovecCount -= 1;
+    }
+
+    if (iovecCount > 0) {
+        pIOVecs->iov_base = (void*)((char*)pIOVecs->iov_base + bytesToSkip);
+        pIOVecs->iov_len -= bytesToSkip;
+    }
+
+    *ppIOVecs = pIOVecs;
+    return iovecCount;
+}
+
+// Writes every iovec in full. The iovecs are modified. If nothing has been written, the pipe is non-blocking and
+// allowWouldBlock is set this returns dripc_result_would_block, otherwise it waits for the pipe to become writable so
+// messages are never split.
+static dripc_result drpipe_writev_all__unix(drpipe_unix* pPipeUnix, struct iovec* pIOVecs, int iovecCount, int allowWouldBlock)
+{
+    size_t totalBytesWritten = 0;
+    while (iovecCount > 0) {
+        DR_IPC_STATS_BEGIN(writeStartTime);
+        ssize_t bytesWritten = writev(pPipeUnix->fd, pIOVecs, (iovecCount < IOV_MAX) ? iovecCount : IOV_MAX);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX((drpipe)pPipeUnix, 1, bytesWritten, writeStartTime);
+        if (bytesWritten == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (totalBytesWritten == 0 && allowWouldBlock) {
+                    return dripc_result_would_block;
+                }
+
+                DR_IPC_STATS_BEGIN(waitStartTime);
+                dripc_result result = dripc_wait_fd__unix(pPipeUnix->fd, POLLOUT, -1);
+                DR_IPC_STATS_RECORD_WAIT((drpipe)pPipeUnix, waitStartTime);
+                if (result != dripc_result_success) {
+                    return result;
+                }
+
+                continue;
+            }
+
+            return dripc_result_from_unix_error(errno);
+        }
+
+        totalBytesWritten += (size_t)bytesWritten;
+        iovecCount = dripc_advance_iovecs__unix(&pIOVecs, iovecCount, (size_t)bytesWritten);
+    }
+
+    return dripc_result_success;
+}
+
+// The read equivalent of drpipe_writev_all__unix(). Reaching the end of the stream part way through is an error.
+static dripc_result drpipe_readv_all__unix(drpipe_unix* pPipeUnix, struct iovec* pIOVecs, int iovecCount, int allowWouldBlock)
+{
+    size_t totalBytesRead = 0;
+    while (iovecCount > 0) {
+        DR_IPC_STATS_BEGIN(readStartTime);
+        ssize_t bytesRead = readv(pPipeUnix->fd, pIOVecs, (iovecCount < IOV_MAX) ? iovecCount : IOV_MAX);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX((drpipe)pPipeUnix, 0, bytesRead, readStartTime);
+        if (bytesRead == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                if (totalBytesRead == 0 && allowWouldBlock) {
+                    return dripc_result_would_block;
+                }
+
+                DR_IPC_STATS_BEGIN(waitStartTime);
+                dripc_result result = dripc_wait_fd__unix(pPipeUnix->fd, POLLIN, -1);
+                DR_IPC_STATS_RECORD_WAIT((drpipe)pPipeUnix, waitStartTime);
+                if (result != dripc_result_success) {
+                    return result;
+                }
+
+                continue;
+            }
+
+            return dripc_result_from_unix_error(errno);
+        }
+
+        if (bytesRead == 0) {
+            return dripc_result_unknown_error;  // The other end was closed.
+        }
+
+        totalBytesRead += (size_t)bytesRead;
+        iovecCount = dripc_advance_iovecs__unix(&pIOVecs, iovecCount, (size_t)bytesRead);
+    }
+
+    return dripc_result_success;
+}
+
+// Sends the first part of a message with sendmsg() so that a descriptor can go with it. The kernel attaches the
+// descriptor to the first byte so it's only sent once, and the rest of the message follows with writev(). The iovecs
+// are advanced past whatever was sent.
+static dripc_result drpipe_sendmsg_fd__unix(drpipe_unix* pPipeUnix, struct iovec** ppIOVecs, int* pIOVecCount, int fd)
+{
+    union
+    {
+        struct cmsghdr header;  // For alignment.
+        char data[CMSG_SPACE(sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov        = *ppIOVecs;
+    message.msg_iovlen     = (*pIOVecCount < IOV_MAX) ? *pIOVecCount : IOV_MAX;
+    message.msg_control    = control.data;
+    message.msg_controllen = sizeof(control.data);
+
+    struct cmsghdr* pHeader = CMSG_FIRSTHDR(&message);
+    pHeader->cmsg_level = SOL_SOCKET;
+    pHeader->cmsg_type  = SCM_RIGHTS;
+    pHeader->cmsg_len   = CMSG_LEN(sizeof(int));
+    memcpy(CMSG_DATA(pHeader), &fd, sizeof(int));
+
+    ssize_t bytesSent;
+    for (;;) {
+        DR_IPC_STATS_BEGIN(writeStartTime);
+        bytesSent = sendmsg(pPipeUnix->fd, &message, 0);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX((drpipe)pPipeUnix, 1, bytesSent, writeStartTime);
+        if (bytesSent != -1) {
+            break;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == ENOTSOCK) {
+            return dripc_result_not_supported;   // Descriptors can only be passed over sockets.
+        }
+
+        return dripc_result_from_unix_error(errno);
+    }
+
+    *pIOVecCount = dripc_advance_iovecs__unix(ppIOVecs, *pIOVecCount, (size_t)bytesSent);
+    return dripc_result_success;
+}
+
+// Sends a length prefixed message. If fd is not -1 it's sent along with the message.
+static dripc_result drpipe_send_message_with_fd__unix(drpipe pipe, uint32_t messageSize, const dripc_buffer* pBuffers, size_t bufferCount, int fd)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    struct iovec iovecsStack[16];
+    struct iovec* pIOVecs = iovecsStack;
+    if (bufferCount + 1 > sizeof(iovecsStack)/sizeof(iovecsStack[0])) {
+        pIOVecs = (struct iovec*)malloc((bufferCount + 1) * sizeof(*pIOVecs));
+        if (pIOVecs == NULL) {
+            return dripc_result_unknown_error;
+        }
+    }
+
+    pIOVecs[0].iov_base = &messageSize;
+    pIOVecs[0].iov_len  = sizeof(messageSize);
+
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        pIOVecs[iBuffer+1].iov_base = pBuffers[iBuffer].pData;
+        pIOVecs[iBuffer+1].iov_len  = pBuffers[iBuffer].sizeInBytes;
+    }
+
+    struct iovec* pIOVecsRemaining = pIOVecs;
+    int iovecCount = (int)(bufferCount + 1);
+    int allowWouldBlock = 1;
+
+    dripc_result result = dripc_result_success;
+    if (fd != -1) {
+        result = drpipe_sendmsg_fd__unix(pPipeUnix, &pIOVecsRemaining, &iovecCount, fd);
+        allowWouldBlock = 0;    // Part of the message has gone so the rest must follow.
+    }
+
+    if (result == dripc_result_success) {
+        result = drpipe_writev_all__unix(pPipeUnix, pIOVecsRemaining, iovecCount, allowWouldBlock);
+    }
+
+    if (pIOVecs != iovecsStack) {
+        free(pIOVecs);
+    }
+
+    return result;
+}
+
+dripc_result drpipe_send_message__unix(drpipe pipe, uint32_t messageSize, const dripc_buffer* pBuffers, size_t bufferCount)
+{
+    return drpipe_send_message_with_fd__unix(pipe, messageSize, pBuffers, bufferCount, -1);
+}
+
+dripc_result dripc_send_fd__unix(drpipe pipe, int fd, uint32_t messageSize, const dripc_buffer* pBuffers, size_t bufferCount)
+{
+    return drpipe_send_message_with_fd__unix(pipe, messageSize, pBuffers, bufferCount, fd);
+}
+
+// The whole batch is gathered into one writev() with a length prefix and a body for each message. Messages whose result
+// is not dripc_result_success on the way in were rejected by drpipe_write_batch() and are skipped. Unlike
+// drpipe_writev_all__unix() a non-blocking pipe only waits to finish the message it's in the middle of.
+dripc_result drpipe_write_batch__unix(drpipe pipe, dripc_message* pMessages, size_t messageCount, size_t* pMessagesWritten)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    uint32_t messageSizesStack[16];
+    struct iovec iovecsStack[32];
+    uint32_t* pMessageSizes = messageSizesStack;
+    struct iovec* pIOVecs = iovecsStack;
+    if (messageCount > sizeof(messageSizesStack)/sizeof(messageSizesStack[0])) {
+        pMessageSizes = (uint32_t*)malloc(messageCount * (sizeof(*pMessageSizes) + 2*sizeof(*pIOVecs)));
+        if (pMessageSizes == NULL) {
+            return dripc_result_unknown_error;
+        }
+
+        pIOVecs = (struct iovec*)(pMessageSizes + messageCount);
+    }
+
+    size_t messagesToWrite = 0;
+    int iovecCount = 0;
+    size_t iMessage;
+    for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+        if (pMessages[iMessage].result != dripc_result_success) {
+            continue;
+        }
+
+        pMessageSizes[messagesToWrite] = (uint32_t)pMessages[iMessage].sizeInBytes;
+        pIOVecs[iovecCount].iov_base = &pMessageSizes[messagesToWrite];
+        pIOVecs[iovecCount].iov_len  = sizeof(uint32_t);
+        iovecCount += 1;
+
+        if (pMessages[iMessage].sizeInBytes > 0) {
+            pIOVecs[iovecCount].iov_base = pMessages[iMessage].pData;
+            pIOVecs[iovecCount].iov_len  = pMessages[iMessage].sizeInBytes;
+            iovecCount += 1;
+        }
+
+        messagesToWrite += 1;
+    }
+
+    // The message currently going out ends messageEnd bytes into the batch, with messageIOVecEnd being the index of the
+    // iovec after its last one.
+    size_t messagesWritten = 0;
+    size_t totalBytesWritten = 0;
+    size_t messageEnd = (messagesToWrite > 0) ? sizeof(uint32_t) + pMessageSizes[0] : 0;
+    int messageIOVecEnd = (messagesToWrite > 0 && pMessageSizes[0] > 0) ? 2 : 1;
+
+    dripc_result result = dripc_result_success;
+    struct iovec* pIOVecsRemaining = pIOVecs;
+    int iovecsRemaining = iovecCount;
+    while (iovecsRemaining > 0) {
+        DR_IPC_STATS_BEGIN(writeStartTime);
+        ssize_t bytesWritten = writev(pPipeUnix->fd, pIOVecsRemaining, (iovecsRemaining < IOV_MAX) ? iovecsRemaining : IOV_MAX);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX(pipe, 1, bytesWritten, writeStartTime);
+        if (bytesWritten == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // A non-blocking pipe has filled up. Rather than wait for room for the whole batch, the message that's
+                // part way out is finished off and the rest are left for the caller to try again.
+                if (totalBytesWritten > messageEnd - sizeof(uint32_t) - pMessageSizes[messagesWritten]) {
+                    result = drpipe_writev_all__unix(pPipeUnix, pIOVecsRemaining, messageIOVecEnd - (int)(pIOVecsRemaining - pIOVecs), 0);
+                    if (result != dripc_result_success) {
+                        break;
+                    }
+
+                    messagesWritten += 1;
+                }
+
+                result = dripc_result_would_block;
+                break;
+            }
+
+            result = dripc_result_from_unix_error(errno);
+            break;
+        }
+
+        totalBytesWritten += (size_t)bytesWritten;
+        iovecsRemaining = dripc_advance_iovecs__unix(&pIOVecsRemaining, iovecsRemaining, (size_t)bytesWritten);
+
+        while (messagesWritten < messagesToWrite && totalBytesWritten >= messageEnd) {
+            messagesWritten += 1;
+            if (messagesWritten < messagesToWrite) {
+                messageEnd      += sizeof(uint32_t) + pMessageSizes[messagesWritten];
+                messageIOVecEnd += (pMessageSizes[messagesWritten] > 0) ? 2 : 1;
+            }
+        }
+    }
+
+    *pMessagesWritten = messagesWritten;
+
+    if (pMessageSizes != messageSizesStack) {
+        free(pMessageSizes);
+    }
+
+    return result;
+}
+
+// Reads the body of a message whose length prefix has already been read.
+static dripc_result drpipe_recv_message_body__unix(drpipe_unix* pPipeUnix, uint32_t messageSize, dripc_buffer* pBuffers, size_t bufferCount)
+{
+    dripc_result result;
+
+    // Only read up to the size of the message so we don't consume the start of the next one.
+    struct iovec iovecsStack[16];
+    struct iovec* pIOVecs = iovecsStack;
+    if (bufferCount > sizeof(iovecsStack)/sizeof(iovecsStack[0])) {
+        pIOVecs = (struct iovec*)malloc(bufferCount * sizeof(*pIOVecs));
+        if (pIOVecs == NULL) {
+            return dripc_result_unknown_error;
+        }
+    }
+
+    size_t bytesRemaining = messageSize;
+    int iovecCount = 0;
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount && bytesRemaining > 0; ++iBuffer) {
+        size_t bytesThisBuffer = (pBuffers[iBuffer].sizeInBytes < bytesRemaining) ? pBuffers[iBuffer].sizeInBytes : bytesRemaining;
+        pIOVecs[iovecCount].iov_base = pBuffers[iBuffer].pData;
+        pIOVecs[iovecCount].iov_len  = bytesThisBuffer;
+        iovecCount += 1;
+        bytesRemaining -= bytesThisBuffer;
+    }
+
+    result = drpipe_readv_all__unix(pPipeUnix, pIOVecs, iovecCount, 0);
+
+    if (pIOVecs != iovecsStack) {
+        free(pIOVecs);
+    }
+
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+
+    // Anything that didn't fit needs to be discarded.
+    if (bytesRemaining > 0) {
+        while (bytesRemaining > 0) {
+            char discard[4096];
+            size_t bytesToDiscard = (bytesRemaining < sizeof(discard)) ? bytesRemaining : sizeof(discard);
+
+            struct iovec discardIOVec;
+            discardIOVec.iov_base = discard;
+            discardIOVec.iov_len  = bytesToDiscard;
+
+            result = drpipe_readv_all__unix(pPipeUnix, &discardIOVec, 1, 0);
+            if (result != dripc_result_success) {
+                return result;
+            }
+
+            bytesRemaining -= bytesToDiscard;
+        }
+
+        return dripc_result_too_large;
+    }
+
+    return dripc_result_success;
+}
+
+// Receives the first part of a message with recvmsg() to pick up a descriptor sent with drpipe_sendmsg_fd__unix(). This
+// reads at most the length prefix. *pFD is set to -1 if no descriptor came with it.
+//
+// If the kernel couldn't hand over every descriptor, either because they didn't fit in the control buffer or because
+// this process is at its descriptor limit, *pWasTruncated is set to 1 and any that did arrive are closed. The bytes are
+// still received so the caller can stay in step with the message boundaries before reporting the failure.
+static dripc_result drpipe_recvmsg_fd__unix(drpipe_unix* pPipeUnix, struct iovec* pIOVec, int* pFD, int* pWasTruncated)
+{
+    *pWasTruncated = 0;
+
+    union
+    {
+        struct cmsghdr header;  // For alignment.
+        char data[CMSG_SPACE(sizeof(int) * 4)];
+    } control;
+
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov        = pIOVec;
+    message.msg_iovlen     = 1;
+    message.msg_control    = control.data;
+    message.msg_controllen = sizeof(control.data);
+
+    int flags = 0;
+#ifdef MSG_CMSG_CLOEXEC
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+
+    ssize_t bytesReceived;
+    for (;;) {
+        DR_IPC_STATS_BEGIN(readStartTime);
+        bytesReceived = recvmsg(pPipeUnix->fd, &message, flags);
+        DR_IPC_STATS_RECORD_SYSCALL__UNIX((drpipe)pPipeUnix, 0, bytesReceived, readStartTime);
+        if (bytesReceived != -1) {
+            break;
+        }
+
+        if (errno == EINTR) {
+            continue;
+        }
+        if (errno == ENOTSOCK) {
+            return dripc_result_not_supported;
+        }
+
+        return dripc_result_from_unix_error(errno);
+    }
+
+    if (bytesReceived == 0) {
+        return dripc_result_unknown_error;  // The other end was closed.
+    }
+
+    // Only one descriptor is ever sent with a message, but anything else that turns up needs to be closed.
+    struct cmsghdr* pHeader;
+    for (pHeader = CMSG_FIRSTHDR(&message); pHeader != NULL; pHeader = CMSG_NXTHDR(&message, pHeader)) {
+        if (pHeader->cmsg_level != SOL_SOCKET || pHeader->cmsg_type != SCM_RIGHTS) {
+            continue;
+        }
+
+        size_t fdCount = (pHeader->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        size_t iFD;
+        for (iFD = 0; iFD < fdCount; ++iFD) {
+            int fd;
+            memcpy(&fd, CMSG_DATA(pHeader) + iFD*sizeof(int), sizeof(int));
+            if (*pFD == -1) {
+                *pFD = fd;
+            } else {
+                close(fd);
+            }
+        }
+    }
+
+    if ((message.msg_flags & MSG_CTRUNC) != 0) {
+        if (*pFD != -1) {
+            close(*pFD);
+            *pFD = -1;
+        }
+
+        *pWasTruncated = 1;
+    }
+
+    pIOVec->iov_base = (char*)pIOVec->iov_base + bytesReceived;
+    pIOVec->iov_len -= (size_t)bytesReceived;
+    return dripc_result_success;
+}
+
+// Receives a length prefixed message. If pFD is not NULL the message is expected to have been sent with
+// dripc_send_fd(), and *pFD is set to the descriptor that came with it or -1 if there wasn't one.
+static dripc_result drpipe_recv_message_with_fd__unix(drpipe pipe, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize, int* pFD)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    uint32_t messageSize;
+    struct iovec headerIOVec;
+    headerIOVec.iov_base = &messageSize;
+    headerIOVec.iov_len  = sizeof(messageSize);
+
+    dripc_result result;
+    int wasTruncated = 0;
+    if (pFD != NULL) {
+        result = drpipe_recvmsg_fd__unix(pPipeUnix, &headerIOVec, pFD, &wasTruncated);
+        if (result == dripc_result_success && headerIOVec.iov_len > 0) {
+            result = drpipe_readv_all__unix(pPipeUnix, &headerIOVec, 1, 0);
+        }
+    } else {
+        result = drpipe_readv_all__unix(pPipeUnix, &headerIOVec, 1, 1);
+    }
+
+    if (result == dripc_result_success) {
+        result = drpipe_recv_message_body__unix(pPipeUnix, messageSize, pBuffers, bufferCount);
+        *pMessageSize = messageSize;
+    }
+
+    // The message has been received in full so the pipe can carry on, but its descriptor is gone.
+    if (wasTruncated && (result == dripc_result_success || result == dripc_result_too_large)) {
+        result = dripc_result_unknown_error;
+    }
+
+    if (pFD != NULL && *pFD != -1 && result != dripc_result_success && result != dripc_result_too_large) {
+        close(*pFD);
+        *pFD = -1;
+    }
+
+    return result;
+}
+
+dripc_result drpipe_recv_message__unix(drpipe pipe, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    return drpipe_recv_message_with_fd__unix(pipe, pBuffers, bufferCount, pMessageSize, NULL);
+}
+
+dripc_result dripc_recv_fd__unix(drpipe pipe, int* pFD, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    return drpipe_recv_message_with_fd__unix(pipe, pBuffers, bufferCount, pMessageSize, pFD);
+}
+
+
+static int dripc_is_fifo__unix(int fd)
+{
+    struct stat info;
+    return fstat(fd, &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+unsigned int drpipe_get_zero_copy_caps__unix(drpipe pipe)
+{
+#ifdef DR_IPC_LINUX
+    // Everything here needs the drpipe to be backed by an actual kernel pipe. Sockets are not.
+    if (dripc_is_fifo__unix(((drpipe_unix*)pipe)->fd)) {
+        return DR_IPC_ZERO_COPY_SPLICE | DR_IPC_ZERO_COPY_VMSPLICE | DR_IPC_ZERO_COPY_TEE;
+    }
+#else
+    (void)pipe;
+#endif
+
+    return 0;
+}
+
+// The fallback for when the kernel can't move the data for us. Whatever is read has to be written out in full because
+// it can't be put back, so a non-blocking destination is waited on once the data has been read.
+static dripc_result dripc_copy_fd__unix(int fdIn, int fdOut, size_t bytesToTransfer, size_t* pBytesTransferred)
+{
+    char buffer[16384];
+    while (*pBytesTransferred < bytesToTransfer) {
+        size_t bytesToRead = bytesToTransfer - *pBytesTransferred;
+        if (bytesToRead > sizeof(buffer)) {
+            bytesToRead = sizeof(buffer);
+        }
+
+        ssize_t bytesRead = read(fdIn, buffer, bytesToRead);
+        if (bytesRead == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (*pBytesTransferred > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? dripc_result_success : dripc_result_from_unix_error(errno);
+        }
+        if (bytesRead == 0) {
+            break;  // End of file.
+        }
+
+        size_t bytesWritten = 0;
+        while (bytesWritten < (size_t)bytesRead) {
+            ssize_t result = write(fdOut, buffer + bytesWritten, (size_t)bytesRead - bytesWritten);
+            if (result == -1) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    dripc_wait_fd__unix(fdOut, POLLOUT, -1);
+                    continue;
+                }
+                if (errno == EINTR) {
+                    continue;
+                }
+                return dripc_result_from_unix_error(errno);
+            }
+
+            bytesWritten += (size_t)result;
+        }
+
+        *pBytesTransferred += (size_t)bytesRead;
+    }
+
+    return dripc_result_success;
+}
+
+#ifdef DR_IPC_LINUX
+// Moves data between two descriptors with splice(), one of which must be a pipe. Returns dripc_result_not_supported
+// without transferring anything if the kernel refuses to splice between these descriptors.
+static dripc_result dripc_splice_fd__unix(int fdIn, int fdOut, unsigned int flags, size_t bytesToTransfer, size_t* pBytesTransferred)
+{
+    size_t bytesAlreadyTransferred = *pBytesTransferred;
+    while (*pBytesTransferred < bytesToTransfer) {
+        size_t bytesRemaining = bytesToTransfer - *pBytesTransferred;
+        ssize_t result = splice(fdIn, NULL, fdOut, NULL, (bytesRemaining < DR_IPC_UNIX_MAX_IO_SIZE) ? bytesRemaining : DR_IPC_UNIX_MAX_IO_SIZE, flags);
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EINVAL || errno == ENOSYS) && *pBytesTransferred == bytesAlreadyTransferred) {
+                return dripc_result_not_supported;
+            }
+            return (*pBytesTransferred > bytesAlreadyTransferred && errno == EAGAIN) ? dripc_result_success : dripc_result_from_unix_error(errno);
+        }
+        if (result == 0) {
+            break;  // End of file.
+        }
+
+        *pBytesTransferred += (size_t)result;
+    }
+
+    return dripc_result_success;
+}
+
+static unsigned int dripc_splice_flags__unix(drpipe_unix* pPipeUnix)
+{
+    unsigned int flags = SPLICE_F_MOVE;
+    if (pPipeUnix->options & DR_IPC_NONBLOCK) {
+        flags |= SPLICE_F_NONBLOCK;
+    }
+
+    return flags;
+}
+#endif
+
+dripc_result drpipe_splice_from_fd__unix(drpipe pipe, int fd, size_t bytesToTransfer, size_t* pBytesTransferred)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+#ifdef DR_IPC_LINUX
+    dripc_result result = dripc_splice_fd__unix(fd, pPipeUnix->fd, dripc_splice_flags__unix(pPipeUnix), bytesToTransfer, pBytesTransferred);
+    if (result != dripc_result_not_supported) {
+        return result;
+    }
+#endif
+
+    return dripc_copy_fd__unix(fd, pPipeUnix->fd, bytesToTransfer, pBytesTransferred);
+}
+
+dripc_result drpipe_splice_to_fd__unix(drpipe pipe, int fd, size_t bytesToTransfer, size_t* pBytesTransferred)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+#ifdef DR_IPC_LINUX
+    dripc_result result = dripc_splice_fd__unix(pPipeUnix->fd, fd, dripc_splice_flags__unix(pPipeUnix), bytesToTransfer, pBytesTransferred);
+    if (result != dripc_result_not_supported) {
+        return result;
+    }
+#endif
+
+    return dripc_copy_fd__unix(pPipeUnix->fd, fd, bytesToTransfer, pBytesTransferred);
+}
+
+dripc_result drpipe_write_pages__unix(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+#ifdef DR_IPC_LINUX
+    if (dripc_is_fifo__unix(pPipeUnix->fd)) {
+        while (*pBytesWritten < bytesToWrite) {
+            size_t bytesRemaining = bytesToWrite - *pBytesWritten;
+
+            struct iovec iov;
+            iov.iov_base = (void*)((const char*)pData + *pBytesWritten);
+            iov.iov_len  = (bytesRemaining < DR_IPC_UNIX_MAX_IO_SIZE) ? bytesRemaining : DR_IPC_UNIX_MAX_IO_SIZE;
+
+            ssize_t result = vmsplice(pPipeUnix->fd, &iov, 1, (pPipeUnix->options & DR_IPC_NONBLOCK) ? SPLICE_F_NONBLOCK : 0);
+            if (result == -1) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return (*pBytesWritten > 0 && errno == EAGAIN) ? dripc_result_success : dripc_result_from_unix_error(errno);
+            }
+
+            *pBytesWritten += (size_t)result;
+        }
+
+        return dripc_result_success;
+    }
+#endif
+
+    // Not a pipe, so fall back to a normal write.
+    while (*pBytesWritten < bytesToWrite) {
+        ssize_t result = write(pPipeUnix->fd, (const char*)pData + *pBytesWritten, bytesToWrite - *pBytesWritten);
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (*pBytesWritten > 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) ? dripc_result_success : dripc_result_from_unix_error(errno);
+        }
+
+        *pBytesWritten += (size_t)result;
+    }
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_tee__unix(drpipe pipeIn, drpipe pipeOut, size_t bytesToCopy, size_t* pBytesCopied)
+{
+#ifdef DR_IPC_LINUX
+    drpipe_unix* pPipeInUnix  = (drpipe_unix*)pipeIn;
+    drpipe_unix* pPipeOutUnix = (drpipe_unix*)pipeOut;
+
+    // tee() duplicates whatever is currently in the input pipe in a single call. Looping would just duplicate the same
+    // data again because nothing is consumed.
+    unsigned int flags = ((pPipeInUnix->options | pPipeOutUnix->options) & DR_IPC_NONBLOCK) ? SPLICE_F_NONBLOCK : 0;
+
+    ssize_t result;
+    do {
+        result = tee(pPipeInUnix->fd, pPipeOutUnix->fd, (bytesToCopy < DR_IPC_UNIX_MAX_IO_SIZE) ? bytesToCopy : DR_IPC_UNIX_MAX_IO_SIZE, flags);
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1) {
+        return (errno == EINVAL) ? dripc_result_not_supported : dripc_result_from_unix_error(errno);
+    }
+
+    *pBytesCopied = (size_t)result;
+    return dripc_result_success;
+#else
+    (void)pipeIn;
+    (void)pipeOut;
+    (void)bytesToCopy;
+    (void)pBytesCopied;
+    return dripc_result_not_supported;
+#endif
+}
+
+
+static dripc_result dripc_make_socket_address__unix(const char* name, struct sockaddr_un* pAddress)
+{
+    memset(pAddress, 0, sizeof(*pAddress));
+    pAddress->sun_family = AF_UNIX;
+
+    if (drpipe_get_translated_name(name, pAddress->sun_path, sizeof(pAddress->sun_path)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    return dripc_result_success;
+}
+
+static dripc_result dripc_set_socket_buffer_sizes__unix(int fd, size_t sendBufferSize, size_t receiveBufferSize)
+{
+    if (sendBufferSize > 0) {
+        int size = (sendBufferSize < 0x7FFFFFFF) ? (int)sendBufferSize : 0x7FFFFFFF;
+        if (setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size)) == -1) {
+            return dripc_result_from_unix_error(errno);
+        }
+    }
+
+    if (receiveBufferSize > 0) {
+        int size = (receiveBufferSize < 0x7FFFFFFF) ? (int)receiveBufferSize : 0x7FFFFFFF;
+        if (setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &size, sizeof(size)) == -1) {
+            return dripc_result_from_unix_error(errno);
+        }
+    }
+
+    return dripc_result_success;
+}
+
+static int dripc_is_socket__unix(int fd)
+{
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        return 0;
+    }
+
+    return S_ISSOCK(info.st_mode);
+}
+
+dripc_result drsocket_listen__unix(const char* name, unsigned int options, unsigned int backlog, drsocket* pSocketOut)
+{
+    struct sockaddr_un address;
+    dripc_result result = dripc_make_socket_address__unix(name, &address);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drpipe_unix* pSocketUnix = (drpipe_unix*)calloc(1, sizeof(*pSocketUnix) + strlen(address.sun_path)+1);     // +1 for null terminator.
+    if (pSocketUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pSocketUnix->options = options | DR_IPC_UNIX_SERVER;
+    strcpy(pSocketUnix->name, address.sun_path);
+
+    pSocketUnix->fd = dripc_create_socket__unix(options);
+    if (pSocketUnix->fd == -1) {
+        free(pSocketUnix);
+        return dripc_result_from_unix_error(errno);
+    }
+
+    if (bind(pSocketUnix->fd, (struct sockaddr*)&address, sizeof(address)) == -1) {
+        int error = errno;
+
+        // If nobody is listening on the existing socket it was left behind by a server that did not shut down cleanly.
+        if (error == EADDRINUSE) {
+            int probe = dripc_create_socket__unix(options);
+            if (probe != -1) {
+                if (connect(probe, (struct sockaddr*)&address, sizeof(address)) == -1 && errno == ECONNREFUSED) {
+                    unlink(address.sun_path);
+                    if (bind(pSocketUnix->fd, (struct sockaddr*)&address, sizeof(address)) == 0) {
+                        error = 0;
+                    } else {
+                        error = errno;
+                    }
+                }
+
+                close(probe);
+            }
+        }
+
+        if (error != 0) {
+            close(pSocketUnix->fd);
+            free(pSocketUnix);
+            return dripc_result_from_unix_error(error);
+        }
+    }
+
+    if (listen(pSocketUnix->fd, (backlog == 0 || backlog > SOMAXCONN) ? SOMAXCONN : (int)backlog) == -1) {
+        int error = errno;
+        close(pSocketUnix->fd);
+        unlink(pSocketUnix->name);
+        free(pSocketUnix);
+        return dripc_result_from_unix_error(error);
+    }
+
+    if (options & DR_IPC_NONBLOCK) {
+        result = drpipe_set_nonblocking__unix(pSocketUnix->fd);
+        if (result != dripc_result_success) {
+            close(pSocketUnix->fd);
+            unlink(pSocketUnix->name);
+            free(pSocketUnix);
+            return result;
+        }
+    }
+
+    *pSocketOut = (drsocket)pSocketUnix;
+    return dripc_result_success;
+}
+
+dripc_result drsocket_accept__unix(drsocket socket, unsigned int options, drpipe* pPipeOut)
+{
+    drpipe_unix* pSocketUnix = (drpipe_unix*)socket;
+
+    drpipe_unix* pPipeUnix = (drpipe_unix*)calloc(1, sizeof(*pPipeUnix) + 1);
+    if (pPipeUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pPipeUnix->options = DR_IPC_READ | DR_IPC_WRITE | (options & DR_IPC_NONBLOCK) | (pSocketUnix->options & DR_IPC_SEQPACKET);
+
+    for (;;) {
+#if defined(DR_IPC_LINUX)
+        pPipeUnix->fd = accept4(pSocketUnix->fd, NULL, NULL, SOCK_CLOEXEC | ((options & DR_IPC_NONBLOCK) ? SOCK_NONBLOCK : 0));
+#else
+        pPipeUnix->fd = accept(pSocketUnix->fd, NULL, NULL);
+#endif
+        if (pPipeUnix->fd != -1 || errno != EINTR) {
+            break;
+        }
+    }
+
+    if (pPipeUnix->fd == -1) {
+        int error = errno;
+        free(pPipeUnix);
+        return dripc_result_from_unix_error(error);
+    }
+
+#if !defined(DR_IPC_LINUX)
+    // The accepted socket may or may not inherit O_NONBLOCK from the listener depending on the platform.
+    {
+        int flags = fcntl(pPipeUnix->fd, F_GETFL);
+        if (flags != -1) {
+            fcntl(pPipeUnix->fd, F_SETFL, (options & DR_IPC_NONBLOCK) ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+        }
+        fcntl(pPipeUnix->fd, F_SETFD, FD_CLOEXEC);
+    }
+#endif
+
+    *pPipeOut = (drpipe)pPipeUnix;
+    return dripc_result_success;
+}
+
+dripc_result drsocket_connect__unix(const char* name, unsigned int options, drpipe* pPipeOut)
+{
+    struct sockaddr_un address;
+    dripc_result result = dripc_make_socket_address__unix(name, &address);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drpipe_unix* pPipeUnix = (drpipe_unix*)calloc(1, sizeof(*pPipeUnix) + strlen(address.sun_path)+1);     // +1 for null terminator.
+    if (pPipeUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pPipeUnix->options = DR_IPC_READ | DR_IPC_WRITE | (options & (DR_IPC_NONBLOCK | DR_IPC_SEQPACKET)) | DR_IPC_UNIX_CLIENT;
+    strcpy(pPipeUnix->name, address.sun_path);
+
+    pPipeUnix->fd = dripc_create_socket__unix(options);
+    if (pPipeUnix->fd == -1) {
+        free(pPipeUnix);
+        return dripc_result_from_unix_error(errno);
+    }
+
+    // Connecting is always done in blocking mode. Connecting to a local socket never waits on the server to accept.
+    int connectResult;
+    do {
+        connectResult = connect(pPipeUnix->fd, (struct sockaddr*)&address, sizeof(address));
+    } while (connectResult == -1 && errno == EINTR);
+
+    if (connectResult == -1) {
+        int error = errno;
+        close(pPipeUnix->fd);
+        free(pPipeUnix);
+        return dripc_result_from_unix_error(error);
+    }
+
+    if (options & DR_IPC_NONBLOCK) {
+        result = drpipe_set_nonblocking__unix(pPipeUnix->fd);
+        if (result != dripc_result_success) {
+            close(pPipeUnix->fd);
+            free(pPipeUnix);
+            return result;
+        }
+    }
+
+    *pPipeOut = (drpipe)pPipeUnix;
+    return dripc_result_success;
+}
+
+dripc_result drsocket_set_buffer_sizes__unix(drsocket socket, size_t sendBufferSize, size_t receiveBufferSize)
+{
+    return dripc_set_socket_buffer_sizes__unix(((drpipe_unix*)socket)->fd, sendBufferSize, receiveBufferSize);
+}
+
+dripc_result drpipe_set_socket_buffer_sizes__unix(drpipe pipe, size_t sendBufferSize, size_t receiveBufferSize)
+{
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+    if (!dripc_is_socket__unix(pPipeUnix->fd)) {
+        return dripc_result_invalid_args;
+    }
+
+    return dripc_set_socket_buffer_sizes__unix(pPipeUnix->fd, sendBufferSize, receiveBufferSize);
+}
+
+// A drpipe_server is a listening socket at the pipe's name. The kernel completes connections on its own and queues up to
+// the backlog of them which is what makes up the pool, so there's nothing to replenish in the background.
+dripc_result drpipe_server_open__unix(const char* name, const drpipe_config* pConfig, unsigned int poolSize, drpipe_server* pServerOut)
+{
+    if ((pConfig->options & (DR_IPC_READ | DR_IPC_WRITE)) == 0) {
+        return dripc_result_invalid_args;   // Neither read nor write mode was specified.
+    }
+
+    // The listener is always non-blocking so that drpipe_server_accept() can put a time limit on waiting, and so that
+    // several threads can accept on the same server without one of them getting stuck when another wins the connection.
+    drsocket listener;
+    dripc_result result = drsocket_listen__unix(name, DR_IPC_NONBLOCK, poolSize, &listener);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drpipe_unix* pListenerUnix = (drpipe_unix*)listener;
+    pListenerUnix->options = DR_IPC_UNIX_SERVER | (pConfig->options & DR_IPC_NONBLOCK);    // Only used for the accepted pipes from here on.
+
+    // Accepted connections inherit the sizes of the listener's buffers.
+    if (pConfig->capacity > 0) {
+        dripc_set_socket_buffer_sizes__unix(pListenerUnix->fd, pConfig->capacity, pConfig->capacity);
+    }
+
+    *pServerOut = (drpipe_server)listener;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_server_accept__unix(drpipe_server server, unsigned int timeoutInMilliseconds, drpipe* pPipeOut)
+{
+    drpipe_unix* pListenerUnix = (drpipe_unix*)server;
+
+    uint64_t startTime = dripc_get_tick_count__unix();
+    for (;;) {
+        dripc_result result = drsocket_accept__unix((drsocket)server, pListenerUnix->options & DR_IPC_NONBLOCK, pPipeOut);
+        if (result != dripc_result_would_block) {
+            return result;
+        }
+
+        int remainingTime = dripc_get_remaining_time__unix(startTime, timeoutInMilliseconds);
+        if (remainingTime == 0) {
+            return dripc_result_timeout;
+        }
+
+        result = dripc_wait_fd__unix(pListenerUnix->fd, POLLIN, remainingTime);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+}
+
+
+#ifdef DR_IPC_LINUX
+typedef struct
+{
+    drpipe pipe;
+    void* pUserData;
+} dripc_poller_entry__unix;
+
+// Entries are indexed by file descriptor which keeps lookups in dripc_poller_wait() constant time without needing to
+// allocate anything per pipe.
+typedef struct
+{
+    int epfd;
+    dripc_poller_entry__unix* pEntries;
+    size_t entryCapacity;
+} dripc_poller_unix;
+
+static uint32_t dripc_events_to_epoll__unix(unsigned int events)
+{
+    uint32_t epollEvents = EPOLLRDHUP;
+    if (events & DR_IPC_READ) {
+        epollEvents |= EPOLLIN;
+    }
+    if (events & DR_IPC_WRITE) {
+        epollEvents |= EPOLLOUT;
+    }
+
+    return epollEvents;
+}
+
+static unsigned int dripc_events_from_epoll__unix(uint32_t epollEvents)
+{
+    unsigned int events = 0;
+    if (epollEvents & EPOLLIN) {
+        events |= DR_IPC_READ;
+    }
+    if (epollEvents & EPOLLOUT) {
+        events |= DR_IPC_WRITE;
+    }
+    if (epollEvents & (EPOLLHUP | EPOLLRDHUP | EPOLLERR)) {
+        events |= DR_IPC_HANGUP;
+    }
+
+    return events;
+}
+#endif
+
+dripc_result dripc_poller_open__unix(dripc_poller* pPollerOut)
+{
+#ifdef DR_IPC_LINUX
+    dripc_poller_unix* pPollerUnix = (dripc_poller_unix*)calloc(1, sizeof(*pPollerUnix));
+    if (pPollerUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pPollerUnix->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (pPollerUnix->epfd == -1) {
+        int error = errno;
+        free(pPollerUnix);
+        return dripc_result_from_unix_error(error);
+    }
+
+    *pPollerOut = (dripc_poller)pPollerUnix;
+    return dripc_result_success;
+#else
+    (void)pPollerOut;
+    return dripc_result_not_supported;
+#endif
+}
+
+void dripc_poller_close__unix(dripc_poller poller)
+{
+#ifdef DR_IPC_LINUX
+    dripc_poller_unix* pPollerUnix = (dripc_poller_unix*)poller;
+
+    close(pPollerUnix->epfd);
+    free(pPollerUnix->pEntries);
+    free(pPollerUnix);
+#else
+    (void)poller;
+#endif
+}
+
+dripc_result dripc_poller_add__unix(dripc_poller poller, drpipe pipe, unsigned int events, void* pUserData)
+{
+#ifdef DR_IPC_LINUX
+    dripc_poller_unix* pPollerUnix = (dripc_poller_unix*)poller;
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    if ((size_t)pPipeUnix->fd >= pPollerUnix->entryCapacity) {
+        size_t newCapacity = (pPollerUnix->entryCapacity == 0) ? 64 : pPollerUnix->entryCapacity;
+        while (newCapacity <= (size_t)pPipeUnix->fd) {
+            newCapacity *= 2;
+        }
+
+        dripc_poller_entry__unix* pNewEntries = (dripc_poller_entry__unix*)realloc(pPollerUnix->pEntries, newCapacity * sizeof(*pNewEntries));
+        if (pNewEntries == NULL) {
+            return dripc_result_unknown_error;
+        }
+
+        memset(pNewEntries + pPollerUnix->entryCapacity, 0, (newCapacity - pPollerUnix->entryCapacity) * sizeof(*pNewEntries));
+        pPollerUnix->pEntries = pNewEntries;
+        pPollerUnix->entryCapacity = newCapacity;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = dripc_events_to_epoll__unix(events);
+    ev.data.fd = pPipeUnix->fd;
+    if (epoll_ctl(pPollerUnix->epfd, EPOLL_CTL_ADD, pPipeUnix->fd, &ev) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pPollerUnix->pEntries[pPipeUnix->fd].pipe = pipe;
+    pPollerUnix->pEntries[pPipeUnix->fd].pUserData = pUserData;
+    return dripc_result_success;
+#else
+    (void)poller;
+    (void)pipe;
+    (void)events;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+}
+
+dripc_result dripc_poller_modify__unix(dripc_poller poller, drpipe pipe, unsigned int events, void* pUserData)
+{
+#ifdef DR_IPC_LINUX
+    dripc_poller_unix* pPollerUnix = (dripc_poller_unix*)poller;
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    if ((size_t)pPipeUnix->fd >= pPollerUnix->entryCapacity || pPollerUnix->pEntries[pPipeUnix->fd].pipe != pipe) {
+        return dripc_result_invalid_args;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = dripc_events_to_epoll__unix(events);
+    ev.data.fd = pPipeUnix->fd;
+    if (epoll_ctl(pPollerUnix->epfd, EPOLL_CTL_MOD, pPipeUnix->fd, &ev) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pPollerUnix->pEntries[pPipeUnix->fd].pUserData = pUserData;
+    return dripc_result_success;
+#else
+    (void)poller;
+    (void)pipe;
+    (void)events;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+}
+
+dripc_result dripc_poller_remove__unix(dripc_poller poller, drpipe pipe)
+{
+#ifdef DR_IPC_LINUX
+    dripc_poller_unix* pPollerUnix = (dripc_poller_unix*)poller;
+    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+
+    if ((size_t)pPipeUnix->fd >= pPollerUnix->entryCapacity || pPollerUnix->pEntries[pPipeUnix->fd].pipe != pipe) {
+        return dripc_result_invalid_args;
+    }
+
+    if (epoll_ctl(pPollerUnix->epfd, EPOLL_CTL_DEL, pPipeUnix->fd, NULL) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pPollerUnix->pEntries[pPipeUnix->fd].pipe = NULL;
+    pPollerUnix->pEntries[pPipeUnix->fd].pUserData = NULL;
+    return dripc_result_success;
+#else
+    (void)poller;
+    (void)pipe;
+    return dripc_result_not_supported;
+#endif
+}
+
+dripc_result dripc_poller_wait__unix(dripc_poller poller, dripc_poll_event* pEvents, size_t eventCapacity, unsigned int timeoutInMilliseconds, size_t* pEventCount)
+{
+#ifdef DR_IPC_LINUX
+    dripc_poller_unix* pPollerUnix = (dripc_poller_unix*)poller;
+
+    struct epoll_event epollEvents[256];
+    int maxEvents = (eventCapacity < 256) ? (int)eventCapacity : 256;
+    int timeout = (timeoutInMilliseconds == DR_IPC_INFINITE || timeoutInMilliseconds > 0x7FFFFFFF) ? -1 : (int)timeoutInMilliseconds;
+
+    int eventCount;
+    do {
+        eventCount = epoll_wait(pPollerUnix->epfd, epollEvents, maxEvents, timeout);
+    } while (eventCount == -1 && errno == EINTR);
+
+    if (eventCount == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+    if (eventCount == 0) {
+        return dripc_result_timeout;
+    }
+
+    int iEvent;
+    for (iEvent = 0; iEvent < eventCount; ++iEvent) {
+        int fd = epollEvents[iEvent].data.fd;
+        pEvents[iEvent].pipe      = pPollerUnix->pEntries[fd].pipe;
+        pEvents[iEvent].pUserData = pPollerUnix->pEntries[fd].pUserData;
+        pEvents[iEvent].events    = dripc_events_from_epoll__unix(epollEvents[iEvent].events);
+    }
+
+    *pEventCount = (size_t)eventCount;
+    return dripc_result_success;
+#else
+    (void)poller;
+    (void)pEvents;
+    (void)eventCapacity;
+    (void)timeoutInMilliseconds;
+    (void)pEventCount;
+    return dripc_result_not_supported;
+#endif
+}
+
+#ifdef DR_IPC_LINUX
+typedef struct dripc_io_op__unix dripc_io_op__unix;
+struct dripc_io_op__unix
+{
+    drpipe pipe;
+    int fd;
+    int isWrite;
+    struct iovec iov;
+    dripc_io_callback onComplete;
+    void* pUserData;
+    dripc_io_op__unix* pNext;   // The next free operation, or with epoll, the next operation queued on the same descriptor.
+};
+
+// With epoll, operations are queued per descriptor and performed in order as the descriptor becomes ready.
+typedef struct
+{
+    dripc_io_op__unix* pReadHead;
+    dripc_io_op__unix* pReadTail;
+    dripc_io_op__unix* pWriteHead;
+    dripc_io_op__unix* pWriteTail;
+    uint32_t registeredEvents;
+    int isSocket;                       // Checked whenever an operation is queued on an idle descriptor.
+} dripc_io_fd_queue__unix;
+
+typedef struct
+{
+    dripc_io_backend backend;
+    dripc_io_op__unix* pOps;
+    dripc_io_op__unix* pFreeOps;
+    unsigned int inFlightCount;
+
+    // io_uring. The rings are shared with the kernel so the head and tail indices are accessed atomically.
+    int ringFD;
+    void* pSQRing;
+    size_t sqRingSize;
+    void* pCQRing;
+    size_t cqRingSize;
+    void* pSQEs;
+    size_t sqesSize;
+    volatile uint32_t* pSQHead;
+    volatile uint32_t* pSQTail;
+    uint32_t* pSQArray;
+    uint32_t sqMask;
+    uint32_t sqEntries;
+    volatile uint32_t* pCQHead;
+    volatile uint32_t* pCQTail;
+    uint32_t cqMask;
+    void* pCQEs;
+    uint32_t unsubmittedCount;
+    uint64_t fileOffset;
+
+    // epoll.
+    int epfd;
+    dripc_io_fd_queue__unix* pQueues;
+    size_t queueCapacity;
+} dripc_io_context_unix;
+
+static dripc_io_op__unix* dripc_io_alloc_op__unix(dripc_io_context_unix* pContextUnix)
+{
+    dripc_io_op__unix* pOp = pContextUnix->pFreeOps;
+    if (pOp != NULL) {
+        pContextUnix->pFreeOps = pOp->pNext;
+        pOp->pNext = NULL;
+        pContextUnix->inFlightCount += 1;
+    }
+
+    return pOp;
+}
+
+// Returns the operation to the free list before firing its callback so that the callback can immediately queue up
+// another operation.
+static void dripc_io_complete_op__unix(dripc_io_context_unix* pContextUnix, dripc_io_op__unix* pOp, dripc_result result, size_t bytesTransferred)
+{
+    drpipe pipe = pOp->pipe;
+    dripc_io_callback onComplete = pOp->onComplete;
+    void* pUserData = pOp->pUserData;
+
+    pOp->pNext = pContextUnix->pFreeOps;
+    pContextUnix->pFreeOps = pOp;
+    pContextUnix->inFlightCount -= 1;
+
+    onComplete((dripc_io_context)pContextUnix, pipe, result, bytesTransferred, pUserData);
+}
+
+
+#ifdef DR_IPC_HAS_IO_URING
+static dripc_result dripc_io_uring_init__unix(dripc_io_context_unix* pContextUnix, unsigned int queueDepth)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int fd = (int)syscall(__NR_io_uring_setup, queueDepth, &params);
+    if (fd == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pContextUnix->ringFD = fd;
+    pContextUnix->sqRingSize = params.sq_off.array + params.sq_entries*sizeof(uint32_t);
+    pContextUnix->cqRingSize = params.cq_off.cqes  + params.cq_entries*sizeof(struct io_uring_cqe);
+    pContextUnix->sqesSize   = params.sq_entries*sizeof(struct io_uring_sqe);
+
+    // Newer kernels let both rings share a single mapping.
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        if (pContextUnix->cqRingSize > pContextUnix->sqRingSize) {
+            pContextUnix->sqRingSize = pContextUnix->cqRingSize;
+        }
+        pContextUnix->cqRingSize = pContextUnix->sqRingSize;
+    }
+
+    pContextUnix->pSQRing = mmap(NULL, pContextUnix->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (pContextUnix->pSQRing == MAP_FAILED) {
+        pContextUnix->pSQRing = NULL;
+        return dripc_result_from_unix_error(errno);
+    }
+
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        pContextUnix->pCQRing = pContextUnix->pSQRing;
+    } else {
+        pContextUnix->pCQRing = mmap(NULL, pContextUnix->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (pContextUnix->pCQRing == MAP_FAILED) {
+            pContextUnix->pCQRing = NULL;
+            return dripc_result_from_unix_error(errno);
+        }
+    }
+
+    pContextUnix->pSQEs = mmap(NULL, pContextUnix->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (pContextUnix->pSQEs == MAP_FAILED) {
+        pContextUnix->pSQEs = NULL;
+        return dripc_result_from_unix_error(errno);
+    }
+
+    char* pSQ = (char*)pContextUnix->pSQRing;
+    char* pCQ = (char*)pContextUnix->pCQRing;
+    pContextUnix->pSQHead   = (volatile uint32_t*)(pSQ + params.sq_off.head);
+    pContextUnix->pSQTail   = (volatile uint32_t*)(pSQ + params.sq_off.tail);
+    pContextUnix->pSQArray  = (uint32_t*)(pSQ + params.sq_off.array);
+    pContextUnix->sqMask    = *(uint32_t*)(pSQ + params.sq_off.ring_mask);
+    pContextUnix->sqEntries = *(uint32_t*)(pSQ + params.sq_off.ring_entries);
+    pContextUnix->pCQHead   = (volatile uint32_t*)(pCQ + params.cq_off.head);
+    pContextUnix->pCQTail   = (volatile uint32_t*)(pCQ + params.cq_off.tail);
+    pContextUnix->cqMask    = *(uint32_t*)(pCQ + params.cq_off.ring_mask);
+    pContextUnix->pCQEs     = pCQ + params.cq_off.cqes;
+
+    // An offset of -1 means "use the current file position" but older kernels reject it. Pipes and sockets don't have a
+    // position anyway so 0 works just as well there.
+    pContextUnix->fileOffset = (params.features & IORING_FEAT_RW_CUR_POS) ? (uint64_t)-1 : 0;
+
+    pContextUnix->backend = dripc_io_backend_io_uring;
+    return dripc_result_success;
+}
+
+static void dripc_io_uring_uninit__unix(dripc_io_context_unix* pContextUnix)
+{
+    if (pContextUnix->pSQEs != NULL) {
+        munmap(pContextUnix->pSQEs, pContextUnix->sqesSize);
+    }
+    if (pContextUnix->pCQRing != NULL && pContextUnix->pCQRing != pContextUnix->pSQRing) {
+        munmap(pContextUnix->pCQRing, pContextUnix->cqRingSize);
+    }
+    if (pContextUnix->pSQRing != NULL) {
+        munmap(pContextUnix->pSQRing, pContextUnix->sqRingSize);
+    }
+    if (pContextUnix->ringFD != -1) {
+        close(pContextUnix->ringFD);
+    }
+
+    pContextUnix->pSQEs   = NULL;
+    pContextUnix->pCQRing = NULL;
+    pContextUnix->pSQRing = NULL;
+    pContextUnix->ringFD  = -1;
+}
+
+static void dripc_io_uring_queue_op__unix(dripc_io_context_unix* pContextUnix, dripc_io_op__unix* pOp)
+{
+    // The number of operations in flight never exceeds the queue depth so there is always room in the submission queue.
+    uint32_t tail  = *pContextUnix->pSQTail;
+    uint32_t index = tail & pContextUnix->sqMask;
+
+    struct io_uring_sqe* pSQE = (struct io_uring_sqe*)pContextUnix->pSQEs + index;
+    memset(pSQE, 0, sizeof(*pSQE));
+    pSQE->opcode    = (pOp->isWrite) ? IORING_OP_WRITEV : IORING_OP_READV;
+    pSQE->fd        = pOp->fd;
+    pSQE->addr      = (uint64_t)(uintptr_t)&pOp->iov;
+    pSQE->len       = 1;
+    pSQE->off       = pContextUnix->fileOffset;
+    pSQE->user_data = (uint64_t)(pOp - pContextUnix->pOps);
+
+    pContextUnix->pSQArray[index] = index;
+    dripc_atomic_store_u32(pContextUnix->pSQTail, tail + 1);
+    pContextUnix->unsubmittedCount += 1;
+}
+
+// Submits everything that has been queued and optionally waits for at least one completion, all in one system call.
+static dripc_result dripc_io_uring_enter__unix(dripc_io_context_unix* pContextUnix, int wait)
+{
+    if (pContextUnix->unsubmittedCount == 0 && !wait) {
+        return dripc_result_success;
+    }
+
+    long result;
+    do {
+        result = syscall(__NR_io_uring_enter, pContextUnix->ringFD, pContextUnix->unsubmittedCount, (wait) ? 1 : 0, (wait) ? IORING_ENTER_GETEVENTS : 0, NULL, 0);
+    } while (result == -1 && errno == EINTR);
+
+    if (result == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pContextUnix->unsubmittedCount -= (uint32_t)result;
+    return dripc_result_success;
+}
+
+static size_t dripc_io_uring_reap__unix(dripc_io_context_unix* pContextUnix)
+{
+    size_t completionCount = 0;
+
+    uint32_t head = *pContextUnix->pCQHead;
+    while (head != dripc_atomic_load_u32(pContextUnix->pCQTail)) {
+        struct io_uring_cqe* pCQE = (struct io_uring_cqe*)pContextUnix->pCQEs + (head & pContextUnix->cqMask);
+        dripc_io_op__unix* pOp = pContextUnix->pOps + pCQE->user_data;
+        int res = pCQE->res;
+
+        // Release the slot before firing the callback.
+        head += 1;
+        dripc_atomic_store_u32(pContextUnix->pCQHead, head);
+
+        if (res < 0) {
+            dripc_io_complete_op__unix(pContextUnix, pOp, dripc_result_from_unix_error(-res), 0);
+        } else {
+            dripc_io_complete_op__unix(pContextUnix, pOp, dripc_result_success, (size_t)res);
+        }
+
+        completionCount += 1;
+    }
+
+    return completionCount;
+}
+#endif  // DR_IPC_HAS_IO_URING
+
+
+static dripc_result dripc_io_epoll_update__unix(dripc_io_context_unix* pContextUnix, int fd)
+{
+    dripc_io_fd_queue__unix* pQueue = &pContextUnix->pQueues[fd];
+
+    uint32_t events = 0;
+    if (pQueue->pReadHead != NULL) {
+        events |= EPOLLIN;
+    }
+    if (pQueue->pWriteHead != NULL) {
+        events |= EPOLLOUT;
+    }
+
+    if (events == pQueue->registeredEvents) {
+        return dripc_result_success;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.fd = fd;
+
+    int op;
+    if (pQueue->registeredEvents == 0) {
+        op = EPOLL_CTL_ADD;
+    } else if (events == 0) {
+        op = EPOLL_CTL_DEL;
+    } else {
+        op = EPOLL_CTL_MOD;
+    }
+
+    if (epoll_ctl(pContextUnix->epfd, op, fd, &ev) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pQueue->registeredEvents = events;
+    return dripc_result_success;
+}
+
+static dripc_result dripc_io_epoll_queue_op__unix(dripc_io_context_unix* pContextUnix, dripc_io_op__unix* pOp)
+{
+    if ((size_t)pOp->fd >= pContextUnix->queueCapacity) {
+        size_t newCapacity = (pContextUnix->queueCapacity == 0) ? 64 : pContextUnix->queueCapacity;
+        while (newCapacity <= (size_t)pOp->fd) {
+            newCapacity *= 2;
+        }
+
+        dripc_io_fd_queue__unix* pNewQueues = (dripc_io_fd_queue__unix*)realloc(pContextUnix->pQueues, newCapacity * sizeof(*pNewQueues));
+        if (pNewQueues == NULL) {
+            return dripc_result_unknown_error;
+        }
+
+        memset(pNewQueues + pContextUnix->queueCapacity, 0, (newCapacity - pContextUnix->queueCapacity) * sizeof(*pNewQueues));
+        pContextUnix->pQueues = pNewQueues;
+        pContextUnix->queueCapacity = newCapacity;
+    }
+
+    dripc_io_fd_queue__unix* pQueue = &pContextUnix->pQueues[pOp->fd];
+    dripc_io_op__unix** ppHead = (pOp->isWrite) ? &pQueue->pWriteHead : &pQueue->pReadHead;
+    dripc_io_op__unix** ppTail = (pOp->isWrite) ? &pQueue->pWriteTail : &pQueue->pReadTail;
+
+    // The descriptor number could have been closed and reused since it was last seen, but not while it has anything queued.
+    if (pQueue->pReadHead == NULL && pQueue->pWriteHead == NULL) {
+        pQueue->isSocket = dripc_is_socket__unix(pOp->fd);
+    }
+
+    if (*ppHead == NULL) {
+        *ppHead = pOp;
+    } else {
+        (*ppTail)->pNext = pOp;
+    }
+    *ppTail = pOp;
+
+    dripc_result result = dripc_io_epoll_update__unix(pContextUnix, pOp->fd);
+    if (result != dripc_result_success) {
+        // Unlink it again. It's always the last one in the list.
+        if (*ppHead == pOp) {
+            *ppHead = NULL;
+            *ppTail = NULL;
+        } else {
+            dripc_io_op__unix* pPrev = *ppHead;
+            while (pPrev->pNext != pOp) {
+                pPrev = pPrev->pNext;
+            }
+            pPrev->pNext = NULL;
+            *ppTail = pPrev;
+        }
+    }
+
+    return result;
+}
+
+// Performs the operation at the head of a descriptor's read or write queue. Returns 1 if it completed. A write to a
+// descriptor that has been hung up on isn't attempted and completes with dripc_result_disconnected instead.
+static int dripc_io_epoll_perform__unix(dripc_io_context_unix* pContextUnix, int fd, int isWrite, int isHungUp)
+{
+    dripc_io_fd_queue__unix* pQueue = &pContextUnix->pQueues[fd];
+    dripc_io_op__unix** ppHead = (isWrite) ? &pQueue->pWriteHead : &pQueue->pReadHead;
+    dripc_io_op__unix* pOp = *ppHead;
+    if (pOp == NULL) {
+        return 0;
+    }
+
+    ssize_t bytesTransferred;
+    int error;
+    if (isWrite && isHungUp) {
+        // Writing to a pipe or socket whose reader has gone raises SIGPIPE, which kills the process by default.
+        bytesTransferred = -1;
+        error = EPIPE;
+    } else {
+        if (isWrite) {
+            size_t bytesToWrite = pOp->iov.iov_len;
+            if (pQueue->isSocket) {
+                // Sockets make no promise about how much a write can take in one piece, so send() is told not to wait
+                // whatever mode the socket is in and the operation completes with however much went out. MSG_NOSIGNAL
+                // turns SIGPIPE into EPIPE if the peer goes away before the hang up has been seen.
+                bytesTransferred = send(fd, pOp->iov.iov_base, bytesToWrite, MSG_DONTWAIT | MSG_NOSIGNAL);
+            } else {
+                // Readiness only guarantees room for PIPE_BUF bytes so on a blocking pipe anything more than that could
+                // block the whole loop. Non-blocking pipes can just take whatever fits.
+                if ((((drpipe_unix*)pOp->pipe)->options & DR_IPC_NONBLOCK) == 0 && bytesToWrite > DR_IPC_PIPE_BUF) {
+                    bytesToWrite = DR_IPC_PIPE_BUF;
+                }
+                bytesTransferred = write(fd, pOp->iov.iov_base, bytesToWrite);
+            }
+        } else {
+            bytesTransferred = read(fd, pOp->iov.iov_base, pOp->iov.iov_len);
+        }
+
+        if (bytesTransferred == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) {
+            return 0;   // Spurious wake up. Leave it queued.
+        }
+
+        error = errno;
+    }
+
+    *ppHead = pOp->pNext;
+    if (*ppHead == NULL) {
+        if (isWrite) {
+            pQueue->pWriteTail = NULL;
+        } else {
+            pQueue->pReadTail = NULL;
+        }
+    }
+
+    if (bytesTransferred == -1) {
+        dripc_io_complete_op__unix(pContextUnix, pOp, dripc_result_from_unix_error(error), 0);
+    } else {
+        dripc_io_complete_op__unix(pContextUnix, pOp, dripc_result_success, (size_t)bytesTransferred);
+    }
+
+    return 1;
+}
+
+static dripc_result dripc_io_epoll_run__unix(dripc_io_context_unix* pContextUnix, unsigned int timeoutInMilliseconds, size_t* pCompletionCount)
+{
+    struct epoll_event epollEvents[256];
+    uint64_t startTime = dripc_get_tick_count__unix();
+    size_t completionCount = 0;
+
+    for (;;) {
+        int timeout = -1;
+        if (timeoutInMilliseconds != DR_IPC_INFINITE) {
+            uint64_t elapsed = dripc_get_tick_count__unix() - startTime;
+            uint64_t remaining = (elapsed >= timeoutInMilliseconds) ? 0 : timeoutInMilliseconds - elapsed;
+            timeout = (remaining > 0x7FFFFFFF) ? 0x7FFFFFFF : (int)remaining;
+        }
+
+        int eventCount = epoll_wait(pContextUnix->epfd, epollEvents, 256, timeout);
+        if (eventCount == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return dripc_result_from_unix_error(errno);
+        }
+
+        int iEvent;
+        for (iEvent = 0; iEvent < eventCount; ++iEvent) {
+            int fd = epollEvents[iEvent].data.fd;
+            uint32_t events = epollEvents[iEvent].events;
+
+            // Errors and hang ups are reported to whichever operations are waiting so they can see EOF or the error. Every
+            // queued write fails since none of them can go anywhere.
+            int isHungUp = (events & (EPOLLHUP | EPOLLERR)) != 0;
+            if (events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                completionCount += dripc_io_epoll_perform__unix(pContextUnix, fd, 0, isHungUp);
+            }
+            if (isHungUp) {
+                while (dripc_io_epoll_perform__unix(pContextUnix, fd, 1, isHungUp)) {
+                    completionCount += 1;
+                }
+            } else if (events & EPOLLOUT) {
+                completionCount += dripc_io_epoll_perform__unix(pContextUnix, fd, 1, isHungUp);
+            }
+
+            dripc_io_epoll_update__unix(pContextUnix, fd);
+        }
+
+        if (completionCount > 0) {
+            break;
+        }
+        if (eventCount == 0 || pContextUnix->inFlightCount == 0) {
+            return dripc_result_timeout;
+        }
+    }
+
+    *pCompletionCount = completionCount;
+    return dripc_result_success;
+}
+#endif  // DR_IPC_LINUX
+
+dripc_result dripc_io_context_open__unix(unsigned int queueDepth, unsigned int options, dripc_io_context* pContextOut)
+{
+#ifdef DR_IPC_LINUX
+    dripc_io_context_unix* pContextUnix = (dripc_io_context_unix*)calloc(1, sizeof(*pContextUnix));
+    if (pContextUnix == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pContextUnix->ringFD = -1;
+    pContextUnix->epfd   = -1;
+
+    pContextUnix->pOps = (dripc_io_op__unix*)calloc(queueDepth, sizeof(*pContextUnix->pOps));
+    if (pContextUnix->pOps == NULL) {
+        free(pContextUnix);
+        return dripc_result_unknown_error;
+    }
+
+    unsigned int iOp;
+    for (iOp = queueDepth; iOp > 0; --iOp) {
+        pContextUnix->pOps[iOp-1].pNext = pContextUnix->pFreeOps;
+        pContextUnix->pFreeOps = &pContextUnix->pOps[iOp-1];
+    }
+
+    dripc_result result = dripc_result_not_supported;
+#ifdef DR_IPC_HAS_IO_URING
+    if ((options & DR_IPC_NO_IO_URING) == 0) {
+        // This fails on kernels older than 5.1 or where io_uring has been disabled, in which case we fall back to epoll.
+        result = dripc_io_uring_init__unix(pContextUnix, queueDepth);
+        if (result != dripc_result_success) {
+            dripc_io_uring_uninit__unix(pContextUnix);
+        }
+    }
+#else
+    (void)options;
+#endif
+
+    if (result != dripc_result_success) {
+        pContextUnix->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (pContextUnix->epfd == -1) {
+            int error = errno;
+            free(pContextUnix->pOps);
+            free(pContextUnix);
+            return dripc_result_from_unix_error(error);
+        }
+
+        pContextUnix->backend = dripc_io_backend_epoll;
+    }
+
+    *pContextOut = (dripc_io_context)pContextUnix;
+    return dripc_result_success;
+#else
+    (void)queueDepth;
+    (void)options;
+    (void)pContextOut;
+    return dripc_result_not_supported;
+#endif
+}
+
+void dripc_io_context_close__unix(dripc_io_context context)
+{
+#ifdef DR_IPC_LINUX
+    dripc_io_context_unix* pContextUnix = (dripc_io_context_unix*)context;
+
+#ifdef DR_IPC_HAS_IO_URING
+    dripc_io_uring_uninit__unix(pContextUnix);
+#endif
+    if (pContextUnix->epfd != -1) {
+        close(pContextUnix->epfd);
+    }
+
+    free(pContextUnix->pQueues);
+    free(pContextUnix->pOps);
+    free(pContextUnix);
+#else
+    (void)context;
+#endif
+}
+
+dripc_io_backend dripc_io_context_get_backend__unix(dripc_io_context context)
+{
+#ifdef DR_IPC_LINUX
+    return ((dripc_io_context_unix*)context)->backend;
+#else
+    (void)context;
+    return dripc_io_backend_none;
+#endif
+}
+
+dripc_result drpipe_submit_async__unix(dripc_io_context context, drpipe pipe, int isWrite, void* pData, size_t sizeInBytes, dripc_io_callback onComplete, void* pUserData)
+{
+#ifdef DR_IPC_LINUX
+    dripc_io_context_unix* pContextUnix = (dripc_io_context_unix*)context;
+
+    dripc_io_op__unix* pOp = dripc_io_alloc_op__unix(pContextUnix);
+    if (pOp == NULL) {
+        return dripc_result_would_block;    // The queue is full. Run the context to drain some completions first.
+    }
+
+    pOp->pipe         = pipe;
+    pOp->fd           = ((drpipe_unix*)pipe)->fd;
+    pOp->isWrite      = isWrite;
+    pOp->iov.iov_base = pData;
+    pOp->iov.iov_len  = (sizeInBytes > DR_IPC_UNIX_MAX_IO_SIZE) ? DR_IPC_UNIX_MAX_IO_SIZE : sizeInBytes;
+    pOp->onComplete   = onComplete;
+    pOp->pUserData    = pUserData;
+
+#ifdef DR_IPC_HAS_IO_URING
+    if (pContextUnix->backend == dripc_io_backend_io_uring) {
+        dripc_io_uring_queue_op__unix(pContextUnix, pOp);
+        return dripc_result_success;
+    }
+#endif
+
+    dripc_result result = dripc_io_epoll_queue_op__unix(pContextUnix, pOp);
+    if (result != dripc_result_success) {
+        pOp->pNext = pContextUnix->pFreeOps;
+        pContextUnix->pFreeOps = pOp;
+        pContextUnix->inFlightCount -= 1;
+    }
+
+    return result;
+#else
+    (void)context;
+    (void)pipe;
+    (void)isWrite;
+    (void)pData;
+    (void)sizeInBytes;
+    (void)onComplete;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+}
+
+dripc_result dripc_io_context_submit__unix(dripc_io_context context)
+{
+#if defined(DR_IPC_LINUX) && defined(DR_IPC_HAS_IO_URING)
+    dripc_io_context_unix* pContextUnix = (dripc_io_context_unix*)context;
+    if (pContextUnix->backend == dripc_io_backend_io_uring) {
+        return dripc_io_uring_enter__unix(pContextUnix, 0);
+    }
+#endif
+
+    // With epoll, operations are registered as they are queued so there is nothing to do.
+    (void)context;
+    return dripc_result_success;
+}
+
+dripc_result dripc_io_context_run__unix(dripc_io_context context, unsigned int timeoutInMilliseconds, size_t* pCompletionCount)
+{
+#ifdef DR_IPC_LINUX
+    dripc_io_context_unix* pContextUnix = (dripc_io_context_unix*)context;
+
+    if (pContextUnix->inFlightCount == 0) {
+        return dripc_result_success;
+    }
+
+#ifdef DR_IPC_HAS_IO_URING
+    if (pContextUnix->backend == dripc_io_backend_io_uring) {
+        // An infinite wait can submit and wait in a single system call. Timed waits submit first and then wait on the ring
+        // itself which becomes readable when there are completions.
+        int waitInKernel = (timeoutInMilliseconds == DR_IPC_INFINITE) && *pContextUnix->pCQHead == dripc_atomic_load_u32(pContextUnix->pCQTail);
+        dripc_result result = dripc_io_uring_enter__unix(pContextUnix, waitInKernel);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        size_t completionCount = dripc_io_uring_reap__unix(pContextUnix);
+        if (completionCount == 0 && !waitInKernel) {
+            int timeout = (timeoutInMilliseconds > 0x7FFFFFFF) ? -1 : (int)timeoutInMilliseconds;
+            result = dripc_wait_fd__unix(pContextUnix->ringFD, POLLIN, timeout);
+            if (result != dripc_result_success) {
+                return result;
+            }
+
+            completionCount = dripc_io_uring_reap__unix(pContextUnix);
+        }
+
+        if (completionCount == 0) {
+            return dripc_result_timeout;
+        }
+
+        *pCompletionCount = completionCount;
+        return dripc_result_success;
+    }
+#endif
+
+    return dripc_io_epoll_run__unix(pContextUnix, timeoutInMilliseconds, pCompletionCount);
+#else
+    (void)context;
+    (void)timeoutInMilliseconds;
+    (void)pCompletionCount;
+    return dripc_result_not_supported;
+#endif
+}
+
+static size_t dripc_translate_name__unix(const char* head, const char* name, char* nameOut, size_t nameOutSize)
+{
+    if (nameOut != NULL && nameOutSize == 0) {
+        return 0;
+    }
+
+    size_t headLength = strlen(head);
+    size_t nameLength = strlen(name);
+
+    if (nameOut != NULL) {
+        if (headLength + nameLength + 1 > nameOutSize) {   // +1 for null terminator.
+            return 0;
+        }
+
+        memcpy(nameOut, head, headLength);
+        memcpy(nameOut + headLength, name, nameLength + 1);
+    }
+
+    return headLength + nameLength;
+}
+
+size_t drpipe_get_translated_name__unix(const char* name, char* nameOut, size_t nameOutSize)
+{
+    return dripc_translate_name__unix(DR_IPC_UNIX_PIPE_NAME_HEAD, name, nameOut, nameOutSize);
+}
+
+
+#ifndef DR_IPC_UNIX_SHM_NAME_HEAD
+#define DR_IPC_UNIX_SHM_NAME_HEAD   "/"
+#endif
+
+#ifndef MFD_CLOEXEC
+#define MFD_CLOEXEC                 0x0001U
+#endif
+
+static dripc_result dripc_shm_map_fd__unix(int fd, size_t sizeInBytes, dripc_shm* pShm)
+{
+    void* pData = mmap(NULL, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pData == MAP_FAILED) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    pShm->pData = pData;
+    pShm->sizeInBytes = sizeInBytes;
+    pShm->hMapping = NULL;
+    return dripc_result_success;
+}
+
+// Creates an unnamed shared memory object and returns its file descriptor.
+static int dripc_shm_create_anonymous_fd__unix(void)
+{
+#if defined(DR_IPC_LINUX) && defined(SYS_memfd_create)
+    int fd = (int)syscall(SYS_memfd_create, "dr_ipc", MFD_CLOEXEC);
+    if (fd != -1) {
+        return fd;
+    }
+#endif
+
+    // Fall back to a uniquely named object which is immediately unlinked.
+    char name[64];
+    unsigned int attempt;
+    for (attempt = 0; attempt < 64; ++attempt) {
+        snprintf(name, sizeof(name), "/dr_ipc_%d_%u_%u", (int)getpid(), (unsigned int)time(NULL), attempt);
+
+        int shmFD = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (shmFD != -1) {
+            shm_unlink(name);
+            return shmFD;
+        }
+
+        if (errno != EEXIST) {
+            break;
+        }
+    }
+
+    return -1;
+}
+
+dripc_result dripc_shm_create__unix(const char* name, size_t sizeInBytes, dripc_shm* pShm)
+{
+    char nameUnix[256];
+    if (dripc_translate_name__unix(DR_IPC_UNIX_SHM_NAME_HEAD, name, nameUnix, sizeof(nameUnix)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    int fd = shm_open(nameUnix, O_RDWR | O_CREAT | O_EXCL, 0666);
+    if (fd == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    if (ftruncate(fd, (off_t)sizeInBytes) == -1) {
+        int error = errno;
+        close(fd);
+        shm_unlink(nameUnix);
+        return dripc_result_from_unix_error(error);
+    }
+
+    dripc_result result = dripc_shm_map_fd__unix(fd, sizeInBytes, pShm);
+    close(fd);  // The mapping keeps the object alive.
+
+    if (result != dripc_result_success) {
+        shm_unlink(nameUnix);
+        return result;
+    }
+
+    pShm->isOwner = 1;
+    strcpy(pShm->name, nameUnix);
+    return dripc_result_success;
+}
+
+dripc_result dripc_shm_open__unix(const char* name, dripc_shm* pShm)
+{
+    char nameUnix[256];
+    if (dripc_translate_name__unix(DR_IPC_UNIX_SHM_NAME_HEAD, name, nameUnix, sizeof(nameUnix)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    int fd = shm_open(nameUnix, O_RDWR, 0);
+    if (fd == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        int error = errno;
+        close(fd);
+        return dripc_result_from_unix_error(error);
+    }
+
+    // The server may not have sized the object yet.
+    if (info.st_size == 0) {
+        close(fd);
+        return dripc_result_unknown_error;
+    }
+
+    dripc_result result = dripc_shm_map_fd__unix(fd, (size_t)info.st_size, pShm);
+    close(fd);
+
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    pShm->isOwner = 0;
+    strcpy(pShm->name, nameUnix);
+    return dripc_result_success;
+}
+
+dripc_result dripc_shm_create_anonymous_pair__unix(size_t sizeInBytes, dripc_shm* pShm0, dripc_shm* pShm1)
+{
+    int fd = dripc_shm_create_anonymous_fd__unix();
+    if (fd == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    dripc_result result = dripc_result_success;
+    if (ftruncate(fd, (off_t)sizeInBytes) == -1) {
+        result = dripc_result_from_unix_error(errno);
+    }
+
+    // Each end gets it's own mapping of the same object so they can be closed independently.
+    if (result == dripc_result_success) {
+        result = dripc_shm_map_fd__unix(fd, sizeInBytes, pShm0);
+    }
+    if (result == dripc_result_success) {
+        result = dripc_shm_map_fd__unix(fd, sizeInBytes, pShm1);
+        if (result != dripc_result_success) {
+            munmap(pShm0->pData, pShm0->sizeInBytes);
+        }
+    }
+
+    close(fd);
+
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    pShm0->isOwner = 0;
+    pShm0->name[0] = '\0';
+    pShm1->isOwner = 0;
+    pShm1->name[0] = '\0';
+    return dripc_result_success;
+}
+
+void dripc_shm_close__unix(dripc_shm* pShm)
+{
+    munmap(pShm->pData, pShm->sizeInBytes);
+
+    if (pShm->isOwner) {
+        shm_unlink(pShm->name);
+    }
+}
+
+dripc_result dripc_map_file__unix(const char* path, size_t sizeInBytes, dripc_mapped_file* pFile)
+{
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    // The file is sparse so space is only used as it's written to.
+    if (ftruncate(fd, (off_t)sizeInBytes) == -1) {
+        dripc_result result = dripc_result_from_unix_error(errno);
+        close(fd);
+        return result;
+    }
+
+    void* pData = mmap(NULL, sizeInBytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (pData == MAP_FAILED) {
+        dripc_result result = dripc_result_from_unix_error(errno);
+        close(fd);
+        return result;
+    }
+
+    pFile->pData       = pData;
+    pFile->sizeInBytes = sizeInBytes;
+    pFile->fd          = fd;
+
+    return dripc_result_success;
+}
+
+// Unmaps a file and cuts it down to the given size.
+void dripc_unmap_file__unix(dripc_mapped_file* pFile, size_t finalSizeInBytes)
+{
+    munmap(pFile->pData, pFile->sizeInBytes);
+
+    if (ftruncate(pFile->fd, (off_t)finalSizeInBytes) == -1) {
+        // Not fatal. The header says how much of the file is used.
+    }
+
+    close(pFile->fd);
+}
+
+
+// Where named regions backed by explicit huge pages live. Each one is a file named after its translated name.
+#ifndef DR_IPC_UNIX_HUGETLBFS_PATH
+#define DR_IPC_UNIX_HUGETLBFS_PATH  "/dev/hugepages"
+#endif
+
+#ifndef MPOL_BIND
+#define MPOL_BIND                   2
+#endif
+
+size_t drshm_get_translated_name__unix(const char* name, char* nameOut, size_t nameOutSize)
+{
+    return dripc_translate_name__unix(DR_IPC_UNIX_SHM_NAME_HEAD, name, nameOut, nameOutSize);
+}
+
+static size_t drshm_get_hugetlbfs_path__unix(const char* name, char* pathOut, size_t pathOutSize)
+{
+    char nameUnix[256];
+    if (dripc_translate_name__unix(DR_IPC_UNIX_SHM_NAME_HEAD, name, nameUnix, sizeof(nameUnix)) == 0) {
+        return 0;
+    }
+
+    return dripc_translate_name__unix(DR_IPC_UNIX_HUGETLBFS_PATH, nameUnix, pathOut, pathOutSize);
+}
+
+static void drshm_region_unlink__unix(const char* path, int isHugeTLB)
+{
+    if (isHugeTLB) {
+        unlink(path);
+    } else {
+        shm_unlink(path);
+    }
+}
+
+// Sizes and maps a newly created object. The fd is always closed. Prefaulting is left to the caller when the memory
+// still needs to be bound to a node since pages that have already been faulted in won't move.
+static dripc_result drshm_region_map_new__unix(int fd, const char* path, int isHugeTLB, size_t sizeInBytes, int populate, dripc_shm* pShm)
+{
+    if (ftruncate(fd, (off_t)sizeInBytes) == -1) {
+        int error = errno;
+        close(fd);
+        drshm_region_unlink__unix(path, isHugeTLB);
+        return dripc_result_from_unix_error(error);
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if (populate) {
+        flags |= MAP_POPULATE;
+    }
+#else
+    (void)populate;
+#endif
+
+    void* pData = mmap(NULL, sizeInBytes, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (pData == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        drshm_region_unlink__unix(path, isHugeTLB);
+        return dripc_result_from_unix_error(error);
+    }
+
+    close(fd);
+
+    pShm->pData = pData;
+    pShm->sizeInBytes = sizeInBytes;
+    pShm->hMapping = NULL;
+    pShm->isOwner = 1;
+    strcpy(pShm->name, path);
+    return dripc_result_success;
+}
+
+dripc_result drshm_region_open_named_server__unix(const char* name, size_t sizeInBytes, const drshm_region_config* pConfig, drshm_region_state* pRegion)
+{
+    char nameUnix[256];
+    if (dripc_translate_name__unix(DR_IPC_UNIX_SHM_NAME_HEAD, name, nameUnix, sizeof(nameUnix)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    // Pages can't be faulted in until they've been bound to their node, so in that case it's done at the end instead.
+    int populate = (pConfig->options & DR_IPC_SHM_PREFAULT) != 0 && pConfig->numaNode < 0;
+    dripc_result result = dripc_result_unknown_error;
+    pRegion->pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+#ifdef DR_IPC_LINUX
+    // Explicit huge pages are reserved when the file is mapped, so if there aren't enough of them the mmap() fails and
+    // this falls back to a normal object. st_blksize of a file on hugetlbfs is the huge page size.
+    if ((pConfig->options & DR_IPC_SHM_HUGE_PAGES) != 0) {
+        char path[256];
+        int fd = -1;
+        if (drshm_get_hugetlbfs_path__unix(name, path, sizeof(path)) != 0) {
+            fd = open(path, O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+        }
+
+        struct stat info;
+        if (fd != -1 && fstat(fd, &info) == -1) {
+            close(fd);
+            drshm_region_unlink__unix(path, 1);
+            fd = -1;
+        }
+
+        if (fd != -1) {
+            size_t hugePageSize = (size_t)info.st_blksize;
+            size_t hugeSizeInBytes = (sizeInBytes + hugePageSize-1) & ~(hugePageSize-1);
+
+            result = drshm_region_map_new__unix(fd, path, 1, hugeSizeInBytes, populate, &pRegion->shm);
+            if (result == dripc_result_success) {
+                pRegion->pageSize = hugePageSize;
+                pRegion->isHugeTLB = 1;
+            }
+        }
+    }
+#endif
+
+    if (!pRegion->isHugeTLB) {
+        int fd = shm_open(nameUnix, O_RDWR | O_CREAT | O_EXCL, 0666);
+        if (fd == -1) {
+            return dripc_result_from_unix_error(errno);
+        }
+
+        result = drshm_region_map_new__unix(fd, nameUnix, 0, sizeInBytes, populate, &pRegion->shm);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+#if defined(DR_IPC_LINUX) && defined(MADV_HUGEPAGE)
+        // Transparent huge pages for shared memory are only used when the system is set up to honour this.
+        if ((pConfig->options & DR_IPC_SHM_HUGE_PAGES) != 0) {
+            madvise(pRegion->shm.pData, pRegion->shm.sizeInBytes, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    if (pConfig->numaNode >= 0) {
+#if defined(DR_IPC_LINUX) && defined(SYS_mbind)
+        unsigned long nodeMask[16];
+        int error = 0;
+        if ((size_t)pConfig->numaNode >= sizeof(nodeMask)*8) {
+            error = EINVAL;
+        } else {
+            memset(nodeMask, 0, sizeof(nodeMask));
+            nodeMask[pConfig->numaNode / (sizeof(nodeMask[0])*8)] = 1UL << (pConfig->numaNode % (sizeof(nodeMask[0])*8));
+
+            // The kernel ignores the last bit of the mask, hence the +1.
+            if (syscall(SYS_mbind, pRegion->shm.pData, pRegion->shm.sizeInBytes, MPOL_BIND, nodeMask, sizeof(nodeMask)*8 + 1, 0) == -1) {
+                error = errno;
+            }
+        }
+#else
+        int error = ENOSYS;
+#endif
+        if (error != 0) {
+            munmap(pRegion->shm.pData, pRegion->shm.sizeInBytes);
+            drshm_region_unlink__unix(pRegion->shm.name, pRegion->isHugeTLB);
+            return dripc_result_from_unix_error(error);
+        }
+
+        pRegion->isNumaBound = 1;
+    }
+
+    int needsPrefault = (pConfig->options & DR_IPC_SHM_PREFAULT) != 0 && !populate;
+#ifndef MAP_POPULATE
+    needsPrefault = (pConfig->options & DR_IPC_SHM_PREFAULT) != 0;
+#endif
+    if (needsPrefault) {
+        drshm_region_prefault(pRegion);
+    }
+
+    return dripc_result_success;
+}
+
+dripc_result drshm_region_open_named_client__unix(const char* name, const drshm_region_config* pConfig, drshm_region_state* pRegion)
+{
+    char path[256];
+    if (dripc_translate_name__unix(DR_IPC_UNIX_SHM_NAME_HEAD, name, path, sizeof(path)) == 0) {
+        return dripc_result_name_too_long;
+    }
+
+    int fd = shm_open(path, O_RDWR, 0);
+#ifdef DR_IPC_LINUX
+    if (fd == -1 && errno == ENOENT && drshm_get_hugetlbfs_path__unix(name, path, sizeof(path)) != 0) {
+        fd = open(path, O_RDWR | O_CLOEXEC);
+        if (fd == -1) {
+            errno = ENOENT;     // Report the missing object rather than a missing hugetlbfs mount.
+        } else {
+            pRegion->isHugeTLB = 1;
+        }
+    }
+#endif
+    if (fd == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        int error = errno;
+        close(fd);
+        return dripc_result_from_unix_error(error);
+    }
+
+    // The server may not have sized the object yet.
+    if (info.st_size == 0) {
+        close(fd);
+        return dripc_result_unknown_error;
+    }
+
+    int flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+    if ((pConfig->options & DR_IPC_SHM_PREFAULT) != 0) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+
+    void* pData = mmap(NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (pData == MAP_FAILED) {
+        int error = errno;
+        close(fd);
+        return dripc_result_from_unix_error(error);
+    }
+
+    pRegion->shm.pData = pData;
+    pRegion->shm.sizeInBytes = (size_t)info.st_size;
+    pRegion->shm.hMapping = NULL;
+    pRegion->shm.isOwner = 0;
+    strcpy(pRegion->shm.name, path);
+    pRegion->pageSize = pRegion->isHugeTLB ? (size_t)info.st_blksize : (size_t)sysconf(_SC_PAGESIZE);
+
+#ifndef MAP_POPULATE
+    if ((pConfig->options & DR_IPC_SHM_PREFAULT) != 0) {
+        drshm_region_prefault(pRegion);
+    }
+#endif
+
+    close(fd);
+    return dripc_result_success;
+}
+
+void drshm_region_close__unix(drshm_region_state* pRegion)
+{
+    munmap(pRegion->shm.pData, pRegion->shm.sizeInBytes);
+
+    if (pRegion->shm.isOwner) {
+        drshm_region_unlink__unix(pRegion->shm.name, pRegion->isHugeTLB);
+    }
+}
+
+// The page size and huge page usage come from the region's entry in /proc/self/smaps. The node comes from
+// move_pages() which, without a target node, just reports where each page is.
+dripc_result drshm_region_get_info__unix(drshm_region_state* pRegion, drshm_region_info* pInfo)
+{
+    pInfo->sizeInBytes = pRegion->shm.sizeInBytes;
+    pInfo->pageSize    = pRegion->pageSize;
+    pInfo->numaNode    = -1;
+    pInfo->isNumaBound = pRegion->isNumaBound;
+
+#ifdef DR_IPC_LINUX
+    FILE* pFile = fopen("/proc/self/smaps", "r");
+    if (pFile != NULL) {
+        unsigned long regionStart = (unsigned long)pRegion->shm.pData;
+        int isInRegion = 0;
+        char line[512];
+        while (fgets(line, sizeof(line), pFile) != NULL) {
+            unsigned long start;
+            unsigned long end;
+            if (sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+                if (isInRegion) {
+                    break;
+                }
+
+                isInRegion = (start == regionStart);
+                continue;
+            }
+
+            if (!isInRegion) {
+                continue;
+            }
+
+            char key[64];
+            unsigned long long valueInKB;
+            if (sscanf(line, "%63[^:]: %llu kB", key, &valueInKB) != 2) {
+                continue;
+            }
+
+            if (strcmp(key, "KernelPageSize") == 0) {
+                pInfo->pageSize = (size_t)(valueInKB * 1024);
+            } else if (strcmp(key, "ShmemPmdMapped") == 0 || strcmp(key, "FilePmdMapped") == 0 || strcmp(key, "Shared_Hugetlb") == 0 || strcmp(key, "Private_Hugetlb") == 0) {
+                pInfo->hugePageBytes += (size_t)(valueInKB * 1024);
+            }
+        }
+
+        fclose(pFile);
+    }
+
+#ifdef SYS_move_pages
+    void* pPage = pRegion->shm.pData;
+    int status = -1;
+    if (syscall(SYS_move_pages, 0, 1UL, &pPage, NULL, &status, 0) == 0 && status >= 0) {
+        pInfo->numaNode = status;
+    }
+#endif
+#endif
+
+    return dripc_result_success;
+}
+
+// Waits while the value at pAddress is equal to expectedValue. This may return spuriously so the caller needs to
+// re-check the condition it is waiting on.
+void dripc_futex_wait__unix(volatile uint32_t* pAddress, uint32_t expectedValue)
+{
+#ifdef DR_IPC_LINUX
+    // Not using FUTEX_PRIVATE_FLAG because the address is in memory shared between processes.
+    syscall(SYS_futex, pAddress, FUTEX_WAIT, expectedValue, NULL, NULL, 0);
+#else
+    (void)pAddress;
+    (void)expectedValue;
+
+    struct timespec ts;
+    ts.tv_sec  = 0;
+    ts.tv_nsec = 100000;
+    nanosleep(&ts, NULL);
+#endif
+}
+
+void dripc_futex_wake__unix(volatile uint32_t* pAddress)
+{
+#ifdef DR_IPC_LINUX
+    syscall(SYS_futex, pAddress, FUTEX_WAKE, 0x7FFFFFFF, NULL, NULL, 0);
+#else
+    (void)pAddress;
+#endif
+}
+
+typedef struct
+{
+    pid_t pid;
+    int exitCode;
+    int hasExited;
+} dripc_process__unix;
+
+extern char** environ;
+
+// Creates the pipe for a dripc_spawn_fd that doesn't have one. The child's end is always blocking.
+static dripc_result dripc_spawn_create_pipe__unix(dripc_spawn_fd* pFD, drpipe* pChildPipe)
+{
+    drpipe pipeRead;
+    drpipe pipeWrite;
+    dripc_result result = drpipe_open_anonymous(&pipeRead, &pipeWrite);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    if ((pFD->options & DR_IPC_READ) != 0) {
+        pFD->parentPipe = pipeWrite;
+        *pChildPipe     = pipeRead;
+    } else {
+        pFD->parentPipe = pipeRead;
+        *pChildPipe     = pipeWrite;
+    }
+
+    if ((pFD->options & DR_IPC_NONBLOCK) != 0) {
+        result = drpipe_set_nonblocking__unix(((drpipe_unix*)pFD->parentPipe)->fd);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        ((drpipe_unix*)pFD->parentPipe)->options |= DR_IPC_NONBLOCK;
+    }
+
+    return dripc_result_success;
+}
+
+dripc_result dripc_spawn__unix(const char* path, const char* const* ppArgs, const char* const* ppEnv, dripc_spawn_fd* pFDs, size_t fdCount, dripc_process* pProcessOut)
+{
+    dripc_process__unix* pProcess = (dripc_process__unix*)calloc(1, sizeof(*pProcess) + fdCount*(sizeof(drpipe) + sizeof(int)));
+    if (pProcess == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    drpipe* pChildPipes = (drpipe*)(pProcess + 1);  // The ends created here that are only needed until the child has them.
+    int* pSourceFDs = (int*)(pChildPipes + fdCount);
+
+    int maxChildFD = 2;
+    size_t iFD;
+    for (iFD = 0; iFD < fdCount; ++iFD) {
+        pSourceFDs[iFD] = -1;
+        pFDs[iFD].parentPipe = NULL;
+        if (pFDs[iFD].childFD > maxChildFD) {
+            maxChildFD = pFDs[iFD].childFD;
+        }
+    }
+
+    dripc_result result = dripc_result_success;
+    for (iFD = 0; iFD < fdCount; ++iFD) {
+        drpipe childPipe = pFDs[iFD].pipe;
+        if (childPipe == NULL) {
+            result = dripc_spawn_create_pipe__unix(&pFDs[iFD], &pChildPipes[iFD]);
+            if (result != dripc_result_success) {
+                break;
+            }
+
+            childPipe = pChildPipes[iFD];
+        }
+
+        // Every source is moved above every target so that none of the dup2()s in the child can clobber a descriptor
+        // that a later one still needs. The copies are close-on-exec so only the targets make it into the child.
+        pSourceFDs[iFD] = fcntl(((drpipe_unix*)childPipe)->fd, F_DUPFD_CLOEXEC, maxChildFD + 1);
+        if (pSourceFDs[iFD] == -1) {
+            result = dripc_result_from_unix_error(errno);
+            break;
+        }
+    }
+
+    posix_spawn_file_actions_t fileActions;
+    if (result == dripc_result_success) {
+        int error = posix_spawn_file_actions_init(&fileActions);
+        for (iFD = 0; iFD < fdCount && error == 0; ++iFD) {
+            error = posix_spawn_file_actions_adddup2(&fileActions, pSourceFDs[iFD], pFDs[iFD].childFD);
+        }
+
+        if (error == 0) {
+            const char* pDefaultArgs[2];
+            if (ppArgs == NULL) {
+                pDefaultArgs[0] = path;
+                pDefaultArgs[1] = NULL;
+                ppArgs = pDefaultArgs;
+            }
+
+            error = posix_spawnp(&pProcess->pid, path, &fileActions, NULL, (char* const*)ppArgs, (ppEnv != NULL) ? (char* const*)ppEnv : environ);
+        }
+
+        posix_spawn_file_actions_destroy(&fileActions);
+
+        if (error != 0) {
+            result = dripc_result_from_unix_error(error);
+        }
+    }
+
+    for (iFD = 0; iFD < fdCount; ++iFD) {
+        if (pSourceFDs[iFD] != -1) {
+            close(pSourceFDs[iFD]);
+        }
+
+        drpipe_close(pChildPipes[iFD]);
+
+        if (result != dripc_result_success) {
+            if (pFDs[iFD].pipe == NULL) {
+                drpipe_close(pFDs[iFD].parentPipe);
+            }
+            pFDs[iFD].parentPipe = NULL;
+        }
+    }
+
+    if (result != dripc_result_success) {
+        free(pProcess);
+        return result;
+    }
+
+    *pProcessOut = (dripc_process)pProcess;
+    return dripc_result_success;
+}
+
+dripc_result dripc_process_wait__unix(dripc_process process, unsigned int timeoutInMilliseconds, int* pExitCode)
+{
+    dripc_process__unix* pProcess = (dripc_process__unix*)process;
+
+    uint64_t startTime = dripc_get_tick_count__unix();
+    while (!pProcess->hasExited) {
+        int status;
+        pid_t pid = waitpid(pProcess->pid, &status, (timeoutInMilliseconds == DR_IPC_INFINITE) ? 0 : WNOHANG);
+        if (pid == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            return dripc_result_from_unix_error(errno);
+        }
+
+        if (pid == pProcess->pid) {
+            pProcess->exitCode  = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+            pProcess->hasExited = 1;
+            break;
+        }
+
+        // There's nothing to wait on for a child other than waitpid() itself so this has to poll.
+        if (dripc_get_remaining_time__unix(startTime, timeoutInMilliseconds) == 0) {
+            return dripc_result_timeout;
+        }
+
+        struct timespec ts;
+        ts.tv_sec  = 0;
+        ts.tv_nsec = 1000000;
+        nanosleep(&ts, NULL);
+    }
+
+    *pExitCode = pProcess->exitCode;
+    return dripc_result_success;
+}
+
+dripc_result dripc_process_kill__unix(dripc_process process)
+{
+    dripc_process__unix* pProcess = (dripc_process__unix*)process;
+    if (pProcess->hasExited) {
+        return dripc_result_success;
+    }
+
+    if (kill(pProcess->pid, SIGKILL) == -1) {
+        return dripc_result_from_unix_error(errno);
+    }
+
+    return dripc_result_success;
+}
+
+void dripc_process_close__unix(dripc_process process)
+{
+    free(process);
+}
+#endif  // Unix
+
+drpipe_config drpipe_config_init(unsigned int options)
+{
+    drpipe_config config;
+    memset(&config, 0, sizeof(config));
+    config.options = options;
+    config.timeoutInMilliseconds = DR_IPC_INFINITE;
+
+    return config;
+}
+
+drshm_region_config drshm_region_config_init(unsigned int options)
+{
+    drshm_region_config config;
+    memset(&config, 0, sizeof(config));
+    config.options = options;
+    config.numaNode = -1;
+
+    return config;
+}
+
+dripc_result drpipe_open_named_server(const char* name, unsigned int options, drpipe* pPipeOut)
+{
+    drpipe_config config = drpipe_config_init(options);
+    return drpipe_open_named_server_with_config(name, &config, pPipeOut);
+}
+
+dripc_result drpipe_open_named_server_with_config(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut)
+{
+    if (name == NULL || pConfig == NULL || pConfig->options == 0 || pPipeOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeOut = NULL;
+
+
+#ifdef DR_IPC_WIN32
+    return drpipe_open_named_server__win32(name, pConfig, pPipeOut);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_open_named_server__unix(name, pConfig, pPipeOut);
+#endif
+}
+
+dripc_result drpipe_open_named_client(const char* name, unsigned int options, drpipe* pPipeOut)
+{
+    drpipe_config config = drpipe_config_init(options);
+    config.timeoutInMilliseconds = 0;   // Fail straight away if the server doesn't exist.
+    return drpipe_open_named_client_with_config(name, &config, pPipeOut);
+}
+
+dripc_result drpipe_open_named_client_with_config(const char* name, const drpipe_config* pConfig, drpipe* pPipeOut)
+{
+    if (name == NULL || pConfig == NULL || pConfig->options == 0 || pPipeOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeOut = NULL;
+
+
+#ifdef DR_IPC_WIN32
+    return drpipe_open_named_client__win32(name, pConfig, pPipeOut);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_open_named_client__unix(name, pConfig, pPipeOut);
+#endif
+}
+
+dripc_result drpipe_server_open(const char* name, const drpipe_config* pConfig, unsigned int poolSize, drpipe_server* pServerOut)
+{
+    if (pServerOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pServerOut = NULL;
+
+    if (name == NULL || pConfig == NULL || pConfig->options == 0) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return drpipe_server_open__win32(name, pConfig, poolSize, pServerOut);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_server_open__unix(name, pConfig, poolSize, pServerOut);
+#endif
+}
+
+dripc_result drpipe_server_accept(drpipe_server server, unsigned int timeoutInMilliseconds, drpipe* pPipeOut)
+{
+    if (pPipeOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeOut = NULL;
+
+    if (server == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return drpipe_server_accept__win32(server, timeoutInMilliseconds, pPipeOut);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_server_accept__unix(server, timeoutInMilliseconds, pPipeOut);
+#endif
+}
+
+void drpipe_server_close(drpipe_server server)
+{
+    if (server == NULL) {
+        return;
+    }
+
+#ifdef DR_IPC_WIN32
+    drpipe_server_close__win32(server);
+#endif
+
+#ifdef DR_IPC_UNIX
+    // The server is a listening socket which shares its internal representation with pipes.
+    drpipe_close__unix((drpipe)server);
+#endif
+}
+
+dripc_result drpipe_open_anonymous(drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    return drpipe_open_anonymous_ex(0, pPipeRead, pPipeWrite);
+}
+
+dripc_result drpipe_open_anonymous_ex(unsigned int options, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    drpipe_config config = drpipe_config_init(options);
+    return drpipe_open_anonymous_with_config(&config, pPipeRead, pPipeWrite);
+}
+
+dripc_result drpipe_open_anonymous_with_config(const drpipe_config* pConfig, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    if (pPipeRead == NULL || pPipeWrite == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeRead = NULL;
+    *pPipeWrite = NULL;
+
+    if (pConfig == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+
+#ifdef DR_IPC_WIN32
+    return drpipe_open_anonymous__win32(pConfig, pPipeRead, pPipeWrite);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_open_anonymous__unix(pConfig, pPipeRead, pPipeWrite);
+#endif
+}
+
+dripc_result drpipe_open_anonymous_in_place(const drpipe_config* pConfig, drpipe_storage* pStorageRead, drpipe_storage* pStorageWrite, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    if (pPipeRead == NULL || pPipeWrite == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeRead = NULL;
+    *pPipeWrite = NULL;
+
+    if (pStorageRead == NULL || pStorageWrite == NULL || pStorageRead == pStorageWrite) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_config defaultConfig;
+    if (pConfig == NULL) {
+        defaultConfig = drpipe_config_init(0);
+        pConfig = &defaultConfig;
+    }
+
+#ifdef DR_IPC_WIN32
+    return drpipe_open_anonymous_in_place__win32(pConfig, pStorageRead, pStorageWrite, pPipeRead, pPipeWrite);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_open_anonymous_in_place__unix(pConfig, pStorageRead, pStorageWrite, pPipeRead, pPipeWrite);
+#endif
+}
+
+dripc_result drpipe_get_capacity(drpipe pipe, size_t* pCapacity)
+{
+    if (pCapacity) *pCapacity = 0;
+
+    if (pipe == NULL || pCapacity == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return drpipe_get_capacity__win32(pipe, pCapacity);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_get_capacity__unix(pipe, pCapacity);
+#endif
+}
+
+dripc_result drpipe_get_stats(drpipe pipe, drpipe_stats* pStats)
+{
+    if (pStats) memset(pStats, 0, sizeof(*pStats));
+
+    if (pipe == NULL || pStats == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_ENABLE_STATS
+    drpipe_stats_counters* pCounters = DR_IPC_PIPE_TO_STATS(pipe);
+    pStats->readCalls                = dripc_atomic_load_u64(&pCounters->readCalls);
+    pStats->readBytes                = dripc_atomic_load_u64(&pCounters->readBytes);
+    pStats->writeCalls               = dripc_atomic_load_u64(&pCounters->writeCalls);
+    pStats->writeBytes               = dripc_atomic_load_u64(&pCounters->writeBytes);
+    pStats->shortReads               = dripc_atomic_load_u64(&pCounters->shortReads);
+    pStats->wouldBlockCount          = dripc_atomic_load_u64(&pCounters->wouldBlockCount);
+    pStats->blockedTimeInNanoseconds = dripc_atomic_load_u64(&pCounters->blockedTimeInNanoseconds);
+
+    unsigned int iBucket;
+    for (iBucket = 0; iBucket < DR_IPC_STATS_SIZE_BUCKET_COUNT; ++iBucket) {
+        pStats->readSizeHistogram[iBucket]  = dripc_atomic_load_u64(&pCounters->readSizeHistogram[iBucket]);
+        pStats->writeSizeHistogram[iBucket] = dripc_atomic_load_u64(&pCounters->writeSizeHistogram[iBucket]);
+    }
+    for (iBucket = 0; iBucket < DR_IPC_STATS_LATENCY_BUCKET_COUNT; ++iBucket) {
+        pStats->latencyHistogram[iBucket] = dripc_atomic_load_u64(&pCounters->latencyHistogram[iBucket]);
+    }
+
+    return dripc_result_success;
+#else
+    return dripc_result_not_supported;
+#endif
+}
+
+unsigned long long drpipe_stats_get_latency_percentile(const drpipe_stats* pStats, double percentile)
+{
+    if (pStats == NULL) {
+        return 0;
+    }
+
+    unsigned long long totalCount = 0;
+    unsigned int iBucket;
+    for (iBucket = 0; iBucket < DR_IPC_STATS_LATENCY_BUCKET_COUNT; ++iBucket) {
+        totalCount += pStats->latencyHistogram[iBucket];
+    }
+
+    if (totalCount == 0) {
+        return 0;
+    }
+
+    // The rank of the sample being looked for, starting from 1.
+    unsigned long long rank = (unsigned long long)(percentile * (double)totalCount + 0.5);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > totalCount) {
+        rank = totalCount;
+    }
+
+    unsigned long long runningCount = 0;
+    for (iBucket = 0; iBucket < DR_IPC_STATS_LATENCY_BUCKET_COUNT; ++iBucket) {
+        runningCount += pStats->latencyHistogram[iBucket];
+        if (runningCount >= rank) {
+            break;
+        }
+    }
+
+    // This is the inverse of dripc_stats_latency_bucket().
+    if (iBucket < 8) {
+        return iBucket;
+    }
+
+    unsigned int shift = iBucket/8 - 1;     // The msb of the bucket's values, minus 3.
+    unsigned long long lowerBound = (unsigned long long)(8 + iBucket%8) << shift;
+    return lowerBound + ((1ULL << shift) - 1);
+}
+
+static int drpipe_poll_readable(drpipe pipe)
+{
+#ifdef DR_IPC_WIN32
+    return drpipe_poll_readable__win32(pipe);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_poll_readable__unix(pipe);
+#endif
+}
+
+static unsigned int dripc_get_cpu_count(void)
+{
+#ifdef DR_IPC_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned int)info.dwNumberOfProcessors;
+#endif
+
+#ifdef DR_IPC_UNIX
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (count > 0) ? (unsigned int)count : 1;
+#endif
+}
+
+static uint32_t dripc_get_process_id(void)
+{
+#ifdef DR_IPC_WIN32
+    return (uint32_t)GetCurrentProcessId();
+#endif
+
+#ifdef DR_IPC_UNIX
+    return (uint32_t)getpid();
+#endif
+}
+
+static void dripc_yield(void)
+{
+#ifdef DR_IPC_WIN32
+    SwitchToThread();
+#endif
+
+#ifdef DR_IPC_UNIX
+    sched_yield();
+#endif
+}
+
+// Polls a pipe according to its wait policy. This returns once there's something to read, or once the policy has run out
+// of polling and the read should go ahead and sleep in the kernel.
+static void drpipe_wait_with_policy(drpipe pipe, drpipe_waiting* pWaiting)
+{
+    if (drpipe_poll_readable(pipe)) {
+        dripc_atomic_fetch_add_u64(&pWaiting->readyImmediately, 1);
+        return;
+    }
+
+    DR_IPC_STATS_BEGIN(startTime);
+
+    unsigned int iSpin;
+    for (iSpin = 0; iSpin < pWaiting->spinCount || pWaiting->mode == dripc_wait_mode_busy_poll; ++iSpin) {
+        dripc_cpu_pause();
+        if (drpipe_poll_readable(pipe)) {
+            dripc_atomic_fetch_add_u64(&pWaiting->readyAfterSpin, 1);
+            DR_IPC_STATS_RECORD_WAIT(pipe, startTime);
+            return;
+        }
+    }
+
+    unsigned int iYield;
+    for (iYield = 0; iYield < pWaiting->yieldCount; ++iYield) {
+        dripc_yield();
+        if (drpipe_poll_readable(pipe)) {
+            dripc_atomic_fetch_add_u64(&pWaiting->readyAfterYield, 1);
+            DR_IPC_STATS_RECORD_WAIT(pipe, startTime);
+            return;
+        }
+    }
+
+    dripc_atomic_fetch_add_u64(&pWaiting->readyAfterBlock, 1);
+    DR_IPC_STATS_RECORD_WAIT(pipe, startTime);
+}
+
+static dripc_result drpipe_read_unbuffered(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    drpipe_waiting* pWaiting = DR_IPC_PIPE_TO_BASE(pipe)->pWaiting;
+    if (pWaiting != NULL) {
+        drpipe_wait_with_policy(pipe, pWaiting);
+    }
+
+#ifdef DR_IPC_WIN32
+    return drpipe_read__win32(pipe, pDataOut, bytesToRead, pBytesRead);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_read__unix(pipe, pDataOut, bytesToRead, pBytesRead);
+#endif
+}
+
+static dripc_result drpipe_write_unbuffered(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+#ifdef DR_IPC_WIN32
+    return drpipe_write__win32(pipe, pData, bytesToWrite, pBytesWritten);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_write__unix(pipe, pData, bytesToWrite, pBytesWritten);
+#endif
+}
+
+static uint64_t dripc_get_tick_count(void)
+{
+#ifdef DR_IPC_WIN32
+    return dripc_get_tick_count__win32();
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_get_tick_count__unix();
+#endif
+}
+
+static unsigned int dripc_get_remaining_time(uint64_t startTime, unsigned int timeoutInMilliseconds)
+{
+    if (timeoutInMilliseconds == DR_IPC_INFINITE) {
+        return DR_IPC_INFINITE;
+    }
+
+    uint64_t elapsed = dripc_get_tick_count() - startTime;
+    return (elapsed >= timeoutInMilliseconds) ? 0 : (unsigned int)(timeoutInMilliseconds - elapsed);
+}
+
+static dripc_result drpipe_wait_readable(drpipe pipe, unsigned int timeoutInMilliseconds)
+{
+    dripc_result result;
+    DR_IPC_STATS_BEGIN(startTime);
+
+#ifdef DR_IPC_WIN32
+    result = drpipe_wait_readable__win32(pipe, timeoutInMilliseconds);
+#endif
+
+#ifdef DR_IPC_UNIX
+    result = drpipe_wait_readable__unix(pipe, timeoutInMilliseconds);
+#endif
+
+    DR_IPC_STATS_RECORD_WAIT(pipe, startTime);
+    return result;
+}
+
+// Writes straight to the pipe, bypassing the write buffer. *pBytesWritten is added to.
+static dripc_result drpipe_write_timeout_unbuffered(drpipe pipe, const void* pData, size_t bytesToWrite, unsigned int timeoutInMilliseconds, size_t* pBytesWritten)
+{
+#ifdef DR_IPC_WIN32
+    return drpipe_write_timeout__win32(pipe, pData, bytesToWrite, timeoutInMilliseconds, pBytesWritten);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_write_timeout__unix(pipe, pData, bytesToWrite, timeoutInMilliseconds, pBytesWritten);
+#endif
+}
+
+// Waits for a non-blocking pipe to become readable or writable. Used when part of something has already been
+// transferred and the rest has to follow.
+static void drpipe_wait_ready(drpipe pipe, unsigned int events)
+{
+    DR_IPC_STATS_BEGIN(startTime);
+
+#ifdef DR_IPC_WIN32
+    (void)pipe;
+    (void)events;
+    Sleep(0);
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_wait_fd__unix(((drpipe_unix*)pipe)->fd, (events & DR_IPC_WRITE) ? POLLOUT : POLLIN, -1);
+#endif
+
+    DR_IPC_STATS_RECORD_WAIT(pipe, startTime);
+}
+
+// Writes out the contents of the write buffer. If a non-blocking pipe fills up, whatever didn't make it is kept at the
+// front of the buffer and dripc_result_would_block is returned, unless waitIfBlocked is set.
+static dripc_result drpipe_flush_buffer(drpipe pipe, drpipe_buffering* pBuffering, int waitIfBlocked)
+{
+    dripc_result result = dripc_result_success;
+    size_t bytesFlushed = 0;
+    while (bytesFlushed < pBuffering->writeBufferLength) {
+        size_t bytesWritten;
+        result = drpipe_write_unbuffered(pipe, pBuffering->pWriteBuffer + bytesFlushed, pBuffering->writeBufferLength - bytesFlushed, &bytesWritten);
+        if (result == dripc_result_would_block && waitIfBlocked) {
+            drpipe_wait_ready(pipe, DR_IPC_WRITE);
+            continue;
+        }
+        if (result != dripc_result_success) {
+            break;
+        }
+
+        bytesFlushed += bytesWritten;
+    }
+
+    if (bytesFlushed > 0) {
+        memmove(pBuffering->pWriteBuffer, pBuffering->pWriteBuffer + bytesFlushed, pBuffering->writeBufferLength - bytesFlushed);
+        pBuffering->writeBufferLength -= bytesFlushed;
+    }
+
+    return (pBuffering->writeBufferLength == 0) ? dripc_result_success : result;
+}
+
+static dripc_result drpipe_read_buffered(drpipe pipe, drpipe_buffering* pBuffering, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    // Anything still sitting in the write buffer is flushed first. Otherwise a request could be stuck in our buffer while
+    // we wait for its response.
+    if (pBuffering->writeBufferLength > 0) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success && result != dripc_result_would_block) {
+            return result;
+        }
+    }
+
+    size_t bytesAvailable = pBuffering->readBufferLength - pBuffering->readBufferOffset;
+    if (bytesAvailable == 0) {
+        // Large reads go straight into the caller's buffer.
+        if (bytesToRead >= pBuffering->readBufferSize) {
+            return drpipe_read_unbuffered(pipe, pDataOut, bytesToRead, pBytesRead);
+        }
+
+        size_t bytesRead;
+        dripc_result result = drpipe_read_unbuffered(pipe, pBuffering->pReadBuffer, pBuffering->readBufferSize, &bytesRead);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        pBuffering->readBufferOffset = 0;
+        pBuffering->readBufferLength = bytesRead;
+        bytesAvailable = bytesRead;
+    }
+
+    size_t bytesToCopy = (bytesToRead < bytesAvailable) ? bytesToRead : bytesAvailable;
+    memcpy(pDataOut, pBuffering->pReadBuffer + pBuffering->readBufferOffset, bytesToCopy);
+    pBuffering->readBufferOffset += bytesToCopy;
+
+    if (pBytesRead) *pBytesRead = bytesToCopy;
+    return dripc_result_success;
+}
+
+static dripc_result drpipe_write_buffered(drpipe pipe, drpipe_buffering* pBuffering, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    if (pBuffering->writeBufferLength + bytesToWrite > pBuffering->writeBufferSize) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success && result != dripc_result_would_block) {
+            return result;
+        }
+
+        // Writes that would never fit in the buffer skip it entirely, but only once everything before them has gone out.
+        if (pBuffering->writeBufferLength == 0 && bytesToWrite >= pBuffering->writeBufferSize) {
+            return drpipe_write_unbuffered(pipe, pData, bytesToWrite, pBytesWritten);
+        }
+    }
+
+    // A non-blocking pipe may not have been able to make room for everything in which case this is a partial write.
+    size_t bytesToCopy = pBuffering->writeBufferSize - pBuffering->writeBufferLength;
+    if (bytesToCopy > bytesToWrite) {
+        bytesToCopy = bytesToWrite;
+    }
+    if (bytesToCopy == 0 && bytesToWrite > 0) {
+        return dripc_result_would_block;
+    }
+
+    memcpy(pBuffering->pWriteBuffer + pBuffering->writeBufferLength, pData, bytesToCopy);
+    pBuffering->writeBufferLength += bytesToCopy;
+    if (pBytesWritten) *pBytesWritten = bytesToCopy;
+
+    if (pBuffering->writeBufferLength >= pBuffering->flushThreshold) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success && result != dripc_result_would_block) {
+            return result;
+        }
+    }
+
+    return dripc_result_success;
+}
+
+// Messages that fit in the write buffer are copied in whole so that a message is never split across a flush on a
+// non-blocking pipe. Anything bigger flushes and then goes through the normal path.
+static dripc_result drpipe_send_message_buffered(drpipe pipe, drpipe_buffering* pBuffering, uint32_t messageSize, const dripc_buffer* pBuffers, size_t bufferCount)
+{
+    size_t totalSize = sizeof(messageSize) + messageSize;
+    if (totalSize > pBuffering->writeBufferSize) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+#ifdef DR_IPC_WIN32
+        return drpipe_send_message__win32(pipe, messageSize, pBuffers, bufferCount);
+#endif
+
+#ifdef DR_IPC_UNIX
+        return drpipe_send_message__unix(pipe, messageSize, pBuffers, bufferCount);
+#endif
+    }
+
+    if (pBuffering->writeBufferLength + totalSize > pBuffering->writeBufferSize) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (pBuffering->writeBufferLength + totalSize > pBuffering->writeBufferSize) {
+            return result;
+        }
+    }
+
+    unsigned char* pDst = pBuffering->pWriteBuffer + pBuffering->writeBufferLength;
+    memcpy(pDst, &messageSize, sizeof(messageSize));
+    pDst += sizeof(messageSize);
+
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        if (pBuffers[iBuffer].sizeInBytes > 0) {
+            memcpy(pDst, pBuffers[iBuffer].pData, pBuffers[iBuffer].sizeInBytes);
+            pDst += pBuffers[iBuffer].sizeInBytes;
+        }
+    }
+
+    pBuffering->writeBufferLength += totalSize;
+
+    if (pBuffering->writeBufferLength >= pBuffering->flushThreshold) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success && result != dripc_result_would_block) {
+            return result;
+        }
+    }
+
+    return dripc_result_success;
+}
+
+// Reads all of the given data through the read buffer. *pStarted works the same as drpipe_read_all__win32().
+static dripc_result drpipe_read_all_buffered(drpipe pipe, drpipe_buffering* pBuffering, void* pDataOut, size_t bytesToRead, int* pStarted)
+{
+    while (bytesToRead > 0) {
+        size_t bytesRead;
+        dripc_result result = drpipe_read_buffered(pipe, pBuffering, pDataOut, bytesToRead, &bytesRead);
+        if (result == dripc_result_would_block && *pStarted) {
+            drpipe_wait_ready(pipe, DR_IPC_READ);
+            continue;
+        }
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        if (bytesRead == 0) {
+            return dripc_result_unknown_error;  // The other end was closed part way through the message.
+        }
+
+        *pStarted = 1;
+        pDataOut = (void*)((char*)pDataOut + bytesRead);
+        bytesToRead -= bytesRead;
+    }
+
+    return dripc_result_success;
+}
+
+static dripc_result drpipe_recv_message_buffered(drpipe pipe, drpipe_buffering* pBuffering, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    int started = 0;
+    uint32_t messageSize;
+    dripc_result result = drpipe_read_all_buffered(pipe, pBuffering, &messageSize, sizeof(messageSize), &started);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    *pMessageSize = messageSize;
+
+    size_t bytesRemaining = messageSize;
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount && bytesRemaining > 0; ++iBuffer) {
+        size_t bytesThisBuffer = (pBuffers[iBuffer].sizeInBytes < bytesRemaining) ? pBuffers[iBuffer].sizeInBytes : bytesRemaining;
+        result = drpipe_read_all_buffered(pipe, pBuffering, pBuffers[iBuffer].pData, bytesThisBuffer, &started);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        bytesRemaining -= bytesThisBuffer;
+    }
+
+    // Anything that didn't fit needs to be discarded.
+    if (bytesRemaining > 0) {
+        while (bytesRemaining > 0) {
+            char discard[4096];
+            size_t bytesToDiscard = (bytesRemaining < sizeof(discard)) ? bytesRemaining : sizeof(discard);
+            result = drpipe_read_all_buffered(pipe, pBuffering, discard, bytesToDiscard, &started);
+            if (result != dripc_result_success) {
+                return result;
+            }
+
+            bytesRemaining -= bytesToDiscard;
+        }
+
+        return dripc_result_too_large;
+    }
+
+    return dripc_result_success;
+}
+
+// Whether or not the next message is already sitting in the read buffer in its entirety.
+static int drpipe_has_buffered_message(drpipe_buffering* pBuffering)
+{
+    size_t bytesAvailable = pBuffering->readBufferLength - pBuffering->readBufferOffset;
+    if (bytesAvailable < sizeof(uint32_t)) {
+        return 0;
+    }
+
+    uint32_t messageSize;
+    memcpy(&messageSize, pBuffering->pReadBuffer + pBuffering->readBufferOffset, sizeof(messageSize));
+    return (bytesAvailable - sizeof(messageSize)) >= messageSize;
+}
+
+// Moves any partial message to the front of the read buffer and tops it up with a single read until the next message is
+// there in its entirety. This gives up rather than block, so returns 0 if the pipe runs dry first.
+static int drpipe_try_buffer_message(drpipe pipe, drpipe_buffering* pBuffering)
+{
+    while (!drpipe_has_buffered_message(pBuffering)) {
+        size_t bytesPending = pBuffering->readBufferLength - pBuffering->readBufferOffset;
+        if (bytesPending == pBuffering->readBufferSize || !drpipe_poll_readable(pipe)) {
+            return 0;
+        }
+
+        memmove(pBuffering->pReadBuffer, pBuffering->pReadBuffer + pBuffering->readBufferOffset, bytesPending);
+        pBuffering->readBufferOffset = 0;
+        pBuffering->readBufferLength = bytesPending;
+
+        size_t bytesRead;
+        dripc_result result = drpipe_read_unbuffered(pipe, pBuffering->pReadBuffer + bytesPending, pBuffering->readBufferSize - bytesPending, &bytesRead);
+        if (result != dripc_result_success || bytesRead == 0) {
+            return 0;   // The other end has gone. That'll be reported by the next read.
+        }
+
+        pBuffering->readBufferLength += bytesRead;
+    }
+
+    return 1;
+}
+
+// The first message is received normally. After that, messages are only taken while they can be had without waiting.
+static dripc_result drpipe_read_batch_buffered(drpipe pipe, drpipe_buffering* pBuffering, dripc_message* pMessages, size_t messageCount, size_t* pMessagesRead)
+{
+    size_t iMessage;
+    for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+        if (iMessage > 0 && !drpipe_try_buffer_message(pipe, pBuffering)) {
+            break;
+        }
+
+        dripc_buffer buffer;
+        buffer.pData       = pMessages[iMessage].pData;
+        buffer.sizeInBytes = pMessages[iMessage].sizeInBytes;
+
+        size_t messageSize;
+        dripc_result result = drpipe_recv_message_buffered(pipe, pBuffering, &buffer, 1, &messageSize);
+        pMessages[iMessage].result = result;
+        if (result != dripc_result_success && result != dripc_result_too_large) {
+            return result;
+        }
+
+        pMessages[iMessage].messageSize = messageSize;
+        *pMessagesRead += 1;
+    }
+
+    return dripc_result_success;
+}
+
+static dripc_result drpipe_write_atomic(drpipe pipe, const void* pData, size_t bytesToWrite, int allowWouldBlock)
+{
+#ifdef DR_IPC_WIN32
+    (void)pipe; (void)pData; (void)bytesToWrite; (void)allowWouldBlock;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_write_atomic__unix(pipe, pData, bytesToWrite, allowWouldBlock);
+#endif
+}
+
+// The bottom half of every stream ID sent from this process. It's shared by every pipe rather than kept per pipe because
+// two handles in the same process can be writing to the same FIFO, and their messages would be stitched together if
+// their IDs could collide.
+static volatile uint32_t g_dripcNextStreamID = 0;
+
+// Sends a message as a series of chunks, each going out in a single atomic write. Nothing is shared between writers
+// other than the message counter so there's no lock. Only the first chunk can report would_block. Once part of a message
+// is in the pipe the rest has to follow or the reader would be left holding an incomplete message forever.
+static dripc_result drpipe_send_message_multi_writer(drpipe pipe, const dripc_buffer* pBuffers, size_t bufferCount, size_t messageSize)
+{
+    unsigned char chunk[DR_IPC_PIPE_BUF];
+    drpipe_chunk_header header;
+    header.streamID = ((uint64_t)dripc_get_process_id() << 32) | dripc_atomic_fetch_add_u32(&g_dripcNextStreamID, 1);
+
+    size_t iBuffer = 0;
+    size_t bufferOffset = 0;
+    size_t bytesRemaining = messageSize;
+    int started = 0;
+    do {
+        size_t chunkSize = (bytesRemaining < sizeof(chunk) - sizeof(header)) ? bytesRemaining : sizeof(chunk) - sizeof(header);
+        header.chunkSize = (uint32_t)chunkSize;
+        header.flags     = (chunkSize == bytesRemaining) ? DR_IPC_CHUNK_LAST : 0;
+        memcpy(chunk, &header, sizeof(header));
+
+        // Gather the body from however many of the caller's buffers it spans.
+        size_t chunkOffset = 0;
+        while (chunkOffset < chunkSize && iBuffer < bufferCount) {
+            size_t bytesThisBuffer = pBuffers[iBuffer].sizeInBytes - bufferOffset;
+            if (bytesThisBuffer > chunkSize - chunkOffset) {
+                bytesThisBuffer = chunkSize - chunkOffset;
+            }
+
+            memcpy(chunk + sizeof(header) + chunkOffset, (const char*)pBuffers[iBuffer].pData + bufferOffset, bytesThisBuffer);
+            chunkOffset  += bytesThisBuffer;
+            bufferOffset += bytesThisBuffer;
+            if (bufferOffset == pBuffers[iBuffer].sizeInBytes) {
+                iBuffer += 1;
+                bufferOffset = 0;
+            }
+        }
+
+        dripc_result result = drpipe_write_atomic(pipe, chunk, sizeof(header) + chunkSize, !started);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        started = 1;
+        bytesRemaining -= chunkSize;
+    } while (bytesRemaining > 0);
+
+    return dripc_result_success;
+}
+
+static drpipe_partial_message* drpipe_find_partial_message(drpipe_multi_writer* pMultiWriter, uint64_t streamID)
+{
+    size_t iPartial;
+    for (iPartial = 0; iPartial < pMultiWriter->partialMessageCount; ++iPartial) {
+        if (pMultiWriter->pPartialMessages[iPartial].streamID == streamID) {
+            return &pMultiWriter->pPartialMessages[iPartial];
+        }
+    }
+
+    return NULL;
+}
+
+static dripc_result drpipe_append_partial_message(drpipe_multi_writer* pMultiWriter, uint64_t streamID, drpipe_partial_message** ppPartial, size_t bytesToAppend)
+{
+    drpipe_partial_message* pPartial = *ppPartial;
+    if (pPartial == NULL) {
+        if (pMultiWriter->partialMessageCount == pMultiWriter->partialMessageCapacity) {
+            size_t newCapacity = (pMultiWriter->partialMessageCapacity == 0) ? 4 : pMultiWriter->partialMessageCapacity * 2;
+            drpipe_partial_message* pNewPartials = (drpipe_partial_message*)realloc(pMultiWriter->pPartialMessages, newCapacity * sizeof(*pNewPartials));
+            if (pNewPartials == NULL) {
+                return dripc_result_unknown_error;
+            }
+
+            pMultiWriter->pPartialMessages       = pNewPartials;
+            pMultiWriter->partialMessageCapacity = newCapacity;
+        }
+
+        pPartial = &pMultiWriter->pPartialMessages[pMultiWriter->partialMessageCount];
+        memset(pPartial, 0, sizeof(*pPartial));
+        pPartial->streamID = streamID;
+        pMultiWriter->partialMessageCount += 1;
+    }
+
+    if (bytesToAppend > DR_IPC_MAX_MESSAGE_SIZE - pPartial->size) {
+        return dripc_result_unknown_error;  // Nothing legitimate gets this big so the stream is corrupt.
+    }
+
+    if (pPartial->size + bytesToAppend > pPartial->capacity) {
+        size_t newCapacity = (pPartial->capacity == 0) ? 4096 : pPartial->capacity * 2;
+        while (newCapacity < pPartial->size + bytesToAppend) {
+            newCapacity *= 2;
+        }
+
+        unsigned char* pNewData = (unsigned char*)realloc(pPartial->pData, newCapacity);
+        if (pNewData == NULL) {
+            return dripc_result_unknown_error;
+        }
+
+        pPartial->pData    = pNewData;
+        pPartial->capacity = newCapacity;
+    }
+
+    *ppPartial = pPartial;
+    return dripc_result_success;
+}
+
+static void drpipe_remove_partial_message(drpipe_multi_writer* pMultiWriter, drpipe_partial_message* pPartial)
+{
+    free(pPartial->pData);
+    *pPartial = pMultiWriter->pPartialMessages[pMultiWriter->partialMessageCount - 1];
+    pMultiWriter->partialMessageCount -= 1;
+}
+
+// Copies a message out to the caller's buffers, returning too_large if it doesn't fit.
+static dripc_result drpipe_scatter_message(const unsigned char* pData, size_t messageSize, dripc_buffer* pBuffers, size_t bufferCount)
+{
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount && messageSize > 0; ++iBuffer) {
+        size_t bytesThisBuffer = (pBuffers[iBuffer].sizeInBytes < messageSize) ? pBuffers[iBuffer].sizeInBytes : messageSize;
+        memcpy(pBuffers[iBuffer].pData, pData, bytesThisBuffer);
+        pData       += bytesThisBuffer;
+        messageSize -= bytesThisBuffer;
+    }
+
+    return (messageSize > 0) ? dripc_result_too_large : dripc_result_success;
+}
+
+// Reads chunks until one of them finishes a message. Chunks of other messages are set aside until their last chunk
+// arrives. Those partial messages are kept across calls so a non-blocking read can give up between chunks.
+static dripc_result drpipe_recv_message_multi_writer(drpipe pipe, drpipe_multi_writer* pMultiWriter, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    // The read buffer is used if there is one. Otherwise an empty one reads straight from the pipe.
+    drpipe_buffering noBuffering;
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering == NULL) {
+        memset(&noBuffering, 0, sizeof(noBuffering));
+        pBuffering = &noBuffering;
+    }
+
+    for (;;) {
+        int started = 0;
+        drpipe_chunk_header header;
+        dripc_result result = drpipe_read_all_buffered(pipe, pBuffering, &header, sizeof(header), &started);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        if (header.chunkSize > DR_IPC_PIPE_BUF - sizeof(header)) {
+            return dripc_result_unknown_error;
+        }
+
+        unsigned char body[DR_IPC_PIPE_BUF];
+        result = drpipe_read_all_buffered(pipe, pBuffering, body, header.chunkSize, &started);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        drpipe_partial_message* pPartial = drpipe_find_partial_message(pMultiWriter, header.streamID);
+        if (pPartial == NULL && (header.flags & DR_IPC_CHUNK_LAST) != 0) {
+            *pMessageSize = header.chunkSize;
+            return drpipe_scatter_message(body, header.chunkSize, pBuffers, bufferCount);
+        }
+
+        result = drpipe_append_partial_message(pMultiWriter, header.streamID, &pPartial, header.chunkSize);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        memcpy(pPartial->pData + pPartial->size, body, header.chunkSize);
+        pPartial->size += header.chunkSize;
+
+        if ((header.flags & DR_IPC_CHUNK_LAST) != 0) {
+            *pMessageSize = pPartial->size;
+            result = drpipe_scatter_message(pPartial->pData, pPartial->size, pBuffers, bufferCount);
+            drpipe_remove_partial_message(pMultiWriter, pPartial);
+            return result;
+        }
+    }
+}
+
+static dripc_result dripc_map_file(const char* path, size_t sizeInBytes, dripc_mapped_file* pFile)
+{
+#ifdef DR_IPC_WIN32
+    return dripc_map_file__win32(path, sizeInBytes, pFile);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_map_file__unix(path, sizeInBytes, pFile);
+#endif
+}
+
+static void dripc_unmap_file(dripc_mapped_file* pFile, size_t finalSizeInBytes)
+{
+#ifdef DR_IPC_WIN32
+    dripc_unmap_file__win32(pFile, finalSizeInBytes);
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_unmap_file__unix(pFile, finalSizeInBytes);
+#endif
+}
+
+// Moves the staged records into the file. The header is only updated once they're there in full so it only ever
+// describes complete records.
+static void drpipe_flush_capture(drpipe_capture* pCapture)
+{
+    if (pCapture->stagingLength == 0) {
+        return;
+    }
+
+    memcpy((unsigned char*)pCapture->file.pData + pCapture->fileOffset, pCapture->pStaging, pCapture->stagingLength);
+    pCapture->fileOffset += pCapture->stagingLength;
+    pCapture->stagingLength = 0;
+
+    drpipe_capture_header* pHeader = (drpipe_capture_header*)pCapture->file.pData;
+    pHeader->recordCount += pCapture->stagedRecordCount;
+    pHeader->dataSize = pCapture->fileOffset - sizeof(*pHeader);
+    pCapture->stagedRecordCount = 0;
+}
+
+static void drpipe_capture_transfer(drpipe_capture* pCapture, unsigned int kind, const void* pData, size_t sizeInBytes)
+{
+    drpipe_capture_header* pHeader = (drpipe_capture_header*)pCapture->file.pData;
+
+    size_t recordSize = (sizeof(drpipe_capture_record) + sizeInBytes + 7) & ~(size_t)7;
+    if (recordSize > pCapture->file.sizeInBytes - pCapture->fileOffset - pCapture->stagingLength) {
+        pHeader->recordsDropped += 1;
+        return;
+    }
+
+    drpipe_capture_record record;
+    record.timeInNanoseconds = dripc_get_time_ns() - pCapture->startTime;
+    record.sizeInBytes       = (unsigned int)sizeInBytes;  // Reads and writes are limited to 2^31 bytes.
+    record.kind              = kind;
+
+    if (recordSize > DR_IPC_CAPTURE_STAGING_SIZE - pCapture->stagingLength) {
+        drpipe_flush_capture(pCapture);
+    }
+
+    // Records that are too big for the staging buffer go straight into the file.
+    int isStaged = (recordSize <= DR_IPC_CAPTURE_STAGING_SIZE);
+    unsigned char* pRecord = isStaged ? pCapture->pStaging + pCapture->stagingLength : (unsigned char*)pCapture->file.pData + pCapture->fileOffset;
+
+    memcpy(pRecord, &record, sizeof(record));
+    memcpy(pRecord + sizeof(record), pData, sizeInBytes);
+    memset(pRecord + sizeof(record) + sizeInBytes, 0, recordSize - sizeof(record) - sizeInBytes);
+
+    if (isStaged) {
+        pCapture->stagingLength += recordSize;
+        pCapture->stagedRecordCount += 1;
+    } else {
+        pCapture->fileOffset += recordSize;
+        pHeader->recordCount += 1;
+        pHeader->dataSize = pCapture->fileOffset - sizeof(*pHeader);
+    }
+}
+
+// Writes out whatever is still staged and trims the file down to what was used.
+static void drpipe_finish_capture(drpipe_capture* pCapture)
+{
+    drpipe_flush_capture(pCapture);
+    dripc_unmap_file(&pCapture->file, pCapture->fileOffset);
+    free(pCapture);
+}
+
+// Frees everything hanging off the platform independent part of a pipe and puts it back to how it was when it was opened.
+static void drpipe_reset_base(drpipe pipe)
+{
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+
+    free(pBase->pBuffering);
+    free(pBase->pWaiting);
+
+    if (pBase->pCapture != NULL) {
+        drpipe_finish_capture(pBase->pCapture);
+    }
+
+    drpipe_multi_writer* pMultiWriter = pBase->pMultiWriter;
+    if (pMultiWriter != NULL) {
+        size_t iPartial;
+        for (iPartial = 0; iPartial < pMultiWriter->partialMessageCount; ++iPartial) {
+            free(pMultiWriter->pPartialMessages[iPartial].pData);
+        }
+
+        free(pMultiWriter->pPartialMessages);
+        free(pMultiWriter);
+    }
+
+    memset(pBase, 0, sizeof(*pBase));
+}
+
+// Closes a pipe and throws away anything still in its write buffer.
+static void drpipe_discard(drpipe pipe)
+{
+    drpipe_reset_base(pipe);
+
+#ifdef DR_IPC_WIN32
+    drpipe_close__win32(pipe);
+#endif
+
+#ifdef DR_IPC_UNIX
+    drpipe_close__unix(pipe);
+#endif
+}
+
+void drpipe_close(drpipe pipe)
+{
+    if (pipe == NULL) {
+        return;
+    }
+
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL) {
+        drpipe_flush_buffer(pipe, pBuffering, 1);
+    }
+
+    drpipe_discard(pipe);
+}
+
+
+static dripc_result drpipe_get_bytes_pending(drpipe pipe, size_t* pBytesPending)
+{
+#ifdef DR_IPC_WIN32
+    return drpipe_get_bytes_pending__win32(pipe, pBytesPending);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_get_bytes_pending__unix(pipe, pBytesPending);
+#endif
+}
+
+// The storage for each pair is the read end followed by the write end. Pairs are either open and waiting to be given
+// out again, in use, or closed. The first two lists hold the indices of the open and closed pairs.
+typedef struct
+{
+    drpipe_config config;
+    size_t pairCount;
+    drpipe_storage* pStorage;
+    size_t* pOpenPairs;
+    size_t openPairCount;
+    size_t* pClosedPairs;
+    size_t closedPairCount;
+} drpipe_pool_state;
+
+// Whether or not a pipe has nothing left in it that the next user of the pair could trip over.
+static int drpipe_is_drained(drpipe pipe)
+{
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+    if (pBase->pBuffering != NULL && (pBase->pBuffering->writeBufferLength > 0 || pBase->pBuffering->readBufferLength > pBase->pBuffering->readBufferOffset)) {
+        return 0;
+    }
+
+    if (pBase->pMultiWriter != NULL && pBase->pMultiWriter->partialMessageCount > 0) {
+        return 0;
+    }
+
+    return 1;
+}
+
+dripc_result drpipe_pool_open(const drpipe_config* pConfig, size_t pairCount, drpipe_pool* pPoolOut)
+{
+    if (pPoolOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPoolOut = NULL;
+
+    if (pairCount > ((size_t)-1 - sizeof(drpipe_pool_state)) / (sizeof(drpipe_storage)*2 + sizeof(size_t)*2)) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_pool_state* pPool = (drpipe_pool_state*)calloc(1, sizeof(*pPool) + pairCount*(sizeof(drpipe_storage)*2 + sizeof(size_t)*2));
+    if (pPool == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pPool->config       = (pConfig != NULL) ? *pConfig : drpipe_config_init(0);
+    pPool->pairCount    = pairCount;
+    pPool->pStorage     = (drpipe_storage*)(pPool + 1);
+    pPool->pOpenPairs   = (size_t*)(pPool->pStorage + pairCount*2);
+    pPool->pClosedPairs = pPool->pOpenPairs + pairCount;
+
+    // Lower indices are handed out first.
+    size_t iPair;
+    for (iPair = 0; iPair < pairCount; ++iPair) {
+        pPool->pClosedPairs[iPair] = pairCount - iPair - 1;
+    }
+    pPool->closedPairCount = pairCount;
+
+    *pPoolOut = (drpipe_pool)pPool;
+    return dripc_result_success;
+}
+
+void drpipe_pool_close(drpipe_pool pool)
+{
+    drpipe_pool_state* pPool = (drpipe_pool_state*)pool;
+    if (pPool == NULL) {
+        return;
+    }
+
+    size_t iOpenPair;
+    for (iOpenPair = 0; iOpenPair < pPool->openPairCount; ++iOpenPair) {
+        size_t iPair = pPool->pOpenPairs[iOpenPair];
+        drpipe_discard((drpipe)&pPool->pStorage[iPair*2 + 0]);
+        drpipe_discard((drpipe)&pPool->pStorage[iPair*2 + 1]);
+    }
+
+    free(pPool);
+}
+
+dripc_result drpipe_pool_acquire(drpipe_pool pool, drpipe* pPipeRead, drpipe* pPipeWrite)
+{
+    if (pPipeRead == NULL || pPipeWrite == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeRead = NULL;
+    *pPipeWrite = NULL;
+
+    drpipe_pool_state* pPool = (drpipe_pool_state*)pool;
+    if (pPool == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    if (pPool->openPairCount > 0) {
+        size_t iPair = pPool->pOpenPairs[--pPool->openPairCount];
+        *pPipeRead  = (drpipe)&pPool->pStorage[iPair*2 + 0];
+        *pPipeWrite = (drpipe)&pPool->pStorage[iPair*2 + 1];
+        return dripc_result_success;
+    }
+
+    if (pPool->closedPairCount > 0) {
+        size_t iPair = pPool->pClosedPairs[pPool->closedPairCount - 1];
+        dripc_result result = drpipe_open_anonymous_in_place(&pPool->config, &pPool->pStorage[iPair*2 + 0], &pPool->pStorage[iPair*2 + 1], pPipeRead, pPipeWrite);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        pPool->closedPairCount -= 1;
+        return dripc_result_success;
+    }
+
+    // Every pair is in use so this one comes from the heap and is closed when it's released.
+    return drpipe_open_anonymous_with_config(&pPool->config, pPipeRead, pPipeWrite);
+}
+
+void drpipe_pool_release(drpipe_pool pool, drpipe pipeRead, drpipe pipeWrite)
+{
+    drpipe_pool_state* pPool = (drpipe_pool_state*)pool;
+    if (pPool == NULL || pipeRead == NULL || pipeWrite == NULL) {
+        return;
+    }
+
+    drpipe_storage* pStorageRead = (drpipe_storage*)pipeRead;
+    if (pStorageRead < pPool->pStorage || pStorageRead >= pPool->pStorage + pPool->pairCount*2) {
+        drpipe_discard(pipeRead);
+        drpipe_discard(pipeWrite);
+        return;
+    }
+
+    size_t iPair = (size_t)(pStorageRead - pPool->pStorage) / 2;
+
+    size_t bytesPending;
+    if (drpipe_is_drained(pipeRead) && drpipe_is_drained(pipeWrite) && drpipe_get_bytes_pending(pipeRead, &bytesPending) == dripc_result_success && bytesPending == 0) {
+        drpipe_reset_base(pipeRead);
+        drpipe_reset_base(pipeWrite);
+        pPool->pOpenPairs[pPool->openPairCount++] = iPair;
+    } else {
+        // Both ends are going away so there's nobody to flush anything to.
+        drpipe_discard(pipeRead);
+        drpipe_discard(pipeWrite);
+        pPool->pClosedPairs[pPool->closedPairCount++] = iPair;
+    }
+}
+
+
+static dripc_result drpipe_read_uncaptured(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL) {
+        if (pBuffering->readBufferSize > 0) {
+            return drpipe_read_buffered(pipe, pBuffering, pDataOut, bytesToRead, pBytesRead);
+        }
+
+        if (pBuffering->writeBufferLength > 0) {
+            dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+            if (result != dripc_result_success && result != dripc_result_would_block) {
+                return result;
+            }
+        }
+    }
+
+    return drpipe_read_unbuffered(pipe, pDataOut, bytesToRead, pBytesRead);
+}
+
+static dripc_result drpipe_write_uncaptured(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferSize > 0) {
+        return drpipe_write_buffered(pipe, pBuffering, pData, bytesToWrite, pBytesWritten);
+    }
+
+    return drpipe_write_unbuffered(pipe, pData, bytesToWrite, pBytesWritten);
+}
+
+dripc_result drpipe_read(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    if (pBytesRead) *pBytesRead = 0;
+
+    if (pipe == NULL || pDataOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    // Currently, reading is restricted to 2^31 bytes.
+    if (bytesToRead > 0x7FFFFFFF) {
+        return dripc_result_invalid_args;
+    }
+
+    // Raw bytes would be mistaken for chunks by the reader, and could be torn apart by other writers.
+    if (DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter != NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_capture* pCapture = DR_IPC_PIPE_TO_BASE(pipe)->pCapture;
+    if (pCapture != NULL) {
+        size_t bytesRead = 0;
+        dripc_result result = drpipe_read_uncaptured(pipe, pDataOut, bytesToRead, &bytesRead);
+        if (bytesRead > 0) {
+            drpipe_capture_transfer(pCapture, DR_IPC_CAPTURE_READ, pDataOut, bytesRead);
+        }
+
+        if (pBytesRead) *pBytesRead = bytesRead;
+        return result;
+    }
+
+    return drpipe_read_uncaptured(pipe, pDataOut, bytesToRead, pBytesRead);
+}
+
+dripc_result drpipe_write(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    if (pBytesWritten) *pBytesWritten = 0;
+
+    if (pipe == NULL || pData == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    // Currently, writing is restricted to 2^31 bytes.
+    if (bytesToWrite > 0x7FFFFFFF) {
+        return dripc_result_invalid_args;
+    }
+
+    // Raw bytes would be mistaken for chunks by the reader, and could be torn apart by other writers.
+    if (DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter != NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_capture* pCapture = DR_IPC_PIPE_TO_BASE(pipe)->pCapture;
+    if (pCapture != NULL) {
+        size_t bytesWritten = 0;
+        dripc_result result = drpipe_write_uncaptured(pipe, pData, bytesToWrite, &bytesWritten);
+        if (bytesWritten > 0) {
+            drpipe_capture_transfer(pCapture, DR_IPC_CAPTURE_WRITE, pData, bytesWritten);
+        }
+
+        if (pBytesWritten) *pBytesWritten = bytesWritten;
+        return result;
+    }
+
+    return drpipe_write_uncaptured(pipe, pData, bytesToWrite, pBytesWritten);
+}
+
+dripc_result drpipe_read_exact(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    if (pBytesRead) *pBytesRead = 0;
+
+    while (bytesToRead > 0) {
+        size_t bytesRead;
+        dripc_result result = drpipe_read(pipe, pDataOut, (bytesToRead <= 0x7FFFFFFF) ? bytesToRead : 0x7FFFFFFF, &bytesRead);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        if (bytesRead == 0) {
+            return dripc_result_unknown_error;  // The other end was closed before all of the data was received.
+        }
+
+        if (bytesRead < bytesToRead) {
+            DR_IPC_STATS_RECORD_SHORT_READ(pipe);
+        }
+
+        pDataOut = (void*)((char*)pDataOut + bytesRead);
+
+        bytesToRead -= bytesRead;
+        if (pBytesRead) *pBytesRead += bytesRead;
+    }
+
+    return dripc_result_success;
+}
+
+
+dripc_result drpipe_read_timeout(drpipe pipe, void* pDataOut, size_t bytesToRead, unsigned int timeoutInMilliseconds, size_t* pBytesRead)
+{
+    if (pBytesRead) *pBytesRead = 0;
+
+    if (pipe == NULL || pDataOut == NULL || DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter != NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    if (timeoutInMilliseconds == DR_IPC_INFINITE) {
+        return drpipe_read(pipe, pDataOut, bytesToRead, pBytesRead);
+    }
+
+    // Data that's already in the read buffer doesn't need to be waited for. Otherwise pending writes need to go out
+    // before waiting, for the same reason drpipe_read() flushes them.
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL) {
+        if (pBuffering->readBufferLength > pBuffering->readBufferOffset) {
+            return drpipe_read(pipe, pDataOut, bytesToRead, pBytesRead);
+        }
+
+        if (pBuffering->writeBufferLength > 0) {
+            dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+            if (result != dripc_result_success && result != dripc_result_would_block) {
+                return result;
+            }
+        }
+    }
+
+    dripc_result result = drpipe_wait_readable(pipe, timeoutInMilliseconds);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    return drpipe_read(pipe, pDataOut, bytesToRead, pBytesRead);
+}
+
+dripc_result drpipe_read_exact_timeout(drpipe pipe, void* pDataOut, size_t bytesToRead, unsigned int timeoutInMilliseconds, size_t* pBytesRead)
+{
+    if (pBytesRead) *pBytesRead = 0;
+
+    uint64_t startTime = dripc_get_tick_count();
+    while (bytesToRead > 0) {
+        size_t bytesRead;
+        dripc_result result = drpipe_read_timeout(pipe, pDataOut, (bytesToRead <= 0x7FFFFFFF) ? bytesToRead : 0x7FFFFFFF, dripc_get_remaining_time(startTime, timeoutInMilliseconds), &bytesRead);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        if (bytesRead == 0) {
+            return dripc_result_unknown_error;  // The other end was closed before all of the data was received.
+        }
+
+        if (bytesRead < bytesToRead) {
+            DR_IPC_STATS_RECORD_SHORT_READ(pipe);
+        }
+
+        pDataOut = (void*)((char*)pDataOut + bytesRead);
+
+        bytesToRead -= bytesRead;
+        if (pBytesRead) *pBytesRead += bytesRead;
+    }
+
+    return dripc_result_success;
+}
+
+
+dripc_result drpipe_write_timeout(drpipe pipe, const void* pData, size_t bytesToWrite, unsigned int timeoutInMilliseconds, size_t* pBytesWritten)
+{
+    if (pBytesWritten) *pBytesWritten = 0;
+
+    if (pipe == NULL || pData == NULL || DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter != NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    uint64_t startTime = dripc_get_tick_count();
+
+    // Buffered data has to go out first to keep everything in order.
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferLength > 0) {
+        size_t bytesFlushed = 0;
+        dripc_result result = drpipe_write_timeout_unbuffered(pipe, pBuffering->pWriteBuffer, pBuffering->writeBufferLength, timeoutInMilliseconds, &bytesFlushed);
+
+        memmove(pBuffering->pWriteBuffer, pBuffering->pWriteBuffer + bytesFlushed, pBuffering->writeBufferLength - bytesFlushed);
+        pBuffering->writeBufferLength -= bytesFlushed;
+
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+    size_t bytesWritten = 0;
+    dripc_result result = drpipe_write_timeout_unbuffered(pipe, pData, bytesToWrite, dripc_get_remaining_time(startTime, timeoutInMilliseconds), &bytesWritten);
+
+    if (bytesWritten > 0 && DR_IPC_PIPE_TO_BASE(pipe)->pCapture != NULL) {
+        drpipe_capture_transfer(DR_IPC_PIPE_TO_BASE(pipe)->pCapture, DR_IPC_CAPTURE_WRITE, pData, bytesWritten);
+    }
+
+    if (pBytesWritten) *pBytesWritten = bytesWritten;
+    return result;
+}
+
+dripc_result drpipe_enable_buffering(drpipe pipe, size_t writeBufferSize, size_t flushThreshold, size_t readBufferSize)
+{
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+    drpipe_buffering* pOldBuffering = pBase->pBuffering;
+
+    // Multi-writer messages have to go out chunk by chunk in single writes, which a write buffer would merge.
+    if (pBase->pMultiWriter != NULL && writeBufferSize > 0) {
+        return dripc_result_invalid_args;
+    }
+
+    // Buffered reads can't be put back so they need to fit in the new read buffer.
+    size_t bytesPending = 0;
+    if (pOldBuffering != NULL) {
+        bytesPending = pOldBuffering->readBufferLength - pOldBuffering->readBufferOffset;
+        if (bytesPending > readBufferSize) {
+            return dripc_result_invalid_args;
+        }
+
+        dripc_result result = drpipe_flush_buffer(pipe, pOldBuffering, 1);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+    drpipe_buffering* pNewBuffering = NULL;
+    if (writeBufferSize > 0 || readBufferSize > 0) {
+        pNewBuffering = (drpipe_buffering*)calloc(1, sizeof(*pNewBuffering) + writeBufferSize + readBufferSize);
+        if (pNewBuffering == NULL) {
+            return dripc_result_unknown_error;
+        }
+
+        pNewBuffering->pWriteBuffer    = (unsigned char*)(pNewBuffering + 1);
+        pNewBuffering->writeBufferSize = writeBufferSize;
+        pNewBuffering->flushThreshold  = (flushThreshold == 0 || flushThreshold > writeBufferSize) ? writeBufferSize : flushThreshold;
+        pNewBuffering->pReadBuffer     = pNewBuffering->pWriteBuffer + writeBufferSize;
+        pNewBuffering->readBufferSize  = readBufferSize;
+
+        if (bytesPending > 0) {
+            memcpy(pNewBuffering->pReadBuffer, pOldBuffering->pReadBuffer + pOldBuffering->readBufferOffset, bytesPending);
+            pNewBuffering->readBufferLength = bytesPending;
+        }
+    }
+
+    free(pOldBuffering);
+    pBase->pBuffering = pNewBuffering;
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_start_capture(drpipe pipe, const char* filePath, size_t maxFileSize)
+{
+    if (pipe == NULL || filePath == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+    if (pBase->pCapture != NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    if (maxFileSize == 0) {
+        maxFileSize = DR_IPC_CAPTURE_DEFAULT_FILE_SIZE;
+    }
+    if (maxFileSize < sizeof(drpipe_capture_header)) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_capture* pCapture = (drpipe_capture*)calloc(1, sizeof(*pCapture) + DR_IPC_CAPTURE_STAGING_SIZE);
+    if (pCapture == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    dripc_result result = dripc_map_file(filePath, maxFileSize, &pCapture->file);
+    if (result != dripc_result_success) {
+        free(pCapture);
+        return result;
+    }
+
+    drpipe_capture_header* pHeader = (drpipe_capture_header*)pCapture->file.pData;
+    pHeader->magic   = DR_IPC_CAPTURE_MAGIC;
+    pHeader->version = DR_IPC_CAPTURE_VERSION;
+
+    pCapture->fileOffset = sizeof(*pHeader);
+    pCapture->startTime  = dripc_get_time_ns();
+    pCapture->pStaging   = (unsigned char*)(pCapture + 1);
+
+    pBase->pCapture = pCapture;
+    return dripc_result_success;
+}
+
+dripc_result drpipe_stop_capture(drpipe pipe)
+{
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+    if (pBase->pCapture == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_finish_capture(pBase->pCapture);
+    pBase->pCapture = NULL;
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_flush(drpipe pipe)
+{
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering == NULL) {
+        return dripc_result_success;
+    }
+
+    return drpipe_flush_buffer(pipe, pBuffering, 0);
+}
+
+
+drpipe_wait_policy drpipe_wait_policy_init(dripc_wait_mode mode)
+{
+    drpipe_wait_policy policy;
+    memset(&policy, 0, sizeof(policy));
+    policy.mode = mode;
+
+    if (mode == dripc_wait_mode_spin_then_block) {
+        // With a single CPU the other end can't run while this one spins, so go straight to yielding.
+        policy.spinCount  = (dripc_get_cpu_count() > 1) ? DR_IPC_PIPE_SPIN_COUNT : 0;
+        policy.yieldCount = DR_IPC_PIPE_YIELD_COUNT;
+    }
+
+    return policy;
+}
+
+dripc_result drpipe_set_wait_policy(drpipe pipe, const drpipe_wait_policy* pPolicy)
+{
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    if (pPolicy != NULL && pPolicy->mode != dripc_wait_mode_block && pPolicy->mode != dripc_wait_mode_spin_then_block && pPolicy->mode != dripc_wait_mode_busy_poll) {
+        return dripc_result_invalid_args;
+    }
+
+    // A non-blocking read never waits so there's nothing to apply the policy to.
+    unsigned int options;
+#ifdef DR_IPC_WIN32
+    options = ((drpipe_win32*)pipe)->options;
+#endif
+#ifdef DR_IPC_UNIX
+    options = ((drpipe_unix*)pipe)->options;
+#endif
+    if ((options & DR_IPC_NONBLOCK) != 0 && pPolicy != NULL && pPolicy->mode != dripc_wait_mode_block) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+
+    drpipe_waiting* pNewWaiting = NULL;
+    if (pPolicy != NULL && pPolicy->mode != dripc_wait_mode_block) {
+        pNewWaiting = (drpipe_waiting*)calloc(1, sizeof(*pNewWaiting));
+        if (pNewWaiting == NULL) {
+            return dripc_result_unknown_error;
+        }
+
+        pNewWaiting->mode       = pPolicy->mode;
+        pNewWaiting->spinCount  = pPolicy->spinCount;
+        pNewWaiting->yieldCount = pPolicy->yieldCount;
+    }
+
+    free(pBase->pWaiting);
+    pBase->pWaiting = pNewWaiting;
+
+    return dripc_result_success;
+}
+
+dripc_result drpipe_enable_multi_writer(drpipe pipe)
+{
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_base* pBase = DR_IPC_PIPE_TO_BASE(pipe);
+    if (pBase->pMultiWriter != NULL) {
+        return dripc_result_success;
+    }
+
+    if (pBase->pBuffering != NULL && pBase->pBuffering->writeBufferSize > 0) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_result result = drpipe_check_multi_writer__unix(pipe);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    pBase->pMultiWriter = (drpipe_multi_writer*)calloc(1, sizeof(*pBase->pMultiWriter));
+    if (pBase->pMultiWriter == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    return dripc_result_success;
+#endif
+}
+
+size_t drpipe_get_atomic_message_size(drpipe pipe)
+{
+    if (pipe == NULL || DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter == NULL) {
+        return 0;
+    }
+
+    return DR_IPC_PIPE_BUF - sizeof(drpipe_chunk_header);
+}
+
+dripc_result drpipe_get_wait_counters(drpipe pipe, drpipe_wait_counters* pCounters)
+{
+    if (pCounters == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    memset(pCounters, 0, sizeof(*pCounters));
+
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_waiting* pWaiting = DR_IPC_PIPE_TO_BASE(pipe)->pWaiting;
+    if (pWaiting != NULL) {
+        pCounters->immediate = dripc_atomic_load_u64(&pWaiting->readyImmediately);
+        pCounters->spin      = dripc_atomic_load_u64(&pWaiting->readyAfterSpin);
+        pCounters->yield     = dripc_atomic_load_u64(&pWaiting->readyAfterYield);
+        pCounters->block     = dripc_atomic_load_u64(&pWaiting->readyAfterBlock);
+    }
+
+    return dripc_result_success;
+}
+
+
+unsigned int drpipe_get_zero_copy_caps(drpipe pipe)
+{
+    if (pipe == NULL) {
+        return 0;
+    }
+
+#ifdef DR_IPC_WIN32
+    return 0;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_get_zero_copy_caps__unix(pipe);
+#endif
+}
+
+dripc_result drpipe_splice_from_fd(drpipe pipe, int fd, size_t bytesToTransfer, size_t* pBytesTransferred)
+{
+    if (pBytesTransferred) *pBytesTransferred = 0;
+
+    if (pipe == NULL || fd < 0) {
+        return dripc_result_invalid_args;
+    }
+
+    // Buffered writes need to go out first to keep everything in order.
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferLength > 0) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)bytesToTransfer;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    size_t bytesTransferred = 0;
+    dripc_result result = drpipe_splice_from_fd__unix(pipe, fd, bytesToTransfer, &bytesTransferred);
+
+    if (pBytesTransferred) *pBytesTransferred = bytesTransferred;
+    return result;
+#endif
+}
+
+dripc_result drpipe_splice_to_fd(drpipe pipe, int fd, size_t bytesToTransfer, size_t* pBytesTransferred)
+{
+    if (pBytesTransferred) *pBytesTransferred = 0;
+
+    if (pipe == NULL || fd < 0) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)bytesToTransfer;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    size_t bytesTransferred = 0;
+
+    // Anything sitting in the read buffer comes before what's still in the pipe.
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    while (pBuffering != NULL && pBuffering->readBufferOffset < pBuffering->readBufferLength && bytesTransferred < bytesToTransfer) {
+        size_t bytesToWrite = pBuffering->readBufferLength - pBuffering->readBufferOffset;
+        if (bytesToWrite > bytesToTransfer - bytesTransferred) {
+            bytesToWrite = bytesToTransfer - bytesTransferred;
+        }
+
+        ssize_t bytesWritten = write(fd, pBuffering->pReadBuffer + pBuffering->readBufferOffset, bytesToWrite);
+        if (bytesWritten == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            if (pBytesTransferred) *pBytesTransferred = bytesTransferred;
+            return (bytesTransferred > 0 && errno == EAGAIN) ? dripc_result_success : dripc_result_from_unix_error(errno);
+        }
+
+        pBuffering->readBufferOffset += (size_t)bytesWritten;
+        bytesTransferred += (size_t)bytesWritten;
+    }
+
+    dripc_result result = dripc_result_success;
+    if (bytesTransferred < bytesToTransfer) {
+        result = drpipe_splice_to_fd__unix(pipe, fd, bytesToTransfer, &bytesTransferred);
+        if (result == dripc_result_would_block && bytesTransferred > 0) {
+            result = dripc_result_success;
+        }
+    }
+
+    if (pBytesTransferred) *pBytesTransferred = bytesTransferred;
+    return result;
+#endif
+}
+
+dripc_result drpipe_write_pages(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    if (pBytesWritten) *pBytesWritten = 0;
+
+    if (pipe == NULL || (pData == NULL && bytesToWrite > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferLength > 0) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    size_t bytesWritten = 0;
+    dripc_result result = drpipe_write_pages__unix(pipe, pData, bytesToWrite, &bytesWritten);
+
+    if (pBytesWritten) *pBytesWritten = bytesWritten;
+    return result;
+#endif
+}
+
+dripc_result drpipe_tee(drpipe pipeIn, drpipe pipeOut, size_t bytesToCopy, size_t* pBytesCopied)
+{
+    if (pBytesCopied) *pBytesCopied = 0;
+
+    if (pipeIn == NULL || pipeOut == NULL || pipeIn == pipeOut) {
+        return dripc_result_invalid_args;
+    }
+
+    if ((drpipe_get_zero_copy_caps(pipeIn) & drpipe_get_zero_copy_caps(pipeOut) & DR_IPC_ZERO_COPY_TEE) == 0) {
+        return dripc_result_not_supported;
+    }
+
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipeOut)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferLength > 0) {
+        dripc_result result = drpipe_flush_buffer(pipeOut, pBuffering, 0);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)bytesToCopy;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    size_t bytesCopied = 0;
+    dripc_result result = drpipe_tee__unix(pipeIn, pipeOut, bytesToCopy, &bytesCopied);
+
+    if (pBytesCopied) *pBytesCopied = bytesCopied;
+    return result;
+#endif
+}
+
+
+dripc_result drpipe_send_message(drpipe pipe, const dripc_buffer* pBuffers, size_t bufferCount)
+{
+    if (pipe == NULL || (pBuffers == NULL && bufferCount > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t messageSize = 0;
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        if (pBuffers[iBuffer].pData == NULL && pBuffers[iBuffer].sizeInBytes > 0) {
+            return dripc_result_invalid_args;
+        }
+        if (pBuffers[iBuffer].sizeInBytes > DR_IPC_MAX_MESSAGE_SIZE - messageSize) {
+            return dripc_result_too_large;
+        }
+
+        messageSize += pBuffers[iBuffer].sizeInBytes;
+    }
+
+    drpipe_multi_writer* pMultiWriter = DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter;
+    if (pMultiWriter != NULL) {
+        return drpipe_send_message_multi_writer(pipe, pBuffers, bufferCount, messageSize);
+    }
+
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferSize > 0) {
+        return drpipe_send_message_buffered(pipe, pBuffering, (uint32_t)messageSize, pBuffers, bufferCount);
+    }
+
+
+#ifdef DR_IPC_WIN32
+    return drpipe_send_message__win32(pipe, (uint32_t)messageSize, pBuffers, bufferCount);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_send_message__unix(pipe, (uint32_t)messageSize, pBuffers, bufferCount);
+#endif
+}
+
+dripc_result drpipe_recv_message(drpipe pipe, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    if (pMessageSize) *pMessageSize = 0;
+
+    if (pipe == NULL || (pBuffers == NULL && bufferCount > 0) || pMessageSize == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        if (pBuffers[iBuffer].pData == NULL && pBuffers[iBuffer].sizeInBytes > 0) {
+            return dripc_result_invalid_args;
+        }
+    }
+
+    drpipe_multi_writer* pMultiWriter = DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter;
+    if (pMultiWriter != NULL) {
+        return drpipe_recv_message_multi_writer(pipe, pMultiWriter, pBuffers, bufferCount, pMessageSize);
+    }
+
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL) {
+        if (pBuffering->readBufferSize > 0) {
+            return drpipe_recv_message_buffered(pipe, pBuffering, pBuffers, bufferCount, pMessageSize);
+        }
+
+        if (pBuffering->writeBufferLength > 0) {
+            dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+            if (result != dripc_result_success && result != dripc_result_would_block) {
+                return result;
+            }
+        }
+    }
+
+
+#ifdef DR_IPC_WIN32
+    return drpipe_recv_message__win32(pipe, pBuffers, bufferCount, pMessageSize);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_recv_message__unix(pipe, pBuffers, bufferCount, pMessageSize);
+#endif
+}
+
+dripc_result drpipe_write_batch(drpipe pipe, dripc_message* pMessages, size_t messageCount, size_t* pMessagesWritten)
+{
+    if (pMessagesWritten) *pMessagesWritten = 0;
+
+    if (pipe == NULL || (pMessages == NULL && messageCount > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t iMessage;
+    for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+        pMessages[iMessage].result = dripc_result_success;
+
+        if (pMessages[iMessage].pData == NULL && pMessages[iMessage].sizeInBytes > 0) {
+            pMessages[iMessage].result = dripc_result_invalid_args;
+        } else if (pMessages[iMessage].sizeInBytes > DR_IPC_MAX_MESSAGE_SIZE) {
+            pMessages[iMessage].result = dripc_result_too_large;
+        }
+    }
+
+    size_t messagesWritten = 0;
+    dripc_result result;
+    drpipe_multi_writer* pMultiWriter = DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter;
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pMultiWriter != NULL) {
+        // Each message is its own stream of chunks so there's nothing to gain from combining them.
+        result = dripc_result_success;
+        for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+            if (pMessages[iMessage].result != dripc_result_success) {
+                continue;
+            }
+
+            dripc_buffer buffer;
+            buffer.pData       = pMessages[iMessage].pData;
+            buffer.sizeInBytes = pMessages[iMessage].sizeInBytes;
+
+            result = drpipe_send_message_multi_writer(pipe, &buffer, 1, buffer.sizeInBytes);
+            if (result != dripc_result_success) {
+                break;
+            }
+
+            messagesWritten += 1;
+        }
+    } else if (pBuffering != NULL && pBuffering->writeBufferSize > 0) {
+        result = dripc_result_success;
+        for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+            if (pMessages[iMessage].result != dripc_result_success) {
+                continue;
+            }
+
+            dripc_buffer buffer;
+            buffer.pData       = pMessages[iMessage].pData;
+            buffer.sizeInBytes = pMessages[iMessage].sizeInBytes;
+
+            result = drpipe_send_message_buffered(pipe, pBuffering, (uint32_t)buffer.sizeInBytes, &buffer, 1);
+            if (result != dripc_result_success) {
+                break;
+            }
+
+            messagesWritten += 1;
+        }
+    } else {
+#ifdef DR_IPC_WIN32
+        result = drpipe_write_batch__win32(pipe, pMessages, messageCount, &messagesWritten);
+#endif
+
+#ifdef DR_IPC_UNIX
+        result = drpipe_write_batch__unix(pipe, pMessages, messageCount, &messagesWritten);
+#endif
+    }
+
+    if (pMessagesWritten) *pMessagesWritten = messagesWritten;
+
+    if (result == dripc_result_success) {
+        return dripc_result_success;
+    }
+
+    // Everything that didn't go out takes on the result that stopped it.
+    size_t messagesSeen = 0;
+    for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+        if (pMessages[iMessage].result != dripc_result_success) {
+            continue;
+        }
+
+        messagesSeen += 1;
+        if (messagesSeen > messagesWritten) {
+            pMessages[iMessage].result = result;
+        }
+    }
+
+    // A non-blocking pipe that filled up part way through the batch isn't an error.
+    if (result == dripc_result_would_block && messagesWritten > 0) {
+        return dripc_result_success;
+    }
+
+    return result;
+}
+
+dripc_result drpipe_read_batch(drpipe pipe, dripc_message* pMessages, size_t messageCount, size_t* pMessagesRead)
+{
+    if (pMessagesRead) *pMessagesRead = 0;
+
+    if (pipe == NULL || (pMessages == NULL && messageCount > 0) || pMessagesRead == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t iMessage;
+    for (iMessage = 0; iMessage < messageCount; ++iMessage) {
+        if (pMessages[iMessage].pData == NULL && pMessages[iMessage].sizeInBytes > 0) {
+            return dripc_result_invalid_args;
+        }
+
+        pMessages[iMessage].messageSize = 0;
+        pMessages[iMessage].result      = dripc_result_would_block;
+    }
+
+    if (messageCount == 0) {
+        return dripc_result_success;
+    }
+
+    // Batched reads parse length prefixes straight out of the read buffer, which multi-writer chunks don't have.
+    if (DR_IPC_PIPE_TO_BASE(pipe)->pMultiWriter != NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    // The read buffer isn't set up here because it would stay behind after this returns, holding data that the caller
+    // might not expect to be read ahead, such as the bytes a descriptor passed with dripc_send_fd() is attached to.
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering == NULL || pBuffering->readBufferSize == 0) {
+        return dripc_result_invalid_args;
+    }
+
+    return drpipe_read_batch_buffered(pipe, pBuffering, pMessages, messageCount, pMessagesRead);
+}
+
+dripc_result dripc_send_fd(drpipe pipe, int fd, const dripc_buffer* pBuffers, size_t bufferCount)
+{
+    if (pipe == NULL || fd < 0 || (pBuffers == NULL && bufferCount > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t messageSize = 0;
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        if (pBuffers[iBuffer].pData == NULL && pBuffers[iBuffer].sizeInBytes > 0) {
+            return dripc_result_invalid_args;
+        }
+        if (pBuffers[iBuffer].sizeInBytes > DR_IPC_MAX_MESSAGE_SIZE - messageSize) {
+            return dripc_result_too_large;
+        }
+
+        messageSize += pBuffers[iBuffer].sizeInBytes;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    // The descriptor can't go through the write buffer so anything in there has to go first.
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL && pBuffering->writeBufferLength > 0) {
+        dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 1);
+        if (result != dripc_result_success) {
+            return result;
+        }
+    }
+
+    return dripc_send_fd__unix(pipe, fd, (uint32_t)messageSize, pBuffers, bufferCount);
+#endif
+}
+
+dripc_result dripc_recv_fd(drpipe pipe, int* pFD, dripc_buffer* pBuffers, size_t bufferCount, size_t* pMessageSize)
+{
+    if (pFD) *pFD = -1;
+    if (pMessageSize) *pMessageSize = 0;
+
+    if (pipe == NULL || pFD == NULL || (pBuffers == NULL && bufferCount > 0) || pMessageSize == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t iBuffer;
+    for (iBuffer = 0; iBuffer < bufferCount; ++iBuffer) {
+        if (pBuffers[iBuffer].pData == NULL && pBuffers[iBuffer].sizeInBytes > 0) {
+            return dripc_result_invalid_args;
+        }
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    drpipe_buffering* pBuffering = DR_IPC_PIPE_TO_BASE(pipe)->pBuffering;
+    if (pBuffering != NULL) {
+        if (pBuffering->readBufferLength > pBuffering->readBufferOffset) {
+            return dripc_result_invalid_args;
+        }
+
+        if (pBuffering->writeBufferLength > 0) {
+            dripc_result result = drpipe_flush_buffer(pipe, pBuffering, 0);
+            if (result != dripc_result_success && result != dripc_result_would_block) {
+                return result;
+            }
+        }
+    }
+
+    return dripc_recv_fd__unix(pipe, pFD, pBuffers, bufferCount, pMessageSize);
+#endif
+}
+
+
+#define DR_IPC_RPC_KIND_REQUEST     1
+#define DR_IPC_RPC_KIND_RESPONSE    2
+
+// Every request and response is a message that starts with this. A response carries the ID of its request.
+typedef struct
+{
+    uint64_t requestID;
+    uint32_t kind;
+    uint32_t reserved;
+} dripc_rpc_header;
+
+typedef struct
+{
+    uint64_t requestID;
+    int isInUse;
+    dripc_rpc_callback onComplete;
+    void* pUserData;
+} dripc_rpc_call_slot;
+
+// Calls are kept in a table indexed by the low bits of their request ID. IDs are handed out in order so a slot can only
+// still be in use by the call from a whole table ago, in which case there are too many calls in flight.
+typedef struct
+{
+    drpipe pipe;
+    uint64_t nextRequestID;
+    size_t callsInFlight;
+    uint64_t slotMask;
+    dripc_rpc_call_slot* pSlots;
+    size_t maxResponseSize;
+    unsigned char* pResponseBuffer;
+} dripc_rpc_state;
+
+// Used by dripc_rpc_call() to turn a callback back into a return value.
+typedef struct
+{
+    void* pResponseOut;
+    size_t responseBufferSize;
+    size_t responseSize;
+    dripc_result result;
+    int isComplete;
+} dripc_rpc_blocking_call;
+
+dripc_result dripc_rpc_open(drpipe pipe, unsigned int maxCallsInFlight, size_t maxResponseSize, dripc_rpc* pRpcOut)
+{
+    if (pRpcOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pRpcOut = NULL;
+
+    if (pipe == NULL || maxCallsInFlight > 0x10000 || maxResponseSize > DR_IPC_MAX_MESSAGE_SIZE - sizeof(dripc_rpc_header)) {
+        return dripc_result_invalid_args;
+    }
+
+    if (maxCallsInFlight == 0) {
+        maxCallsInFlight = DR_IPC_RPC_DEFAULT_MAX_CALLS;
+    }
+    if (maxResponseSize == 0) {
+        maxResponseSize = DR_IPC_RPC_DEFAULT_MAX_RESPONSE_SIZE;
+    }
+
+    size_t slotCount = 1;
+    while (slotCount < maxCallsInFlight) {
+        slotCount <<= 1;
+    }
+
+    dripc_rpc_state* pRpc = (dripc_rpc_state*)calloc(1, sizeof(*pRpc) + slotCount*sizeof(dripc_rpc_call_slot) + maxResponseSize);
+    if (pRpc == NULL) {
+        return dripc_result_unknown_error;
+    }
+
+    pRpc->pipe = pipe;
+    pRpc->slotMask = slotCount - 1;
+    pRpc->pSlots = (dripc_rpc_call_slot*)(pRpc + 1);
+    pRpc->maxResponseSize = maxResponseSize;
+    pRpc->pResponseBuffer = (unsigned char*)(pRpc->pSlots + slotCount);
+
+    *pRpcOut = (dripc_rpc)pRpc;
+    return dripc_result_success;
+}
+
+void dripc_rpc_close(dripc_rpc rpc)
+{
+    free(rpc);
+}
+
+// Completes every call in flight with the given error. Used when the connection has failed and no more responses are
+// coming.
+static void dripc_rpc_fail_calls(dripc_rpc_state* pRpc, dripc_result result)
+{
+    uint64_t iSlot;
+    for (iSlot = 0; iSlot <= pRpc->slotMask; ++iSlot) {
+        dripc_rpc_call_slot* pSlot = &pRpc->pSlots[iSlot];
+        if (!pSlot->isInUse) {
+            continue;
+        }
+
+        pSlot->isInUse = 0;
+        pRpc->callsInFlight -= 1;
+        pSlot->onComplete((dripc_rpc)pRpc, result, NULL, 0, pSlot->pUserData);
+    }
+}
+
+dripc_result dripc_rpc_call_async(dripc_rpc rpc, const void* pRequest, size_t requestSize, dripc_rpc_callback onComplete, void* pUserData, unsigned long long* pRequestID)
+{
+    if (pRequestID) *pRequestID = 0;
+
+    if (rpc == NULL || (pRequest == NULL && requestSize > 0) || onComplete == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_rpc_state* pRpc = (dripc_rpc_state*)rpc;
+    dripc_rpc_call_slot* pSlot = &pRpc->pSlots[pRpc->nextRequestID & pRpc->slotMask];
+    if (pSlot->isInUse) {
+        return dripc_result_would_block;
+    }
+
+    dripc_rpc_header header;
+    header.requestID = pRpc->nextRequestID;
+    header.kind      = DR_IPC_RPC_KIND_REQUEST;
+    header.reserved  = 0;
+
+    dripc_buffer buffers[2];
+    buffers[0].pData       = &header;
+    buffers[0].sizeInBytes = sizeof(header);
+    buffers[1].pData       = (void*)pRequest;
+    buffers[1].sizeInBytes = requestSize;
+
+    dripc_result result = drpipe_send_message(pRpc->pipe, buffers, 2);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    pSlot->requestID  = header.requestID;
+    pSlot->isInUse    = 1;
+    pSlot->onComplete = onComplete;
+    pSlot->pUserData  = pUserData;
+
+    pRpc->nextRequestID += 1;
+    pRpc->callsInFlight += 1;
+
+    if (pRequestID) *pRequestID = header.requestID;
+    return dripc_result_success;
+}
+
+dripc_result dripc_rpc_pump(dripc_rpc rpc)
+{
+    if (rpc == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_rpc_state* pRpc = (dripc_rpc_state*)rpc;
+    if (pRpc->callsInFlight == 0) {
+        return dripc_result_success;    // Nothing to wait for.
+    }
+
+    dripc_rpc_header header;
+    dripc_buffer buffers[2];
+    buffers[0].pData       = &header;
+    buffers[0].sizeInBytes = sizeof(header);
+    buffers[1].pData       = pRpc->pResponseBuffer;
+    buffers[1].sizeInBytes = pRpc->maxResponseSize;
+
+    size_t messageSize;
+    dripc_result result = drpipe_recv_message(pRpc->pipe, buffers, 2, &messageSize);
+    if (result == dripc_result_would_block) {
+        return result;
+    }
+
+    // The end of the stream is reported as an error by drpipe_recv_message(), as is anything that isn't a response.
+    if ((result != dripc_result_success && result != dripc_result_too_large) || messageSize < sizeof(header) || header.kind != DR_IPC_RPC_KIND_RESPONSE) {
+        if (result == dripc_result_success || result == dripc_result_too_large) {
+            result = dripc_result_unknown_error;
+        }
+
+        dripc_rpc_fail_calls(pRpc, result);
+        return result;
+    }
+
+    // A response nobody is waiting for is dropped.
+    dripc_rpc_call_slot* pSlot = &pRpc->pSlots[header.requestID & pRpc->slotMask];
+    if (!pSlot->isInUse || pSlot->requestID != header.requestID) {
+        return dripc_result_success;
+    }
+
+    // The slot is released before the callback so the callback can make another call.
+    pSlot->isInUse = 0;
+    pRpc->callsInFlight -= 1;
+
+    size_t responseSize = messageSize - sizeof(header);
+    pSlot->onComplete(rpc, result, (result == dripc_result_success) ? pRpc->pResponseBuffer : NULL, responseSize, pSlot->pUserData);
+
+    return dripc_result_success;
+}
+
+static void dripc_rpc_on_blocking_call_complete(dripc_rpc rpc, dripc_result result, const void* pResponse, size_t responseSize, void* pUserData)
+{
+    dripc_rpc_blocking_call* pCall = (dripc_rpc_blocking_call*)pUserData;
+    (void)rpc;
+
+    pCall->result       = result;
+    pCall->responseSize = responseSize;
+    pCall->isComplete   = 1;
+
+    if (result == dripc_result_success) {
+        if (responseSize > pCall->responseBufferSize) {
+            pCall->result = dripc_result_too_large;
+        } else if (responseSize > 0) {
+            memcpy(pCall->pResponseOut, pResponse, responseSize);
+        }
+    }
+}
+
+dripc_result dripc_rpc_call(dripc_rpc rpc, const void* pRequest, size_t requestSize, void* pResponseOut, size_t responseBufferSize, size_t* pResponseSize)
+{
+    if (pResponseSize) *pResponseSize = 0;
+
+    if (rpc == NULL || (pResponseOut == NULL && responseBufferSize > 0) || pResponseSize == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_rpc_state* pRpc = (dripc_rpc_state*)rpc;
+
+    dripc_rpc_blocking_call call;
+    memset(&call, 0, sizeof(call));
+    call.pResponseOut       = pResponseOut;
+    call.responseBufferSize = responseBufferSize;
+
+    // Both loops wait on the pipe themselves when it's non-blocking so this always blocks.
+    for (;;) {
+        dripc_result result = dripc_rpc_call_async(rpc, pRequest, requestSize, dripc_rpc_on_blocking_call_complete, &call, NULL);
+        if (result != dripc_result_would_block) {
+            if (result != dripc_result_success) {
+                return result;
+            }
+
+            break;
+        }
+
+        // Either the slot for the next ID is still waiting for its response or the pipe is full. Responses can arrive
+        // out of order so the slot can be busy even when fewer than maxCallsInFlight calls are waiting. Receiving a
+        // response deals with that.
+        if (pRpc->pSlots[pRpc->nextRequestID & pRpc->slotMask].isInUse) {
+            result = dripc_rpc_pump(rpc);
+            if (result == dripc_result_would_block) {
+                drpipe_wait_ready(pRpc->pipe, DR_IPC_READ);
+            } else if (result != dripc_result_success) {
+                return result;
+            }
+        } else {
+            drpipe_wait_ready(pRpc->pipe, DR_IPC_WRITE);
+        }
+    }
+
+    while (!call.isComplete) {
+        dripc_result result = dripc_rpc_pump(rpc);
+        if (result == dripc_result_would_block) {
+            drpipe_wait_ready(pRpc->pipe, DR_IPC_READ);
+        } else if (result != dripc_result_success && !call.isComplete) {
+            return result;
+        }
+    }
+
+    *pResponseSize = call.responseSize;
+    return call.result;
+}
+
+size_t dripc_rpc_get_calls_in_flight(dripc_rpc rpc)
+{
+    if (rpc == NULL) {
+        return 0;
+    }
+
+    return ((dripc_rpc_state*)rpc)->callsInFlight;
+}
+
+dripc_result dripc_rpc_recv_request(dripc_rpc rpc, void* pRequestOut, size_t requestBufferSize, size_t* pRequestSize, unsigned long long* pRequestID)
+{
+    if (pRequestSize) *pRequestSize = 0;
+    if (pRequestID) *pRequestID = 0;
+
+    if (rpc == NULL || (pRequestOut == NULL && requestBufferSize > 0) || pRequestSize == NULL || pRequestID == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_rpc_state* pRpc = (dripc_rpc_state*)rpc;
+
+    dripc_rpc_header header;
+    dripc_buffer buffers[2];
+    buffers[0].pData       = &header;
+    buffers[0].sizeInBytes = sizeof(header);
+    buffers[1].pData       = pRequestOut;
+    buffers[1].sizeInBytes = requestBufferSize;
+
+    size_t messageSize;
+    dripc_result result = drpipe_recv_message(pRpc->pipe, buffers, 2, &messageSize);
+    if (result != dripc_result_success && result != dripc_result_too_large) {
+        return result;
+    }
+
+    if (messageSize < sizeof(header) || header.kind != DR_IPC_RPC_KIND_REQUEST) {
+        return dripc_result_unknown_error;
+    }
+
+    *pRequestSize = messageSize - sizeof(header);
+    *pRequestID   = header.requestID;
+    return result;
+}
+
+dripc_result dripc_rpc_send_response(dripc_rpc rpc, unsigned long long requestID, const void* pResponse, size_t responseSize)
+{
+    if (rpc == NULL || (pResponse == NULL && responseSize > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_rpc_state* pRpc = (dripc_rpc_state*)rpc;
+
+    dripc_rpc_header header;
+    header.requestID = requestID;
+    header.kind      = DR_IPC_RPC_KIND_RESPONSE;
+    header.reserved  = 0;
+
+    dripc_buffer buffers[2];
+    buffers[0].pData       = &header;
+    buffers[0].sizeInBytes = sizeof(header);
+    buffers[1].pData       = (void*)pResponse;
+    buffers[1].sizeInBytes = responseSize;
+
+    return drpipe_send_message(pRpc->pipe, buffers, 2);
+}
+
+
+dripc_result dripc_spawn(const char* path, const char* const* ppArgs, const char* const* ppEnv, dripc_spawn_fd* pFDs, size_t fdCount, dripc_process* pProcessOut)
+{
+    if (pProcessOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pProcessOut = NULL;
+
+    if (path == NULL || (pFDs == NULL && fdCount > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    // Each descriptor can only be set up once, and a new pipe needs to know which way it goes.
+    size_t iFD;
+    for (iFD = 0; iFD < fdCount; ++iFD) {
+        if (pFDs[iFD].childFD < 0) {
+            return dripc_result_invalid_args;
+        }
+
+        if (pFDs[iFD].pipe == NULL && (pFDs[iFD].options & (DR_IPC_READ | DR_IPC_WRITE)) != DR_IPC_READ && (pFDs[iFD].options & (DR_IPC_READ | DR_IPC_WRITE)) != DR_IPC_WRITE) {
+            return dripc_result_invalid_args;
+        }
+
+        size_t iOtherFD;
+        for (iOtherFD = 0; iOtherFD < iFD; ++iOtherFD) {
+            if (pFDs[iOtherFD].childFD == pFDs[iFD].childFD) {
+                return dripc_result_invalid_args;
+            }
+        }
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_spawn__win32(path, ppArgs, ppEnv, pFDs, fdCount, pProcessOut);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_spawn__unix(path, ppArgs, ppEnv, pFDs, fdCount, pProcessOut);
+#endif
+}
+
+dripc_result dripc_process_wait(dripc_process process, unsigned int timeoutInMilliseconds, int* pExitCode)
+{
+    if (pExitCode) *pExitCode = 0;
+
+    if (process == NULL || pExitCode == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_process_wait__win32(process, timeoutInMilliseconds, pExitCode);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_process_wait__unix(process, timeoutInMilliseconds, pExitCode);
+#endif
+}
+
+dripc_result dripc_process_kill(dripc_process process)
+{
+    if (process == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_process_kill__win32(process);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_process_kill__unix(process);
+#endif
+}
+
+void dripc_process_close(dripc_process process)
+{
+    if (process == NULL) {
+        return;
+    }
+
+#ifdef DR_IPC_WIN32
+    dripc_process_close__win32(process);
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_process_close__unix(process);
+#endif
+}
+
+
+size_t drpipe_get_translated_name(const char* name, char* nameOut, size_t nameOutSize)
+{
+    if (name == NULL) {
+        return 0;
+    }
+
+#ifdef DR_IPC_WIN32
+    return drpipe_get_translated_name__win32(name, nameOut, nameOutSize);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_get_translated_name__unix(name, nameOut, nameOutSize);
+#endif
+}
+
+size_t drshm_get_translated_name(const char* name, char* nameOut, size_t nameOutSize)
+{
+    if (name == NULL) {
+        return 0;
+    }
+
+#ifdef DR_IPC_WIN32
+    return drshm_get_translated_name__win32(name, nameOut, nameOutSize);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drshm_get_translated_name__unix(name, nameOut, nameOutSize);
+#endif
+}
+
+
+dripc_result drsocket_listen(const char* name, unsigned int options, unsigned int backlog, drsocket* pSocketOut)
+{
+    if (pSocketOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pSocketOut = NULL;
+
+    if (name == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)options;
+    (void)backlog;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drsocket_listen__unix(name, options, backlog, pSocketOut);
+#endif
+}
+
+dripc_result drsocket_accept(drsocket socket, unsigned int options, drpipe* pPipeOut)
+{
+    if (pPipeOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeOut = NULL;
+
+    if (socket == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)options;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drsocket_accept__unix(socket, options, pPipeOut);
+#endif
+}
+
+dripc_result drsocket_connect(const char* name, unsigned int options, drpipe* pPipeOut)
+{
+    if (pPipeOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPipeOut = NULL;
+
+    if (name == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)options;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drsocket_connect__unix(name, options, pPipeOut);
+#endif
+}
+
+void drsocket_close(drsocket socket)
+{
+    if (socket == NULL) {
+        return;
+    }
+
+#ifdef DR_IPC_UNIX
+    // Listening sockets share their internal representation with pipes.
+    drpipe_close__unix((drpipe)socket);
+#endif
+}
+
+dripc_result drsocket_set_buffer_sizes(drsocket socket, size_t sendBufferSize, size_t receiveBufferSize)
+{
+    if (socket == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)sendBufferSize;
+    (void)receiveBufferSize;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drsocket_set_buffer_sizes__unix(socket, sendBufferSize, receiveBufferSize);
+#endif
+}
+
+dripc_result drpipe_set_socket_buffer_sizes(drpipe pipe, size_t sendBufferSize, size_t receiveBufferSize)
+{
+    if (pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)sendBufferSize;
+    (void)receiveBufferSize;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_set_socket_buffer_sizes__unix(pipe, sendBufferSize, receiveBufferSize);
+#endif
+}
+
+
+dripc_result dripc_poller_open(dripc_poller* pPollerOut)
+{
+    if (pPollerOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pPollerOut = NULL;
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_poller_open__unix(pPollerOut);
+#endif
+}
+
+void dripc_poller_close(dripc_poller poller)
+{
+    if (poller == NULL) {
+        return;
+    }
+
+#ifdef DR_IPC_UNIX
+    dripc_poller_close__unix(poller);
+#endif
+}
+
+dripc_result dripc_poller_add(dripc_poller poller, drpipe pipe, unsigned int events, void* pUserData)
+{
+    if (poller == NULL || pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)events;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_poller_add__unix(poller, pipe, events, pUserData);
+#endif
+}
+
+dripc_result dripc_poller_modify(dripc_poller poller, drpipe pipe, unsigned int events, void* pUserData)
+{
+    if (poller == NULL || pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)events;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_poller_modify__unix(poller, pipe, events, pUserData);
+#endif
+}
+
+dripc_result dripc_poller_remove(dripc_poller poller, drpipe pipe)
+{
+    if (poller == NULL || pipe == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_poller_remove__unix(poller, pipe);
+#endif
+}
+
+dripc_result dripc_poller_wait(dripc_poller poller, dripc_poll_event* pEvents, size_t eventCapacity, unsigned int timeoutInMilliseconds, size_t* pEventCount)
+{
+    if (pEventCount) *pEventCount = 0;
+
+    if (poller == NULL || pEvents == NULL || eventCapacity == 0 || pEventCount == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)timeoutInMilliseconds;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_poller_wait__unix(poller, pEvents, eventCapacity, timeoutInMilliseconds, pEventCount);
+#endif
+}
+
+
+dripc_result dripc_io_context_open(unsigned int queueDepth, unsigned int options, dripc_io_context* pContextOut)
+{
+    if (pContextOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pContextOut = NULL;
+
+    if (queueDepth == 0) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)options;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_io_context_open__unix(queueDepth, options, pContextOut);
+#endif
+}
+
+void dripc_io_context_close(dripc_io_context context)
+{
+    if (context == NULL) {
+        return;
+    }
+
+#ifdef DR_IPC_UNIX
+    dripc_io_context_close__unix(context);
+#endif
+}
+
+dripc_io_backend dripc_io_context_get_backend(dripc_io_context context)
+{
+    if (context == NULL) {
+        return dripc_io_backend_none;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_io_backend_none;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_io_context_get_backend__unix(context);
+#endif
+}
+
+dripc_result drpipe_read_async(dripc_io_context context, drpipe pipe, void* pDataOut, size_t bytesToRead, dripc_io_callback onComplete, void* pUserData)
+{
+    if (context == NULL || pipe == NULL || pDataOut == NULL || onComplete == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)bytesToRead;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_submit_async__unix(context, pipe, 0, pDataOut, bytesToRead, onComplete, pUserData);
+#endif
+}
+
+dripc_result drpipe_write_async(dripc_io_context context, drpipe pipe, const void* pData, size_t bytesToWrite, dripc_io_callback onComplete, void* pUserData)
+{
+    if (context == NULL || pipe == NULL || pData == NULL || onComplete == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)bytesToWrite;
+    (void)pUserData;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return drpipe_submit_async__unix(context, pipe, 1, (void*)pData, bytesToWrite, onComplete, pUserData);
+#endif
+}
+
+dripc_result dripc_io_context_submit(dripc_io_context context)
+{
+    if (context == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_io_context_submit__unix(context);
+#endif
+}
+
+dripc_result dripc_io_context_run(dripc_io_context context, unsigned int timeoutInMilliseconds, size_t* pCompletionCount)
+{
+    if (pCompletionCount) *pCompletionCount = 0;
+
+    if (context == NULL || pCompletionCount == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+#ifdef DR_IPC_WIN32
+    (void)timeoutInMilliseconds;
+    return dripc_result_not_supported;
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_io_context_run__unix(context, timeoutInMilliseconds, pCompletionCount);
+#endif
+}
+
+
+static dripc_result dripc_shm_create(const char* name, size_t sizeInBytes, dripc_shm* pShm)
+{
+#ifdef DR_IPC_WIN32
+    return dripc_shm_create__win32(name, sizeInBytes, pShm);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_shm_create__unix(name, sizeInBytes, pShm);
+#endif
+}
+
+static dripc_result dripc_shm_open(const char* name, dripc_shm* pShm)
+{
+#ifdef DR_IPC_WIN32
+    return dripc_shm_open__win32(name, pShm);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_shm_open__unix(name, pShm);
+#endif
+}
+
+static dripc_result dripc_shm_create_anonymous_pair(size_t sizeInBytes, dripc_shm* pShm0, dripc_shm* pShm1)
+{
+#ifdef DR_IPC_WIN32
+    return dripc_shm_create_anonymous_pair__win32(sizeInBytes, pShm0, pShm1);
+#endif
+
+#ifdef DR_IPC_UNIX
+    return dripc_shm_create_anonymous_pair__unix(sizeInBytes, pShm0, pShm1);
+#endif
+}
+
+static void dripc_shm_close(dripc_shm* pShm)
+{
+#ifdef DR_IPC_WIN32
+    dripc_shm_close__win32(pShm);
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_shm_close__unix(pShm);
+#endif
+}
+
+static void dripc_futex_wait(volatile uint32_t* pAddress, uint32_t expectedValue)
+{
+#ifdef DR_IPC_WIN32
+    dripc_futex_wait__win32(pAddress, expectedValue);
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_futex_wait__unix(pAddress, expectedValue);
+#endif
+}
+
+static void dripc_futex_wake(volatile uint32_t* pAddress)
+{
+#ifdef DR_IPC_WIN32
+    dripc_futex_wake__win32(pAddress);
+#endif
+
+#ifdef DR_IPC_UNIX
+    dripc_futex_wake__unix(pAddress);
+#endif
+}
+
+// Wakes up anything waiting on pWaiting. This must be called after the state the waiter is interested in has been
+// published. The fence pairs with the one in dripc_wait_for_change() so that either the waiter sees the new state or
+// this sees the waiting flag. The common case where nobody is waiting costs no system calls.
+static void dripc_wake_waiter(volatile uint32_t* pWaiting)
+{
+    dripc_atomic_fence();
+    if (dripc_atomic_load_u32(pWaiting) != 0) {
+        dripc_atomic_store_u32(pWaiting, 0);
+        dripc_futex_wake(pWaiting);
+    }
+}
+
+// Spins and then waits in the kernel until the value at pValue is different to staleValue, or until any of the bits in
+// closedMask are set in *pFlags. Returns 0 if the wait was ended because of the flags.
+static int dripc_wait_for_change(volatile uint64_t* pValue, uint64_t staleValue, volatile uint32_t* pWaiting, volatile uint32_t* pFlags, uint32_t closedMask)
+{
+    unsigned int iSpin;
+    for (iSpin = 0; iSpin < DR_IPC_SHM_SPIN_COUNT; ++iSpin) {
+        if (dripc_atomic_load_u64(pValue) != staleValue) {
+            return 1;
+        }
+        if ((dripc_atomic_load_u32(pFlags) & closedMask) != 0) {
+            return 0;
+        }
+
+        dripc_cpu_pause();
+    }
+
+    for (;;) {
+        dripc_atomic_store_u32(pWaiting, 1);
+        dripc_atomic_fence();
+
+        if (dripc_atomic_load_u64(pValue) != staleValue) {
+            dripc_atomic_store_u32(pWaiting, 0);
+            return 1;
+        }
+        if ((dripc_atomic_load_u32(pFlags) & closedMask) != 0) {
+            dripc_atomic_store_u32(pWaiting, 0);
+            return 0;
+        }
+
+        dripc_futex_wait(pWaiting, 1);
+    }
+}
+
+
+#define DR_IPC_SHM_RING_MAGIC           0x474E4952  // "RING"
+#define DR_IPC_SHM_RING_READER_CLOSED   0x01
+#define DR_IPC_SHM_RING_WRITER_CLOSED   0x02
+
+// The layout of the header at the start of a ring's shared memory. The read and write positions live on their own cache
+// lines so the producer and consumer do not contend with each other. The positions are never wrapped; they are masked
+// against the capacity when indexing into the buffer.
+typedef struct
+{
+    volatile uint32_t magic;            // Set last by the server once the rest of the header has been initialized.
+    volatile uint32_t flags;            // DR_IPC_SHM_RING_READER_CLOSED, DR_IPC_SHM_RING_WRITER_CLOSED
+    uint64_t capacity;
+    uint8_t pad0[DR_IPC_CACHE_LINE_SIZE - 16];
+    volatile uint64_t writePos;
+    uint8_t pad1[DR_IPC_CACHE_LINE_SIZE - 8];
+    volatile uint64_t readPos;
+    uint8_t pad2[DR_IPC_CACHE_LINE_SIZE - 8];
+    volatile uint32_t readerWaiting;
+    volatile uint32_t writerWaiting;
+    uint8_t pad3[DR_IPC_CACHE_LINE_SIZE - 8];
+} drshm_ring_header;
+
+typedef struct
+{
+    dripc_shm shm;
+    drshm_ring_header* pHeader;
+    unsigned char* pBuffer;
+    uint64_t capacity;
+    uint64_t cachedPeerPos;             // The last known position of the other end. Only refreshed when it looks like we need to wait.
+    unsigned int options;
+    int isUsed;                         // Whether or not this end has been read from or written to. See drshm_ring_close().
+} drshm_ring_state;
+
+static int drshm_ring_validate_options(unsigned int options)
+{
+    return (options & (DR_IPC_READ | DR_IPC_WRITE)) == DR_IPC_READ || (options & (DR_IPC_READ | DR_IPC_WRITE)) == DR_IPC_WRITE;
+}
+
+static uint64_t drshm_ring_round_capacity(size_t capacity)
+{
+    uint64_t rounded = 4096;
+    while (rounded < (uint64_t)capacity) {
+        rounded <<= 1;
+    }
+
+    return rounded;
+}
+
+static drshm_ring_state* drshm_ring_create_state(const dripc_shm* pShm, unsigned int options)
+{
+    drshm_ring_state* pRing = (drshm_ring_state*)calloc(1, sizeof(*pRing));
+    if (pRing == NULL) {
+        return NULL;
+    }
+
+    pRing->shm = *pShm;
+    pRing->pHeader = (drshm_ring_header*)pShm->pData;
+    pRing->pBuffer = (unsigned char*)pShm->pData + sizeof(drshm_ring_header);
+    pRing->capacity = pRing->pHeader->capacity;
+    pRing->options = options;
+
+    if (options & DR_IPC_WRITE) {
+        pRing->cachedPeerPos = dripc_atomic_load_u64(&pRing->pHeader->readPos);
+    } else {
+        pRing->cachedPeerPos = dripc_atomic_load_u64(&pRing->pHeader->writePos);
+    }
+
+    return pRing;
+}
+
+static void drshm_ring_init_header(drshm_ring_header* pHeader, uint64_t capacity)
+{
+    pHeader->flags = 0;
+    pHeader->capacity = capacity;
+    pHeader->writePos = 0;
+    pHeader->readPos = 0;
+    pHeader->readerWaiting = 0;
+    pHeader->writerWaiting = 0;
+    dripc_atomic_store_u32(&pHeader->magic, DR_IPC_SHM_RING_MAGIC);
+}
+
+dripc_result drshm_ring_open_named_server(const char* name, size_t capacity, unsigned int options, drshm_ring* pRingOut)
+{
+    if (pRingOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pRingOut = NULL;
+
+    if (name == NULL || capacity == 0 || !drshm_ring_validate_options(options)) {
+        return dripc_result_invalid_args;
+    }
+
+    uint64_t capacity64 = drshm_ring_round_capacity(capacity);
+    if (capacity64 + sizeof(drshm_ring_header) > (uint64_t)((size_t)-1)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_create(name, sizeof(drshm_ring_header) + (size_t)capacity64, &shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drshm_ring_init_header((drshm_ring_header*)shm.pData, capacity64);
+
+    drshm_ring_state* pRing = drshm_ring_create_state(&shm, options);
+    if (pRing == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pRingOut = (drshm_ring)pRing;
+    return dripc_result_success;
+}
+
+dripc_result drshm_ring_open_named_client(const char* name, unsigned int options, drshm_ring* pRingOut)
+{
+    if (pRingOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pRingOut = NULL;
+
+    if (name == NULL || !drshm_ring_validate_options(options)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_open(name, &shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    // Make sure the server has finished initializing the ring and that it's not something else with the same name.
+    drshm_ring_header* pHeader = (drshm_ring_header*)shm.pData;
+    if (shm.sizeInBytes < sizeof(*pHeader) || dripc_atomic_load_u32(&pHeader->magic) != DR_IPC_SHM_RING_MAGIC || pHeader->capacity > shm.sizeInBytes - sizeof(*pHeader)) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    drshm_ring_state* pRing = drshm_ring_create_state(&shm, options);
+    if (pRing == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pRingOut = (drshm_ring)pRing;
+    return dripc_result_success;
+}
+
+dripc_result drshm_ring_open_anonymous(size_t capacity, drshm_ring* pRingRead, drshm_ring* pRingWrite)
+{
+    if (pRingRead == NULL || pRingWrite == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pRingRead = NULL;
+    *pRingWrite = NULL;
+
+    if (capacity == 0) {
+        return dripc_result_invalid_args;
+    }
+
+    uint64_t capacity64 = drshm_ring_round_capacity(capacity);
+    if (capacity64 + sizeof(drshm_ring_header) > (uint64_t)((size_t)-1)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shmRead;
+    dripc_shm shmWrite;
+    dripc_result result = dripc_shm_create_anonymous_pair(sizeof(drshm_ring_header) + (size_t)capacity64, &shmRead, &shmWrite);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drshm_ring_init_header((drshm_ring_header*)shmRead.pData, capacity64);
+
+    drshm_ring_state* pRingReadState = drshm_ring_create_state(&shmRead, DR_IPC_READ);
+    drshm_ring_state* pRingWriteState = drshm_ring_create_state(&shmWrite, DR_IPC_WRITE);
+    if (pRingReadState == NULL || pRingWriteState == NULL) {
+        free(pRingReadState);
+        free(pRingWriteState);
+        dripc_shm_close(&shmRead);
+        dripc_shm_close(&shmWrite);
+        return dripc_result_unknown_error;
+    }
+
+    *pRingRead = (drshm_ring)pRingReadState;
+    *pRingWrite = (drshm_ring)pRingWriteState;
+    return dripc_result_success;
+}
+
+void drshm_ring_close(drshm_ring ring)
+{
+    if (ring == NULL) {
+        return;
+    }
+
+    drshm_ring_state* pRing = (drshm_ring_state*)ring;
+    drshm_ring_header* pHeader = pRing->pHeader;
+
+    // After a fork() both processes have a copy of both ends of an anonymous ring and will close the end they are not
+    // using. That must not look like the other side hanging up, so anonymous ends only signal once they've been used.
+    if (pRing->isUsed || pRing->shm.name[0] != '\0') {
+        dripc_atomic_fetch_or_u32(&pHeader->flags, (pRing->options & DR_IPC_WRITE) ? DR_IPC_SHM_RING_WRITER_CLOSED : DR_IPC_SHM_RING_READER_CLOSED);
+        dripc_wake_waiter(&pHeader->readerWaiting);
+        dripc_wake_waiter(&pHeader->writerWaiting);
+    }
+
+    dripc_shm_close(&pRing->shm);
+    free(pRing);
+}
+
+dripc_result drshm_ring_read(drshm_ring ring, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    if (pBytesRead) *pBytesRead = 0;
+
+    if (ring == NULL || pDataOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_ring_state* pRing = (drshm_ring_state*)ring;
+    if ((pRing->options & DR_IPC_READ) == 0) {
+        return dripc_result_invalid_args;
+    }
+
+    if (bytesToRead == 0) {
+        return dripc_result_success;
+    }
+
+    pRing->isUsed = 1;
+
+    drshm_ring_header* pHeader = pRing->pHeader;
+    uint64_t readPos = pHeader->readPos;    // Only ever written by us.
+
+    if (pRing->cachedPeerPos == readPos) {
+        pRing->cachedPeerPos = dripc_atomic_load_u64(&pHeader->writePos);
+        if (pRing->cachedPeerPos == readPos) {
+            if (!dripc_wait_for_change(&pHeader->writePos, readPos, &pHeader->readerWaiting, &pHeader->flags, DR_IPC_SHM_RING_WRITER_CLOSED)) {
+                // The writer has closed, but it may have written some data before doing so.
+                pRing->cachedPeerPos = dripc_atomic_load_u64(&pHeader->writePos);
+                if (pRing->cachedPeerPos == readPos) {
+                    return dripc_result_success;    // End of stream.
+                }
+            }
+
+            pRing->cachedPeerPos = dripc_atomic_load_u64(&pHeader->writePos);
+        }
+    }
+
+    uint64_t available = pRing->cachedPeerPos - readPos;
+    size_t bytesRead = (available < (uint64_t)bytesToRead) ? (size_t)available : bytesToRead;
+
+    size_t offset = (size_t)(readPos & (pRing->capacity - 1));
+    size_t firstPart = (size_t)pRing->capacity - offset;
+    if (firstPart > bytesRead) {
+        firstPart = bytesRead;
+    }
+
+    memcpy(pDataOut, pRing->pBuffer + offset, firstPart);
+    memcpy((unsigned char*)pDataOut + firstPart, pRing->pBuffer, bytesRead - firstPart);
+
+    dripc_atomic_store_u64(&pHeader->readPos, readPos + bytesRead);
+    dripc_wake_waiter(&pHeader->writerWaiting);
+
+    if (pBytesRead) *pBytesRead = bytesRead;
+    return dripc_result_success;
+}
+
+dripc_result drshm_ring_read_exact(drshm_ring ring, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+{
+    if (pBytesRead) *pBytesRead = 0;
+
+    while (bytesToRead > 0) {
+        size_t bytesRead;
+        dripc_result result = drshm_ring_read(ring, pDataOut, bytesToRead, &bytesRead);
+        if (result != dripc_result_success) {
+            return result;
+        }
+
+        if (bytesRead == 0) {
+            return dripc_result_unknown_error;  // The writer closed before all of the data was received.
+        }
+
+        pDataOut = (void*)((char*)pDataOut + bytesRead);
+
+        bytesToRead -= bytesRead;
+        if (pBytesRead) *pBytesRead += bytesRead;
+    }
+
+    return dripc_result_success;
+}
+
+dripc_result drshm_ring_write(drshm_ring ring, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+{
+    if (pBytesWritten) *pBytesWritten = 0;
+
+    if (ring == NULL || pData == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_ring_state* pRing = (drshm_ring_state*)ring;
+    if ((pRing->options & DR_IPC_WRITE) == 0) {
+        return dripc_result_invalid_args;
+    }
+
+    pRing->isUsed = 1;
+
+    drshm_ring_header* pHeader = pRing->pHeader;
+    uint64_t writePos = pHeader->writePos;  // Only ever written by us.
+
+    while (bytesToWrite > 0) {
+        if ((dripc_atomic_load_u32(&pHeader->flags) & DR_IPC_SHM_RING_READER_CLOSED) != 0) {
+            return dripc_result_unknown_error;
+        }
+
+        uint64_t space = pRing->capacity - (writePos - pRing->cachedPeerPos);
+        if (space == 0) {
+            pRing->cachedPeerPos = dripc_atomic_load_u64(&pHeader->readPos);
+            space = pRing->capacity - (writePos - pRing->cachedPeerPos);
+            if (space == 0) {
+                if (!dripc_wait_for_change(&pHeader->readPos, pRing->cachedPeerPos, &pHeader->writerWaiting, &pHeader->flags, DR_IPC_SHM_RING_READER_CLOSED)) {
+                    return dripc_result_unknown_error;
+                }
+                continue;
+            }
+        }
+
+        size_t bytesThisIteration = (space < (uint64_t)bytesToWrite) ? (size_t)space : bytesToWrite;
+
+        size_t offset = (size_t)(writePos & (pRing->capacity - 1));
+        size_t firstPart = (size_t)pRing->capacity - offset;
+        if (firstPart > bytesThisIteration) {
+            firstPart = bytesThisIteration;
+        }
+
+        memcpy(pRing->pBuffer + offset, pData, firstPart);
+        memcpy(pRing->pBuffer, (const unsigned char*)pData + firstPart, bytesThisIteration - firstPart);
+
+        writePos += bytesThisIteration;
+        dripc_atomic_store_u64(&pHeader->writePos, writePos);
+        dripc_wake_waiter(&pHeader->readerWaiting);
+
+        pData = (const void*)((const char*)pData + bytesThisIteration);
+        bytesToWrite -= bytesThisIteration;
+        if (pBytesWritten) *pBytesWritten += bytesThisIteration;
+    }
+
+    return dripc_result_success;
+}
+
+
+#define DR_IPC_SHM_QUEUE_MAGIC          0x45555551  // "QUEU"
+
+// The layout of the header at the start of a queue's shared memory. This is a bounded multi-producer/multi-consumer
+// queue in the style of Dmitry Vyukov's. Each slot has a sequence number which tells producers and consumers whose turn
+// it is, so the only contended operations are the compare-exchanges on the enqueue and dequeue positions.
+//
+// The not-empty and not-full words are event counters. A waiter samples one, registers itself in the matching waiter
+// count, checks the queue again and only then sleeps on the counter. The other side bumps the counter and wakes any
+// waiters, but only if the waiter count is non-zero so nobody pays for a system call when nobody is waiting.
+typedef struct
+{
+    volatile uint32_t magic;            // Set last by the server once the rest of the header has been initialized.
+    uint32_t slotSize;                  // The maximum size of a message.
+    uint64_t slotCount;                 // Always a power of 2.
+    uint64_t slotStride;                // The distance between slots, rounded up to a whole number of cache lines.
+    uint8_t pad0[DR_IPC_CACHE_LINE_SIZE - 24];
+    volatile uint64_t enqueuePos;
+    uint8_t pad1[DR_IPC_CACHE_LINE_SIZE - 8];
+    volatile uint64_t dequeuePos;
+    uint8_t pad2[DR_IPC_CACHE_LINE_SIZE - 8];
+    volatile uint32_t notEmpty;
+    volatile uint32_t consumersWaiting;
+    uint8_t pad3[DR_IPC_CACHE_LINE_SIZE - 8];
+    volatile uint32_t notFull;
+    volatile uint32_t producersWaiting;
+    uint8_t pad4[DR_IPC_CACHE_LINE_SIZE - 8];
+} drshm_queue_header;
+
+typedef struct
+{
+    volatile uint64_t sequence;
+    uint32_t size;
+    uint32_t reserved;
+} drshm_queue_slot;
+
+typedef struct
+{
+    dripc_shm shm;
+    drshm_queue_header* pHeader;
+    unsigned char* pSlots;
+    uint64_t slotMask;
+    uint64_t slotStride;
+    uint32_t slotSize;
+} drshm_queue_state;
+
+static drshm_queue_slot* drshm_queue_get_slot(drshm_queue_state* pQueue, uint64_t pos)
+{
+    return (drshm_queue_slot*)(pQueue->pSlots + (size_t)((pos & pQueue->slotMask) * pQueue->slotStride));
+}
+
+static drshm_queue_state* drshm_queue_create_state(const dripc_shm* pShm)
+{
+    drshm_queue_state* pQueue = (drshm_queue_state*)calloc(1, sizeof(*pQueue));
+    if (pQueue == NULL) {
+        return NULL;
+    }
+
+    pQueue->shm = *pShm;
+    pQueue->pHeader = (drshm_queue_header*)pShm->pData;
+    pQueue->pSlots = (unsigned char*)pShm->pData + sizeof(drshm_queue_header);
+    pQueue->slotMask = pQueue->pHeader->slotCount - 1;
+    pQueue->slotStride = pQueue->pHeader->slotStride;
+    pQueue->slotSize = pQueue->pHeader->slotSize;
+
+    return pQueue;
+}
+
+// Bumps an event counter and wakes anything sleeping on it. The fence pairs with the one in drshm_queue_wait().
+static void drshm_queue_signal(volatile uint32_t* pEvent, volatile uint32_t* pWaiterCount)
+{
+    dripc_atomic_fence();
+    if (dripc_atomic_load_u32(pWaiterCount) != 0) {
+        dripc_atomic_fetch_add_u32(pEvent, 1);
+        dripc_futex_wake(pEvent);
+    }
+}
+
+dripc_result drshm_queue_open_named_server(const char* name, size_t slotSize, size_t slotCount, drshm_queue* pQueueOut)
+{
+    if (pQueueOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pQueueOut = NULL;
+
+    if (name == NULL || slotSize == 0 || slotSize > 0x7FFFFFFF || slotCount == 0 || slotCount > ((uint64_t)1 << 32)) {
+        return dripc_result_invalid_args;
+    }
+
+    uint64_t slotCount64 = 2;
+    while (slotCount64 < (uint64_t)slotCount) {
+        slotCount64 <<= 1;
+    }
+
+    uint64_t slotStride = (sizeof(drshm_queue_slot) + (uint64_t)slotSize + DR_IPC_CACHE_LINE_SIZE-1) & ~(uint64_t)(DR_IPC_CACHE_LINE_SIZE-1);
+    if (slotStride > (((uint64_t)((size_t)-1) - sizeof(drshm_queue_header)) / slotCount64)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_create(name, sizeof(drshm_queue_header) + (size_t)(slotStride * slotCount64), &shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drshm_queue_header* pHeader = (drshm_queue_header*)shm.pData;
+    pHeader->slotSize = (uint32_t)slotSize;
+    pHeader->slotCount = slotCount64;
+    pHeader->slotStride = slotStride;
+    pHeader->enqueuePos = 0;
+    pHeader->dequeuePos = 0;
+    pHeader->notEmpty = 0;
+    pHeader->consumersWaiting = 0;
+    pHeader->notFull = 0;
+    pHeader->producersWaiting = 0;
+
+    uint64_t iSlot;
+    for (iSlot = 0; iSlot < slotCount64; ++iSlot) {
+        drshm_queue_slot* pSlot = (drshm_queue_slot*)((unsigned char*)shm.pData + sizeof(drshm_queue_header) + (size_t)(iSlot * slotStride));
+        pSlot->sequence = iSlot;
+    }
+
+    dripc_atomic_store_u32(&pHeader->magic, DR_IPC_SHM_QUEUE_MAGIC);
+
+    drshm_queue_state* pQueue = drshm_queue_create_state(&shm);
+    if (pQueue == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pQueueOut = (drshm_queue)pQueue;
+    return dripc_result_success;
+}
+
+dripc_result drshm_queue_open_named_client(const char* name, drshm_queue* pQueueOut)
+{
+    if (pQueueOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pQueueOut = NULL;
+
+    if (name == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_open(name, &shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    // Make sure the server has finished initializing the queue and that it's not something else with the same name.
+    drshm_queue_header* pHeader = (drshm_queue_header*)shm.pData;
+    if (shm.sizeInBytes < sizeof(*pHeader) || dripc_atomic_load_u32(&pHeader->magic) != DR_IPC_SHM_QUEUE_MAGIC ||
+        pHeader->slotCount == 0 || (pHeader->slotCount & (pHeader->slotCount - 1)) != 0 || pHeader->slotStride < sizeof(drshm_queue_slot) + pHeader->slotSize ||
+        pHeader->slotStride > (shm.sizeInBytes - sizeof(*pHeader)) / pHeader->slotCount) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    drshm_queue_state* pQueue = drshm_queue_create_state(&shm);
+    if (pQueue == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pQueueOut = (drshm_queue)pQueue;
+    return dripc_result_success;
+}
+
+void drshm_queue_close(drshm_queue queue)
+{
+    if (queue == NULL) {
+        return;
+    }
+
+    drshm_queue_state* pQueue = (drshm_queue_state*)queue;
+    dripc_shm_close(&pQueue->shm);
+    free(pQueue);
+}
+
+size_t drshm_queue_get_slot_size(drshm_queue queue)
+{
+    if (queue == NULL) {
+        return 0;
+    }
+
+    return ((drshm_queue_state*)queue)->slotSize;
+}
+
+dripc_result drshm_queue_try_push(drshm_queue queue, const void* pData, size_t sizeInBytes)
+{
+    if (queue == NULL || (pData == NULL && sizeInBytes > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_queue_state* pQueue = (drshm_queue_state*)queue;
+    drshm_queue_header* pHeader = pQueue->pHeader;
+    if (sizeInBytes > pQueue->slotSize) {
+        return dripc_result_too_large;
+    }
+
+    drshm_queue_slot* pSlot;
+    uint64_t pos = dripc_atomic_load_u64(&pHeader->enqueuePos);
+    for (;;) {
+        pSlot = drshm_queue_get_slot(pQueue, pos);
+
+        int64_t diff = (int64_t)(dripc_atomic_load_u64(&pSlot->sequence) - pos);
+        if (diff == 0) {
+            if (dripc_atomic_compare_exchange_u64(&pHeader->enqueuePos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return dripc_result_would_block;    // Full. The slot still holds a message from the previous lap.
+        } else {
+            pos = dripc_atomic_load_u64(&pHeader->enqueuePos);
+        }
+    }
+
+    pSlot->size = (uint32_t)sizeInBytes;
+    if (sizeInBytes > 0) {
+        memcpy(pSlot + 1, pData, sizeInBytes);
+    }
+
+    dripc_atomic_store_u64(&pSlot->sequence, pos + 1);
+    drshm_queue_signal(&pHeader->notEmpty, &pHeader->consumersWaiting);
+
+    return dripc_result_success;
+}
+
+dripc_result drshm_queue_try_pop(drshm_queue queue, void* pDataOut, size_t bufferSize, size_t* pMessageSize)
+{
+    if (pMessageSize) *pMessageSize = 0;
+
+    if (queue == NULL || (pDataOut == NULL && bufferSize > 0) || pMessageSize == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_queue_state* pQueue = (drshm_queue_state*)queue;
+    drshm_queue_header* pHeader = pQueue->pHeader;
+
+    drshm_queue_slot* pSlot;
+    uint64_t pos = dripc_atomic_load_u64(&pHeader->dequeuePos);
+    for (;;) {
+        pSlot = drshm_queue_get_slot(pQueue, pos);
+
+        int64_t diff = (int64_t)(dripc_atomic_load_u64(&pSlot->sequence) - (pos + 1));
+        if (diff == 0) {
+            // The size can be checked before claiming the slot because a published slot can't change until somebody
+            // claims it, in which case the compare-exchange below fails.
+            uint32_t size = pSlot->size;
+            if (size > bufferSize) {
+                if (dripc_atomic_load_u64(&pHeader->dequeuePos) == pos) {
+                    *pMessageSize = size;
+                    return dripc_result_too_large;
+                }
+
+                pos = dripc_atomic_load_u64(&pHeader->dequeuePos);
+                continue;
+            }
+
+            if (dripc_atomic_compare_exchange_u64(&pHeader->dequeuePos, &pos, pos + 1)) {
+                break;
+            }
+        } else if (diff < 0) {
+            return dripc_result_would_block;    // Empty.
+        } else {
+            pos = dripc_atomic_load_u64(&pHeader->dequeuePos);
+        }
+    }
+
+    size_t size = pSlot->size;
+    if (size > 0) {
+        memcpy(pDataOut, pSlot + 1, size);
+    }
+
+    // Hand the slot to the producer on the next lap.
+    dripc_atomic_store_u64(&pSlot->sequence, pos + pQueue->slotMask + 1);
+    drshm_queue_signal(&pHeader->notFull, &pHeader->producersWaiting);
+
+    *pMessageSize = size;
+    return dripc_result_success;
+}
+
+dripc_result drshm_queue_push(drshm_queue queue, const void* pData, size_t sizeInBytes)
+{
+    unsigned int iSpin = 0;
+    for (;;) {
+        dripc_result result = drshm_queue_try_push(queue, pData, sizeInBytes);
+        if (result != dripc_result_would_block) {
+            return result;
+        }
+
+        if (iSpin < DR_IPC_SHM_SPIN_COUNT) {
+            iSpin += 1;
+            dripc_cpu_pause();
+            continue;
+        }
+
+        drshm_queue_header* pHeader = ((drshm_queue_state*)queue)->pHeader;
+        uint32_t event = dripc_atomic_load_u32(&pHeader->notFull);
+        dripc_atomic_fetch_add_u32(&pHeader->producersWaiting, 1);
+        dripc_atomic_fence();
+
+        result = drshm_queue_try_push(queue, pData, sizeInBytes);
+        if (result == dripc_result_would_block) {
+            dripc_futex_wait(&pHeader->notFull, event);
+        }
+
+        dripc_atomic_fetch_add_u32(&pHeader->producersWaiting, (uint32_t)-1);
+
+        if (result != dripc_result_would_block) {
+            return result;
+        }
+    }
+}
+
+dripc_result drshm_queue_pop(drshm_queue queue, void* pDataOut, size_t bufferSize, size_t* pMessageSize)
+{
+    unsigned int iSpin = 0;
+    for (;;) {
+        dripc_result result = drshm_queue_try_pop(queue, pDataOut, bufferSize, pMessageSize);
+        if (result != dripc_result_would_block) {
+            return result;
+        }
+
+        if (iSpin < DR_IPC_SHM_SPIN_COUNT) {
+            iSpin += 1;
+            dripc_cpu_pause();
+            continue;
+        }
+
+        drshm_queue_header* pHeader = ((drshm_queue_state*)queue)->pHeader;
+        uint32_t event = dripc_atomic_load_u32(&pHeader->notEmpty);
+        dripc_atomic_fetch_add_u32(&pHeader->consumersWaiting, 1);
+        dripc_atomic_fence();
+
+        result = drshm_queue_try_pop(queue, pDataOut, bufferSize, pMessageSize);
+        if (result == dripc_result_would_block) {
+            dripc_futex_wait(&pHeader->notEmpty, event);
+        }
+
+        dripc_atomic_fetch_add_u32(&pHeader->consumersWaiting, (uint32_t)-1);
+
+        if (result != dripc_result_would_block) {
+            return result;
+        }
+    }
+}
+
+
+#define DR_IPC_SHM_ARENA_MAGIC          0x4E455241  // "AREN"
+#define DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT    6       // Blocks are at least a cache line.
+#define DR_IPC_SHM_ARENA_CLASS_COUNT        64      // Size classes are indexed by the log2 of their block size.
+#ifndef DR_IPC_SHM_ARENA_PAGE_SIZE
+#define DR_IPC_SHM_ARENA_PAGE_SIZE          65536   // Must be a power of 2.
+#endif
+
+// Each size class has a free list which is a Treiber stack of blocks. The head is tagged with a counter in its upper 32
+// bits which is bumped on every change so that a block being popped, reallocated and pushed again in between another
+// thread reading the head and swapping it can't go unnoticed. The lower 32 bits are the index of the top block plus 1, in
+// units of the minimum block size, or 0 when the list is empty.
+typedef struct
+{
+    volatile uint64_t head;
+    uint8_t pad[DR_IPC_CACHE_LINE_SIZE - 8];
+} drshm_arena_free_list;
+
+// The layout of the header at the start of an arena's shared memory. It's followed by the page table which records the
+// size class of the blocks that each page has been carved into, or 0 if the page isn't the first page of a block. The
+// pages themselves start at dataOffset.
+//
+// Pages are handed out by bumping nextPage. A page for a small size class is split into blocks straight away and all but
+// one of them go on that class's free list. A block that is at least a page in size is made of whole pages.
+typedef struct
+{
+    volatile uint32_t magic;            // Set last by the server once the rest of the header has been initialized.
+    uint32_t pageShift;
+    uint64_t pageCount;
+    uint64_t dataOffset;                // Always a multiple of the page size.
+    uint8_t pad0[DR_IPC_CACHE_LINE_SIZE - 24];
+    volatile uint64_t nextPage;
+    uint8_t pad1[DR_IPC_CACHE_LINE_SIZE - 8];
+    drshm_arena_free_list freeLists[DR_IPC_SHM_ARENA_CLASS_COUNT];
+} drshm_arena_header;
+
+typedef struct
+{
+    dripc_shm shm;
+    drshm_arena_header* pHeader;
+    volatile uint8_t* pPageClasses;
+    unsigned char* pData;
+    size_t dataSize;
+    uint32_t pageShift;
+} drshm_arena_state;
+
+static volatile uint32_t* drshm_arena_get_block(drshm_arena_state* pArena, uint32_t index)
+{
+    return (volatile uint32_t*)(pArena->pData + ((size_t)(index - 1) << DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT));
+}
+
+// Pushes a chain of blocks that have already been linked together onto a free list.
+static void drshm_arena_push(drshm_arena_state* pArena, uint32_t sizeClass, uint32_t firstIndex, uint32_t lastIndex)
+{
+    drshm_arena_free_list* pList = &pArena->pHeader->freeLists[sizeClass];
+
+    uint64_t head = dripc_atomic_load_u64(&pList->head);
+    for (;;) {
+        dripc_atomic_store_u32(drshm_arena_get_block(pArena, lastIndex), (uint32_t)head);
+        if (dripc_atomic_compare_exchange_u64(&pList->head, &head, (((head >> 32) + 1) << 32) | firstIndex)) {
+            break;
+        }
+    }
+}
+
+// Returns 0 if the free list is empty.
+static uint32_t drshm_arena_pop(drshm_arena_state* pArena, uint32_t sizeClass)
+{
+    drshm_arena_free_list* pList = &pArena->pHeader->freeLists[sizeClass];
+
+    uint64_t head = dripc_atomic_load_u64(&pList->head);
+    for (;;) {
+        uint32_t index = (uint32_t)head;
+        if (index == 0) {
+            return 0;
+        }
+
+        // The block may have already been popped and written to by somebody else, in which case this reads garbage. That's
+        // fine because the tag will have changed and the compare-exchange will fail.
+        uint32_t next = dripc_atomic_load_u32(drshm_arena_get_block(pArena, index));
+        if (dripc_atomic_compare_exchange_u64(&pList->head, &head, (((head >> 32) + 1) << 32) | next)) {
+            return index;
+        }
     }
+}
 
+// Reserves a run of pages. Returns (uint64_t)-1 if there's not enough room left.
+static uint64_t drshm_arena_take_pages(drshm_arena_state* pArena, uint64_t pageCount)
+{
+    drshm_arena_header* pHeader = pArena->pHeader;
 
-    // Wait for a client to connect...
-    if (!ConnectNamedPipe(hPipeWin32, NULL)) {
-        CloseHandle(hPipeWin32);
-        return dripc_result_from_win32_error(GetLastError());
+    uint64_t firstPage = dripc_atomic_load_u64(&pHeader->nextPage);
+    for (;;) {
+        if (pageCount > pHeader->pageCount - firstPage) {
+            return (uint64_t)-1;
+        }
+
+        if (dripc_atomic_compare_exchange_u64(&pHeader->nextPage, &firstPage, firstPage + pageCount)) {
+            return firstPage;
+        }
+    }
+}
+
+static drshm_arena_state* drshm_arena_create_state(const dripc_shm* pShm)
+{
+    drshm_arena_state* pArena = (drshm_arena_state*)calloc(1, sizeof(*pArena));
+    if (pArena == NULL) {
+        return NULL;
+    }
+
+    pArena->shm = *pShm;
+    pArena->pHeader = (drshm_arena_header*)pShm->pData;
+    pArena->pPageClasses = (volatile uint8_t*)(pArena->pHeader + 1);
+    pArena->pData = (unsigned char*)pShm->pData + (size_t)pArena->pHeader->dataOffset;
+    pArena->dataSize = (size_t)(pArena->pHeader->pageCount << pArena->pHeader->pageShift);
+    pArena->pageShift = pArena->pHeader->pageShift;
+
+    return pArena;
+}
+
+dripc_result drshm_arena_open_named_server(const char* name, size_t capacity, drshm_arena* pArenaOut)
+{
+    if (pArenaOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pArenaOut = NULL;
+
+    if (name == NULL || capacity == 0) {
+        return dripc_result_invalid_args;
+    }
+
+    uint32_t pageShift = 0;
+    while (((uint64_t)1 << pageShift) < DR_IPC_SHM_ARENA_PAGE_SIZE) {
+        pageShift += 1;
     }
 
+    // Block indices are 32 bits in units of the minimum block size which puts a limit on how big an arena can be.
+    uint64_t pageSize = (uint64_t)1 << pageShift;
+    uint64_t pageCount = ((uint64_t)capacity + pageSize-1) >> pageShift;
+    if (pageCount > ((uint64_t)0xFFFFFFFF << DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT) >> pageShift) {
+        return dripc_result_invalid_args;
+    }
+
+    uint64_t dataOffset = (sizeof(drshm_arena_header) + pageCount + pageSize-1) & ~(pageSize-1);
+    if (pageCount > (((uint64_t)((size_t)-1) - dataOffset) >> pageShift)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_create(name, (size_t)(dataOffset + (pageCount << pageShift)), &shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drshm_arena_header* pHeader = (drshm_arena_header*)shm.pData;
+    memset(pHeader, 0, (size_t)dataOffset);
+    pHeader->pageShift = pageShift;
+    pHeader->pageCount = pageCount;
+    pHeader->dataOffset = dataOffset;
 
-    *pPipeOut = DR_IPC_WIN32_HANDLE_TO_PIPE(hPipeWin32);
+    dripc_atomic_store_u32(&pHeader->magic, DR_IPC_SHM_ARENA_MAGIC);
+
+    drshm_arena_state* pArena = drshm_arena_create_state(&shm);
+    if (pArena == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pArenaOut = (drshm_arena)pArena;
     return dripc_result_success;
 }
 
-dripc_result drpipe_open_named_client__win32(const char* name, unsigned int options, drpipe* pPipeOut)
+dripc_result drshm_arena_open_named_client(const char* name, drshm_arena* pArenaOut)
 {
-    char nameWin32[256] = DR_IPC_WIN32_PIPE_NAME_HEAD;
-    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
-        return dripc_result_name_too_long;
+    if (pArenaOut == NULL) {
+        return dripc_result_invalid_args;
     }
 
-    DWORD dwDesiredAccess = 0;
-    if (options & DR_IPC_READ) {
-        dwDesiredAccess |= GENERIC_READ;
+    *pArenaOut = NULL;
+
+    if (name == NULL) {
+        return dripc_result_invalid_args;
     }
-    if (options & DR_IPC_WRITE) {
-        dwDesiredAccess |= GENERIC_WRITE;
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_open(name, &shm);
+    if (result != dripc_result_success) {
+        return result;
     }
 
-    if (dwDesiredAccess == 0) {
-        return dripc_result_invalid_args;   // Neither read nor write mode was specified.
+    // Make sure the server has finished initializing the arena and that it's not something else with the same name.
+    drshm_arena_header* pHeader = (drshm_arena_header*)shm.pData;
+    if (shm.sizeInBytes < sizeof(*pHeader) || dripc_atomic_load_u32(&pHeader->magic) != DR_IPC_SHM_ARENA_MAGIC ||
+        pHeader->pageShift < DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT || pHeader->pageShift >= DR_IPC_SHM_ARENA_CLASS_COUNT ||
+        pHeader->dataOffset < sizeof(*pHeader) + pHeader->pageCount || pHeader->dataOffset > shm.sizeInBytes ||
+        pHeader->pageCount > ((shm.sizeInBytes - pHeader->dataOffset) >> pHeader->pageShift)) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
     }
 
-    // The pipe might be busy, so just keep trying.
-    for (;;) {
-        HANDLE hPipeWin32 = CreateFileA(nameWin32, dwDesiredAccess, 0, NULL, OPEN_EXISTING, 0, NULL);
-        if (hPipeWin32 == INVALID_HANDLE_VALUE) {
-            DWORD dwError = GetLastError();
-            if (dwError != ERROR_PIPE_BUSY) {
-                return dripc_result_from_win32_error(dwError);
+    drshm_arena_state* pArena = drshm_arena_create_state(&shm);
+    if (pArena == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pArenaOut = (drshm_arena)pArena;
+    return dripc_result_success;
+}
+
+void drshm_arena_close(drshm_arena arena)
+{
+    if (arena == NULL) {
+        return;
+    }
+
+    drshm_arena_state* pArena = (drshm_arena_state*)arena;
+    dripc_shm_close(&pArena->shm);
+    free(pArena);
+}
+
+dripc_result drshm_arena_alloc(drshm_arena arena, size_t sizeInBytes, size_t* pOffsetOut)
+{
+    if (pOffsetOut) *pOffsetOut = 0;
+
+    if (arena == NULL || pOffsetOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_arena_state* pArena = (drshm_arena_state*)arena;
+
+    if (sizeInBytes > pArena->dataSize) {
+        return dripc_result_too_large;
+    }
+
+    uint32_t sizeClass = DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT;
+    while (((size_t)1 << sizeClass) < sizeInBytes) {
+        sizeClass += 1;
+    }
+
+    size_t blockSize = (size_t)1 << sizeClass;
+    if (blockSize > pArena->dataSize) {
+        return dripc_result_too_large;  // It would fit if it wasn't rounded up to a power of 2, but it is.
+    }
+
+    uint32_t index = drshm_arena_pop(pArena, sizeClass);
+    if (index == 0) {
+        // The free list is empty so carve up some new pages.
+        uint64_t pageCount = (sizeClass > pArena->pageShift) ? ((uint64_t)1 << (sizeClass - pArena->pageShift)) : 1;
+        uint64_t page = drshm_arena_take_pages(pArena, pageCount);
+        if (page == (uint64_t)-1) {
+            return dripc_result_out_of_memory;
+        }
+
+        pArena->pPageClasses[page] = (uint8_t)sizeClass;
+
+        index = (uint32_t)((page << pArena->pageShift) >> DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT) + 1;
+
+        // The first block is the one being returned. The rest of them go on the free list.
+        if (sizeClass < pArena->pageShift) {
+            uint32_t blocksPerPage = (uint32_t)1 << (pArena->pageShift - sizeClass);
+            uint32_t indexStride   = (uint32_t)1 << (sizeClass - DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT);
+
+            uint32_t iBlock;
+            for (iBlock = 1; iBlock < blocksPerPage - 1; ++iBlock) {
+                *drshm_arena_get_block(pArena, index + iBlock*indexStride) = index + (iBlock+1)*indexStride;
             }
-        } else {
-            *pPipeOut = DR_IPC_WIN32_HANDLE_TO_PIPE(hPipeWin32);
-            break;
+
+            drshm_arena_push(pArena, sizeClass, index + indexStride, index + (blocksPerPage-1)*indexStride);
         }
     }
 
+    *pOffsetOut = (size_t)pArena->pHeader->dataOffset + ((size_t)(index - 1) << DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT);
     return dripc_result_success;
 }
 
-dripc_result drpipe_open_anonymous__win32(drpipe* pPipeRead, drpipe* pPipeWrite)
+dripc_result drshm_arena_free(drshm_arena arena, size_t offset)
 {
-    HANDLE hPipeReadWin32;
-    HANDLE hPipeWriteWin32;
-    if (!CreatePipe(&hPipeReadWin32, &hPipeWriteWin32, NULL, DR_IPC_WIN32_PIPE_BUFFER_SIZE)) {
-        return dripc_result_from_win32_error(GetLastError());
+    if (arena == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_arena_state* pArena = (drshm_arena_state*)arena;
+
+    // Anything that doesn't look like the start of a block is rejected rather than corrupting a free list.
+    size_t dataOffset = (size_t)pArena->pHeader->dataOffset;
+    if (offset < dataOffset || offset - dataOffset >= pArena->dataSize) {
+        return dripc_result_invalid_args;
+    }
+
+    size_t blockOffset = offset - dataOffset;
+    uint32_t sizeClass = pArena->pPageClasses[blockOffset >> pArena->pageShift];
+    if (sizeClass == 0 || (blockOffset & (((size_t)1 << sizeClass) - 1) & (((size_t)1 << pArena->pageShift) - 1)) != 0) {
+        return dripc_result_invalid_args;
     }
 
-    *pPipeRead = DR_IPC_WIN32_HANDLE_TO_PIPE(hPipeReadWin32);
-    *pPipeWrite = DR_IPC_WIN32_HANDLE_TO_PIPE(hPipeWriteWin32);
+    uint32_t index = (uint32_t)(blockOffset >> DR_IPC_SHM_ARENA_MIN_BLOCK_SHIFT) + 1;
+    drshm_arena_push(pArena, sizeClass, index, index);
+
     return dripc_result_success;
 }
 
-void drpipe_close__win32(drpipe pipe)
+void* drshm_arena_get_pointer(drshm_arena arena, size_t offset)
 {
-    CloseHandle(DR_IPC_PIPE_TO_WIN32_HANDLE(pipe));
-}
+    if (arena == NULL) {
+        return NULL;
+    }
 
+    drshm_arena_state* pArena = (drshm_arena_state*)arena;
 
-dripc_result drpipe_connect__win32(drpipe pipe)
+    size_t dataOffset = (size_t)pArena->pHeader->dataOffset;
+    if (offset < dataOffset || offset - dataOffset >= pArena->dataSize) {
+        return NULL;
+    }
+
+    return (unsigned char*)pArena->shm.pData + offset;
+}
+
+size_t drshm_arena_get_offset(drshm_arena arena, const void* pData)
 {
-    if (!ConnectNamedPipe(pipe, NULL)) {
-        return dripc_result_from_win32_error(GetLastError());
+    if (arena == NULL || pData == NULL) {
+        return 0;
     }
 
-    return dripc_result_success;
+    drshm_arena_state* pArena = (drshm_arena_state*)arena;
+
+    const unsigned char* pBytes = (const unsigned char*)pData;
+    if (pBytes < pArena->pData || pBytes >= pArena->pData + pArena->dataSize) {
+        return 0;
+    }
+
+    return (size_t)(pBytes - (const unsigned char*)pArena->shm.pData);
 }
 
 
-dripc_result drpipe_read__win32(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+#define DR_IPC_SHM_BROADCAST_MAGIC      0x54534342  // "BCST"
+
+// The layout of the header at the start of a broadcast channel's shared memory. Message n lives in slot n & slotMask.
+// Each slot is guarded by its own sequence lock: the writer sets the slot's sequence to 2n+1 while it's writing message
+// n and to 2n+2 once it's done. A reader looking for message n copies the slot out between two reads of the sequence
+// and keeps the copy only if both were 2n+2. A sequence that's ahead of that means the writer has lapped the reader.
+//
+// Readers never write to the shared memory except to register themselves as waiting, so the writer's cost doesn't
+// depend on how many of them there are. The not-empty word is an event counter that works like the ones in
+// drshm_queue_header.
+typedef struct
 {
-    HANDLE hPipe = DR_IPC_PIPE_TO_WIN32_HANDLE(pipe);
+    volatile uint32_t magic;            // Set last by the server once the rest of the header has been initialized.
+    uint32_t slotSize;                  // The maximum size of a message.
+    uint64_t slotCount;                 // Always a power of 2.
+    uint64_t slotStride;                // The distance between slots, rounded up to a whole number of cache lines.
+    uint8_t pad0[DR_IPC_CACHE_LINE_SIZE - 24];
+    volatile uint64_t writePos;         // The number of messages that have been published.
+    uint8_t pad1[DR_IPC_CACHE_LINE_SIZE - 8];
+    volatile uint32_t notEmpty;
+    volatile uint32_t readersWaiting;
+    uint8_t pad2[DR_IPC_CACHE_LINE_SIZE - 8];
+} drshm_broadcast_header;
 
-    DWORD dwBytesRead;
-    if (!ReadFile(hPipe, pDataOut, (DWORD)bytesToRead, &dwBytesRead, NULL)) {
-        return dripc_result_from_win32_error(GetLastError());
+typedef struct
+{
+    volatile uint64_t sequence;
+    volatile uint32_t size;
+    uint32_t reserved;
+} drshm_broadcast_slot;
+
+typedef struct
+{
+    dripc_shm shm;
+    drshm_broadcast_header* pHeader;
+    unsigned char* pSlots;
+    uint64_t slotMask;
+    uint64_t slotStride;
+    uint32_t slotSize;
+    uint64_t readPos;                   // The next message this reader will receive. Private to this process.
+    uint64_t messagesLost;
+} drshm_broadcast_state;
+
+static drshm_broadcast_slot* drshm_broadcast_get_slot(drshm_broadcast_state* pBroadcast, uint64_t pos)
+{
+    return (drshm_broadcast_slot*)(pBroadcast->pSlots + (size_t)((pos & pBroadcast->slotMask) * pBroadcast->slotStride));
+}
+
+static drshm_broadcast_state* drshm_broadcast_create_state(const dripc_shm* pShm)
+{
+    drshm_broadcast_state* pBroadcast = (drshm_broadcast_state*)calloc(1, sizeof(*pBroadcast));
+    if (pBroadcast == NULL) {
+        return NULL;
+    }
+
+    pBroadcast->shm = *pShm;
+    pBroadcast->pHeader = (drshm_broadcast_header*)pShm->pData;
+    pBroadcast->pSlots = (unsigned char*)pShm->pData + sizeof(drshm_broadcast_header);
+    pBroadcast->slotMask = pBroadcast->pHeader->slotCount - 1;
+    pBroadcast->slotStride = pBroadcast->pHeader->slotStride;
+    pBroadcast->slotSize = pBroadcast->pHeader->slotSize;
+    pBroadcast->readPos = dripc_atomic_load_u64(&pBroadcast->pHeader->writePos);
+
+    return pBroadcast;
+}
+
+dripc_result drshm_broadcast_open_named_server(const char* name, size_t slotSize, size_t slotCount, drshm_broadcast* pBroadcastOut)
+{
+    if (pBroadcastOut == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    *pBroadcastOut = NULL;
+
+    if (name == NULL || slotSize == 0 || slotSize > 0x7FFFFFFF || slotCount == 0 || slotCount > ((uint64_t)1 << 32)) {
+        return dripc_result_invalid_args;
+    }
+
+    uint64_t slotCount64 = 2;
+    while (slotCount64 < (uint64_t)slotCount) {
+        slotCount64 <<= 1;
+    }
+
+    uint64_t slotStride = (sizeof(drshm_broadcast_slot) + (uint64_t)slotSize + DR_IPC_CACHE_LINE_SIZE-1) & ~(uint64_t)(DR_IPC_CACHE_LINE_SIZE-1);
+    if (slotStride > (((uint64_t)((size_t)-1) - sizeof(drshm_broadcast_header)) / slotCount64)) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_create(name, sizeof(drshm_broadcast_header) + (size_t)(slotStride * slotCount64), &shm);
+    if (result != dripc_result_success) {
+        return result;
     }
 
-    *pBytesRead = dwBytesRead;
+    // Every slot starts out with a sequence of 0 which is behind every message, so the freshly zeroed memory is fine.
+    drshm_broadcast_header* pHeader = (drshm_broadcast_header*)shm.pData;
+    pHeader->slotSize = (uint32_t)slotSize;
+    pHeader->slotCount = slotCount64;
+    pHeader->slotStride = slotStride;
+    pHeader->writePos = 0;
+    pHeader->notEmpty = 0;
+    pHeader->readersWaiting = 0;
+
+    dripc_atomic_store_u32(&pHeader->magic, DR_IPC_SHM_BROADCAST_MAGIC);
+
+    drshm_broadcast_state* pBroadcast = drshm_broadcast_create_state(&shm);
+    if (pBroadcast == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pBroadcastOut = (drshm_broadcast)pBroadcast;
     return dripc_result_success;
 }
 
-dripc_result drpipe_write__win32(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+dripc_result drshm_broadcast_open_named_client(const char* name, drshm_broadcast* pBroadcastOut)
 {
-    HANDLE hPipe = DR_IPC_PIPE_TO_WIN32_HANDLE(pipe);
+    if (pBroadcastOut == NULL) {
+        return dripc_result_invalid_args;
+    }
 
-    DWORD dwBytesWritten;
-    if (!WriteFile(hPipe, pData, (DWORD)bytesToWrite, &dwBytesWritten, NULL)) {
-        return dripc_result_from_win32_error(GetLastError());
+    *pBroadcastOut = NULL;
+
+    if (name == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    dripc_shm shm;
+    dripc_result result = dripc_shm_open(name, &shm);
+    if (result != dripc_result_success) {
+        return result;
+    }
+
+    drshm_broadcast_header* pHeader = (drshm_broadcast_header*)shm.pData;
+    if (shm.sizeInBytes < sizeof(*pHeader) || dripc_atomic_load_u32(&pHeader->magic) != DR_IPC_SHM_BROADCAST_MAGIC ||
+        pHeader->slotCount < 2 || (pHeader->slotCount & (pHeader->slotCount - 1)) != 0 || pHeader->slotStride < sizeof(drshm_broadcast_slot) + pHeader->slotSize ||
+        pHeader->slotStride > (shm.sizeInBytes - sizeof(*pHeader)) / pHeader->slotCount) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
     }
 
-    *pBytesWritten = dwBytesWritten;
+    drshm_broadcast_state* pBroadcast = drshm_broadcast_create_state(&shm);
+    if (pBroadcast == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
+    }
+
+    *pBroadcastOut = (drshm_broadcast)pBroadcast;
     return dripc_result_success;
 }
 
-size_t drpipe_get_translated_name__win32(const char* name, char* nameOut, size_t nameOutSize)
+void drshm_broadcast_close(drshm_broadcast broadcast)
 {
-    if (nameOut != NULL && nameOutSize == 0) {
+    if (broadcast == NULL) {
+        return;
+    }
+
+    drshm_broadcast_state* pBroadcast = (drshm_broadcast_state*)broadcast;
+    dripc_shm_close(&pBroadcast->shm);
+    free(pBroadcast);
+}
+
+size_t drshm_broadcast_get_slot_size(drshm_broadcast broadcast)
+{
+    if (broadcast == NULL) {
         return 0;
     }
 
-    char nameWin32[256] = DR_IPC_WIN32_PIPE_NAME_HEAD;
-    if (strcat_s(nameWin32, sizeof(nameWin32), name) != 0) {
-        return dripc_result_name_too_long;
+    return ((drshm_broadcast_state*)broadcast)->slotSize;
+}
+
+dripc_result drshm_broadcast_publish(drshm_broadcast broadcast, const void* pData, size_t sizeInBytes)
+{
+    if (broadcast == NULL || (pData == NULL && sizeInBytes > 0)) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_broadcast_state* pBroadcast = (drshm_broadcast_state*)broadcast;
+    drshm_broadcast_header* pHeader = pBroadcast->pHeader;
+    if (!pBroadcast->shm.isOwner) {
+        return dripc_result_invalid_args;
+    }
+    if (sizeInBytes > pBroadcast->slotSize) {
+        return dripc_result_too_large;
+    }
+
+    // Only the server writes to writePos so it can't have changed since the last publish.
+    uint64_t pos = pHeader->writePos;
+    drshm_broadcast_slot* pSlot = drshm_broadcast_get_slot(pBroadcast, pos);
+
+    // The fence keeps the odd sequence ahead of the new contents so a reader can't see the new contents with the old
+    // sequence.
+    dripc_atomic_store_u64(&pSlot->sequence, pos*2 + 1);
+    dripc_atomic_fence();
+
+    pSlot->size = (uint32_t)sizeInBytes;
+    if (sizeInBytes > 0) {
+        memcpy(pSlot + 1, pData, sizeInBytes);
+    }
+
+    dripc_atomic_store_u64(&pSlot->sequence, pos*2 + 2);
+    dripc_atomic_store_u64(&pHeader->writePos, pos + 1);
+    drshm_queue_signal(&pHeader->notEmpty, &pHeader->readersWaiting);
+
+    return dripc_result_success;
+}
+
+dripc_result drshm_broadcast_try_receive(drshm_broadcast broadcast, void* pDataOut, size_t bufferSize, size_t* pMessageSize)
+{
+    if (pMessageSize) *pMessageSize = 0;
+
+    if (broadcast == NULL || (pDataOut == NULL && bufferSize > 0) || pMessageSize == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_broadcast_state* pBroadcast = (drshm_broadcast_state*)broadcast;
+    uint64_t pos = pBroadcast->readPos;
+    uint64_t expectedSequence = pos*2 + 2;
+    drshm_broadcast_slot* pSlot = drshm_broadcast_get_slot(pBroadcast, pos);
+
+    uint64_t sequence = dripc_atomic_load_u64(&pSlot->sequence);
+    if (sequence == expectedSequence) {
+        // The size can be torn by the writer coming round again. That's caught by the second read of the sequence, but
+        // it still needs to be clamped so the copy stays inside the slot.
+        size_t size = pSlot->size;
+        if (size > pBroadcast->slotSize) {
+            size = pBroadcast->slotSize;
+        }
+
+        if (size <= bufferSize && size > 0) {
+            memcpy(pDataOut, pSlot + 1, size);
+        }
+
+        dripc_atomic_fence();
+        if (dripc_atomic_load_u64(&pSlot->sequence) == expectedSequence) {
+            *pMessageSize = size;
+            if (size > bufferSize) {
+                return dripc_result_too_large;
+            }
+
+            pBroadcast->readPos = pos + 1;
+            return dripc_result_success;
+        }
+    } else if ((int64_t)(sequence - expectedSequence) < 0) {
+        return dripc_result_would_block;    // Not published yet, or being written for the first time.
+    }
+
+    // The writer has lapped us. Skip ahead far enough that there's some room before it laps us again.
+    uint64_t writePos = dripc_atomic_load_u64(&pBroadcast->pHeader->writePos);
+    uint64_t newPos = writePos - (pBroadcast->slotMask + 1)/2;
+    pBroadcast->messagesLost += newPos - pos;
+    pBroadcast->readPos = newPos;
+
+    return dripc_result_overrun;
+}
+
+dripc_result drshm_broadcast_receive(drshm_broadcast broadcast, void* pDataOut, size_t bufferSize, size_t* pMessageSize)
+{
+    unsigned int iSpin = 0;
+    for (;;) {
+        dripc_result result = drshm_broadcast_try_receive(broadcast, pDataOut, bufferSize, pMessageSize);
+        if (result != dripc_result_would_block) {
+            return result;
+        }
+
+        if (iSpin < DR_IPC_SHM_SPIN_COUNT) {
+            iSpin += 1;
+            dripc_cpu_pause();
+            continue;
+        }
+
+        drshm_broadcast_header* pHeader = ((drshm_broadcast_state*)broadcast)->pHeader;
+        uint32_t event = dripc_atomic_load_u32(&pHeader->notEmpty);
+        dripc_atomic_fetch_add_u32(&pHeader->readersWaiting, 1);
+        dripc_atomic_fence();
+
+        result = drshm_broadcast_try_receive(broadcast, pDataOut, bufferSize, pMessageSize);
+        if (result == dripc_result_would_block) {
+            dripc_futex_wait(&pHeader->notEmpty, event);
+        }
+
+        dripc_atomic_fetch_add_u32(&pHeader->readersWaiting, (uint32_t)-1);
+
+        if (result != dripc_result_would_block) {
+            return result;
+        }
     }
+}
 
-    if (nameOut != NULL) {
-        strcpy_s(nameOut, nameOutSize, nameWin32);
+unsigned long long drshm_broadcast_get_messages_lost(drshm_broadcast broadcast)
+{
+    if (broadcast == NULL) {
+        return 0;
     }
 
-    return strlen(nameWin32);
+    return ((drshm_broadcast_state*)broadcast)->messagesLost;
 }
-#endif  // Win32
-
 
-///////////////////////////////////////////////////////////////////////////////
-//
-// Unix Implementation
-//
-///////////////////////////////////////////////////////////////////////////////
-#ifdef DR_IPC_UNIX
 
-#ifndef DR_IPC_UNIX_PIPE_NAME_HEAD
-#define DR_IPC_UNIX_PIPE_NAME_HEAD  "/tmp/"
-#endif
+#define DR_IPC_SHM_LATEST_MAGIC         0x5453544C  // "LTST"
 
-#define DR_IPC_UNIX_SERVER          (1 << 31)
-#define DR_IPC_UNIX_CLIENT          (1 << 30)
+// The layout of the header at the start of a latest-value channel's shared memory. It's followed by two slots. Version
+// v is written to slot v & 1, so the writer is always filling in the slot that readers aren't being pointed at and a
+// reader is only ever overtaken if two whole values are published while it's copying.
+//
+// Each slot is guarded by a sequence lock in the same way as drshm_broadcast_slot: the writer sets the sequence to 2v-1
+// while it's writing version v and to 2v once it's done, and only then sets the header's version to v. A reader loads
+// the version, copies the slot out between two reads of the sequence, and keeps the copy only if both were 2v.
+typedef struct
+{
+    volatile uint32_t magic;            // Set last by the server once the rest of the header has been initialized.
+    uint32_t maxValueSize;
+    uint64_t slotStride;                // The distance between slots, rounded up to a whole number of cache lines.
+    uint8_t pad0[DR_IPC_CACHE_LINE_SIZE - 16];
+    volatile uint64_t version;          // The number of values that have been published.
+    uint8_t pad1[DR_IPC_CACHE_LINE_SIZE - 8];
+} drshm_latest_header;
 
 typedef struct
 {
-    int fd;
-    unsigned int options;
-    char name[1];
-} drpipe_unix;
+    volatile uint64_t sequence;
+    volatile uint32_t size;
+    uint32_t reserved;
+} drshm_latest_slot;
 
-static dripc_result dripc_result_from_unix_error(int error)
+typedef struct
 {
-    switch (error)
-    {
-    default: return dripc_result_unknown_error;
-    }
+    dripc_shm shm;
+    drshm_latest_header* pHeader;
+    unsigned char* pSlots;
+    uint64_t slotStride;
+    uint32_t maxValueSize;
+} drshm_latest_state;
+
+static drshm_latest_slot* drshm_latest_get_slot(drshm_latest_state* pLatest, uint64_t version)
+{
+    return (drshm_latest_slot*)(pLatest->pSlots + (size_t)((version & 1) * pLatest->slotStride));
 }
 
-static int dripc_options_to_fd_open_flags(unsigned int options)
+static drshm_latest_state* drshm_latest_create_state(const dripc_shm* pShm)
 {
-    int flags = 0;
-    if (options & DR_IPC_READ) {
-        if (options & DR_IPC_WRITE) {
-            flags |= O_RDWR;
-        } else {
-            flags |= O_RDONLY;
-        }
-    } else {
-        if (options & DR_IPC_WRITE) {
-            flags |= O_WRONLY;
-        } else {
-            return dripc_result_invalid_args;   // Neither read nor write mode was specified.
-        }
+    drshm_latest_state* pLatest = (drshm_latest_state*)calloc(1, sizeof(*pLatest));
+    if (pLatest == NULL) {
+        return NULL;
     }
 
-    return flags;
+    pLatest->shm = *pShm;
+    pLatest->pHeader = (drshm_latest_header*)pShm->pData;
+    pLatest->pSlots = (unsigned char*)pShm->pData + sizeof(drshm_latest_header);
+    pLatest->slotStride = pLatest->pHeader->slotStride;
+    pLatest->maxValueSize = pLatest->pHeader->maxValueSize;
+
+    return pLatest;
 }
 
-dripc_result drpipe_open_named_server__unix(const char* name, unsigned int options, drpipe* pPipeOut)
+dripc_result drshm_latest_open_named_server(const char* name, size_t maxValueSize, drshm_latest* pLatestOut)
 {
-    char nameUnix[512];
-    if (drpipe_get_translated_name(name, nameUnix, sizeof(nameUnix)) == 0) {
-        return dripc_result_name_too_long;
+    if (pLatestOut == NULL) {
+        return dripc_result_invalid_args;
     }
 
-    if (mkfifo(nameUnix, 0666) == -1) {
-        return dripc_result_from_unix_error(errno);
+    *pLatestOut = NULL;
+
+    if (name == NULL || maxValueSize == 0 || maxValueSize > 0x7FFFFFFF) {
+        return dripc_result_invalid_args;
     }
 
+    uint64_t slotStride = (sizeof(drshm_latest_slot) + (uint64_t)maxValueSize + DR_IPC_CACHE_LINE_SIZE-1) & ~(uint64_t)(DR_IPC_CACHE_LINE_SIZE-1);
+    if (slotStride > (((uint64_t)((size_t)-1) - sizeof(drshm_latest_header)) / 2)) {
+        return dripc_result_invalid_args;
+    }
 
-    drpipe_unix* pPipeUnix = (drpipe_unix*)malloc(sizeof(*pPipeUnix) + strlen(nameUnix)+1);     // +1 for null terminator.
-    if (pPipeUnix == NULL) {
-        return dripc_result_unknown_error;
+    dripc_shm shm;
+    dripc_result result = dripc_shm_create(name, sizeof(drshm_latest_header) + (size_t)(slotStride * 2), &shm);
+    if (result != dripc_result_success) {
+        return result;
     }
 
-    pPipeUnix->options = options | DR_IPC_UNIX_SERVER;
-    strcpy(pPipeUnix->name, nameUnix);
+    // A version of 0 means nothing has been published, and both slots start out with a sequence of 0 which doesn't
+    // match any version, so the freshly zeroed memory is fine.
+    drshm_latest_header* pHeader = (drshm_latest_header*)shm.pData;
+    pHeader->maxValueSize = (uint32_t)maxValueSize;
+    pHeader->slotStride = slotStride;
+    pHeader->version = 0;
 
+    dripc_atomic_store_u32(&pHeader->magic, DR_IPC_SHM_LATEST_MAGIC);
 
-    // Wait for a client to connect...
-    pPipeUnix->fd = open(pPipeUnix->name, dripc_options_to_fd_open_flags(pPipeUnix->options));
-    if (pPipeUnix->fd == -1) {
-        return dripc_result_from_unix_error(errno);
+    drshm_latest_state* pLatest = drshm_latest_create_state(&shm);
+    if (pLatest == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
     }
 
-
-    *pPipeOut = (drpipe)pPipeUnix;
+    *pLatestOut = (drshm_latest)pLatest;
     return dripc_result_success;
 }
 
-dripc_result drpipe_open_named_client__unix(const char* name, unsigned int options, drpipe* pPipeOut)
+dripc_result drshm_latest_open_named_client(const char* name, drshm_latest* pLatestOut)
 {
-    char nameUnix[512];
-    if (drpipe_get_translated_name(name, nameUnix, sizeof(nameUnix)) == 0) {
-        return dripc_result_name_too_long;
-    }
-
-    drpipe_unix* pPipeUnix = (drpipe_unix*)malloc(sizeof(*pPipeUnix) + strlen(nameUnix)+1);     // +1 for null terminator.
-    if (pPipeUnix == NULL) {
-        return dripc_result_unknown_error;
+    if (pLatestOut == NULL) {
+        return dripc_result_invalid_args;
     }
 
-    pPipeUnix->options = options | DR_IPC_UNIX_CLIENT;
-    strcpy(pPipeUnix->name, nameUnix);
+    *pLatestOut = NULL;
 
-    pPipeUnix->fd = open(nameUnix, dripc_options_to_fd_open_flags(options));
-    if (pPipeUnix->fd == -1) {
-        free(pPipeUnix);
-        return dripc_result_from_unix_error(errno);
+    if (name == NULL) {
+        return dripc_result_invalid_args;
     }
 
-
-    *pPipeOut = (drpipe)pPipeUnix;
-    return dripc_result_success;
-}
-
-dripc_result drpipe_open_anonymous__unix(drpipe* pPipeRead, drpipe* pPipeWrite)
-{
-    drpipe_unix* pPipeReadUnix = (drpipe_unix*)calloc(1, sizeof(*pPipeReadUnix) + 1);
-    if (pPipeReadUnix == NULL) {
-        return dripc_result_unknown_error;
+    dripc_shm shm;
+    dripc_result result = dripc_shm_open(name, &shm);
+    if (result != dripc_result_success) {
+        return result;
     }
 
-    drpipe_unix* pPipeWriteUnix = (drpipe_unix*)calloc(1, sizeof(*pPipeWriteUnix) + 1);
-    if (pPipeWriteUnix == NULL) {
-        free(pPipeReadUnix);
+    drshm_latest_header* pHeader = (drshm_latest_header*)shm.pData;
+    if (shm.sizeInBytes < sizeof(*pHeader) || dripc_atomic_load_u32(&pHeader->magic) != DR_IPC_SHM_LATEST_MAGIC ||
+        pHeader->slotStride < sizeof(drshm_latest_slot) + pHeader->maxValueSize || pHeader->slotStride > (shm.sizeInBytes - sizeof(*pHeader)) / 2) {
+        dripc_shm_close(&shm);
         return dripc_result_unknown_error;
     }
 
-    int pipeFDs[2];
-    if (pipe(pipeFDs) == -1) {
-        free(pPipeWriteUnix);
-        free(pPipeReadUnix);
-        return dripc_result_from_unix_error(errno);
+    drshm_latest_state* pLatest = drshm_latest_create_state(&shm);
+    if (pLatest == NULL) {
+        dripc_shm_close(&shm);
+        return dripc_result_unknown_error;
     }
 
-    pPipeReadUnix->fd  = pipeFDs[0];
-    pPipeWriteUnix->fd = pipeFDs[1];
-
-    *pPipeRead = pPipeReadUnix;
-    *pPipeWrite = pPipeWriteUnix;
-
+    *pLatestOut = (drshm_latest)pLatest;
     return dripc_result_success;
 }
 
-void drpipe_close__unix(drpipe pipe)
+void drshm_latest_close(drshm_latest latest)
 {
-    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
-
-    if (pPipeUnix->fd != -1) {
-        close(pPipeUnix->fd);
+    if (latest == NULL) {
+        return;
     }
 
-    if (pPipeUnix->options & DR_IPC_UNIX_SERVER) {
-        unlink(pPipeUnix->name);
-    }
+    drshm_latest_state* pLatest = (drshm_latest_state*)latest;
+    dripc_shm_close(&pLatest->shm);
+    free(pLatest);
 }
 
-
-dripc_result drpipe_read__unix(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+size_t drshm_latest_get_max_size(drshm_latest latest)
 {
-    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
-
-    ssize_t bytesRead = read(pPipeUnix->fd, pDataOut, bytesToRead);
-    if (bytesRead == -1) {
-        return dripc_result_from_unix_error(errno);
+    if (latest == NULL) {
+        return 0;
     }
 
-    *pBytesRead = (size_t)bytesRead;
-    return dripc_result_success;
+    return ((drshm_latest_state*)latest)->maxValueSize;
 }
 
-dripc_result drpipe_write__unix(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+dripc_result drshm_latest_publish(drshm_latest latest, const void* pData, size_t sizeInBytes)
 {
-    drpipe_unix* pPipeUnix = (drpipe_unix*)pipe;
+    if (latest == NULL || (pData == NULL && sizeInBytes > 0)) {
+        return dripc_result_invalid_args;
+    }
 
-    ssize_t bytesWritten = write(pPipeUnix->fd, pData, bytesToWrite);
-    if (bytesWritten == -1) {
-        return dripc_result_from_unix_error(errno);
+    drshm_latest_state* pLatest = (drshm_latest_state*)latest;
+    drshm_latest_header* pHeader = pLatest->pHeader;
+    if (!pLatest->shm.isOwner) {
+        return dripc_result_invalid_args;
+    }
+    if (sizeInBytes > pLatest->maxValueSize) {
+        return dripc_result_too_large;
     }
 
-    *pBytesWritten = (size_t)bytesWritten;
-    return dripc_result_success;
-}
+    // Only the server writes to the version so it can't have changed since the last publish.
+    uint64_t version = pHeader->version + 1;
+    drshm_latest_slot* pSlot = drshm_latest_get_slot(pLatest, version);
 
-size_t drpipe_get_translated_name__unix(const char* name, char* nameOut, size_t nameOutSize)
-{
-    if (nameOut != NULL && nameOutSize == 0) {
-        return 0;
-    }
+    dripc_atomic_store_u64(&pSlot->sequence, version*2 - 1);
+    dripc_atomic_fence();
 
-    char nameUnix[512];
-    if (strcpy_s(nameUnix, sizeof(nameUnix), DR_IPC_UNIX_PIPE_NAME_HEAD) != 0) {
-        return 0;
-    }
-    if (strcat_s(nameUnix, sizeof(nameUnix), name) != 0) {
-        return 0;
+    pSlot->size = (uint32_t)sizeInBytes;
+    if (sizeInBytes > 0) {
+        memcpy(pSlot + 1, pData, sizeInBytes);
     }
 
-    if (strcpy_s(nameOut, nameOutSize, nameUnix) != 0) {
-        return 0;
-    }
+    dripc_atomic_store_u64(&pSlot->sequence, version*2);
+    dripc_atomic_store_u64(&pHeader->version, version);
 
-    return strlen(nameUnix);
+    return dripc_result_success;
 }
-#endif  // Unix
 
-dripc_result drpipe_open_named_server(const char* name, unsigned int options, drpipe* pPipeOut)
+dripc_result drshm_latest_read(drshm_latest latest, void* pDataOut, size_t bufferSize, size_t* pValueSize, unsigned long long* pVersion)
 {
-    if (name == NULL || options == 0 || pPipeOut == NULL) {
+    if (pValueSize) *pValueSize = 0;
+    if (pVersion)   *pVersion   = 0;
+
+    if (latest == NULL || (pDataOut == NULL && bufferSize > 0) || pValueSize == NULL) {
         return dripc_result_invalid_args;
     }
 
-    *pPipeOut = NULL;
+    drshm_latest_state* pLatest = (drshm_latest_state*)latest;
+    for (;;) {
+        uint64_t version = dripc_atomic_load_u64(&pLatest->pHeader->version);
+        if (version == 0) {
+            return dripc_result_would_block;
+        }
 
+        drshm_latest_slot* pSlot = drshm_latest_get_slot(pLatest, version);
+        uint64_t expectedSequence = version*2;
 
-#ifdef DR_IPC_WIN32
-    return drpipe_open_named_server__win32(name, options, pPipeOut);
-#endif
+        if (dripc_atomic_load_u64(&pSlot->sequence) == expectedSequence) {
+            // As with broadcasts, the size can be torn if the writer gets round to this slot again mid-copy. The second
+            // read of the sequence catches that, but the copy still needs to stay inside the slot.
+            size_t size = pSlot->size;
+            if (size > pLatest->maxValueSize) {
+                size = pLatest->maxValueSize;
+            }
 
-#ifdef DR_IPC_UNIX
-    return drpipe_open_named_server__unix(name, options, pPipeOut);
-#endif
+            if (size <= bufferSize && size > 0) {
+                memcpy(pDataOut, pSlot + 1, size);
+            }
+
+            dripc_atomic_fence();
+            if (dripc_atomic_load_u64(&pSlot->sequence) == expectedSequence) {
+                *pValueSize = size;
+                if (pVersion) *pVersion = version;
+
+                if (size > bufferSize) {
+                    return dripc_result_too_large;
+                }
+
+                return dripc_result_success;
+            }
+        }
+
+        // The writer published twice while we were copying, so there's a newer value. Go again with that one.
+        dripc_cpu_pause();
+    }
 }
 
-dripc_result drpipe_open_named_client(const char* name, unsigned int options, drpipe* pPipeOut)
+unsigned long long drshm_latest_get_version(drshm_latest latest)
 {
-    if (name == NULL || options == 0 || pPipeOut == NULL) {
-        return dripc_result_invalid_args;
+    if (latest == NULL) {
+        return 0;
     }
 
-    *pPipeOut = NULL;
+    return dripc_atomic_load_u64(&((drshm_latest_state*)latest)->pHeader->version);
+}
 
 
-#ifdef DR_IPC_WIN32
-    return drpipe_open_named_client__win32(name, options, pPipeOut);
-#endif
+dripc_result drshm_region_open_named_server(const char* name, size_t sizeInBytes, const drshm_region_config* pConfig, drshm_region* pRegionOut)
+{
+    if (pRegionOut == NULL) {
+        return dripc_result_invalid_args;
+    }
 
-#ifdef DR_IPC_UNIX
-    return drpipe_open_named_client__unix(name, options, pPipeOut);
-#endif
-}
+    *pRegionOut = NULL;
 
-dripc_result drpipe_open_anonymous(drpipe* pPipeRead, drpipe* pPipeWrite)
-{
-    if (pPipeRead == NULL || pPipeWrite == NULL) {
+    if (name == NULL || sizeInBytes == 0) {
         return dripc_result_invalid_args;
     }
 
-    *pPipeRead = NULL;
-    *pPipeWrite = NULL;
+    drshm_region_config config = (pConfig != NULL) ? *pConfig : drshm_region_config_init(0);
 
+    drshm_region_state* pRegion = (drshm_region_state*)calloc(1, sizeof(*pRegion));
+    if (pRegion == NULL) {
+        return dripc_result_unknown_error;
+    }
 
+    dripc_result result;
 #ifdef DR_IPC_WIN32
-    return drpipe_open_anonymous__win32(pPipeRead, pPipeWrite);
+    result = drshm_region_open_named_server__win32(name, sizeInBytes, &config, pRegion);
 #endif
 
 #ifdef DR_IPC_UNIX
-    return drpipe_open_anonymous__unix(pPipeRead, pPipeWrite);
+    result = drshm_region_open_named_server__unix(name, sizeInBytes, &config, pRegion);
 #endif
-}
 
-void drpipe_close(drpipe pipe)
-{
-    if (pipe == NULL) {
-        return;
+    if (result != dripc_result_success) {
+        free(pRegion);
+        return result;
     }
 
-#ifdef DR_IPC_WIN32
-    drpipe_close__win32(pipe);
-#endif
-
-#ifdef DR_IPC_UNIX
-    drpipe_close__unix(pipe);
-#endif
+    *pRegionOut = (drshm_region)pRegion;
+    return dripc_result_success;
 }
 
-
-dripc_result drpipe_read(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
+dripc_result drshm_region_open_named_client(const char* name, const drshm_region_config* pConfig, drshm_region* pRegionOut)
 {
-    if (pBytesRead) *pBytesRead = 0;
-
-    if (pipe == NULL || pDataOut == NULL) {
+    if (pRegionOut == NULL) {
         return dripc_result_invalid_args;
     }
 
-    // Currently, reading is restricted to 2^31 bytes.
-    if (bytesToRead > 0x7FFFFFFF) {
+    *pRegionOut = NULL;
+
+    if (name == NULL) {
         return dripc_result_invalid_args;
     }
 
+    drshm_region_config config = (pConfig != NULL) ? *pConfig : drshm_region_config_init(0);
+
+    drshm_region_state* pRegion = (drshm_region_state*)calloc(1, sizeof(*pRegion));
+    if (pRegion == NULL) {
+        return dripc_result_unknown_error;
+    }
 
+    dripc_result result;
 #ifdef DR_IPC_WIN32
-    return drpipe_read__win32(pipe, pDataOut, bytesToRead, pBytesRead);
+    result = drshm_region_open_named_client__win32(name, &config, pRegion);
 #endif
 
 #ifdef DR_IPC_UNIX
-    return drpipe_read__unix(pipe, pDataOut, bytesToRead, pBytesRead);
+    result = drshm_region_open_named_client__unix(name, &config, pRegion);
 #endif
-}
-
-dripc_result drpipe_read_exact(drpipe pipe, void* pDataOut, size_t bytesToRead, size_t* pBytesRead)
-{
-    if (pBytesRead) *pBytesRead = 0;
-
-    while (bytesToRead > 0) {
-        size_t bytesRead;
-        dripc_result result = drpipe_read(pipe, pDataOut, (bytesToRead <= 0x7FFFFFFF) ? bytesToRead : 0x7FFFFFFF, &bytesRead);
-        if (result != dripc_result_success) {
-            return result;
-        }
 
-        pDataOut = (void*)((char*)pDataOut + bytesRead);
-
-        bytesToRead -= bytesRead;
-        if (pBytesRead) *pBytesRead += bytesRead;
+    if (result != dripc_result_success) {
+        free(pRegion);
+        return result;
     }
 
+    *pRegionOut = (drshm_region)pRegion;
     return dripc_result_success;
 }
 
-
-dripc_result drpipe_write(drpipe pipe, const void* pData, size_t bytesToWrite, size_t* pBytesWritten)
+void drshm_region_close(drshm_region region)
 {
-    if (pBytesWritten) *pBytesWritten = 0;
-
-    if (pipe == NULL || pData == NULL) {
-        return dripc_result_invalid_args;
-    }
-
-    // Currently, writing is restricted to 2^31 bytes.
-    if (bytesToWrite > 0x7FFFFFFF) {
-        return dripc_result_invalid_args;
+    if (region == NULL) {
+        return;
     }
 
+    drshm_region_state* pRegion = (drshm_region_state*)region;
 
 #ifdef DR_IPC_WIN32
-    return drpipe_write__win32(pipe, pData, bytesToWrite, pBytesWritten);
+    dripc_shm_close__win32(&pRegion->shm);
 #endif
 
 #ifdef DR_IPC_UNIX
-    return drpipe_write__unix(pipe, pData, bytesToWrite, pBytesWritten);
+    drshm_region_close__unix(pRegion);
 #endif
+
+    free(pRegion);
 }
 
+void* drshm_region_get_pointer(drshm_region region)
+{
+    if (region == NULL) {
+        return NULL;
+    }
+
+    return ((drshm_region_state*)region)->shm.pData;
+}
 
-size_t drpipe_get_translated_name(const char* name, char* nameOut, size_t nameOutSize)
+size_t drshm_region_get_size(drshm_region region)
 {
-    if (name == NULL) {
+    if (region == NULL) {
         return 0;
     }
 
+    return ((drshm_region_state*)region)->shm.sizeInBytes;
+}
+
+dripc_result drshm_region_get_info(drshm_region region, drshm_region_info* pInfo)
+{
+    if (pInfo) memset(pInfo, 0, sizeof(*pInfo));
+
+    if (region == NULL || pInfo == NULL) {
+        return dripc_result_invalid_args;
+    }
+
+    drshm_region_state* pRegion = (drshm_region_state*)region;
+
 #ifdef DR_IPC_WIN32
-    return drpipe_get_translated_name__win32(name, nameOut, nameOutSize);
+    pInfo->sizeInBytes = pRegion->shm.sizeInBytes;
+    pInfo->pageSize    = pRegion->pageSize;
+    pInfo->numaNode    = -1;
+    return dripc_result_success;
 #endif
 
 #ifdef DR_IPC_UNIX
-    return drpipe_get_translated_name__unix(name, nameOut, nameOutSize);
+    return drshm_region_get_info__unix(pRegion, pInfo);
 #endif
 }
 
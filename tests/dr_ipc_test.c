@@ -0,0 +1,1439 @@
+// Behaviour tests for dr_ipc. Public Domain. See "unlicense" statement at the end of dr_ipc.h.
+//
+// This is a standalone program. Build it with something like the following:
+//   cc -O2 -o dr_ipc_test tests/dr_ipc_test.c -lpthread
+//
+// Then run it with:
+//   ./dr_ipc_test [name...]
+//
+// Every test is run unless some names are given, in which case only the tests whose names start with one of them are
+// run. A line is written to stdout for each test and the exit code is the number of tests that failed. Named objects
+// are created under names starting with "dr_ipc_test_" and are removed again by each test that passes. Tests that use
+// more than one process fork() and run the other side in the child, which reports failure through its exit status.
+//
+// This is currently only supported on *nix platforms.
+#define DR_IPC_IMPLEMENTATION
+#include "../dr_ipc.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+// Fails the current test with the location and the condition that didn't hold.
+#define TEST_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            printf("    %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            return 1; \
+        } \
+    } while (0)
+
+typedef int (* test_proc)(void);
+
+typedef struct
+{
+    const char* name;
+    test_proc proc;
+} test_case;
+
+// Waits for a child created with fork() and returns whether or not it exited with a status of 0.
+static int test_wait_for_child(pid_t pid)
+{
+    int status;
+
+    if (waitpid(pid, &status, 0) != pid) {
+        return 0;
+    }
+
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// A cheap deterministic generator so that threads don't share the state of rand().
+static unsigned int test_next_random(unsigned int* pSeed)
+{
+    *pSeed = *pSeed*1103515245u + 12345u;
+    return *pSeed >> 16;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Sockets
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_SOCKET_MESSAGE_COUNT   500
+#define TEST_SOCKET_MAX_SIZE        100000
+
+static size_t test_socket_get_message_size(unsigned int index)
+{
+    return 1 + (size_t)((index*7919u) % TEST_SOCKET_MAX_SIZE);
+}
+
+static void test_socket_fill_message(unsigned char* pMessage, size_t size, unsigned int index)
+{
+    size_t i;
+    for (i = 0; i < size; ++i) {
+        pMessage[i] = (unsigned char)(index*13 + i);
+    }
+}
+
+// The client side, which runs in the child. Each message is sent and the echo compared against it before moving on.
+static int test_socket_client(void)
+{
+    drpipe client;
+    unsigned char* pSent     = (unsigned char*)malloc(TEST_SOCKET_MAX_SIZE);
+    unsigned char* pReceived = (unsigned char*)malloc(TEST_SOCKET_MAX_SIZE);
+    unsigned int index;
+
+    TEST_CHECK(pSent != NULL && pReceived != NULL);
+    TEST_CHECK(drsocket_connect("dr_ipc_test_socket", 0, &client) == dripc_result_success);
+
+    for (index = 0; index < TEST_SOCKET_MESSAGE_COUNT; ++index) {
+        dripc_buffer buffer;
+        size_t messageSize;
+
+        buffer.pData       = pSent;
+        buffer.sizeInBytes = test_socket_get_message_size(index);
+        test_socket_fill_message(pSent, buffer.sizeInBytes, index);
+        TEST_CHECK(drpipe_send_message(client, &buffer, 1) == dripc_result_success);
+
+        buffer.pData       = pReceived;
+        buffer.sizeInBytes = TEST_SOCKET_MAX_SIZE;
+        TEST_CHECK(drpipe_recv_message(client, &buffer, 1, &messageSize) == dripc_result_success);
+        TEST_CHECK(messageSize == test_socket_get_message_size(index));
+        TEST_CHECK(memcmp(pSent, pReceived, messageSize) == 0);
+    }
+
+    drpipe_close(client);
+    free(pSent);
+    free(pReceived);
+    return 0;
+}
+
+// A server and a client in two processes. The server echoes every message back, and once the client has gone the next
+// receive has to fail instead of blocking or returning an empty message.
+static int test_socket_echo(void)
+{
+    drsocket listener;
+    drpipe server;
+    unsigned char* pMessage = (unsigned char*)malloc(TEST_SOCKET_MAX_SIZE);
+    unsigned int index;
+    pid_t pid;
+
+    TEST_CHECK(pMessage != NULL);
+    TEST_CHECK(drsocket_listen("dr_ipc_test_socket", 0, 0, &listener) == dripc_result_success);
+
+    pid = fork();
+    TEST_CHECK(pid != -1);
+    if (pid == 0) {
+        _exit(test_socket_client());
+    }
+
+    TEST_CHECK(drsocket_accept(listener, 0, &server) == dripc_result_success);
+
+    for (index = 0; index < TEST_SOCKET_MESSAGE_COUNT; ++index) {
+        dripc_buffer buffer;
+        size_t messageSize;
+
+        buffer.pData       = pMessage;
+        buffer.sizeInBytes = TEST_SOCKET_MAX_SIZE;
+        TEST_CHECK(drpipe_recv_message(server, &buffer, 1, &messageSize) == dripc_result_success);
+
+        buffer.sizeInBytes = messageSize;
+        TEST_CHECK(drpipe_send_message(server, &buffer, 1) == dripc_result_success);
+    }
+
+    TEST_CHECK(test_wait_for_child(pid));
+
+    {
+        dripc_buffer buffer;
+        size_t messageSize;
+
+        buffer.pData       = pMessage;
+        buffer.sizeInBytes = TEST_SOCKET_MAX_SIZE;
+        TEST_CHECK(drpipe_recv_message(server, &buffer, 1, &messageSize) != dripc_result_success);
+    }
+
+    drpipe_close(server);
+    drsocket_close(listener);
+    free(pMessage);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Descriptor Passing
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Connects a client and a server socket to each other within this process.
+static int test_open_socket_pair(const char* name, drsocket* pListener, drpipe* pClient, drpipe* pServer)
+{
+    TEST_CHECK(drsocket_listen(name, 0, 0, pListener) == dripc_result_success);
+    TEST_CHECK(drsocket_connect(name, 0, pClient) == dripc_result_success);
+    TEST_CHECK(drsocket_accept(*pListener, 0, pServer) == dripc_result_success);
+    return 0;
+}
+
+// The read end of a pipe goes over a socket and the received descriptor has to be a working, close-on-exec copy of it.
+static int test_fd_passing(void)
+{
+    drsocket listener;
+    drpipe client;
+    drpipe server;
+    int pipeFDs[2];
+    int receivedFD;
+    char message[8];
+    char data[8];
+    dripc_buffer buffer;
+    size_t messageSize;
+
+    TEST_CHECK(test_open_socket_pair("dr_ipc_test_fd", &listener, &client, &server) == 0);
+    TEST_CHECK(pipe(pipeFDs) == 0);
+
+    memcpy(message, "pipe", 4);
+    buffer.pData       = message;
+    buffer.sizeInBytes = 4;
+    TEST_CHECK(dripc_send_fd(client, pipeFDs[0], &buffer, 1) == dripc_result_success);
+    close(pipeFDs[0]);
+
+    memset(message, 0, sizeof(message));
+    buffer.sizeInBytes = sizeof(message);
+    TEST_CHECK(dripc_recv_fd(server, &receivedFD, &buffer, 1, &messageSize) == dripc_result_success);
+    TEST_CHECK(receivedFD >= 0);
+    TEST_CHECK(messageSize == 4 && memcmp(message, "pipe", 4) == 0);
+    TEST_CHECK((fcntl(receivedFD, F_GETFD) & FD_CLOEXEC) != 0);
+
+    TEST_CHECK(write(pipeFDs[1], "hello", 5) == 5);
+    TEST_CHECK(read(receivedFD, data, sizeof(data)) == 5);
+    TEST_CHECK(memcmp(data, "hello", 5) == 0);
+
+    close(receivedFD);
+    close(pipeFDs[1]);
+    drpipe_close(client);
+    drpipe_close(server);
+    drsocket_close(listener);
+    return 0;
+}
+
+// When the receiver is out of descriptors the kernel drops the one being passed. That has to be reported as an error
+// rather than as a message without a descriptor, and the message after it has to be unaffected.
+static int test_fd_passing_truncated(void)
+{
+    drsocket listener;
+    drpipe client;
+    drpipe server;
+    int fd;
+    int probeFD;
+    int receivedFD = 0;
+    char message[8];
+    dripc_buffer buffer;
+    size_t messageSize;
+    struct rlimit oldLimit;
+    struct rlimit newLimit;
+    dripc_result result;
+
+    TEST_CHECK(test_open_socket_pair("dr_ipc_test_fd_truncated", &listener, &client, &server) == 0);
+
+    fd = open("/dev/null", O_RDONLY);
+    TEST_CHECK(fd != -1);
+
+    memcpy(message, "one", 3);
+    buffer.pData       = message;
+    buffer.sizeInBytes = 3;
+    TEST_CHECK(dripc_send_fd(client, fd, &buffer, 1) == dripc_result_success);
+    memcpy(message, "two", 3);
+    TEST_CHECK(dripc_send_fd(client, fd, &buffer, 1) == dripc_result_success);
+
+    // Lower the limit to the lowest free descriptor so that nothing new can be created.
+    TEST_CHECK(getrlimit(RLIMIT_NOFILE, &oldLimit) == 0);
+    probeFD = open("/dev/null", O_RDONLY);
+    TEST_CHECK(probeFD != -1);
+    close(probeFD);
+    newLimit = oldLimit;
+    newLimit.rlim_cur = (rlim_t)probeFD;
+    TEST_CHECK(setrlimit(RLIMIT_NOFILE, &newLimit) == 0);
+
+    buffer.sizeInBytes = sizeof(message);
+    result = dripc_recv_fd(server, &receivedFD, &buffer, 1, &messageSize);
+    TEST_CHECK(setrlimit(RLIMIT_NOFILE, &oldLimit) == 0);
+    TEST_CHECK(result == dripc_result_unknown_error);
+    TEST_CHECK(receivedFD == -1);
+
+    memset(message, 0, sizeof(message));
+    TEST_CHECK(dripc_recv_fd(server, &receivedFD, &buffer, 1, &messageSize) == dripc_result_success);
+    TEST_CHECK(receivedFD >= 0);
+    TEST_CHECK(messageSize == 3 && memcmp(message, "two", 3) == 0);
+
+    close(receivedFD);
+    close(fd);
+    drpipe_close(client);
+    drpipe_close(server);
+    drsocket_close(listener);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Named Pipes
+//
+///////////////////////////////////////////////////////////////////////////////
+typedef struct
+{
+    unsigned int delayBeforeOpen;       // In microseconds.
+    unsigned int delayBeforeWrite;      // In microseconds.
+    int result;
+} test_named_pipe_writer;
+
+static int test_named_pipe_write(test_named_pipe_writer* pWriter)
+{
+    drpipe client;
+    drpipe_config config;
+
+    usleep(pWriter->delayBeforeOpen);
+
+    config = drpipe_config_init(DR_IPC_WRITE);
+    config.timeoutInMilliseconds = 2000;
+    TEST_CHECK(drpipe_open_named_client_with_config("dr_ipc_test_timed", &config, &client) == dripc_result_success);
+
+    usleep(pWriter->delayBeforeWrite);
+    TEST_CHECK(drpipe_write(client, "hi", 2, NULL) == dripc_result_success);
+
+    drpipe_close(client);
+    return 0;
+}
+
+static void* test_named_pipe_writer_thread(void* pUserData)
+{
+    test_named_pipe_writer* pWriter = (test_named_pipe_writer*)pUserData;
+    pWriter->result = test_named_pipe_write(pWriter);
+    return NULL;
+}
+
+// A read-only server with a timeout is connected as soon as a writer opens the pipe, even if that writer doesn't write
+// anything until well after the timeout. With nobody opening the pipe at all it times out.
+static int test_named_pipe_timed_connect(void)
+{
+    drpipe server;
+    drpipe_config config;
+    test_named_pipe_writer writer;
+    pthread_t thread;
+    char data[2];
+    size_t bytesRead;
+
+    writer.delayBeforeOpen  = 50000;
+    writer.delayBeforeWrite = 400000;
+    writer.result           = 1;
+    TEST_CHECK(pthread_create(&thread, NULL, test_named_pipe_writer_thread, &writer) == 0);
+
+    config = drpipe_config_init(DR_IPC_READ);
+    config.timeoutInMilliseconds = 200;
+    TEST_CHECK(drpipe_open_named_server_with_config("dr_ipc_test_timed", &config, &server) == dripc_result_success);
+    TEST_CHECK(drpipe_read_exact(server, data, 2, &bytesRead) == dripc_result_success);
+    TEST_CHECK(bytesRead == 2 && memcmp(data, "hi", 2) == 0);
+
+    pthread_join(thread, NULL);
+    TEST_CHECK(writer.result == 0);
+    drpipe_close(server);
+
+    TEST_CHECK(drpipe_open_named_server_with_config("dr_ipc_test_timed", &config, &server) == dripc_result_timeout);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Batches
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Splitting a batch needs a read buffer, so without one this is refused. With one, every message that was written is
+// received in a single call, and one that doesn't fit its buffer is reported without disturbing the ones after it.
+static int test_read_batch(void)
+{
+    drpipe readPipe;
+    drpipe writePipe;
+    char sent[10][16];
+    char received[10][16];
+    dripc_message messages[12];
+    size_t messageCount;
+    size_t iMessage;
+
+    TEST_CHECK(drpipe_open_anonymous(&readPipe, &writePipe) == dripc_result_success);
+
+    messages[0].pData       = received[0];
+    messages[0].sizeInBytes = sizeof(received[0]);
+    TEST_CHECK(drpipe_read_batch(readPipe, messages, 1, &messageCount) == dripc_result_invalid_args);
+    TEST_CHECK(drpipe_enable_buffering(readPipe, 0, 0, 64*1024) == dripc_result_success);
+
+    for (iMessage = 0; iMessage < 10; ++iMessage) {
+        messages[iMessage].pData       = sent[iMessage];
+        messages[iMessage].sizeInBytes = (size_t)snprintf(sent[iMessage], sizeof(sent[iMessage]), "message %d", (int)iMessage);
+    }
+    TEST_CHECK(drpipe_write_batch(writePipe, messages, 10, &messageCount) == dripc_result_success);
+    TEST_CHECK(messageCount == 10);
+
+    for (iMessage = 0; iMessage < 12; ++iMessage) {
+        messages[iMessage].pData       = received[iMessage % 10];
+        messages[iMessage].sizeInBytes = (iMessage == 3) ? 4 : sizeof(received[0]);
+    }
+    TEST_CHECK(drpipe_read_batch(readPipe, messages, 12, &messageCount) == dripc_result_success);
+    TEST_CHECK(messageCount == 10);
+
+    for (iMessage = 0; iMessage < 10; ++iMessage) {
+        TEST_CHECK(messages[iMessage].messageSize == strlen(sent[iMessage]));
+        if (iMessage == 3) {
+            TEST_CHECK(messages[iMessage].result == dripc_result_too_large);
+        } else {
+            TEST_CHECK(messages[iMessage].result == dripc_result_success);
+            TEST_CHECK(memcmp(received[iMessage], sent[iMessage], messages[iMessage].messageSize) == 0);
+        }
+    }
+    TEST_CHECK(messages[10].result == dripc_result_would_block);
+
+    drpipe_close(readPipe);
+    drpipe_close(writePipe);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Multi-Writer Pipes
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_MW_MESSAGE_COUNT   2000
+#define TEST_MW_MAX_SIZE        20000
+
+typedef struct
+{
+    drpipe pipe;
+    unsigned int writerID;
+    dripc_result result;
+} test_mw_writer;
+
+// Every message is a writer ID and an index followed by a size and contents that are derived from both.
+static size_t test_mw_get_message_size(unsigned int writerID, unsigned int index)
+{
+    return 8 + (size_t)((writerID*7919u + index*104729u) % (TEST_MW_MAX_SIZE - 8));
+}
+
+static void test_mw_fill_message(unsigned char* pMessage, size_t size, unsigned int writerID, unsigned int index)
+{
+    size_t i;
+
+    memcpy(pMessage + 0, &writerID, 4);
+    memcpy(pMessage + 4, &index, 4);
+    for (i = 8; i < size; ++i) {
+        pMessage[i] = (unsigned char)(writerID*31 + index*17 + i);
+    }
+}
+
+static void* test_mw_writer_thread(void* pUserData)
+{
+    test_mw_writer* pWriter = (test_mw_writer*)pUserData;
+    unsigned char* pMessage = (unsigned char*)malloc(TEST_MW_MAX_SIZE);
+    unsigned int index;
+
+    pWriter->result = (pMessage != NULL) ? dripc_result_success : dripc_result_out_of_memory;
+    for (index = 0; index < TEST_MW_MESSAGE_COUNT && pWriter->result == dripc_result_success; ++index) {
+        dripc_buffer buffer;
+        buffer.pData       = pMessage;
+        buffer.sizeInBytes = test_mw_get_message_size(pWriter->writerID, index);
+        test_mw_fill_message(pMessage, buffer.sizeInBytes, pWriter->writerID, index);
+
+        pWriter->result = drpipe_send_message(pWriter->pipe, &buffer, 1);
+    }
+
+    free(pMessage);
+    return NULL;
+}
+
+// Two handles in the same process writing large messages to the same FIFO at the same time. Each message has to come
+// out whole, in order with the other messages from its writer, and with nothing from the other writer mixed into it.
+static int test_multi_writer_two_handles(void)
+{
+    drpipe reader;
+    test_mw_writer writers[2];
+    pthread_t threads[2];
+    unsigned int nextIndex[2] = {0, 0};
+    unsigned char* pReceived = (unsigned char*)malloc(TEST_MW_MAX_SIZE);
+    unsigned char* pExpected = (unsigned char*)malloc(TEST_MW_MAX_SIZE);
+    unsigned int iWriter;
+    unsigned int iMessage;
+
+    TEST_CHECK(pReceived != NULL && pExpected != NULL);
+
+    // Opening the reader for both reading and writing means the writers' opens don't have to wait for it.
+    TEST_CHECK(drpipe_open_named_server("dr_ipc_test_mw", DR_IPC_READ | DR_IPC_WRITE, &reader) == dripc_result_success);
+    TEST_CHECK(drpipe_enable_multi_writer(reader) == dripc_result_success);
+
+    for (iWriter = 0; iWriter < 2; ++iWriter) {
+        writers[iWriter].writerID = iWriter;
+        TEST_CHECK(drpipe_open_named_client("dr_ipc_test_mw", DR_IPC_WRITE, &writers[iWriter].pipe) == dripc_result_success);
+        TEST_CHECK(drpipe_enable_multi_writer(writers[iWriter].pipe) == dripc_result_success);
+    }
+
+    for (iWriter = 0; iWriter < 2; ++iWriter) {
+        TEST_CHECK(pthread_create(&threads[iWriter], NULL, test_mw_writer_thread, &writers[iWriter]) == 0);
+    }
+
+    for (iMessage = 0; iMessage < 2*TEST_MW_MESSAGE_COUNT; ++iMessage) {
+        dripc_buffer buffer;
+        size_t messageSize;
+        unsigned int writerID;
+        unsigned int index;
+
+        buffer.pData       = pReceived;
+        buffer.sizeInBytes = TEST_MW_MAX_SIZE;
+        TEST_CHECK(drpipe_recv_message(reader, &buffer, 1, &messageSize) == dripc_result_success);
+        TEST_CHECK(messageSize >= 8);
+
+        memcpy(&writerID, pReceived + 0, 4);
+        memcpy(&index,    pReceived + 4, 4);
+        TEST_CHECK(writerID < 2);
+        TEST_CHECK(index == nextIndex[writerID]);
+        TEST_CHECK(messageSize == test_mw_get_message_size(writerID, index));
+
+        test_mw_fill_message(pExpected, messageSize, writerID, index);
+        TEST_CHECK(memcmp(pReceived, pExpected, messageSize) == 0);
+
+        nextIndex[writerID] += 1;
+    }
+
+    for (iWriter = 0; iWriter < 2; ++iWriter) {
+        pthread_join(threads[iWriter], NULL);
+        TEST_CHECK(writers[iWriter].result == dripc_result_success);
+        drpipe_close(writers[iWriter].pipe);
+    }
+
+    drpipe_close(reader);
+    free(pReceived);
+    free(pExpected);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Capture
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_CAPTURE_PATH   "/tmp/dr_ipc_test_capture.bin"
+
+static int test_read_capture_header(drpipe_capture_header* pHeader)
+{
+    FILE* pFile = fopen(TEST_CAPTURE_PATH, "rb");
+    size_t bytesRead;
+
+    TEST_CHECK(pFile != NULL);
+    bytesRead = fread(pHeader, 1, sizeof(*pHeader), pFile);
+    fclose(pFile);
+    TEST_CHECK(bytesRead == sizeof(*pHeader));
+    return 0;
+}
+
+// Records are staged in memory before they reach the file, and the header must only ever count what the file actually
+// holds. Each record here is a 16 byte drpipe_capture_record plus 5 bytes of data padded to 8.
+static int test_capture_counts(void)
+{
+    drpipe readPipe;
+    drpipe writePipe;
+    drpipe_capture_header header;
+    char data[8];
+    int iRecord;
+
+    TEST_CHECK(drpipe_open_anonymous(&readPipe, &writePipe) == dripc_result_success);
+    TEST_CHECK(drpipe_start_capture(writePipe, TEST_CAPTURE_PATH, 1024*1024) == dripc_result_success);
+
+    for (iRecord = 0; iRecord < 5; ++iRecord) {
+        TEST_CHECK(drpipe_write(writePipe, "hello", 5, NULL) == dripc_result_success);
+        TEST_CHECK(drpipe_read_exact(readPipe, data, 5, NULL) == dripc_result_success);
+    }
+
+    TEST_CHECK(test_read_capture_header(&header) == 0);
+    TEST_CHECK(header.magic == DR_IPC_CAPTURE_MAGIC);
+    TEST_CHECK(header.recordCount == 0 && header.dataSize == 0);
+
+    TEST_CHECK(drpipe_stop_capture(writePipe) == dripc_result_success);
+    TEST_CHECK(test_read_capture_header(&header) == 0);
+    TEST_CHECK(header.recordCount == 5 && header.dataSize == 5*24);
+    TEST_CHECK(header.recordsDropped == 0);
+
+    drpipe_close(readPipe);
+    drpipe_close(writePipe);
+    unlink(TEST_CAPTURE_PATH);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// RPC
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_RPC_CALL_COUNT 1000
+
+typedef struct
+{
+    int expected;
+    int response;
+    dripc_result result;
+    unsigned int completionOrder;
+} test_rpc_pending_call;
+
+static unsigned int g_TestRPCCompletionCount = 0;
+
+static void test_rpc_on_response(dripc_rpc rpc, dripc_result result, const void* pResponse, size_t responseSize, void* pUserData)
+{
+    test_rpc_pending_call* pCall = (test_rpc_pending_call*)pUserData;
+
+    (void)rpc;
+
+    pCall->result = result;
+    pCall->completionOrder = g_TestRPCCompletionCount++;
+    if (result == dripc_result_success && responseSize == sizeof(pCall->response)) {
+        memcpy(&pCall->response, pResponse, sizeof(pCall->response));
+    }
+}
+
+// The server side, which runs in the child. It answers the first two requests in the opposite order to how they came
+// in, with a delay in between, and then doubles the value in every other request as it arrives.
+static int test_rpc_serve(drsocket listener)
+{
+    drpipe server;
+    dripc_rpc rpc;
+    int values[2];
+    unsigned long long requestIDs[2];
+    size_t requestSize;
+    unsigned int iCall;
+
+    TEST_CHECK(drsocket_accept(listener, 0, &server) == dripc_result_success);
+    TEST_CHECK(dripc_rpc_open(server, 0, 0, &rpc) == dripc_result_success);
+
+    for (iCall = 0; iCall < 2; ++iCall) {
+        TEST_CHECK(dripc_rpc_recv_request(rpc, &values[iCall], sizeof(values[iCall]), &requestSize, &requestIDs[iCall]) == dripc_result_success);
+        TEST_CHECK(requestSize == sizeof(values[iCall]));
+        values[iCall] *= 2;
+    }
+
+    TEST_CHECK(dripc_rpc_send_response(rpc, requestIDs[1], &values[1], sizeof(values[1])) == dripc_result_success);
+    usleep(100000);
+    TEST_CHECK(dripc_rpc_send_response(rpc, requestIDs[0], &values[0], sizeof(values[0])) == dripc_result_success);
+
+    for (iCall = 0; iCall < TEST_RPC_CALL_COUNT; ++iCall) {
+        TEST_CHECK(dripc_rpc_recv_request(rpc, &values[0], sizeof(values[0]), &requestSize, &requestIDs[0]) == dripc_result_success);
+        values[0] *= 2;
+        TEST_CHECK(dripc_rpc_send_response(rpc, requestIDs[0], &values[0], sizeof(values[0])) == dripc_result_success);
+    }
+
+    dripc_rpc_close(rpc);
+    drpipe_close(server);
+    return 0;
+}
+
+// Responses that come back out of order have to be matched to the right callback, and a blocking call made straight
+// afterwards must still return.
+static int test_rpc_out_of_order(void)
+{
+    drsocket listener;
+    drpipe client;
+    dripc_rpc rpc;
+    test_rpc_pending_call calls[2];
+    int request;
+    int response;
+    size_t responseSize;
+    unsigned int iCall;
+    pid_t pid;
+
+    TEST_CHECK(drsocket_listen("dr_ipc_test_rpc", 0, 0, &listener) == dripc_result_success);
+
+    pid = fork();
+    TEST_CHECK(pid != -1);
+    if (pid == 0) {
+        _exit(test_rpc_serve(listener));
+    }
+
+    TEST_CHECK(drsocket_connect("dr_ipc_test_rpc", 0, &client) == dripc_result_success);
+    TEST_CHECK(dripc_rpc_open(client, 2, 0, &rpc) == dripc_result_success);
+
+    g_TestRPCCompletionCount = 0;
+    for (iCall = 0; iCall < 2; ++iCall) {
+        request = (int)iCall + 1;
+        calls[iCall].expected = request*2;
+        calls[iCall].response = 0;
+        calls[iCall].result   = dripc_result_would_block;
+        TEST_CHECK(dripc_rpc_call_async(rpc, &request, sizeof(request), test_rpc_on_response, &calls[iCall], NULL) == dripc_result_success);
+    }
+
+    while (dripc_rpc_get_calls_in_flight(rpc) > 0) {
+        TEST_CHECK(dripc_rpc_pump(rpc) == dripc_result_success);
+    }
+
+    for (iCall = 0; iCall < 2; ++iCall) {
+        TEST_CHECK(calls[iCall].result == dripc_result_success);
+        TEST_CHECK(calls[iCall].response == calls[iCall].expected);
+    }
+    TEST_CHECK(calls[1].completionOrder == 0 && calls[0].completionOrder == 1);
+
+    for (iCall = 0; iCall < TEST_RPC_CALL_COUNT; ++iCall) {
+        request = (int)iCall;
+        TEST_CHECK(dripc_rpc_call(rpc, &request, sizeof(request), &response, sizeof(response), &responseSize) == dripc_result_success);
+        TEST_CHECK(responseSize == sizeof(response) && response == request*2);
+    }
+
+    TEST_CHECK(test_wait_for_child(pid));
+
+    dripc_rpc_close(rpc);
+    drpipe_close(client);
+    drsocket_close(listener);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Processes
+//
+///////////////////////////////////////////////////////////////////////////////
+
+// Data written to a child's stdin comes back on its stdout, the child sees end-of-stream once the parent closes its
+// end, and exit codes are passed through.
+static int test_spawn(void)
+{
+    dripc_process process;
+    dripc_spawn_fd fds[2];
+    const char* const args[] = {"sh", "-c", "exit 7", NULL};
+    char data[8];
+    size_t bytesRead;
+    int exitCode;
+
+    fds[0].childFD = 0;
+    fds[0].options = DR_IPC_READ;
+    fds[0].pipe    = NULL;
+    fds[1].childFD = 1;
+    fds[1].options = DR_IPC_WRITE;
+    fds[1].pipe    = NULL;
+    TEST_CHECK(dripc_spawn("cat", NULL, NULL, fds, 2, &process) == dripc_result_success);
+
+    TEST_CHECK(drpipe_write(fds[0].parentPipe, "hello", 5, NULL) == dripc_result_success);
+    drpipe_close(fds[0].parentPipe);
+
+    TEST_CHECK(drpipe_read_exact(fds[1].parentPipe, data, 5, &bytesRead) == dripc_result_success);
+    TEST_CHECK(memcmp(data, "hello", 5) == 0);
+    TEST_CHECK(drpipe_read(fds[1].parentPipe, data, sizeof(data), &bytesRead) == dripc_result_success && bytesRead == 0);
+
+    TEST_CHECK(dripc_process_wait(process, DR_IPC_INFINITE, &exitCode) == dripc_result_success);
+    TEST_CHECK(exitCode == 0);
+    drpipe_close(fds[1].parentPipe);
+    dripc_process_close(process);
+
+    TEST_CHECK(dripc_spawn("/bin/sh", args, NULL, NULL, 0, &process) == dripc_result_success);
+    TEST_CHECK(dripc_process_wait(process, 5000, &exitCode) == dripc_result_success);
+    TEST_CHECK(exitCode == 7);
+    dripc_process_close(process);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Asynchronous I/O
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_HANGUP_WRITE_SIZE  (1024*1024)
+
+typedef struct
+{
+    unsigned int completedCount;
+    dripc_result results[3];
+} test_hangup_writes;
+
+static void test_hangup_on_write(dripc_io_context context, drpipe pipe, dripc_result result, size_t bytesTransferred, void* pUserData)
+{
+    test_hangup_writes* pWrites = (test_hangup_writes*)pUserData;
+
+    (void)context;
+    (void)pipe;
+    (void)bytesTransferred;
+
+    pWrites->results[pWrites->completedCount++] = result;
+}
+
+// Queues writes to a pipe whose other end has already been closed. Every one of them has to complete as disconnected,
+// and none may raise SIGPIPE, which would kill this process.
+static int test_hangup_writes_fail(drpipe readPipe, drpipe writePipe, const void* pData)
+{
+    dripc_io_context context;
+    test_hangup_writes writes;
+    size_t completionCount;
+    unsigned int iWrite;
+
+    writes.completedCount = 0;
+    TEST_CHECK(dripc_io_context_open(8, DR_IPC_NO_IO_URING, &context) == dripc_result_success);
+
+    drpipe_close(readPipe);
+    for (iWrite = 0; iWrite < 3; ++iWrite) {
+        TEST_CHECK(drpipe_write_async(context, writePipe, pData, TEST_HANGUP_WRITE_SIZE, test_hangup_on_write, &writes) == dripc_result_success);
+    }
+
+    while (writes.completedCount < 3) {
+        TEST_CHECK(dripc_io_context_run(context, 2000, &completionCount) == dripc_result_success);
+    }
+
+    for (iWrite = 0; iWrite < 3; ++iWrite) {
+        TEST_CHECK(writes.results[iWrite] == dripc_result_disconnected);
+    }
+
+    dripc_io_context_close(context);
+    drpipe_close(writePipe);
+    return 0;
+}
+
+static int test_async_write_hangup(void)
+{
+    drsocket listener;
+    drpipe readPipe;
+    drpipe writePipe;
+    void* pData = calloc(1, TEST_HANGUP_WRITE_SIZE);
+
+    TEST_CHECK(pData != NULL);
+
+    TEST_CHECK(drpipe_open_anonymous(&readPipe, &writePipe) == dripc_result_success);
+    TEST_CHECK(test_hangup_writes_fail(readPipe, writePipe, pData) == 0);
+
+    TEST_CHECK(test_open_socket_pair("dr_ipc_test_hangup", &listener, &writePipe, &readPipe) == 0);
+    TEST_CHECK(test_hangup_writes_fail(readPipe, writePipe, pData) == 0);
+    drsocket_close(listener);
+
+    free(pData);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Shared Memory Rings
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_RING_CHUNK_COUNT   20000
+#define TEST_RING_CHUNK_SIZE    1000
+
+static unsigned char test_ring_get_byte(size_t position)
+{
+    return (unsigned char)(position/TEST_RING_CHUNK_SIZE + position%TEST_RING_CHUNK_SIZE);
+}
+
+static int test_ring_produce(drshm_ring ring)
+{
+    unsigned char chunk[TEST_RING_CHUNK_SIZE];
+    size_t iChunk;
+    size_t i;
+
+    for (iChunk = 0; iChunk < TEST_RING_CHUNK_COUNT; ++iChunk) {
+        for (i = 0; i < TEST_RING_CHUNK_SIZE; ++i) {
+            chunk[i] = test_ring_get_byte(iChunk*TEST_RING_CHUNK_SIZE + i);
+        }
+        TEST_CHECK(drshm_ring_write(ring, chunk, sizeof(chunk), NULL) == dripc_result_success);
+    }
+
+    drshm_ring_close(ring);
+    return 0;
+}
+
+// A child writes a stream through a ring that is much smaller than it so both sides have to keep waiting on each other.
+// The parent reads it back in pieces of a different size and then sees end-of-stream once the child closes its end.
+static int test_ring_stream(void)
+{
+    drshm_ring readRing;
+    drshm_ring writeRing;
+    unsigned char data[777];
+    size_t position = 0;
+    size_t bytesRead;
+    size_t i;
+    pid_t pid;
+
+    TEST_CHECK(drshm_ring_open_anonymous(5000, &readRing, &writeRing) == dripc_result_success);
+
+    pid = fork();
+    TEST_CHECK(pid != -1);
+    if (pid == 0) {
+        drshm_ring_close(readRing);
+        _exit(test_ring_produce(writeRing));
+    }
+    drshm_ring_close(writeRing);
+
+    for (;;) {
+        TEST_CHECK(drshm_ring_read(readRing, data, sizeof(data), &bytesRead) == dripc_result_success);
+        if (bytesRead == 0) {
+            break;
+        }
+
+        for (i = 0; i < bytesRead; ++i) {
+            TEST_CHECK(data[i] == test_ring_get_byte(position + i));
+        }
+        position += bytesRead;
+    }
+
+    TEST_CHECK(position == TEST_RING_CHUNK_COUNT*TEST_RING_CHUNK_SIZE);
+    TEST_CHECK(test_wait_for_child(pid));
+    drshm_ring_close(readRing);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Shared Memory Queues
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_QUEUE_PRODUCER_COUNT   4
+#define TEST_QUEUE_CONSUMER_COUNT   3
+#define TEST_QUEUE_ITEM_COUNT       50000  // Per producer.
+
+typedef struct
+{
+    drshm_queue queue;
+    unsigned char* pSeen;   // TEST_QUEUE_ITEM_COUNT entries for each producer.
+    int result;
+} test_queue_consumer;
+
+static int test_queue_produce(unsigned int producerID)
+{
+    drshm_queue queue;
+    unsigned int item[2];
+
+    TEST_CHECK(drshm_queue_open_named_client("dr_ipc_test_queue", &queue) == dripc_result_success);
+
+    item[0] = producerID;
+    for (item[1] = 0; item[1] < TEST_QUEUE_ITEM_COUNT; ++item[1]) {
+        TEST_CHECK(drshm_queue_push(queue, item, sizeof(item)) == dripc_result_success);
+    }
+
+    drshm_queue_close(queue);
+    return 0;
+}
+
+// Pops until an empty message arrives. The items of any one producer come out of the queue in the order they were
+// pushed, so each consumer must see them in increasing order even though it only gets some of them.
+static int test_queue_consume(test_queue_consumer* pConsumer)
+{
+    unsigned int item[4];
+    unsigned int nextItem[TEST_QUEUE_PRODUCER_COUNT];
+    size_t itemSize;
+
+    memset(nextItem, 0, sizeof(nextItem));
+
+    for (;;) {
+        TEST_CHECK(drshm_queue_pop(pConsumer->queue, item, sizeof(item), &itemSize) == dripc_result_success);
+        if (itemSize == 0) {
+            break;
+        }
+
+        TEST_CHECK(itemSize == 2*sizeof(unsigned int));
+        TEST_CHECK(item[0] < TEST_QUEUE_PRODUCER_COUNT && item[1] < TEST_QUEUE_ITEM_COUNT);
+        TEST_CHECK(item[1] >= nextItem[item[0]]);
+
+        nextItem[item[0]] = item[1] + 1;
+        pConsumer->pSeen[item[0]*TEST_QUEUE_ITEM_COUNT + item[1]] += 1;
+    }
+
+    return 0;
+}
+
+static void* test_queue_consumer_thread(void* pUserData)
+{
+    test_queue_consumer* pConsumer = (test_queue_consumer*)pUserData;
+    pConsumer->result = test_queue_consume(pConsumer);
+    return NULL;
+}
+
+// Producers in several processes and consumers on several threads share a queue that is small enough for both pushes
+// and pops to have to wait. Every item must be received exactly once.
+static int test_queue_mpmc(void)
+{
+    drshm_queue queue;
+    test_queue_consumer consumers[TEST_QUEUE_CONSUMER_COUNT];
+    pthread_t threads[TEST_QUEUE_CONSUMER_COUNT];
+    pid_t pids[TEST_QUEUE_PRODUCER_COUNT];
+    unsigned int iConsumer;
+    unsigned int iProducer;
+    size_t iItem;
+
+    TEST_CHECK(drshm_queue_open_named_server("dr_ipc_test_queue", 8, 64, &queue) == dripc_result_success);
+
+    for (iConsumer = 0; iConsumer < TEST_QUEUE_CONSUMER_COUNT; ++iConsumer) {
+        consumers[iConsumer].queue  = queue;
+        consumers[iConsumer].pSeen  = (unsigned char*)calloc(TEST_QUEUE_PRODUCER_COUNT, TEST_QUEUE_ITEM_COUNT);
+        consumers[iConsumer].result = 1;
+        TEST_CHECK(consumers[iConsumer].pSeen != NULL);
+        TEST_CHECK(pthread_create(&threads[iConsumer], NULL, test_queue_consumer_thread, &consumers[iConsumer]) == 0);
+    }
+
+    for (iProducer = 0; iProducer < TEST_QUEUE_PRODUCER_COUNT; ++iProducer) {
+        pids[iProducer] = fork();
+        TEST_CHECK(pids[iProducer] != -1);
+        if (pids[iProducer] == 0) {
+            _exit(test_queue_produce(iProducer));
+        }
+    }
+
+    for (iProducer = 0; iProducer < TEST_QUEUE_PRODUCER_COUNT; ++iProducer) {
+        TEST_CHECK(test_wait_for_child(pids[iProducer]));
+    }
+
+    // One empty message for each consumer to tell it to stop.
+    for (iConsumer = 0; iConsumer < TEST_QUEUE_CONSUMER_COUNT; ++iConsumer) {
+        TEST_CHECK(drshm_queue_push(queue, NULL, 0) == dripc_result_success);
+    }
+
+    for (iConsumer = 0; iConsumer < TEST_QUEUE_CONSUMER_COUNT; ++iConsumer) {
+        pthread_join(threads[iConsumer], NULL);
+        TEST_CHECK(consumers[iConsumer].result == 0);
+    }
+
+    for (iItem = 0; iItem < TEST_QUEUE_PRODUCER_COUNT*TEST_QUEUE_ITEM_COUNT; ++iItem) {
+        unsigned int seenCount = 0;
+        for (iConsumer = 0; iConsumer < TEST_QUEUE_CONSUMER_COUNT; ++iConsumer) {
+            seenCount += consumers[iConsumer].pSeen[iItem];
+        }
+        TEST_CHECK(seenCount == 1);
+    }
+
+    for (iConsumer = 0; iConsumer < TEST_QUEUE_CONSUMER_COUNT; ++iConsumer) {
+        free(consumers[iConsumer].pSeen);
+    }
+
+    drshm_queue_close(queue);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Shared Memory Arenas
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_ARENA_THREAD_COUNT     8
+#define TEST_ARENA_OPERATION_COUNT  100000
+#define TEST_ARENA_SLOT_COUNT       64
+
+typedef struct
+{
+    drshm_arena arena;
+    unsigned int workerIndex;
+    int result;
+} test_arena_worker;
+
+static size_t test_arena_get_size(unsigned int slot)
+{
+    return (size_t)64 << (slot % 6);
+}
+
+// Randomly allocates into and frees from a set of slots. Each allocation is filled with a byte unique to this thread
+// and slot which has to still be there when it's freed, so two threads being handed overlapping blocks is caught.
+static int test_arena_work(test_arena_worker* pWorker)
+{
+    size_t offsets[TEST_ARENA_SLOT_COUNT];
+    unsigned int seed = pWorker->workerIndex + 1;
+    unsigned int iOperation;
+    unsigned int slot;
+
+    memset(offsets, 0, sizeof(offsets));
+
+    for (iOperation = 0; iOperation < TEST_ARENA_OPERATION_COUNT; ++iOperation) {
+        unsigned char fill;
+        size_t size;
+
+        slot = test_next_random(&seed) % TEST_ARENA_SLOT_COUNT;
+        fill = (unsigned char)(pWorker->workerIndex*TEST_ARENA_SLOT_COUNT + slot);
+        size = test_arena_get_size(slot);
+
+        if (offsets[slot] != 0) {
+            const unsigned char* pData = (const unsigned char*)drshm_arena_get_pointer(pWorker->arena, offsets[slot]);
+            size_t i;
+
+            TEST_CHECK(pData != NULL);
+            for (i = 0; i < size; ++i) {
+                TEST_CHECK(pData[i] == fill);
+            }
+
+            TEST_CHECK(drshm_arena_free(pWorker->arena, offsets[slot]) == dripc_result_success);
+            offsets[slot] = 0;
+        } else {
+            dripc_result result = drshm_arena_alloc(pWorker->arena, size, &offsets[slot]);
+            if (result == dripc_result_out_of_memory) {
+                offsets[slot] = 0;
+                continue;
+            }
+
+            TEST_CHECK(result == dripc_result_success);
+            memset(drshm_arena_get_pointer(pWorker->arena, offsets[slot]), fill, size);
+        }
+    }
+
+    for (slot = 0; slot < TEST_ARENA_SLOT_COUNT; ++slot) {
+        if (offsets[slot] != 0) {
+            TEST_CHECK(drshm_arena_free(pWorker->arena, offsets[slot]) == dripc_result_success);
+        }
+    }
+
+    return 0;
+}
+
+static void* test_arena_worker_thread(void* pUserData)
+{
+    test_arena_worker* pWorker = (test_arena_worker*)pUserData;
+    pWorker->result = test_arena_work(pWorker);
+    return NULL;
+}
+
+// Frees a block that the parent allocated, from another process.
+static int test_arena_free_in_child(drpipe readPipe)
+{
+    drshm_arena arena;
+    size_t offset;
+
+    TEST_CHECK(drshm_arena_open_named_client("dr_ipc_test_arena", &arena) == dripc_result_success);
+    TEST_CHECK(drpipe_read_exact(readPipe, &offset, sizeof(offset), NULL) == dripc_result_success);
+    TEST_CHECK(strcmp((const char*)drshm_arena_get_pointer(arena, offset), "from the parent") == 0);
+    TEST_CHECK(drshm_arena_free(arena, offset) == dripc_result_success);
+
+    drshm_arena_close(arena);
+    return 0;
+}
+
+// A block allocated in one process can be read and freed in another, after which it's handed out again. Then several
+// threads allocate and free concurrently, with the arena small enough that they sometimes run out.
+static int test_arena_concurrent(void)
+{
+    drshm_arena arena;
+    drpipe readPipe;
+    drpipe writePipe;
+    test_arena_worker workers[TEST_ARENA_THREAD_COUNT];
+    pthread_t threads[TEST_ARENA_THREAD_COUNT];
+    size_t offset;
+    size_t reusedOffset;
+    unsigned int iWorker;
+    pid_t pid;
+
+    TEST_CHECK(drshm_arena_open_named_server("dr_ipc_test_arena", 1024*1024, &arena) == dripc_result_success);
+    TEST_CHECK(drpipe_open_anonymous(&readPipe, &writePipe) == dripc_result_success);
+
+    pid = fork();
+    TEST_CHECK(pid != -1);
+    if (pid == 0) {
+        _exit(test_arena_free_in_child(readPipe));
+    }
+
+    TEST_CHECK(drshm_arena_alloc(arena, 4096, &offset) == dripc_result_success);
+    TEST_CHECK(drshm_arena_get_offset(arena, drshm_arena_get_pointer(arena, offset)) == offset);
+    strcpy((char*)drshm_arena_get_pointer(arena, offset), "from the parent");
+    TEST_CHECK(drpipe_write(writePipe, &offset, sizeof(offset), NULL) == dripc_result_success);
+    TEST_CHECK(test_wait_for_child(pid));
+
+    TEST_CHECK(drshm_arena_alloc(arena, 4096, &reusedOffset) == dripc_result_success);
+    TEST_CHECK(reusedOffset == offset);
+    TEST_CHECK(drshm_arena_free(arena, reusedOffset) == dripc_result_success);
+
+    for (iWorker = 0; iWorker < TEST_ARENA_THREAD_COUNT; ++iWorker) {
+        workers[iWorker].arena       = arena;
+        workers[iWorker].workerIndex = iWorker;
+        workers[iWorker].result      = 1;
+        TEST_CHECK(pthread_create(&threads[iWorker], NULL, test_arena_worker_thread, &workers[iWorker]) == 0);
+    }
+
+    for (iWorker = 0; iWorker < TEST_ARENA_THREAD_COUNT; ++iWorker) {
+        pthread_join(threads[iWorker], NULL);
+        TEST_CHECK(workers[iWorker].result == 0);
+    }
+
+    drpipe_close(readPipe);
+    drpipe_close(writePipe);
+    drshm_arena_close(arena);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Shared Memory Broadcasts
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_BROADCAST_READER_COUNT     2
+#define TEST_BROADCAST_MESSAGE_COUNT    200000
+
+// A reader that falls more than a ring's worth behind is told so once and then continues from a newer message, and the
+// number it missed is what it reports as lost.
+static int test_broadcast_overrun(void)
+{
+    drshm_broadcast writer;
+    drshm_broadcast reader;
+    unsigned long long value;
+    char smallBuffer[4];
+    size_t messageSize;
+
+    TEST_CHECK(drshm_broadcast_open_named_server("dr_ipc_test_broadcast", 64, 8, &writer) == dripc_result_success);
+    TEST_CHECK(drshm_broadcast_open_named_client("dr_ipc_test_broadcast", &reader) == dripc_result_success);
+
+    TEST_CHECK(drshm_broadcast_try_receive(reader, &value, sizeof(value), &messageSize) == dripc_result_would_block);
+    TEST_CHECK(drshm_broadcast_publish(reader, &value, sizeof(value)) == dripc_result_invalid_args);
+
+    for (value = 0; value < 30; ++value) {
+        TEST_CHECK(drshm_broadcast_publish(writer, &value, sizeof(value)) == dripc_result_success);
+    }
+
+    TEST_CHECK(drshm_broadcast_try_receive(reader, &value, sizeof(value), &messageSize) == dripc_result_overrun);
+    TEST_CHECK(drshm_broadcast_try_receive(reader, smallBuffer, sizeof(smallBuffer), &messageSize) == dripc_result_too_large);
+    TEST_CHECK(messageSize == sizeof(value));
+    TEST_CHECK(drshm_broadcast_receive(reader, &value, sizeof(value), &messageSize) == dripc_result_success);
+    TEST_CHECK(value >= 30 - 8 && value < 30);
+    TEST_CHECK(drshm_broadcast_get_messages_lost(reader) == value);
+
+    drshm_broadcast_close(reader);
+    drshm_broadcast_close(writer);
+    return 0;
+}
+
+// Receives until the final message. The reader attaches before anything is published, so every value up to the final
+// one has to be accounted for as either received or lost, and each value received has to be the next one after those.
+static int test_broadcast_receive_all(drpipe readyPipe)
+{
+    drshm_broadcast reader;
+    unsigned long long value;
+    unsigned long long receivedCount = 0;
+    size_t messageSize;
+
+    TEST_CHECK(drshm_broadcast_open_named_client("dr_ipc_test_broadcast", &reader) == dripc_result_success);
+    TEST_CHECK(drpipe_write(readyPipe, "r", 1, NULL) == dripc_result_success);
+
+    for (;;) {
+        dripc_result result = drshm_broadcast_receive(reader, &value, sizeof(value), &messageSize);
+        if (result == dripc_result_overrun) {
+            continue;
+        }
+
+        TEST_CHECK(result == dripc_result_success);
+        TEST_CHECK(messageSize == sizeof(value));
+        TEST_CHECK(value == receivedCount + drshm_broadcast_get_messages_lost(reader));
+
+        if (value == TEST_BROADCAST_MESSAGE_COUNT) {
+            break;
+        }
+
+        receivedCount += 1;
+    }
+
+    drshm_broadcast_close(reader);
+    return 0;
+}
+
+// One writer and readers in other processes that keep up as best they can. The value TEST_BROADCAST_MESSAGE_COUNT is
+// published last to tell them to stop.
+static int test_broadcast_multi_process(void)
+{
+    drshm_broadcast writer;
+    drpipe readyRead;
+    drpipe readyWrite;
+    pid_t pids[TEST_BROADCAST_READER_COUNT];
+    unsigned long long value;
+    unsigned int iReader;
+    char ready;
+
+    TEST_CHECK(drshm_broadcast_open_named_server("dr_ipc_test_broadcast", 64, 1024, &writer) == dripc_result_success);
+    TEST_CHECK(drpipe_open_anonymous(&readyRead, &readyWrite) == dripc_result_success);
+
+    for (iReader = 0; iReader < TEST_BROADCAST_READER_COUNT; ++iReader) {
+        pids[iReader] = fork();
+        TEST_CHECK(pids[iReader] != -1);
+        if (pids[iReader] == 0) {
+            _exit(test_broadcast_receive_all(readyWrite));
+        }
+    }
+
+    for (iReader = 0; iReader < TEST_BROADCAST_READER_COUNT; ++iReader) {
+        TEST_CHECK(drpipe_read_exact(readyRead, &ready, 1, NULL) == dripc_result_success);
+    }
+
+    for (value = 0; value <= TEST_BROADCAST_MESSAGE_COUNT; ++value) {
+        TEST_CHECK(drshm_broadcast_publish(writer, &value, sizeof(value)) == dripc_result_success);
+    }
+
+    for (iReader = 0; iReader < TEST_BROADCAST_READER_COUNT; ++iReader) {
+        TEST_CHECK(test_wait_for_child(pids[iReader]));
+    }
+
+    drpipe_close(readyRead);
+    drpipe_close(readyWrite);
+    drshm_broadcast_close(writer);
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Shared Memory Latest Values
+//
+///////////////////////////////////////////////////////////////////////////////
+#define TEST_LATEST_READER_COUNT    3
+#define TEST_LATEST_PUBLISH_COUNT   1000000
+#define TEST_LATEST_MAX_WORDS       256
+
+typedef struct
+{
+    volatile int* pIsDone;
+    int result;
+} test_latest_reader;
+
+// Version N is N repeated a number of times that depends on N.
+static size_t test_latest_get_word_count(unsigned long long version)
+{
+    return 1 + (size_t)(version % TEST_LATEST_MAX_WORDS);
+}
+
+// Keeps reading while the value is being replaced. A read that mixes two versions, or goes back to an older one, is a
+// failure of the sequence lock.
+static int test_latest_read_all(test_latest_reader* pReader)
+{
+    drshm_latest latest;
+    unsigned int words[TEST_LATEST_MAX_WORDS];
+    unsigned long long version;
+    unsigned long long lastVersion = 0;
+    size_t valueSize;
+    size_t i;
+
+    TEST_CHECK(drshm_latest_open_named_client("dr_ipc_test_latest", &latest) == dripc_result_success);
+
+    while (!*pReader->pIsDone) {
+        dripc_result result = drshm_latest_read(latest, words, sizeof(words), &valueSize, &version);
+        if (result == dripc_result_would_block) {
+            continue;
+        }
+
+        TEST_CHECK(result == dripc_result_success);
+        TEST_CHECK(version >= lastVersion);
+        TEST_CHECK(valueSize == test_latest_get_word_count(version)*sizeof(words[0]));
+        for (i = 0; i < valueSize/sizeof(words[0]); ++i) {
+            TEST_CHECK(words[i] == (unsigned int)version);
+        }
+
+        lastVersion = version;
+    }
+
+    drshm_latest_close(latest);
+    return 0;
+}
+
+static void* test_latest_reader_thread(void* pUserData)
+{
+    test_latest_reader* pReader = (test_latest_reader*)pUserData;
+    pReader->result = test_latest_read_all(pReader);
+    return NULL;
+}
+
+static int test_latest_consistency(void)
+{
+    drshm_latest latest;
+    test_latest_reader readers[TEST_LATEST_READER_COUNT];
+    pthread_t threads[TEST_LATEST_READER_COUNT];
+    unsigned int words[TEST_LATEST_MAX_WORDS];
+    volatile int isDone = 0;
+    unsigned int version;
+    unsigned int iReader;
+    size_t wordCount;
+    size_t i;
+
+    TEST_CHECK(drshm_latest_open_named_server("dr_ipc_test_latest", sizeof(words), &latest) == dripc_result_success);
+    TEST_CHECK(drshm_latest_publish(latest, words, sizeof(words) + 1) == dripc_result_too_large);
+
+    for (iReader = 0; iReader < TEST_LATEST_READER_COUNT; ++iReader) {
+        readers[iReader].pIsDone = &isDone;
+        readers[iReader].result  = 1;
+        TEST_CHECK(pthread_create(&threads[iReader], NULL, test_latest_reader_thread, &readers[iReader]) == 0);
+    }
+
+    for (version = 1; version <= TEST_LATEST_PUBLISH_COUNT; ++version) {
+        wordCount = test_latest_get_word_count(version);
+        for (i = 0; i < wordCount; ++i) {
+            words[i] = version;
+        }
+        TEST_CHECK(drshm_latest_publish(latest, words, wordCount*sizeof(words[0])) == dripc_result_success);
+    }
+    isDone = 1;
+
+    for (iReader = 0; iReader < TEST_LATEST_READER_COUNT; ++iReader) {
+        pthread_join(threads[iReader], NULL);
+        TEST_CHECK(readers[iReader].result == 0);
+    }
+
+    TEST_CHECK(drshm_latest_get_version(latest) == TEST_LATEST_PUBLISH_COUNT);
+    drshm_latest_close(latest);
+    return 0;
+}
+
+
+static const test_case g_Tests[] = {
+    {"socket_echo",              test_socket_echo},
+    {"fd_passing",               test_fd_passing},
+    {"fd_passing_truncated",     test_fd_passing_truncated},
+    {"named_pipe_timed_connect", test_named_pipe_timed_connect},
+    {"read_batch",               test_read_batch},
+    {"multi_writer_two_handles", test_multi_writer_two_handles},
+    {"capture_counts",           test_capture_counts},
+    {"rpc_out_of_order",         test_rpc_out_of_order},
+    {"spawn",                    test_spawn},
+    {"async_write_hangup",       test_async_write_hangup},
+    {"ring_stream",              test_ring_stream},
+    {"queue_mpmc",               test_queue_mpmc},
+    {"arena_concurrent",         test_arena_concurrent},
+    {"broadcast_overrun",        test_broadcast_overrun},
+    {"broadcast_multi_process",  test_broadcast_multi_process},
+    {"latest_consistency",       test_latest_consistency}
+};
+
+static int test_is_selected(const char* name, int argc, char** argv)
+{
+    int iArg;
+
+    if (argc < 2) {
+        return 1;
+    }
+
+    for (iArg = 1; iArg < argc; ++iArg) {
+        if (strncmp(name, argv[iArg], strlen(argv[iArg])) == 0) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    int failedCount = 0;
+    size_t iTest;
+
+    setvbuf(stdout, NULL, _IONBF, 0);
+
+    for (iTest = 0; iTest < sizeof(g_Tests) / sizeof(g_Tests[0]); ++iTest) {
+        if (!test_is_selected(g_Tests[iTest].name, argc, argv)) {
+            continue;
+        }
+
+        if (g_Tests[iTest].proc() == 0) {
+            printf("PASS %s\n", g_Tests[iTest].name);
+        } else {
+            printf("FAIL %s\n", g_Tests[iTest].name);
+            failedCount += 1;
+        }
+    }
+
+    return failedCount;
+}